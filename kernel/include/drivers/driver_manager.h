@@ -75,6 +75,7 @@ enum DRIVER_STORAGE_OPERTAION {
     DRIVER_STORAGE_WRITE,
     DRIVER_STORAGE_FLUSH,
     DRIVER_STORAGE_CAPACITY,
+    DRIVER_STORAGE_HANDLE_REQUEST, // optional, serves a block_request_t of the block layer
 };
 
 // Api function of DRIVER_INPUT_SYSTEMS type
@@ -123,6 +124,8 @@ enum DRIVER_FILE_SYSTEM_OPERTAION {
     DRIVER_FILE_SYSTEM_FSTAT,
     DRIVER_FILE_SYSTEM_IOCTL,
     DRIVER_FILE_SYSTEM_MMAP,
+    DRIVER_FILE_SYSTEM_FSYNC,
+    DRIVER_FILE_SYSTEM_SYNC_DEVICE,
 };
 
 typedef struct {
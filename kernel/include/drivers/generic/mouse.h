@@ -7,13 +7,23 @@
 #ifndef _KERNEL_DRIVERS_GENERIC_MOUSE_H
 #define _KERNEL_DRIVERS_GENERIC_MOUSE_H
 
+#include <libkern/types.h>
+
+/* Packets which are not read yet. Motion is merged, so it is filled only by clicks. */
+#define MOUSE_QUEUE_SIZE 128
+
 /* The mouse packet should be aligned to 4 bytes */
 struct mouse_packet {
     int16_t x_offset;
     int16_t y_offset;
     uint16_t button_states;
     int16_t wheel_data;
+    uint32_t time_ms; /* Time of the last merged motion, in ms since boot. */
 };
 typedef struct mouse_packet mouse_packet_t;
 
-#endif //_KERNEL_DRIVERS_GENERIC_MOUSE_H
\ No newline at end of file
+void generic_mouse_init();
+int generic_mouse_create_devfs();
+void generic_mouse_emit(mouse_packet_t* packet);
+
+#endif //_KERNEL_DRIVERS_GENERIC_MOUSE_H
@@ -8,6 +8,7 @@
 #define _KERNEL_FS_EXT2_EXT2_H
 
 #include <libkern/c_attrs.h>
+#include <libkern/lock.h>
 #include <libkern/types.h>
 
 #define SUPERBLOCK_START 1024
@@ -52,12 +53,36 @@ struct PACKED superblock {
 
     uint8_t prealloc_blocks;
     uint8_t prealloc_dir_blocks;
+    uint16_t reserved_gdt_blocks;
 
     // current jurnalling is unsupported
-    uint8_t unused[1024 - 206];
+    uint8_t journal_uuid[16];
+    uint32_t journal_inum;
+    uint32_t journal_dev;
+    uint32_t last_orphan;
+
+    uint32_t hash_seed[4];
+    uint8_t def_hash_version;
+    uint8_t jnl_backup_type;
+    uint16_t desc_size;
+    uint32_t default_mount_opts;
+    uint32_t first_meta_bg;
+    uint32_t mkfs_time;
+    uint32_t jnl_blocks[17];
+    uint32_t blocks_count_hi;
+    uint32_t r_blocks_count_hi;
+    uint32_t free_blocks_count_hi;
+    uint16_t min_extra_isize;
+    uint16_t want_extra_isize;
+    uint32_t flags;
+    uint8_t unused[1024 - 356];
 };
 typedef struct superblock superblock_t;
 
+#define EXT2_FEATURE_COMPAT_DIR_INDEX 0x0020
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002
+#define EXT2_FLAGS_UNSIGNED_HASH 0x0002
+
 #define GROUP_LEN (sizeof(group_desc_t))
 struct PACKED group_desc {
     uint32_t block_bitmap;
@@ -93,6 +118,8 @@ typedef struct group_desc group_desc_t;
 #define S_IWOTH 0x0002
 #define S_IXOTH 0x0001
 
+#define EXT2_INDEX_FL 0x1000
+
 #define INODE_LEN (sizeof(inode_t))
 #define INODES_RESERVED 11
 struct PACKED inode {
@@ -127,6 +154,200 @@ struct PACKED dir_entry {
 };
 typedef struct dir_entry dir_entry_t;
 
+#define EXT2_FT_UNKNOWN 0
+#define EXT2_FT_REG_FILE 1
+#define EXT2_FT_DIR 2
+
+/**
+ * DIRECTORY INDEX
+ * The layout is the one of ext3/4 dir_index. Block 0 of an indexed dir
+ * holds "." and "..", the rec_len of ".." covers the root of the index.
+ * Interior nodes are blocks with a single empty entry covering the node.
+ * Blocks in dx entries are logical blocks of the dir.
+ */
+
+#define EXT2_DX_ROOT_INFO_OFFSET 24
+#define EXT2_DX_ROOT_ENTRIES_OFFSET 32
+#define EXT2_DX_NODE_ENTRIES_OFFSET 8
+#define EXT2_DX_MAX_LEVELS 2
+
+struct PACKED dx_root_info {
+    uint32_t reserved_zero;
+    uint8_t hash_version;
+    uint8_t info_length;
+    uint8_t indirect_levels;
+    uint8_t unused_flags;
+};
+typedef struct dx_root_info dx_root_info_t;
+
+/* Overlays the hash of the first dx entry, which is implicitly 0. */
+struct PACKED dx_countlimit {
+    uint16_t limit;
+    uint16_t count;
+};
+typedef struct dx_countlimit dx_countlimit_t;
+
+struct PACKED dx_entry {
+    uint32_t hash;
+    uint32_t block;
+};
+typedef struct dx_entry dx_entry_t;
+
+/**
+ * A step of a walk down the index: the block, its copy in memory and the
+ * entry which was taken.
+ */
+struct ext2_dx_frame {
+    uint32_t block;
+    uint8_t* buf;
+    dx_entry_t* entries;
+    dx_entry_t* at;
+};
+typedef struct ext2_dx_frame ext2_dx_frame_t;
+
+struct ext2_dx_map_entry {
+    uint32_t hash;
+    uint32_t offset;
+};
+typedef struct ext2_dx_map_entry ext2_dx_map_entry_t;
+
+/**
+ * Unlink gets only the dentry of the child, so lookups remember in which
+ * block of the dir the child was found. A hint is only a guess, it is
+ * checked against the content of the block.
+ */
+#define EXT2_DIR_HINTS 8
+
+struct ext2_dir_hint {
+    uint32_t dir_inode_indx;
+    uint32_t inode_indx;
+    uint32_t block;
+};
+typedef struct ext2_dir_hint ext2_dir_hint_t;
+
+/**
+ * ALLOCATION CACHE
+ */
+
+#define EXT2_PREALLOC_BLOCKS 8
+#define EXT2_PREALLOC_WINDOWS 16
+
+enum EXT2_GROUP_CACHE_FLAGS {
+    EXT2_GROUP_BLOCK_BITMAP_DIRTY = 0x1,
+    EXT2_GROUP_INODE_BITMAP_DIRTY = 0x2,
+};
+
+/**
+ * Bitmaps of a group are read on the first allocation or freeing in the
+ * group and are written back only on flush. Hints hold the offsets from
+ * which a search for a free entry starts.
+ */
+struct ext2_group_cache {
+    uint8_t* block_bitmap;
+    uint8_t* inode_bitmap;
+    uint32_t flags;
+    uint32_t block_hint;
+    uint32_t inode_hint;
+};
+typedef struct ext2_group_cache ext2_group_cache_t;
+
+/**
+ * A preallocation window reserves blocks [next, end) for the inode in
+ * memory only, the blocks are marked in the bitmap when they are taken.
+ */
+struct ext2_prealloc_window {
+    uint32_t inode_indx;
+    uint32_t next;
+    uint32_t end;
+    uint32_t last_used;
+};
+typedef struct ext2_prealloc_window ext2_prealloc_window_t;
+
+/**
+ * Free counters of the group table, which is kept in memory, serve as
+ * summaries, so full groups are skipped without reading their bitmaps.
+ */
+struct ext2_alloc_cache {
+    lock_t lock;
+    ext2_group_cache_t* groups;
+    bool group_table_dirty;
+    uint32_t clock;
+    ext2_prealloc_window_t windows[EXT2_PREALLOC_WINDOWS];
+};
+typedef struct ext2_alloc_cache ext2_alloc_cache_t;
+
+/**
+ * BLOCK MAP CACHE
+ */
+
+#define EXT2_INDIRECT_CACHE_SIZE 64
+#define EXT2_MAP_RUNS 16
+
+/**
+ * A cached indirect block. Changes are written back on flush or when the
+ * entry is replaced.
+ */
+struct ext2_indirect_entry {
+    uint32_t block_index;
+    uint32_t last_used;
+    bool dirty;
+    uint32_t* data;
+};
+typedef struct ext2_indirect_entry ext2_indirect_entry_t;
+
+/**
+ * A run maps @count logical blocks of the inode starting from @logical
+ * to consecutive blocks on the drive starting from @physical.
+ */
+struct ext2_map_run {
+    uint32_t inode_indx;
+    uint32_t logical;
+    uint32_t physical;
+    uint32_t count;
+    uint32_t last_used;
+};
+typedef struct ext2_map_run ext2_map_run_t;
+
+struct ext2_map_cache {
+    lock_t lock;
+    uint32_t clock;
+    ext2_indirect_entry_t indirect[EXT2_INDIRECT_CACHE_SIZE];
+    ext2_map_run_t runs[EXT2_MAP_RUNS];
+};
+typedef struct ext2_map_cache ext2_map_cache_t;
+
+/**
+ * DELAYED ALLOCATION
+ */
+
+#define EXT2_DELALLOC_BUFFERS 8
+#define EXT2_DELALLOC_BUFFER_SIZE (16 * 1024)
+
+struct dentry;
+
+/**
+ * Holds data appended to the end of a file which has not reached the drive
+ * yet. Blocks for it are allocated when the buffer is written back, so a
+ * stream of small appends ends up as a few writes of consecutive blocks.
+ * The buffer keeps a reference to the dentry while it holds data.
+ */
+struct ext2_delalloc_buffer {
+    struct dentry* dentry;
+    uint32_t inode_indx;
+    uint32_t start;
+    uint32_t len;
+    uint32_t last_used;
+    uint8_t* data;
+};
+typedef struct ext2_delalloc_buffer ext2_delalloc_buffer_t;
+
+/* Is protected by the lock of the device. */
+struct ext2_delalloc_cache {
+    uint32_t clock;
+    ext2_delalloc_buffer_t buffers[EXT2_DELALLOC_BUFFERS];
+};
+typedef struct ext2_delalloc_cache ext2_delalloc_cache_t;
+
 void ext2_install();
 
 /* All others apis are avail for VFS throw struct fs_ops_t */
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_FS_EXT2_HASH_H
+#define _KERNEL_FS_EXT2_HASH_H
+
+#include <libkern/types.h>
+
+/* Hash versions of the directory index, as stored in the dx root. */
+enum EXT2_DX_HASH {
+    EXT2_DX_HASH_LEGACY = 0,
+    EXT2_DX_HASH_HALF_MD4 = 1,
+    EXT2_DX_HASH_TEA = 2,
+    EXT2_DX_HASH_LEGACY_UNSIGNED = 3,
+    EXT2_DX_HASH_HALF_MD4_UNSIGNED = 4,
+    EXT2_DX_HASH_TEA_UNSIGNED = 5,
+};
+
+#define EXT2_DX_HASH_EOF 0x7fffffff
+
+/**
+ * Returns the hash of the name as ext3/4 compute it. @seed is 4 words from
+ * the superblock, a zero seed means the default one. The lowest bit of the
+ * result is always clear, the index uses it to mark hash collisions.
+ */
+uint32_t ext2_dx_hash(const char* name, uint32_t len, uint32_t version, const uint32_t* seed);
+
+#endif // _KERNEL_FS_EXT2_HASH_H
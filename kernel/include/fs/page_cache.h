@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_FS_PAGE_CACHE_H
+#define _KERNEL_FS_PAGE_CACHE_H
+
+#include <libkern/types.h>
+
+struct dentry;
+
+struct page_cache_entry {
+    uint32_t index; /* Offset of the page in the file, in pages. */
+    uint32_t paddr;
+    bool mapped; /* The frame was mapped into a process with page_cache_get(). */
+};
+typedef struct page_cache_entry page_cache_entry_t;
+
+/**
+ * Page cache keeps frames with file's data. The frames are owned by the
+ * cache and are mapped read-only into every process which maps the file
+ * sharedly (e.g. text of executables), so they are never freed by vmm.
+ * Entries are sorted by index.
+ */
+struct page_cache {
+    uint32_t count;
+    uint32_t capacity;
+    page_cache_entry_t* entries;
+};
+typedef struct page_cache page_cache_t;
+
+uint32_t page_cache_get(struct dentry* dentry, uint32_t offset);
+bool page_cache_is_cached(struct dentry* dentry, uint32_t offset);
+int page_cache_read(struct dentry* dentry, uint8_t* buf, uint32_t offset, uint32_t len);
+void page_cache_write(struct dentry* dentry, uint8_t* buf, uint32_t offset, uint32_t len);
+void page_cache_truncate(struct dentry* dentry, uint32_t len);
+void page_cache_free(struct dentry* dentry);
+uint32_t page_cache_pages();
+
+#endif // _KERNEL_FS_PAGE_CACHE_H
@@ -36,7 +36,8 @@ struct PACKED procfs_inode {
     /* NOTE: Instead of blocks here, we store procfs required things */
     uint32_t index;
     const struct file_ops* ops;
-    uint8_t padding[52];
+    uint32_t pid; /* Inode indexes of pid files are based on proc slots, which are reused. */
+    uint8_t padding[48];
     /* Block hack ends here */
 
     uint32_t generation;
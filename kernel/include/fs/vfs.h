@@ -54,6 +54,7 @@ typedef struct dirent dirent_t;
 #define DENTRY_INODE_TO_BE_DELETED 0x8
 #define DENTRY_PRIVATE 0x10 /* This dentry can't be opened so can't be copied */
 #define DENTRY_CUSTOM 0x20 /* Such dentries won't be process in dentry.c file */
+#define DENTRY_SIZE_DIRTY 0x40 /* Size or blocks of the inode changed, so fdatasync has to write it. */
 struct dentry {
     uint32_t d_count;
     uint32_t flags;
@@ -70,6 +71,7 @@ struct dentry {
     struct dentry* mounted_dentry;
 
     struct socket* sock;
+    struct page_cache* page_cache;
 };
 typedef struct dentry dentry_t;
 
@@ -99,6 +101,7 @@ struct file_ops {
     int (*ioctl)(dentry_t* dentry, uint32_t cmd, uint32_t arg);
     int (*fstat)(dentry_t* dentry, fstat_t* stat);
     struct proc_zone* (*mmap)(dentry_t* dentry, mmap_params_t* params);
+    int (*fsync)(dentry_t* dentry, bool datasync);
 };
 typedef struct file_ops file_ops_t;
 
@@ -114,6 +117,7 @@ struct fs_ops {
     int (*recognize)(vfs_device_t* dev);
     int (*prepare_fs)(vfs_device_t* dev);
     int (*eject_device)(vfs_device_t* dev);
+    int (*sync_device)(vfs_device_t* dev);
 
     file_ops_t file;
     dentry_ops_t dentry;
@@ -204,6 +208,7 @@ int vfs_add_dev_with_fs(device_t* dev, int fs_id);
 void vfs_add_fs(driver_t* t_new_fs);
 int vfs_get_fs_id(const char* name);
 void vfs_eject_device(device_t* t_new_dev);
+void vfs_sync_devices();
 
 int vfs_resolve_path(const char* path, dentry_t** result);
 int vfs_resolve_path_start_from(dentry_t* dentry, const char* path, dentry_t** result);
@@ -221,6 +226,7 @@ int vfs_mkdir(dentry_t* dir, const char* name, size_t len, mode_t mode);
 int vfs_rmdir(dentry_t* dir);
 int vfs_getdents(file_descriptor_t* dir_fd, uint8_t* buf, uint32_t len);
 int vfs_fstat(file_descriptor_t* fd, fstat_t* stat);
+int vfs_fsync(file_descriptor_t* fd, bool datasync);
 
 int vfs_mount(dentry_t* mountpoint, device_t* dev, uint32_t fs_indx);
 int vfs_umount(dentry_t* mountpoint);
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_IO_BLOCK_BLOCK_H
+#define _KERNEL_IO_BLOCK_BLOCK_H
+
+#include <drivers/driver_manager.h>
+#include <libkern/lock.h>
+#include <libkern/types.h>
+
+#define BLOCK_SECTOR_SIZE 512
+/* Fits the 16-bit data length of PL181 and the 8-bit sector count of ATA. */
+#define BLOCK_MAX_REQUEST_SECTORS 64
+
+/* Deadlines are in timer ticks, reads are preferred since someone waits for them. */
+#define BLOCK_READ_DEADLINE 5
+#define BLOCK_WRITE_DEADLINE 50
+
+enum BIO_FLAGS {
+    BIO_WRITE = 0x1,
+    BIO_DONE = 0x2,
+};
+
+/**
+ * A bio describes a transfer of consecutive sectors to or from a single
+ * buffer. end_io is called once the transfer is finished, status holds
+ * the number of transferred bytes or a negative error.
+ */
+struct bio {
+    device_t* dev;
+    uint32_t sector;
+    uint32_t count;
+    uint8_t* data;
+    uint32_t flags;
+    int status;
+    void (*end_io)(struct bio* bio);
+    void* private;
+    struct bio* next;
+};
+typedef struct bio bio_t;
+
+/**
+ * A request is what a driver gets. It covers consecutive sectors, which
+ * are split between the buffers of the merged bios, in order.
+ */
+struct block_request {
+    uint32_t sector;
+    uint32_t count;
+    bool is_write;
+    uint32_t seq;
+    time_t deadline;
+    bio_t* bio_head;
+    bio_t* bio_tail;
+    struct block_request* next;
+};
+typedef struct block_request block_request_t;
+
+/**
+ * Requests are kept sorted by sector. The elevator serves them in one
+ * direction, unless the oldest request has missed its deadline.
+ */
+struct block_queue {
+    lock_t lock;
+    block_request_t* head;
+    uint32_t next_sector;
+    uint32_t next_seq;
+    int plugged;
+    bool running;
+
+    /* Stat */
+    uint32_t stat_bios;
+    uint32_t stat_merges;
+    uint32_t stat_dispatches;
+};
+typedef struct block_queue block_queue_t;
+
+#define foreach_bio(req) for (bio_t* bio = (req)->bio_head; bio; bio = bio->next)
+
+int block_init();
+
+void bio_init(bio_t* bio, device_t* dev, uint32_t sector, uint32_t count, uint8_t* data, uint32_t flags);
+void block_submit(bio_t* bio);
+int block_wait(bio_t* bio);
+
+void block_plug(device_t* dev);
+void block_unplug(device_t* dev);
+
+int block_read(device_t* dev, uint32_t sector, uint32_t count, uint8_t* data);
+int block_write(device_t* dev, uint32_t sector, uint32_t count, uint8_t* data);
+int block_flush(device_t* dev);
+
+void block_get_stat(uint32_t* bios, uint32_t* merges, uint32_t* dispatches);
+
+#endif /* _KERNEL_IO_BLOCK_BLOCK_H */
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_IO_IORING_IORING_H
+#define _KERNEL_IO_IORING_IORING_H
+
+#include <libkern/bits/ioring.h>
+#include <libkern/types.h>
+
+struct proc;
+
+int ioring_init();
+int ioring_setup(struct proc* p, ioring_t** res);
+int ioring_submit(struct proc* p);
+int ioring_fork(struct proc* new_proc, struct proc* from_proc);
+int ioring_free(struct proc* p);
+
+bool ioring_can_reap(struct proc* p, uint32_t min_complete);
+bool ioring_has_pending_work();
+void ioring_worker();
+
+#endif /* _KERNEL_IO_IORING_IORING_H */
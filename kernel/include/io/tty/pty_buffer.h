@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_IO_TTY_PTY_BUFFER_H
+#define _KERNEL_IO_TTY_PTY_BUFFER_H
+
+#include <algo/sync_ringbuffer.h>
+#include <libkern/types.h>
+
+#define PTY_BUFFER_STD_SIZE (64 * KB)
+#define PTY_BUFFER_MIN_SIZE (4 * KB)
+#define PTY_BUFFER_MAX_SIZE (1 * MB)
+
+/**
+ * A pty buffer carries data in one direction of a pty pair.
+ *
+ * Flow control: once the buffer is filled up to the high watermark, the
+ * writer is throttled and can't write until the reader drains the buffer
+ * down to the low watermark. A writer of a big output is woken once per
+ * half of the buffer instead of once per read.
+ *
+ * Coalescing: with a coalesce window set, the reader isn't woken for new
+ * data until the window has passed since the first byte came in, or the
+ * buffer reached the high watermark.
+ */
+struct pty_buffer {
+    sync_ringbuffer_t ring;
+    uint32_t high_watermark;
+    uint32_t low_watermark;
+    bool throttled;
+    time_t coalesce_ticks;
+    time_t first_pending_tick;
+};
+typedef struct pty_buffer pty_buffer_t;
+
+int pty_buffer_init(pty_buffer_t* buf, uint32_t size);
+void pty_buffer_free(pty_buffer_t* buf);
+int pty_buffer_resize_pair(pty_buffer_t* a, pty_buffer_t* b, uint32_t size);
+void pty_buffer_clear(pty_buffer_t* buf);
+void pty_buffer_set_coalesce(pty_buffer_t* buf, uint32_t ms);
+
+static ALWAYS_INLINE uint32_t pty_buffer_size(pty_buffer_t* buf) { return buf->ring.ringbuffer.zone.len; }
+
+bool pty_buffer_can_read(pty_buffer_t* buf);
+bool pty_buffer_can_write(pty_buffer_t* buf);
+uint32_t pty_buffer_read(pty_buffer_t* buf, uint8_t* data, uint32_t len);
+uint32_t pty_buffer_write(pty_buffer_t* buf, const uint8_t* data, uint32_t len);
+
+#endif
\ No newline at end of file
@@ -7,7 +7,7 @@
 #ifndef _KERNEL_IO_TTY_PTY_MASTER_H
 #define _KERNEL_IO_TTY_PTY_MASTER_H
 
-#include <algo/sync_ringbuffer.h>
+#include <io/tty/pty_buffer.h>
 #include <fs/vfs.h>
 
 #ifndef PTYS_COUNT
@@ -16,7 +16,7 @@
 
 struct pty_slave_entry;
 struct pty_master_entry {
-    sync_ringbuffer_t buffer;
+    pty_buffer_t buffer;
     struct pty_slave_entry* pts;
     dentry_t dentry;
 };
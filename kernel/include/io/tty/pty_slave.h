@@ -7,7 +7,7 @@
 #ifndef _KERNEL_IO_TTY_PTY_SLAVE_H
 #define _KERNEL_IO_TTY_PTY_SLAVE_H
 
-#include <algo/sync_ringbuffer.h>
+#include <io/tty/pty_buffer.h>
 
 #ifndef PTYS_COUNT
 #define PTYS_COUNT 4
@@ -17,7 +17,7 @@ struct pty_master_entry;
 struct pty_slave_entry {
     int inode_indx;
     struct pty_master_entry* ptm;
-    sync_ringbuffer_t buffer;
+    pty_buffer_t buffer;
 };
 typedef struct pty_slave_entry pty_slave_entry_t;
 
@@ -0,0 +1,54 @@
+#ifndef _KERNEL_LIBKERN_BITS_IORING_H
+#define _KERNEL_LIBKERN_BITS_IORING_H
+
+#include <libkern/types.h>
+
+#define IORING_ENTRIES 32 /* Should be a power of 2. */
+#define IORING_SIZE (16 * 1024)
+
+enum IORING_OPS {
+    IORING_OP_NOP = 0,
+    IORING_OP_READ,
+    IORING_OP_WRITE,
+    IORING_OP_IOCTL,
+    IORING_OP_CLOSE,
+};
+
+/**
+ * @addr points to the ring's data area for reads and writes,
+ * ioctl uses @len as a cmd and @addr as an arg.
+ */
+struct ioring_sqe {
+    uint32_t opcode;
+    int fd;
+    uint32_t addr;
+    uint32_t len;
+    uint32_t user_data;
+};
+typedef struct ioring_sqe ioring_sqe_t;
+
+struct ioring_cqe {
+    uint32_t user_data;
+    int res;
+};
+typedef struct ioring_cqe ioring_cqe_t;
+
+/**
+ * The ring is shared between a process and the kernel. Counters are
+ * free-running, the process advances sq_tail and cq_head, the kernel
+ * advances sq_head and cq_tail. Entries are completed in order.
+ */
+struct ioring {
+    uint32_t sq_head;
+    uint32_t sq_tail;
+    uint32_t cq_head;
+    uint32_t cq_tail;
+    ioring_sqe_t sqes[IORING_ENTRIES];
+    ioring_cqe_t cqes[IORING_ENTRIES];
+    uint8_t data[];
+};
+typedef struct ioring ioring_t;
+
+#define IORING_DATA_SIZE (IORING_SIZE - sizeof(ioring_t))
+
+#endif // _KERNEL_LIBKERN_BITS_IORING_H
@@ -48,6 +48,11 @@ enum __sysid {
     SYS_SHBUF_CREATE,
     SYS_SHBUF_GET,
     SYS_SHBUF_FREE,
+    SYS_CLOCK_PAGE,
+    SYS_IORING_SETUP,
+    SYS_IORING_ENTER,
+    SYS_FSYNC,
+    SYS_FDATASYNC,
 };
 typedef enum __sysid sysid_t;
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_LIBKERN_KTRACE_H
+#define _KERNEL_LIBKERN_KTRACE_H
+
+#include <libkern/c_attrs.h>
+#include <libkern/types.h>
+
+#define KTRACE_MAGIC 0x4352544b /* "KTRC" */
+#define KTRACE_EVENTS_PER_CPU 4096 /* Should be a power of 2. */
+
+enum KTRACE_EVENT_TYPES {
+    KTRACE_EVENT_NONE = 0,
+    KTRACE_EVENT_SCHED_SWITCH, /* arg0: next tid, arg1: next pid */
+    KTRACE_EVENT_SCHED_WAKEUP, /* arg0: woken tid, arg1: blocker reason */
+    KTRACE_EVENT_SYSCALL_ENTER, /* arg0: sysid */
+    KTRACE_EVENT_SYSCALL_EXIT, /* arg0: sysid, arg1: result */
+    KTRACE_EVENT_PAGE_FAULT, /* arg0: vaddr, arg1: info */
+    KTRACE_EVENT_BIO_SUBMIT, /* arg0: sector, arg1: 1 if write */
+    KTRACE_EVENT_BIO_COMPLETE, /* arg0: sector, arg1: result */
+    KTRACE_EVENT_IPC_SEND, /* arg0: socket, arg1: len */
+    KTRACE_EVENT_IPC_RECEIVE, /* arg0: socket, arg1: len */
+};
+
+struct ktrace_event {
+    uint64_t ts; /* In cycles of system_read_cycle_counter() */
+    uint16_t type;
+    uint16_t cpu;
+    uint32_t tid;
+    uint32_t arg0;
+    uint32_t arg1;
+};
+typedef struct ktrace_event ktrace_event_t;
+
+/**
+ * /dev/ktrace contains ktrace_header_t and then, for every cpu, a 32-bit
+ * count of recorded events, a padding word and KTRACE_EVENTS_PER_CPU events.
+ * The header lets a decoder find the frequency of the counter.
+ */
+struct ktrace_header {
+    uint32_t magic;
+    uint32_t cpus;
+    uint32_t events_per_cpu;
+    uint32_t ticks_per_second;
+    uint64_t start_ts;
+    uint64_t now_ts;
+    uint32_t start_ticks;
+    uint32_t now_ticks;
+};
+typedef struct ktrace_header ktrace_header_t;
+
+extern bool ktrace_enabled;
+
+int ktrace_install();
+void ktrace_record(uint16_t type, uint32_t arg0, uint32_t arg1);
+
+static ALWAYS_INLINE void ktrace(uint16_t type, uint32_t arg0, uint32_t arg1)
+{
+    if (likely(!ktrace_enabled)) {
+        return;
+    }
+    ktrace_record(type, arg0, arg1);
+}
+
+#endif // _KERNEL_LIBKERN_KTRACE_H
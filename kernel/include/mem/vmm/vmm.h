@@ -61,6 +61,7 @@ int vmm_setup_secondary_cpu();
 int vmm_allocate_ptable(uint32_t vaddr);
 int vmm_free_ptable(uint32_t vaddr, struct dynamic_array* zones);
 int vmm_free_pdir(pdirectory_t* pdir, struct dynamic_array* zones);
+int vmm_count_resident_pages(pdirectory_t* pdir, struct dynamic_array* zones, uint32_t* resident, uint32_t* shared);
 
 int vmm_map_page(uint32_t vaddr, uint32_t paddr, uint32_t settings);
 int vmm_map_pages(uint32_t vaddr, uint32_t paddr, uint32_t n_pages, uint32_t settings);
@@ -118,4 +118,13 @@ inline static int system_cpu_id()
     return res & 0x3;
 }
 
+inline static uint64_t system_read_cycle_counter()
+{
+    // Physical count of the generic timer (CNTPCT).
+    uint32_t low, high;
+    asm volatile("mrrc p15, 0, %0, %1, c14"
+                 : "=r"(low), "=r"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
 #endif /* _KERNEL_PLATFORM_AARCH32_SYSTEM_H */
\ No newline at end of file
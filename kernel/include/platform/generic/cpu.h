@@ -16,6 +16,7 @@
 #define CPU_CNT 4
 #define THIS_CPU (&cpus[system_cpu_id()])
 #define FPU_ENABLED
+#define CPU_STAT_IRQ_LINES 256
 
 struct thread;
 typedef int cpu_state_t;
@@ -33,6 +34,7 @@ typedef struct {
     context_t* sched_context; // context of sched's registers
     struct thread* running_thread;
     cpu_state_t current_state;
+    cpu_state_t interrupted_state; // state the cpu was in when the last trap came
     struct thread* idle_thread;
 
     sched_data_t sched;
@@ -41,6 +43,12 @@ typedef struct {
     time_t stat_ticks_since_boot;
     time_t stat_system_and_idle_ticks;
     time_t stat_user_ticks;
+    uint32_t stat_context_switches;
+    uint32_t stat_syscalls;
+    uint32_t stat_minor_faults;
+    uint32_t stat_major_faults;
+    uint32_t stat_cow_faults;
+    uint32_t stat_irqs[CPU_STAT_IRQ_LINES];
 
 #ifdef FPU_ENABLED
     // Information about current state of fpu.
@@ -90,4 +90,12 @@ inline static int system_cpu_id()
     return 0;
 }
 
+inline static uint64_t system_read_cycle_counter()
+{
+    uint32_t low, high;
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
 #endif /* _KERNEL_PLATFORM_X86_SYSTEM_H */
\ No newline at end of file
@@ -54,15 +54,20 @@ void sys_create_thread(trapframe_t* tf);
 void sys_sleep(trapframe_t* tf);
 void sys_select(trapframe_t* tf);
 void sys_fstat(trapframe_t* tf);
+void sys_fsync(trapframe_t* tf);
+void sys_fdatasync(trapframe_t* tf);
 void sys_sched_yield(trapframe_t* tf);
 void sys_uname(trapframe_t* tf);
 void sys_clock_settime(trapframe_t* tf);
 void sys_clock_gettime(trapframe_t* tf);
 void sys_clock_getres(trapframe_t* tf);
+void sys_clock_page(trapframe_t* tf);
 void sys_nice(trapframe_t* tf);
 void sys_shbuf_create(trapframe_t* tf);
 void sys_shbuf_get(trapframe_t* tf);
 void sys_shbuf_free(trapframe_t* tf);
+void sys_ioring_setup(trapframe_t* tf);
+void sys_ioring_enter(trapframe_t* tf);
 
 void sys_none(trapframe_t* tf);
 
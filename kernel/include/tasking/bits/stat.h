@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_TASKING_BITS_STAT_H
+#define _KERNEL_TASKING_BITS_STAT_H
+
+#include <libkern/types.h>
+
+/**
+ * Counters are updated only by the cpu which runs the thread, so they are
+ * not atomic. Readers (procfs) could see slightly stale values.
+ */
+struct task_stat {
+    time_t user_ticks;
+    time_t system_ticks;
+    uint32_t voluntary_switches;
+    uint32_t involuntary_switches;
+    uint32_t minor_faults;
+    uint32_t major_faults;
+    uint32_t cow_faults;
+    uint32_t syscalls;
+    uint32_t read_bytes;
+    uint32_t written_bytes;
+};
+typedef struct task_stat task_stat_t;
+
+static inline void task_stat_add(task_stat_t* to, task_stat_t* from)
+{
+    to->user_ticks += from->user_ticks;
+    to->system_ticks += from->system_ticks;
+    to->voluntary_switches += from->voluntary_switches;
+    to->involuntary_switches += from->involuntary_switches;
+    to->minor_faults += from->minor_faults;
+    to->major_faults += from->major_faults;
+    to->cow_faults += from->cow_faults;
+    to->syscalls += from->syscalls;
+    to->read_bytes += from->read_bytes;
+    to->written_bytes += from->written_bytes;
+}
+
+#endif // _KERNEL_TASKING_BITS_STAT_H
@@ -17,6 +17,7 @@
 
 static inline void cpu_enter_kernel_space()
 {
+    THIS_CPU->interrupted_state = THIS_CPU->current_state;
     THIS_CPU->current_state = CPU_IN_KERNEL;
 }
 
@@ -25,12 +26,27 @@ static inline void cpu_leave_kernel_space()
     THIS_CPU->current_state = CPU_IN_USERLAND;
 }
 
+/**
+ * Is called from the timer interrupt, so the interrupted state tells if
+ * the thread was running its own code or was inside a syscall.
+ */
 static inline void cpu_tick()
 {
-    if (THIS_CPU->running_thread->process->is_kthread) {
-        THIS_CPU->stat_system_and_idle_ticks++;
+    cpu_t* cpu = THIS_CPU;
+    thread_t* thread = cpu->running_thread;
+    if (!thread->process->is_kthread && cpu->interrupted_state == CPU_IN_USERLAND) {
+        cpu->stat_user_ticks++;
+        thread->stat.user_ticks++;
     } else {
-        THIS_CPU->stat_user_ticks++;
+        cpu->stat_system_and_idle_ticks++;
+        thread->stat.system_ticks++;
+    }
+}
+
+static inline void cpu_count_irq(int line)
+{
+    if (line >= 0 && line < CPU_STAT_IRQ_LINES) {
+        THIS_CPU->stat_irqs[line]++;
     }
 }
 
@@ -15,6 +15,7 @@
 #include <libkern/types.h>
 #include <mem/vmm/vmm.h>
 #include <mem/vmm/zoner.h>
+#include <tasking/bits/stat.h>
 
 #define MAX_PROCESS_COUNT 1024
 #define MAX_OPENED_FILES 16
@@ -50,6 +51,7 @@ struct proc_zone {
     uint32_t flags;
     dentry_t* file;
     uint32_t offset;
+    uint32_t file_len; /* Bytes of the zone backed by the file, the rest is zeroed. */
 };
 typedef struct proc_zone proc_zone_t;
 
@@ -85,7 +87,14 @@ struct proc {
     file_descriptor_t* fds;
     tty_entry_t* tty;
 
+    /* Stat of the threads which are already freed. */
+    task_stat_t stat;
+
     bool is_kthread;
+
+    /* Hash chains of the pid and pdir indices, see tasking.c. */
+    struct proc* pid_index_next;
+    struct proc* pdir_index_next;
 };
 typedef struct proc proc_t;
 
@@ -108,6 +117,18 @@ struct thread* proc_create_thread(proc_t* p);
 void proc_kill_all_threads(proc_t* p);
 void proc_kill_all_threads_except(proc_t* p, struct thread* gthread);
 
+/**
+ * Runs the body for every alive thread of @p, which is named thread. Dead
+ * threads keep the process, which could be a reused slot now. Users need
+ * tasking/thread.h.
+ */
+extern struct thread_list thread_list;
+#define foreach_thread(p)                                                                                                                      \
+    for (thread_list_node_t* __thread_list_node = thread_list.head; __thread_list_node != NULL; __thread_list_node = __thread_list_node->next) \
+        for (int i = 0; i < THREADS_PER_NODE; i++)                                                                                             \
+            for (thread_t* thread = &__thread_list_node->thread_storage[i]; thread; thread = NULL)                                             \
+                if (thread->process == p && !thread_is_free(thread))
+
 /**
  * KTHREAD FUNCTIONS
  */
@@ -27,9 +27,18 @@ extern proc_t proc[MAX_PROCESS_COUNT];
 extern uint32_t nxt_proc;
 extern uint32_t ended_proc;
 
+thread_t* tasking_get_thread(uint32_t tid);
 proc_t* tasking_get_proc(uint32_t pid);
 proc_t* tasking_get_proc_by_pdir(pdirectory_t* pdir);
 
+/**
+ * The pid, pdir and tid of a task are indexed, so they have to be changed
+ * only with these functions.
+ */
+void tasking_set_proc_pid(proc_t* p, uint32_t pid);
+void tasking_set_proc_pdir(proc_t* p, pdirectory_t* pdir);
+void tasking_set_thread_tid(thread_t* thread, uint32_t tid);
+
 /**
  * CPU FUNCTIONS
  */
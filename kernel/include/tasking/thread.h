@@ -13,6 +13,7 @@
 #include <libkern/types.h>
 #include <platform/generic/tasking/context.h>
 #include <platform/generic/tasking/trapframe.h>
+#include <tasking/bits/stat.h>
 #include <tasking/signal.h>
 #include <time/time_manager.h>
 
@@ -41,6 +42,7 @@ enum BLOCKER_REASON {
     BLOCKER_SLEEP,
     BLOCKER_SELECT,
     BLOCKER_DUMPING,
+    BLOCKER_IORING,
 };
 
 struct proc;
@@ -72,13 +74,18 @@ struct thread {
     fd_set_t readfds;
     fd_set_t writefds;
     fd_set_t exceptfds;
+    uint32_t ioring_min_complete;
 
     /* Stat data */
     time_t stat_total_running_ticks;
+    task_stat_t stat;
 
     uint32_t signals_mask;
     uint32_t pending_signals_mask;
     void* signal_handlers[SIGNALS_CNT];
+
+    /* Hash chain of the tid index, see tasking.c. */
+    struct thread* tid_index_next;
 };
 typedef struct thread thread_t;
 
@@ -125,6 +132,8 @@ int init_read_blocker(thread_t* p, file_descriptor_t* bfd);
 int init_write_blocker(thread_t* thread, file_descriptor_t* bfd);
 int init_sleep_blocker(thread_t* thread, uint32_t time);
 int init_select_blocker(thread_t* thread, int nfds, fd_set_t* readfds, fd_set_t* writefds, fd_set_t* exceptfds, timeval_t* timeout);
+int init_ioring_blocker(thread_t* thread, uint32_t min_complete);
+int init_ioring_worker_blocker(thread_t* thread);
 
 /**
  * DEBUG FUNCTIONS
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _KERNEL_TIME_CLOCK_PAGE_H
+#define _KERNEL_TIME_CLOCK_PAGE_H
+
+#include <libkern/bits/clock_page.h>
+#include <libkern/types.h>
+
+int clock_page_setup();
+void clock_page_update();
+uint32_t clock_page_user_address();
+
+#endif /* _KERNEL_TIME_CLOCK_PAGE_H */
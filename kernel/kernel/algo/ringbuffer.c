@@ -57,15 +57,18 @@ uint32_t ringbuffer_read(ringbuffer_t* buf, uint8_t* holder, uint32_t siz)
 {
     uint32_t i = 0;
     if (buf->start > buf->end) {
-        for (; i < siz && buf->start < buf->zone.len; i++, buf->start++) {
-            holder[i] = buf->zone.ptr[buf->start];
-        }
+        i = min(siz, buf->zone.len - buf->start);
+        memcpy(holder, buf->zone.ptr + buf->start, i);
+        buf->start += i;
         if (buf->start == buf->zone.len) {
             buf->start = 0;
         }
     }
-    for (; i < siz && buf->start < buf->end; i++, buf->start++) {
-        holder[i] = buf->zone.ptr[buf->start];
+    if (buf->start < buf->end) {
+        uint32_t chunk = min(siz - i, buf->end - buf->start);
+        memcpy(holder + i, buf->zone.ptr + buf->start, chunk);
+        buf->start += chunk;
+        i += chunk;
     }
     return i;
 }
@@ -75,15 +78,17 @@ uint32_t ringbuffer_read_with_start(ringbuffer_t* buf, uint32_t start, uint8_t*
     uint32_t i = 0;
     start %= buf->zone.len;
     if (start > buf->end) {
-        for (; i < siz && start < buf->zone.len; i++, start++) {
-            holder[i] = buf->zone.ptr[start];
-        }
+        i = min(siz, buf->zone.len - start);
+        memcpy(holder, buf->zone.ptr + start, i);
+        start += i;
         if (start == buf->zone.len) {
             start = 0;
         }
     }
-    for (; i < siz && start < buf->end; i++, start++) {
-        holder[i] = buf->zone.ptr[start];
+    if (start < buf->end) {
+        uint32_t chunk = min(siz - i, buf->end - start);
+        memcpy(holder + i, buf->zone.ptr + start, chunk);
+        i += chunk;
     }
     return i;
 }
@@ -105,15 +110,18 @@ uint32_t ringbuffer_write(ringbuffer_t* buf, const uint8_t* holder, uint32_t siz
 {
     uint32_t i = 0;
     if (buf->end >= buf->start) {
-        for (; i < siz && buf->end < buf->zone.len; i++, buf->end++) {
-            buf->zone.ptr[buf->end] = holder[i];
-        }
+        i = min(siz, buf->zone.len - buf->end);
+        memcpy(buf->zone.ptr + buf->end, holder, i);
+        buf->end += i;
         if (buf->end == buf->zone.len) {
             buf->end = 0;
         }
     }
-    for (; i < siz && buf->end < buf->start; i++, buf->end++) {
-        buf->zone.ptr[buf->end] = holder[i];
+    if (buf->end < buf->start) {
+        uint32_t chunk = min(siz - i, buf->start - buf->end);
+        memcpy(buf->zone.ptr + buf->end, holder + i, chunk);
+        buf->end += chunk;
+        i += chunk;
     }
     return i;
 }
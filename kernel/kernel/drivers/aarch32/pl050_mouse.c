@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <algo/ringbuffer.h>
 #include <drivers/aarch32/pl050.h>
 #include <drivers/generic/mouse.h>
 #include <fs/devfs/devfs.h>
@@ -20,7 +19,6 @@
 // #define DEBUG_PL050
 // #define MOUSE_DRIVER_DEBUG
 
-static ringbuffer_t mouse_buffer;
 static zone_t mapped_zone;
 static volatile pl050_registers_t* registers = (pl050_registers_t*)PL050_MOUSE_BASE;
 
@@ -32,34 +30,12 @@ static inline int _pl050_map_itself()
     return 0;
 }
 
-static bool _mouse_can_read(dentry_t* dentry, uint32_t start)
-{
-    return ringbuffer_space_to_read(&mouse_buffer) >= 1;
-}
-
-static int _mouse_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
-{
-    uint32_t leno = ringbuffer_space_to_read(&mouse_buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = ringbuffer_read(&mouse_buffer, buf, leno);
-    return leno;
-}
 static void pl050_mouse_recieve_notification(uint32_t msg, uint32_t param)
 {
     if (msg == DM_NOTIFICATION_DEVFS_READY) {
-        dentry_t* mp;
-        if (vfs_resolve_path("/dev", &mp) < 0) {
+        if (generic_mouse_create_devfs() < 0) {
             kpanic("Can't init pl050_mouse in /dev");
         }
-
-        file_ops_t fops = { 0 };
-        fops.can_read = _mouse_can_read;
-        fops.read = _mouse_read;
-        devfs_inode_t* res = devfs_register(mp, MKDEV(10, 1), "mouse", 5, 0, &fops);
-
-        dentry_put(mp);
     }
 }
 
@@ -133,7 +109,7 @@ static void _pl050_mouse_int_handler()
         packet.y_offset = 0;
     }
 
-    ringbuffer_write(&mouse_buffer, (uint8_t*)&packet, sizeof(mouse_packet_t));
+    generic_mouse_emit(&packet);
 
 #ifdef MOUSE_DRIVER_DEBUG
     log("%x ", packet.button_states);
@@ -161,8 +137,8 @@ void pl050_mouse_init(device_t* dev)
     _mouse_send_cmd_and_data(0xF3, 200);
     _mouse_send_cmd_and_data(0xF3, 100);
     _mouse_send_cmd_and_data(0xF3, 80);
+    generic_mouse_init();
     irq_register_handler(PL050_MOUSE_IRQ_LINE, 0, 0, _pl050_mouse_int_handler, BOOT_CPU_MASK);
-    mouse_buffer = ringbuffer_create_std();
 }
 
 static driver_desc_t _pl050_mouse_driver_info()
@@ -15,10 +15,11 @@
 #include <tasking/tasking.h>
 
 #define DEBUG_PL111
+#define PL111_BUFFERS_COUNT 3
 
 static zone_t mapped_zone;
 static volatile pl111_registers_t* registers = (pl111_registers_t*)PL111_BASE;
-static char* pl111_bufs_paddr[2];
+static char* pl111_bufs_paddr[PL111_BUFFERS_COUNT];
 static uint32_t pl111_screen_width;
 static uint32_t pl111_screen_height;
 static uint32_t pl111_screen_buffer_size;
@@ -42,10 +43,11 @@ static inline uint32_t roundup_to_page_size(uint32_t size)
 static int _pl111_init_buffer(uint32_t width, uint32_t height)
 {
     uint32_t one_screen_len = width * 4 * height;
-    pl111_screen_buffer_size = one_screen_len * 2;
+    pl111_screen_buffer_size = one_screen_len * PL111_BUFFERS_COUNT;
     char* paddr_zone = pmm_alloc(pl111_screen_buffer_size);
-    pl111_bufs_paddr[0] = (char*)(paddr_zone);
-    pl111_bufs_paddr[1] = (char*)(paddr_zone + one_screen_len);
+    for (int i = 0; i < PL111_BUFFERS_COUNT; i++) {
+        pl111_bufs_paddr[i] = (char*)(paddr_zone + i * one_screen_len);
+    }
     registers->lcd_upbase = (uint32_t)pl111_bufs_paddr[0];
     return 0;
 }
@@ -57,8 +59,10 @@ static int _pl111_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
         return pl111_screen_height;
     case BGA_GET_WIDTH:
         return pl111_screen_width;
+    case BGA_GET_BUFFERS_COUNT:
+        return PL111_BUFFERS_COUNT;
     case BGA_SWAP_BUFFERS:
-        registers->lcd_upbase = (uint32_t)pl111_bufs_paddr[(arg & 1)];
+        registers->lcd_upbase = (uint32_t)pl111_bufs_paddr[(arg % PL111_BUFFERS_COUNT)];
         return 0;
     default:
         return -EINVAL;
@@ -5,12 +5,18 @@
  */
 
 #include <drivers/aarch32/pl181.h>
+#include <io/block/block.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/vmm/vmm.h>
 #include <mem/vmm/zoner.h>
 
 // #define DEBUG_PL181
 
+/* Polls of the status register without progress before a transfer is given up. */
+#define PL181_MAX_IDLE_POLLS 0x100000
+
 static sd_card_t sd_cards[MAX_DEVICES_COUNT];
 static zone_t mapped_zone;
 static volatile pl181_registers_t* registers = (pl181_registers_t*)PL181_BASE;
@@ -35,16 +41,25 @@ static int _pl181_send_cmd(uint32_t cmd, uint32_t param)
     registers->arg = param;
     registers->cmd = cmd;
 
-    while (registers->status & MMC_STAT_CMD_ACTIVE_MASK) { }
+    uint32_t polls = 0;
+    while (registers->status & MMC_STAT_CMD_ACTIVE_MASK) {
+        if (++polls == PL181_MAX_IDLE_POLLS) {
+            return -EIO;
+        }
+    }
 
     if ((cmd & MMC_CMD_RESP_MASK) == MMC_CMD_RESP_MASK) {
         while (((registers->status & MMC_STAT_CMD_RESP_END_MASK) != MMC_STAT_CMD_RESP_END_MASK) || (registers->status & MMC_STAT_CMD_ACTIVE_MASK)) {
-            if (registers->status & MMC_STAT_CMD_TIMEOUT_MASK) {
+            if ((registers->status & MMC_STAT_CMD_TIMEOUT_MASK) || ++polls == PL181_MAX_IDLE_POLLS) {
                 return -1;
             }
         }
     } else {
-        while ((registers->status & MMC_STAT_CMD_SENT_MASK) != MMC_STAT_CMD_SENT_MASK) { }
+        while ((registers->status & MMC_STAT_CMD_SENT_MASK) != MMC_STAT_CMD_SENT_MASK) {
+            if (++polls == PL181_MAX_IDLE_POLLS) {
+                return -EIO;
+            }
+        }
     }
     return 0;
 }
@@ -67,50 +82,151 @@ inline static int _pl181_select_card(uint32_t rca)
     return _pl181_send_cmd(CMD_SELECT | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, rca);
 }
 
-static int _pl181_read_block(device_t* device, uint32_t lba_like, void* read_data)
+static inline uint32_t _pl181_block_address(sd_card_t* sd_card, uint32_t lba_like)
 {
-    sd_card_t* sd_card = &sd_cards[device->id];
-    uint32_t* read_data32 = (uint32_t*)read_data;
-    uint32_t bytes_read = 0;
+    return sd_card->ishc ? lba_like : lba_like * PL181_SECTOR_SIZE;
+}
 
-    registers->data_length = PL181_SECTOR_SIZE; // Set length of bytes to transfer
-    registers->data_control = 0b11; // Enable dpsm and set direction from card to host
+static inline uint32_t _pl181_load_word(uint8_t* data)
+{
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
 
-    if (sd_card->ishc) {
-        _pl181_send_cmd(CMD_READ_SINGLE_BLOCK | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, lba_like);
-    } else {
-        _pl181_send_cmd(CMD_READ_SINGLE_BLOCK | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, lba_like * PL181_SECTOR_SIZE);
+static inline void _pl181_store_word(uint8_t* data, uint32_t word)
+{
+    memcpy(data, &word, sizeof(word));
+}
+
+/**
+ * The FIFO is drained in bursts of half of its size, while it is at least
+ * half full, so status is polled once per burst instead of once per word.
+ * A transfer fails on a data error or when the FIFO makes no progress for
+ * PL181_MAX_IDLE_POLLS polls.
+ */
+static int _pl181_drain_fifo(uint8_t* data, uint32_t len)
+{
+    uint32_t done = 0;
+    uint32_t idle_polls = 0;
+    while (done < len) {
+        uint32_t status = registers->status;
+        if (status & MMC_STAT_DATA_ERROR_MASK) {
+            return -EIO;
+        }
+
+        if ((status & MMC_STAT_RECEIVE_FIFO_HALF_FULL_MASK) && len - done >= PL181_FIFO_HALF_WORDS * 4) {
+            for (int i = 0; i < PL181_FIFO_HALF_WORDS; i++) {
+                _pl181_store_word(&data[done], registers->fifo_data[i]);
+                done += 4;
+            }
+        } else if (status & MMC_STAT_FIFO_DATA_AVAIL_TO_READ_MASK) {
+            _pl181_store_word(&data[done], registers->fifo_data[0]);
+            done += 4;
+        } else if (++idle_polls == PL181_MAX_IDLE_POLLS) {
+            return -EIO;
+        } else {
+            continue;
+        }
+        idle_polls = 0;
     }
+    return done;
+}
+
+static int _pl181_fill_fifo(uint8_t* data, uint32_t len)
+{
+    uint32_t done = 0;
+    uint32_t idle_polls = 0;
+    while (done < len) {
+        uint32_t status = registers->status;
+        if (status & MMC_STAT_DATA_ERROR_MASK) {
+            return -EIO;
+        }
 
-    while (registers->status & MMC_STAT_FIFO_DATA_AVAIL_TO_READ_MASK) {
-        *read_data32 = registers->fifo_data[0];
-        read_data32++;
-        bytes_read += 4;
+        if ((status & MMC_STAT_TRANSMIT_FIFO_HALF_EMPTY_MASK) && len - done >= PL181_FIFO_HALF_WORDS * 4) {
+            for (int i = 0; i < PL181_FIFO_HALF_WORDS; i++) {
+                registers->fifo_data[i] = _pl181_load_word(&data[done]);
+                done += 4;
+            }
+        } else if (status & MMC_STAT_TRANSMIT_FIFO_EMPTY_MASK) {
+            registers->fifo_data[0] = _pl181_load_word(&data[done]);
+            done += 4;
+        } else if (++idle_polls == PL181_MAX_IDLE_POLLS) {
+            return -EIO;
+        } else {
+            continue;
+        }
+        idle_polls = 0;
     }
-    return bytes_read;
+    return done;
 }
 
-static int _pl181_write_block(device_t* device, uint32_t lba_like, void* write_data)
+/**
+ * Serves the request with a single command. Several sectors are moved with
+ * READ/WRITE_MULTIPLE_BLOCK, which is ended with STOP_TRANSMISSION. The data
+ * of merged bios goes through the FIFO one bio after another.
+ */
+static int _pl181_handle_request(device_t* device, block_request_t* req)
 {
     sd_card_t* sd_card = &sd_cards[device->id];
-    uint32_t* write_data32 = (uint32_t*)write_data;
-    uint32_t bytes_written = 0;
 
-    registers->data_length = PL181_SECTOR_SIZE; // Set length of bytes to transfer
-    registers->data_control = 0b01; // Enable dpsm and set direction from host to card
+    registers->data_length = req->count * PL181_SECTOR_SIZE; // Set length of bytes to transfer
+    registers->data_control = MMC_DATA_CTRL_ENABLE_MASK | (req->is_write ? 0 : MMC_DATA_CTRL_DIRECTION_MASK) | (9 << MMC_DATA_CTRL_BLOCK_SIZE_POS);
 
-    if (sd_card->ishc) {
-        _pl181_send_cmd(CMD_WRITE_SINGLE_BLOCK | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, lba_like);
+    uint32_t cmd;
+    if (req->is_write) {
+        cmd = req->count > 1 ? CMD_WRITE_MULTIPLE_BLOCK : CMD_WRITE_SINGLE_BLOCK;
     } else {
-        _pl181_send_cmd(CMD_WRITE_SINGLE_BLOCK | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, lba_like * PL181_SECTOR_SIZE);
+        cmd = req->count > 1 ? CMD_READ_MULTIPLE_BLOCK : CMD_READ_SINGLE_BLOCK;
+    }
+    if (_pl181_send_cmd(cmd | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, _pl181_block_address(sd_card, req->sector)) < 0) {
+        return -EIO;
+    }
+
+    int res = 0;
+    foreach_bio(req)
+    {
+        uint32_t len = bio->count * PL181_SECTOR_SIZE;
+        res = req->is_write ? _pl181_fill_fifo(bio->data, len) : _pl181_drain_fifo(bio->data, len);
+        if (res < 0) {
+            break;
+        }
+    }
+
+    if (req->count > 1) {
+        _pl181_send_cmd(CMD_STOP_TRANSMISSION | MMC_CMD_ENABLE_MASK | MMC_CMD_RESP_MASK, 0);
     }
 
-    while (registers->status & MMC_STAT_TRANSMIT_FIFO_EMPTY_MASK) {
-        registers->fifo_data[0] = *write_data32;
-        write_data32++;
-        bytes_written += 4;
+    if (res < 0) {
+#ifdef DEBUG_PL181
+        log_error("PL181: transfer of %d sectors at %d failed", req->count, req->sector);
+#endif
+        return res;
     }
-    return bytes_written;
+    return req->count * PL181_SECTOR_SIZE;
+}
+
+static int _pl181_transfer_block(device_t* device, uint32_t lba_like, void* data, bool is_write)
+{
+    bio_t bio;
+    bio_init(&bio, device, lba_like, 1, (uint8_t*)data, is_write ? BIO_WRITE : 0);
+
+    block_request_t req = { 0 };
+    req.sector = lba_like;
+    req.count = 1;
+    req.is_write = is_write;
+    req.bio_head = req.bio_tail = &bio;
+    return _pl181_handle_request(device, &req);
+}
+
+static int _pl181_read_block(device_t* device, uint32_t lba_like, void* read_data)
+{
+    return _pl181_transfer_block(device, lba_like, read_data, false);
+}
+
+static int _pl181_write_block(device_t* device, uint32_t lba_like, void* write_data)
+{
+    return _pl181_transfer_block(device, lba_like, write_data, true);
 }
 
 static void _pl181_add_new_device(device_t* new_device)
@@ -161,6 +277,7 @@ static driver_desc_t _pl181_driver_info()
     ata_desc.functions[DRIVER_STORAGE_WRITE] = _pl181_write_block;
     ata_desc.functions[DRIVER_STORAGE_FLUSH] = 0;
     ata_desc.functions[DRIVER_STORAGE_CAPACITY] = _pl181_get_capacity;
+    ata_desc.functions[DRIVER_STORAGE_HANDLE_REQUEST] = _pl181_handle_request;
     ata_desc.pci_serve_class = 0x08;
     ata_desc.pci_serve_subclass = 0x05;
     ata_desc.pci_serve_vendor_id = 0x00;
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <drivers/generic/mouse.h>
+#include <fs/devfs/devfs.h>
+#include <fs/vfs.h>
+#include <libkern/libkern.h>
+#include <libkern/lock.h>
+#include <time/time_manager.h>
+
+static mouse_packet_t _gmouse_queue[MOUSE_QUEUE_SIZE];
+static uint32_t _gmouse_head = 0;
+static uint32_t _gmouse_count = 0;
+static lock_t _gmouse_lock;
+
+/* The last queued packet could take more motion only if it is not a click. */
+static bool _gmouse_tail_mergeable = false;
+static uint16_t _gmouse_last_buttons = 0;
+
+static inline mouse_packet_t* _generic_mouse_tail()
+{
+    return &_gmouse_queue[(_gmouse_head + _gmouse_count - 1) % MOUSE_QUEUE_SIZE];
+}
+
+static inline bool _generic_mouse_fits_int16(int32_t val)
+{
+    return -0x8000 <= val && val <= 0x7fff;
+}
+
+/**
+ * Merges relative motion of @packet into the last unread packet. Button
+ * transitions are never merged, so a click is seen where it happened.
+ */
+static bool _generic_mouse_try_merge(mouse_packet_t* packet)
+{
+    if (!_gmouse_count || !_gmouse_tail_mergeable) {
+        return false;
+    }
+
+    mouse_packet_t* tail = _generic_mouse_tail();
+    if (tail->button_states != packet->button_states) {
+        return false;
+    }
+
+    int32_t x_offset = (int32_t)tail->x_offset + packet->x_offset;
+    int32_t y_offset = (int32_t)tail->y_offset + packet->y_offset;
+    int32_t wheel_data = (int32_t)tail->wheel_data + packet->wheel_data;
+    if (!_generic_mouse_fits_int16(x_offset) || !_generic_mouse_fits_int16(y_offset) || !_generic_mouse_fits_int16(wheel_data)) {
+        return false;
+    }
+
+    tail->x_offset = x_offset;
+    tail->y_offset = y_offset;
+    tail->wheel_data = wheel_data;
+    tail->time_ms = packet->time_ms;
+    return true;
+}
+
+static bool _generic_mouse_can_read(dentry_t* dentry, uint32_t start)
+{
+    return _gmouse_count > 0;
+}
+
+static int _generic_mouse_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    lock_acquire(&_gmouse_lock);
+    uint32_t cnt = min(len / sizeof(mouse_packet_t), _gmouse_count);
+    mouse_packet_t* packets = (mouse_packet_t*)buf;
+    for (uint32_t i = 0; i < cnt; i++) {
+        packets[i] = _gmouse_queue[_gmouse_head];
+        _gmouse_head = (_gmouse_head + 1) % MOUSE_QUEUE_SIZE;
+    }
+    _gmouse_count -= cnt;
+    lock_release(&_gmouse_lock);
+    return cnt * sizeof(mouse_packet_t);
+}
+
+int generic_mouse_create_devfs()
+{
+    dentry_t* mp;
+    if (vfs_resolve_path("/dev", &mp) < 0) {
+        return -1;
+    }
+
+    file_ops_t fops = { 0 };
+    fops.can_read = _generic_mouse_can_read;
+    fops.read = _generic_mouse_read;
+    devfs_inode_t* res = devfs_register(mp, MKDEV(10, 1), "mouse", 5, 0, &fops);
+
+    dentry_put(mp);
+    return 0;
+}
+
+void generic_mouse_init()
+{
+    lock_init(&_gmouse_lock);
+    _gmouse_head = 0;
+    _gmouse_count = 0;
+    _gmouse_tail_mergeable = false;
+    _gmouse_last_buttons = 0;
+}
+
+/**
+ * Is called by drivers from the interrupt handler for every packet.
+ */
+void generic_mouse_emit(mouse_packet_t* packet)
+{
+    packet->time_ms = timeman_ticks_since_boot() * 1000 / timeman_ticks_per_second();
+
+    lock_acquire(&_gmouse_lock);
+    bool is_click = (packet->button_states != _gmouse_last_buttons);
+    _gmouse_last_buttons = packet->button_states;
+
+    if (!is_click && _generic_mouse_try_merge(packet)) {
+        lock_release(&_gmouse_lock);
+        return;
+    }
+
+    if (_gmouse_count == MOUSE_QUEUE_SIZE) {
+        // Nobody reads the mouse, the oldest packet is dropped.
+        _gmouse_head = (_gmouse_head + 1) % MOUSE_QUEUE_SIZE;
+        _gmouse_count--;
+    }
+
+    _gmouse_count++;
+    *_generic_mouse_tail() = *packet;
+    _gmouse_tail_mergeable = !is_click;
+    lock_release(&_gmouse_lock);
+}
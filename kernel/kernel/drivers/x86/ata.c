@@ -5,6 +5,7 @@
  */
 
 #include <drivers/x86/ata.h>
+#include <io/block/block.h>
 #include <libkern/bits/errno.h>
 
 ata_t _ata_drives[MAX_DEVICES_COUNT];
@@ -17,6 +18,7 @@ static uint8_t _ata_gen_drive_head_register(bool is_lba, bool is_master, uint8_t
 static int ata_write(device_t* device, uint32_t sector, uint8_t* data, uint32_t size);
 static int ata_read(device_t* device, uint32_t sector, uint8_t* read_data);
 static int ata_flush(device_t* device);
+static int ata_handle_request(device_t* device, block_request_t* req);
 static uint32_t ata_get_capacity(device_t* device);
 
 /**
@@ -48,6 +50,7 @@ driver_desc_t _ata_driver_info()
     ata_desc.functions[DRIVER_STORAGE_WRITE] = ata_write;
     ata_desc.functions[DRIVER_STORAGE_FLUSH] = ata_flush;
     ata_desc.functions[DRIVER_STORAGE_CAPACITY] = ata_get_capacity;
+    ata_desc.functions[DRIVER_STORAGE_HANDLE_REQUEST] = ata_handle_request;
     ata_desc.pci_serve_class = 0x01;
     ata_desc.pci_serve_subclass = 0x05;
     ata_desc.pci_serve_vendor_id = 0x00;
@@ -224,6 +227,73 @@ int ata_read(device_t* device, uint32_t sectorNum, uint8_t* read_data)
     return 0;
 }
 
+/**
+ * Waits for the drive to be ready to transfer the next sector.
+ */
+static int _ata_wait_drq(ata_t* dev)
+{
+    // while BSY is on and no Errors
+    uint8_t status = port_8bit_in(dev->port.command);
+    while (((status >> 7) & 1) == 1 && ((status >> 0) & 1) != 1) {
+        status = port_8bit_in(dev->port.command);
+    }
+
+    if (((status >> 0) & 1) == 1) {
+        return -EBUSY;
+    }
+
+    if (((status >> 3) & 1) == 0) {
+        return -ENODEV;
+    }
+    return 0;
+}
+
+/**
+ * Serves the whole request with a single READ/WRITE SECTORS command, the
+ * drive raises DRQ for every sector.
+ */
+static int ata_handle_request(device_t* device, block_request_t* req)
+{
+    ata_t* dev = &_ata_drives[device->id];
+
+    uint8_t dev_config = _ata_gen_drive_head_register(true, !dev->is_master, (req->sector >> 24) & 0xF);
+
+    port_8bit_out(dev->port.device, dev_config);
+    port_8bit_out(dev->port.sector_count, req->count & 0xFF);
+    port_8bit_out(dev->port.lba_lo, req->sector & 0x000000FF);
+    port_8bit_out(dev->port.lba_mid, (req->sector & 0x0000FF00) >> 8);
+    port_8bit_out(dev->port.lba_hi, (req->sector & 0x00FF0000) >> 16);
+    port_8bit_out(dev->port.error, 0);
+    port_8bit_out(dev->port.command, req->is_write ? 0x31 : 0x21);
+
+    foreach_bio(req)
+    {
+        for (uint32_t sector = 0; sector < bio->count; sector++) {
+            int err = _ata_wait_drq(dev);
+            if (err) {
+                kprintf("Error");
+                return err;
+            }
+
+            uint8_t* data = &bio->data[sector * BLOCK_SECTOR_SIZE];
+            for (int i = 0; i < 256; i++) {
+                if (req->is_write) {
+                    port_16bit_out(dev->port.data, (data[2 * i + 1] << 8) + data[2 * i]);
+                } else {
+                    uint16_t word = port_16bit_in(dev->port.data);
+                    data[2 * i + 1] = (word >> 8) & 0xFF;
+                    data[2 * i + 0] = (word >> 0) & 0xFF;
+                }
+            }
+        }
+    }
+
+    if (req->is_write) {
+        return ata_flush(device);
+    }
+    return 0;
+}
+
 int ata_flush(device_t* device)
 {
     ata_t* dev = &_ata_drives[device->id];
@@ -33,6 +33,9 @@
 #define VBE_DISPI_ENABLED 0x01
 #define VBE_DISPI_LFB_ENABLED 0x40
 
+/* The virtual screen holds three buffers, so the compositor never waits for the one on screen. */
+#define BGA_BUFFERS_COUNT 3
+
 static uint16_t bga_screen_width, bga_screen_height;
 static uint32_t bga_screen_line_size, bga_screen_buffer_size;
 static uint32_t bga_buf_paddr;
@@ -55,7 +58,7 @@ static void _bga_set_resolution(uint16_t width, uint16_t height)
     _bga_write_reg(VBE_DISPI_INDEX_XRES, width);
     _bga_write_reg(VBE_DISPI_INDEX_YRES, height);
     _bga_write_reg(VBE_DISPI_INDEX_VIRT_WIDTH, width);
-    _bga_write_reg(VBE_DISPI_INDEX_VIRT_HEIGHT, (uint16_t)height * 2);
+    _bga_write_reg(VBE_DISPI_INDEX_VIRT_HEIGHT, (uint16_t)height * BGA_BUFFERS_COUNT);
     _bga_write_reg(VBE_DISPI_INDEX_BPP, 32);
     _bga_write_reg(VBE_DISPI_INDEX_X_OFFSET, 0);
     _bga_write_reg(VBE_DISPI_INDEX_Y_OFFSET, 0);
@@ -73,8 +76,10 @@ static int _bga_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
         return bga_screen_height;
     case BGA_GET_WIDTH:
         return bga_screen_width;
+    case BGA_GET_BUFFERS_COUNT:
+        return BGA_BUFFERS_COUNT;
     case BGA_SWAP_BUFFERS:
-        y_offset = bga_screen_height * (arg & 1);
+        y_offset = bga_screen_height * (arg % BGA_BUFFERS_COUNT);
         _bga_write_reg(VBE_DISPI_INDEX_Y_OFFSET, (uint16_t)y_offset);
         return 0;
     default:
@@ -161,5 +166,5 @@ void bga_set_resolution(uint16_t width, uint16_t height)
     _bga_set_resolution(width, height);
     bga_screen_width = width;
     bga_screen_height = height;
-    bga_screen_buffer_size = bga_screen_line_size * (uint32_t)height * 2;
+    bga_screen_buffer_size = bga_screen_line_size * (uint32_t)height * BGA_BUFFERS_COUNT;
 }
\ No newline at end of file
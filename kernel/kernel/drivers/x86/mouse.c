@@ -4,7 +4,6 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <algo/ringbuffer.h>
 #include <drivers/driver_manager.h>
 #include <drivers/x86/display.h>
 #include <drivers/x86/mouse.h>
@@ -17,39 +16,14 @@
 
 // #define MOUSE_DRIVER_DEBUG
 
-static ringbuffer_t mouse_buffer;
-
 void mouse_run();
 
-static bool _mouse_can_read(dentry_t* dentry, uint32_t start)
-{
-    return ringbuffer_space_to_read(&mouse_buffer) >= 1;
-}
-
-static int _mouse_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
-{
-    uint32_t leno = ringbuffer_space_to_read(&mouse_buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = ringbuffer_read(&mouse_buffer, buf, leno);
-    return leno;
-}
-
 static void _mouse_recieve_notification(uint32_t msg, uint32_t param)
 {
     if (msg == DM_NOTIFICATION_DEVFS_READY) {
-        dentry_t* mp;
-        if (vfs_resolve_path("/dev", &mp) < 0) {
+        if (generic_mouse_create_devfs() < 0) {
             kpanic("Can't init mouse in /dev");
         }
-
-        file_ops_t fops = { 0 };
-        fops.can_read = _mouse_can_read;
-        fops.read = _mouse_read;
-        devfs_inode_t* res = devfs_register(mp, MKDEV(10, 1), "mouse", 5, 0, &fops);
-
-        dentry_put(mp);
     }
 }
 
@@ -154,7 +128,7 @@ void mouse_handler()
         packet.y_offset = 0;
     }
 
-    ringbuffer_write(&mouse_buffer, (uint8_t*)&packet, sizeof(mouse_packet_t));
+    generic_mouse_emit(&packet);
 
 #ifdef MOUSE_DRIVER_DEBUG
     log("%x", packet.button_states);
@@ -180,9 +154,8 @@ void mouse_run()
     _mouse_send_cmd_and_data(0xF3, 200);
     _mouse_send_cmd_and_data(0xF3, 100);
     _mouse_send_cmd_and_data(0xF3, 80);
+    generic_mouse_init();
     set_irq_handler(IRQ12, mouse_handler);
-
-    mouse_buffer = ringbuffer_create_std();
 }
 
 bool mouse_install()
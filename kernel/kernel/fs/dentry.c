@@ -5,6 +5,7 @@
  */
 
 #include <algo/dynamic_array.h>
+#include <fs/page_cache.h>
 #include <fs/vfs.h>
 #include <libkern/atomic.h>
 #include <libkern/kassert.h>
@@ -46,6 +47,7 @@ static inline bool free_inode_cache()
         int dentries_in_block = dentry_cache_block->len / sizeof(dentry_t);
         for (int i = 0; i < dentries_in_block; i++) {
             if (dentry_cache_block->data[i].d_count == 0) {
+                page_cache_free(&dentry_cache_block->data[i]);
                 dentry_cache_block->data[i].inode_indx = 0;
                 stat_cached_inodes_area_size -= INODE_LEN;
                 kfree(dentry_cache_block->data[i].inode);
@@ -132,7 +134,7 @@ static inline void dentry_flush_inode(dentry_t* dentry)
 {
     if (dentry_test_flag_lockless(dentry, DENTRY_DIRTY) && dentry->inode) {
         dentry->ops->dentry.write_inode(dentry);
-        dentry_rem_flag_lockless(dentry, DENTRY_DIRTY);
+        dentry_rem_flag_lockless(dentry, DENTRY_DIRTY | DENTRY_SIZE_DIRTY);
     }
 }
 
@@ -146,6 +148,7 @@ static void dentry_delete_from_cache(dentry_t* dentry)
 {
     /* This marks the dentry as deleted. */
     dentry->inode_indx = 0;
+    page_cache_free(dentry);
     if (dentry->inode) {
         kfree(dentry->inode);
     }
@@ -185,6 +188,7 @@ static dentry_t* dentry_alloc_new(uint32_t dev_indx, uint32_t inode_indx, int ne
     /* If inode_indx isn't 0, so we can say that we replace a valid dentry, which
        has area for storing inode allocated. */
     bool already_allocated_inode = (dentry->inode_indx != 0);
+    page_cache_free(dentry);
     lock_init(&dentry->lock);
     dentry->d_count = 1;
     dentry->flags = 0;
@@ -236,7 +240,8 @@ dentry_t* dentry_get_parent(dentry_t* dentry)
 }
 
 /**
- * Is a thread enrty point. The function flushes all inodes to drive.
+ * Is a thread enrty point. The function writes back delayed data and
+ * flushes all inodes to drive.
  */
 void dentry_flusher()
 {
@@ -244,6 +249,9 @@ void dentry_flusher()
 #ifdef DENTRY_DEBUG
         log("WORK dentry_flusher");
 #endif
+        /* Data goes first, so inodes are written with blocks allocated for it. */
+        vfs_sync_devices();
+
         dentry_cache_list_t* dentry_cache_block = dentry_cache;
         while (dentry_cache_block) {
             lock_acquire(&dentry_cache_block->lock);
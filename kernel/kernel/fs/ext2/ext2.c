@@ -4,7 +4,9 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <fs/ext2/hash.h>
 #include <fs/vfs.h>
+#include <io/block/block.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/lock.h>
@@ -17,6 +19,9 @@
 #define SUPERBLOCK _ext2_superblocks[dev->dev->id]
 #define GROUPS_COUNT _ext2_group_table_info[dev->dev->id].count
 #define GROUP_TABLES _ext2_group_table_info[dev->dev->id].table
+#define ALLOC_CACHE _ext2_alloc_caches[dev->dev->id]
+#define MAP_CACHE _ext2_map_caches[dev->dev->id]
+#define DELALLOC_CACHE _ext2_delalloc_caches[dev->dev->id]
 #define VFS_DEVICE_LOCK dev->lock
 #define VFS_DEVICE_LOCK_OWNED_BY(x) x->dev->lock
 #define BLOCK_LEN(sb) (1024 << (sb->log_block_size))
@@ -25,13 +30,17 @@
 
 static superblock_t* _ext2_superblocks[MAX_DEVICES_COUNT];
 static groups_info_t _ext2_group_table_info[MAX_DEVICES_COUNT];
+static ext2_alloc_cache_t _ext2_alloc_caches[MAX_DEVICES_COUNT];
+static ext2_map_cache_t _ext2_map_caches[MAX_DEVICES_COUNT];
+static ext2_delalloc_cache_t _ext2_delalloc_caches[MAX_DEVICES_COUNT];
+static ext2_dir_hint_t _ext2_dir_hints[MAX_DEVICES_COUNT][EXT2_DIR_HINTS];
 static lock_t _ext2_lock;
 
 driver_desc_t _ext2_driver_info();
 
 /* DRIVE RELATED FUNCTIONS */
-static void _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
-static void _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
+static int _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
+static int _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len);
 static uint32_t _ext2_get_disk_size(vfs_device_t* dev);
 
 /* UTILS */
@@ -43,24 +52,34 @@ static inline void _ext2_bitmap_unset_bit(uint8_t* bitmap, uint32_t index);
 static inline uint32_t _ext2_get_group_len(superblock_t* sb);
 static inline int _ext2_get_groups_cnt(vfs_device_t* dev, superblock_t* sb);
 
+/* ALLOCATION CACHE FUNCTIONS */
+static uint8_t* _ext2_get_block_bitmap_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index);
+static uint8_t* _ext2_get_inode_bitmap_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index);
+static void _ext2_flush_alloc_cache_lockless(vfs_device_t* dev, fsdata_t fsdata);
+static void _ext2_release_window_lockless(vfs_device_t* dev, uint32_t inode_indx);
+
+/* BLOCK MAP CACHE FUNCTIONS */
+static ext2_indirect_entry_t* _ext2_get_indirect_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, bool is_new);
+static void _ext2_flush_map_cache_lockless(vfs_device_t* dev, fsdata_t fsdata);
+static void _ext2_cut_runs_lockless(vfs_device_t* dev, uint32_t inode_indx, uint32_t logical);
+
 /* BLOCK FUNCTIONS */
 static uint32_t _ext2_get_block_offset(superblock_t* sb, uint32_t block_index);
 
-static uint32_t _ext2_get_block_of_inode_lev0(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index);
-static uint32_t _ext2_get_block_of_inode_lev1(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index);
-static uint32_t _ext2_get_block_of_inode_lev2(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index);
+static int _ext2_get_block_path(superblock_t* sb, uint32_t inode_block_index, uint32_t* offsets);
+static uint32_t _ext2_indirect_blocks_for(superblock_t* sb, uint32_t data_blocks);
+static uint32_t _ext2_data_blocks_of_inode(dentry_t* dentry);
+static uint32_t _ext2_resolve_block_of_inode_lockless(dentry_t* dentry, uint32_t inode_block_index);
 static uint32_t _ext2_get_block_of_inode(dentry_t* dentry, uint32_t inode_block_index);
-
-static int _ext2_set_block_of_inode_lev0(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val);
-static int _ext2_set_block_of_inode_lev1(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val);
-static int _ext2_set_block_of_inode_lev2(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val);
 static int _ext2_set_block_of_inode(dentry_t* dentry, uint32_t inode_block_index, uint32_t val);
+static void _ext2_free_indirect_tree(dentry_t* dentry, uint32_t block_index, int depth);
+static void _ext2_trim_indirect_blocks(dentry_t* dentry, uint32_t data_blocks);
 
-static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index);
-static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t pref_group);
+static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index, uint32_t from, uint32_t inode_indx);
+static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t goal, uint32_t inode_indx);
 static int _ext2_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index);
 
-static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t pref_group, uint32_t* block_index);
+static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t goal, uint32_t* block_index);
 
 /* INODE FUNCTIONS */
 int ext2_read_inode(dentry_t* dentry);
@@ -80,13 +99,27 @@ static bool _ext2_is_dir_empty(dentry_t* dir);
 static int _ext2_add_first_entry_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len);
 static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len);
 static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry);
+static void _ext2_remember_dir_hint(dentry_t* dir, uint32_t inode_indx, uint32_t block);
 
 static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, int len);
 static int _ext2_rm_child(dentry_t* dir, dentry_t* child_dentry);
 static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode);
 
+/* DIR INDEX FUNCTIONS */
+static int _ext2_dx_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* found_inode_index, uint32_t* found_block);
+static int _ext2_dx_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, uint32_t len);
+static int _ext2_dx_create_index(dentry_t* dir);
+
+/* DELAYED ALLOCATION FUNCTIONS */
+static ext2_delalloc_buffer_t* _ext2_delalloc_find_lockless(vfs_device_t* dev, uint32_t inode_indx);
+static ext2_delalloc_buffer_t* _ext2_delalloc_get_lockless(vfs_device_t* dev, dentry_t* dentry);
+static void _ext2_delalloc_flush_lockless(vfs_device_t* dev, ext2_delalloc_buffer_t* buffer);
+static void _ext2_delalloc_flush_range_lockless(dentry_t* dentry, uint32_t start, uint32_t len);
+static int _ext2_delalloc_write_lockless(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+
 /* FILE FUNCTIONS */
 static int _ext2_setup_file(dentry_t* file, mode_t mode);
+static int _ext2_write_lockless(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 
 /* API FUNTIONS */
 int ext2_recognize_drive(vfs_device_t* dev);
@@ -97,6 +130,8 @@ fsdata_t get_fsdata(dentry_t* dentry);
 int ext2_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int ext2_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int ext2_truncate(dentry_t* dentry, uint32_t len);
+int ext2_fsync(dentry_t* dentry, bool datasync);
+int ext2_sync_device(vfs_device_t* dev);
 int ext2_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result);
 int ext2_mkdir(dentry_t* dir, const char* name, uint32_t len, mode_t mode);
 int ext2_getdirent(dentry_t* dir, uint32_t* offset, dirent_t* res);
@@ -107,45 +142,79 @@ int ext2_rm(dentry_t* dentry);
  * DRIVE RELATED FUNCTIONS
  */
 
-static void _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len)
+/**
+ * Whole sectors are read straight into @buf with a single block request,
+ * only partial sectors at the edges go through tmp_buf. Returns an error
+ * of the drive if any.
+ */
+static int _ext2_read_from_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len)
 {
-    void (*read)(device_t * d, uint32_t s, uint8_t * r) = drivers[dev->dev->driver_id].desc.functions[DRIVER_STORAGE_READ];
-    int already_read = 0;
-    uint32_t sector = start / 512;
-    uint32_t start_offset = start % 512;
-    uint8_t tmp_buf[512];
+    uint32_t sector = start / BLOCK_SECTOR_SIZE;
+    uint32_t start_offset = start % BLOCK_SECTOR_SIZE;
+    uint8_t tmp_buf[BLOCK_SECTOR_SIZE];
 
     while (len) {
-        read(dev->dev, sector, tmp_buf);
-        for (int i = 0; i < min(512 - start_offset, len); i++) {
-            buf[already_read++] = tmp_buf[start_offset + i];
+        if (start_offset == 0 && len >= BLOCK_SECTOR_SIZE) {
+            uint32_t count = len / BLOCK_SECTOR_SIZE;
+            int err = block_read(dev->dev, sector, count, buf);
+            if (err < 0) {
+                return err;
+            }
+            buf += count * BLOCK_SECTOR_SIZE;
+            len -= count * BLOCK_SECTOR_SIZE;
+            sector += count;
+            continue;
+        }
+
+        uint32_t chunk = min(BLOCK_SECTOR_SIZE - start_offset, len);
+        int err = block_read(dev->dev, sector, 1, tmp_buf);
+        if (err < 0) {
+            return err;
         }
-        len -= min(512 - start_offset, len);
+        memcpy(buf, &tmp_buf[start_offset], chunk);
+        buf += chunk;
+        len -= chunk;
         sector++;
         start_offset = 0;
     }
+    return 0;
 }
 
-static void _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len)
+static int _ext2_write_to_dev(vfs_device_t* dev, uint8_t* buf, uint32_t start, uint32_t len)
 {
-    void (*read)(device_t * d, uint32_t s, uint8_t * r) = drivers[dev->dev->driver_id].desc.functions[DRIVER_STORAGE_READ];
-    void (*write)(device_t * d, uint32_t s, uint8_t * r, uint32_t siz) = drivers[dev->dev->driver_id].desc.functions[DRIVER_STORAGE_WRITE];
-    int already_written = 0;
-    uint32_t sector = start / 512;
-    uint32_t start_offset = start % 512;
-    uint8_t tmp_buf[512];
-    while (len != 0) {
-        if (start_offset != 0 || len < 512) {
-            read(dev->dev, sector, tmp_buf);
+    uint32_t sector = start / BLOCK_SECTOR_SIZE;
+    uint32_t start_offset = start % BLOCK_SECTOR_SIZE;
+    uint8_t tmp_buf[BLOCK_SECTOR_SIZE];
+
+    while (len) {
+        if (start_offset == 0 && len >= BLOCK_SECTOR_SIZE) {
+            uint32_t count = len / BLOCK_SECTOR_SIZE;
+            int err = block_write(dev->dev, sector, count, buf);
+            if (err < 0) {
+                return err;
+            }
+            buf += count * BLOCK_SECTOR_SIZE;
+            len -= count * BLOCK_SECTOR_SIZE;
+            sector += count;
+            continue;
+        }
+
+        uint32_t chunk = min(BLOCK_SECTOR_SIZE - start_offset, len);
+        int err = block_read(dev->dev, sector, 1, tmp_buf);
+        if (err < 0) {
+            return err;
         }
-        for (int i = 0; i < min(512 - start_offset, len); i++) {
-            tmp_buf[start_offset + i] = buf[already_written++];
+        memcpy(&tmp_buf[start_offset], buf, chunk);
+        err = block_write(dev->dev, sector, 1, tmp_buf);
+        if (err < 0) {
+            return err;
         }
-        write(dev->dev, sector, tmp_buf, 512);
-        len -= min(512 - start_offset, len);
+        buf += chunk;
+        len -= chunk;
         sector++;
         start_offset = 0;
     }
+    return 0;
 }
 
 static uint32_t _ext2_get_disk_size(vfs_device_t* dev)
@@ -194,593 +263,1949 @@ static inline int _ext2_get_groups_cnt(vfs_device_t* dev, superblock_t* sb)
 }
 
 /**
- * BLOCK FUNCTIONS
+ * ALLOCATION CACHE FUNCTIONS
  */
 
-static uint32_t _ext2_get_block_offset(superblock_t* sb, uint32_t block_index)
-{
-    return SUPERBLOCK_START + (block_index - 1) * BLOCK_LEN(sb);
-}
-
-static uint32_t _ext2_get_block_of_inode_lev0(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index)
+static inline uint32_t _ext2_blocks_per_group(superblock_t* sb)
 {
-    uint32_t offset = inode_block_index;
-    uint32_t res;
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)&res, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return res;
+    return min(sb->blocks_per_group, 8 * BLOCK_LEN(sb));
 }
 
-static uint32_t _ext2_get_block_of_inode_lev1(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index)
+static inline uint32_t _ext2_inodes_per_group(superblock_t* sb)
 {
-    uint32_t lev_contain = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    uint32_t offset = inode_block_index / lev_contain;
-    uint32_t offset_inner = inode_block_index % lev_contain;
-    uint32_t res;
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)&res, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return res ? _ext2_get_block_of_inode_lev0(dentry, res, offset_inner) : 0;
+    return min(sb->inodes_per_group, 8 * BLOCK_LEN(sb));
 }
 
-static uint32_t _ext2_get_block_of_inode_lev2(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index)
+static inline uint32_t _ext2_group_block(superblock_t* sb, uint32_t group_index, uint32_t off)
 {
-    uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    uint32_t lev_contain = block_len * block_len;
-    uint32_t offset = inode_block_index / lev_contain;
-    uint32_t offset_inner = inode_block_index % lev_contain;
-    uint32_t res;
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)&res, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return res ? _ext2_get_block_of_inode_lev1(dentry, res, offset_inner) : 0;
+    return sb->blocks_per_group * group_index + off + 1;
 }
 
-/* FIXME: think of more effecient way */
-static uint32_t _ext2_get_block_of_inode(dentry_t* dentry, uint32_t inode_block_index)
+static inline uint32_t _ext2_group_of_block(superblock_t* sb, uint32_t block_index)
 {
-    uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    if (inode_block_index < 12) {
-        return dentry->inode->block[inode_block_index];
-    }
-    if (inode_block_index < 12 + block_len) { // single indirect
-        return _ext2_get_block_of_inode_lev0(dentry, dentry->inode->block[12], inode_block_index - 12);
-    }
-    if (inode_block_index < 12 + block_len + block_len * block_len) { // double indirect
-        return _ext2_get_block_of_inode_lev1(dentry, dentry->inode->block[13], inode_block_index - 12 - block_len);
-    } // triple indirect
-    return _ext2_get_block_of_inode_lev2(dentry, dentry->inode->block[14], inode_block_index - (12 + block_len + block_len * block_len));
+    return (block_index - 1) / sb->blocks_per_group;
 }
 
-static int _ext2_set_block_of_inode_lev0(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val)
+static inline uint32_t _ext2_group_of_inode(superblock_t* sb, uint32_t inode_index)
 {
-    uint32_t offset = inode_block_index;
-    _ext2_write_to_dev(dentry->dev, (uint8_t*)&val, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return 0;
+    return (inode_index - 1) / sb->inodes_per_group;
 }
 
-static int _ext2_set_block_of_inode_lev1(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val)
+static int _ext2_bitmap_find_zero(uint8_t* bitmap, uint32_t from, uint32_t len)
 {
-    uint32_t lev_contain = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    uint32_t offset = inode_block_index / lev_contain;
-    uint32_t offset_inner = inode_block_index % lev_contain;
-    uint32_t res;
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)&res, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return res ? _ext2_set_block_of_inode_lev0(dentry, res, offset_inner, val) : -1;
+    uint32_t off = from;
+    while (off < len) {
+        if ((off & 0x7) == 0 && bitmap[off / 8] == 0xff) {
+            off += 8;
+            continue;
+        }
+        if (!_ext2_bitmap_get(bitmap, off)) {
+            return off;
+        }
+        off++;
+    }
+    return -1;
 }
 
-static int _ext2_set_block_of_inode_lev2(dentry_t* dentry, uint32_t cur_block, uint32_t inode_block_index, uint32_t val)
+static uint32_t _ext2_bitmap_count_zeros(uint8_t* bitmap, uint32_t len)
 {
-    uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    uint32_t lev_contain = block_len * block_len;
-    uint32_t offset = inode_block_index / lev_contain;
-    uint32_t offset_inner = inode_block_index % lev_contain;
-    uint32_t res;
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)&res, _ext2_get_block_offset(dentry->fsdata.sb, cur_block) + offset * 4, 4);
-    return res ? _ext2_set_block_of_inode_lev1(dentry, res, offset_inner, val) : -1;
+    uint32_t res = 0;
+    for (uint32_t off = 0; off < len; off++) {
+        res += !_ext2_bitmap_get(bitmap, off);
+    }
+    return res;
 }
 
-/* FIXME: think of more effecient way */
-int _ext2_set_block_of_inode(dentry_t* dentry, uint32_t inode_block_index, uint32_t val)
+/**
+ * Free counters on the drive could be stale, so they are recounted from
+ * the bitmap when it is loaded.
+ */
+static uint8_t* _ext2_load_bitmap_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t bitmap_block, uint32_t len, uint32_t* free)
 {
-    uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb) / 4;
-    if (inode_block_index < 12) {
-        dentry->inode->block[inode_block_index] = val;
-        dentry_set_flag(dentry, DENTRY_DIRTY);
-        return 0;
+    uint8_t* bitmap = kmalloc(BLOCK_LEN(fsdata.sb));
+    if (!bitmap) {
+        return NULL;
     }
-    if (inode_block_index < 12 + block_len) { // single indirect
-        return _ext2_set_block_of_inode_lev0(dentry, dentry->inode->block[12], inode_block_index - 12, val);
+
+    if (_ext2_read_from_dev(dev, bitmap, _ext2_get_block_offset(fsdata.sb, bitmap_block), BLOCK_LEN(fsdata.sb)) < 0) {
+        kfree(bitmap);
+        return NULL;
     }
-    if (inode_block_index < 12 + block_len + block_len * block_len) { // double indirect
-        return _ext2_set_block_of_inode_lev1(dentry, dentry->inode->block[13], inode_block_index - 12 - block_len, val);
-    } // triple indirect
-    return _ext2_set_block_of_inode_lev2(dentry, dentry->inode->block[14], inode_block_index - (12 + block_len + block_len * block_len), val);
+    *free = _ext2_bitmap_count_zeros(bitmap, len);
+    return bitmap;
 }
 
-static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index)
+static uint8_t* _ext2_get_block_bitmap_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index)
 {
-    uint8_t block_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), BLOCK_LEN(fsdata.sb));
-
-    for (uint32_t off = 0; off < 8 * BLOCK_LEN(fsdata.sb); off++) {
-        if (!_ext2_bitmap_get(block_bitmap, off)) {
-            *block_index = fsdata.sb->blocks_per_group * group_index + off + 1;
-            _ext2_bitmap_set_bit(block_bitmap, off);
-            _ext2_write_to_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), BLOCK_LEN(fsdata.sb));
-            return 0;
+    ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+    if (!group->block_bitmap) {
+        group_desc_t* desc = &fsdata.gt->table[group_index];
+        uint32_t free;
+        group->block_bitmap = _ext2_load_bitmap_lockless(dev, fsdata, desc->block_bitmap, _ext2_blocks_per_group(fsdata.sb), &free);
+        if (group->block_bitmap && desc->free_blocks_count != free) {
+            fsdata.sb->free_blocks_count = fsdata.sb->free_blocks_count - desc->free_blocks_count + free;
+            desc->free_blocks_count = free;
+            ALLOC_CACHE.group_table_dirty = true;
         }
     }
-    return -ENOSPC;
+    return group->block_bitmap;
 }
 
-static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t pref_group)
+static uint8_t* _ext2_get_inode_bitmap_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index)
 {
-    uint32_t groups_cnt = GROUPS_COUNT;
-    for (int i = 0; i < groups_cnt; i++) {
-        uint32_t group_id = (pref_group + i) % groups_cnt;
-        if (GROUP_TABLES[group_id].free_blocks_count) {
-            if (_ext2_find_free_block_index(dev, fsdata, block_index, group_id) == 0) {
-                return 0;
-            }
+    ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+    if (!group->inode_bitmap) {
+        group_desc_t* desc = &fsdata.gt->table[group_index];
+        uint32_t free;
+        group->inode_bitmap = _ext2_load_bitmap_lockless(dev, fsdata, desc->inode_bitmap, _ext2_inodes_per_group(fsdata.sb), &free);
+        if (group->inode_bitmap && desc->free_inodes_count != free) {
+            fsdata.sb->free_inodes_count = fsdata.sb->free_inodes_count - desc->free_inodes_count + free;
+            desc->free_inodes_count = free;
+            ALLOC_CACHE.group_table_dirty = true;
         }
     }
-    return -ENOSPC;
+    return group->inode_bitmap;
 }
 
-static int _ext2_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index)
+/**
+ * Writes dirty bitmaps and the group table back, so after a burst of
+ * allocations each touched bitmap is written once.
+ */
+static void _ext2_flush_alloc_cache_lockless(vfs_device_t* dev, fsdata_t fsdata)
 {
-    block_index--;
-    uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    uint32_t group_index = block_index / block_len;
-    uint32_t off = block_index % block_len;
+    if (!ALLOC_CACHE.groups) {
+        return;
+    }
 
-    uint8_t block_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), block_len);
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
+    for (uint32_t i = 0; i < fsdata.gt->count; i++) {
+        ext2_group_cache_t* group = &ALLOC_CACHE.groups[i];
+        if (group->flags & EXT2_GROUP_BLOCK_BITMAP_DIRTY) {
+            _ext2_write_to_dev(dev, group->block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[i].block_bitmap), block_len);
+        }
+        if (group->flags & EXT2_GROUP_INODE_BITMAP_DIRTY) {
+            _ext2_write_to_dev(dev, group->inode_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[i].inode_bitmap), block_len);
+        }
+        group->flags = 0;
+    }
 
-    _ext2_bitmap_unset_bit(block_bitmap, off);
-    _ext2_write_to_dev(dev, block_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].block_bitmap), block_len);
-    return 0;
+    if (ALLOC_CACHE.group_table_dirty) {
+        _ext2_write_to_dev(dev, (uint8_t*)fsdata.gt->table, _ext2_get_block_offset(fsdata.sb, 2), fsdata.gt->count * GROUP_LEN);
+        ALLOC_CACHE.group_table_dirty = false;
+    }
 }
 
-/**
- * Returns allocated block in @block_index
- */
-static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t pref_group, uint32_t* block_index)
+static ext2_prealloc_window_t* _ext2_get_window_lockless(vfs_device_t* dev, uint32_t inode_indx)
 {
-    if (_ext2_allocate_block_index(dentry->dev, dentry->fsdata, block_index, pref_group) == 0) {
-        uint32_t blocks_per_inode = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-        if (_ext2_set_block_of_inode(dentry, blocks_per_inode, *block_index) == 0) {
-            dentry->inode->blocks += BLOCK_LEN(dentry->fsdata.sb) / 512;
-            dentry_set_flag(dentry, DENTRY_DIRTY);
-            return 0;
+    for (int i = 0; i < EXT2_PREALLOC_WINDOWS; i++) {
+        if (ALLOC_CACHE.windows[i].inode_indx == inode_indx) {
+            return &ALLOC_CACHE.windows[i];
         }
     }
-    return -ENOSPC;
+    return NULL;
 }
 
 /**
- * INODE FUNCTIONS
+ * Returns a window of another inode which covers @block_index.
  */
-
-int ext2_read_inode(dentry_t* dentry)
-{
-    uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
-    uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
-    uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
-    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
-    _ext2_read_from_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
-    return 0;
-}
-
-int ext2_write_inode(dentry_t* dentry)
+static ext2_prealloc_window_t* _ext2_find_reserving_window_lockless(vfs_device_t* dev, uint32_t block_index, uint32_t inode_indx)
 {
-    uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
-    uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
-    uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
-    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
-    _ext2_write_to_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
-    return 0;
+    for (int i = 0; i < EXT2_PREALLOC_WINDOWS; i++) {
+        ext2_prealloc_window_t* window = &ALLOC_CACHE.windows[i];
+        if (window->inode_indx && window->inode_indx != inode_indx && window->next <= block_index && block_index < window->end) {
+            return window;
+        }
+    }
+    return NULL;
 }
 
-static int _ext2_find_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* inode_index, uint32_t group_index)
+static void _ext2_release_window_lockless(vfs_device_t* dev, uint32_t inode_indx)
 {
-    uint8_t inode_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, inode_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].inode_bitmap), BLOCK_LEN(fsdata.sb));
-
-    for (uint32_t off = 0; off < 8 * BLOCK_LEN(fsdata.sb); off++) {
-        if (!_ext2_bitmap_get(inode_bitmap, off)) {
-            *inode_index = SUPERBLOCK->inodes_per_group * group_index + off + 1;
-            _ext2_bitmap_set_bit(inode_bitmap, off);
-            _ext2_write_to_dev(dev, inode_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].inode_bitmap), BLOCK_LEN(fsdata.sb));
-            return 0;
-        }
+    ext2_prealloc_window_t* window = _ext2_get_window_lockless(dev, inode_indx);
+    if (window) {
+        window->inode_indx = 0;
     }
-    return -ENOSPC;
 }
 
-static int _ext2_allocate_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* inode_index, uint32_t pref_group)
+/**
+ * Reserves blocks right after @block_index inside its group for the inode.
+ * If all windows are in use, the least recently used one is replaced.
+ */
+static void _ext2_open_window_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t inode_indx, uint32_t block_index)
 {
-    uint32_t groups_cnt = GROUPS_COUNT;
-    for (int i = 0; i < groups_cnt; i++) {
-        uint32_t group_id = (pref_group + i) % groups_cnt;
-        if (fsdata.gt->table[group_id].free_inodes_count) {
-            if (_ext2_find_free_inode_index(dev, fsdata, inode_index, group_id) == 0) {
-                return 0;
+    ext2_prealloc_window_t* window = _ext2_get_window_lockless(dev, inode_indx);
+    if (!window) {
+        window = _ext2_get_window_lockless(dev, 0);
+    }
+    if (!window) {
+        window = &ALLOC_CACHE.windows[0];
+        for (int i = 1; i < EXT2_PREALLOC_WINDOWS; i++) {
+            if (ALLOC_CACHE.windows[i].last_used < window->last_used) {
+                window = &ALLOC_CACHE.windows[i];
             }
         }
     }
-    return -ENOSPC;
+
+    uint32_t group_index = _ext2_group_of_block(fsdata.sb, block_index);
+    uint32_t group_end = _ext2_group_block(fsdata.sb, group_index, _ext2_blocks_per_group(fsdata.sb));
+    window->inode_indx = inode_indx;
+    window->next = block_index + 1;
+    window->end = min(block_index + 1 + EXT2_PREALLOC_BLOCKS, group_end);
+    window->last_used = ++ALLOC_CACHE.clock;
 }
 
-static int _ext2_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t inode_index)
+static void _ext2_mark_block_used_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t group_index, uint32_t off)
 {
-    inode_index--;
-    uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    uint32_t inodes_per_group = fsdata.sb->inodes_per_group;
-    uint32_t group_index = inode_index / inodes_per_group;
-    uint32_t off = inode_index % inodes_per_group;
+    ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+    _ext2_bitmap_set_bit(group->block_bitmap, off);
+    group->flags |= EXT2_GROUP_BLOCK_BITMAP_DIRTY;
+    group->block_hint = off + 1;
+    fsdata.gt->table[group_index].free_blocks_count--;
+    fsdata.sb->free_blocks_count--;
+    ALLOC_CACHE.group_table_dirty = true;
+}
 
-    uint8_t inode_bitmap[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, inode_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].inode_bitmap), block_len);
+/**
+ * BLOCK MAP CACHE FUNCTIONS
+ */
 
-    _ext2_bitmap_unset_bit(inode_bitmap, off);
-    _ext2_write_to_dev(dev, inode_bitmap, _ext2_get_block_offset(fsdata.sb, fsdata.gt->table[group_index].inode_bitmap), block_len);
-    return 0;
+static void _ext2_write_indirect_lockless(vfs_device_t* dev, fsdata_t fsdata, ext2_indirect_entry_t* entry)
+{
+    if (entry->dirty) {
+        _ext2_write_to_dev(dev, (uint8_t*)entry->data, _ext2_get_block_offset(fsdata.sb, entry->block_index), BLOCK_LEN(fsdata.sb));
+        entry->dirty = false;
+    }
 }
 
-int ext2_free_inode(dentry_t* dentry)
+/**
+ * Returns the cached copy of the indirect block, reading it from the drive
+ * on a miss. A just allocated block (@is_new) is zeroed instead of read.
+ */
+static ext2_indirect_entry_t* _ext2_get_indirect_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, bool is_new)
 {
-    ASSERT(dentry->d_count == 0 && dentry->inode->links_count == 0);
-    uint32_t block_per_dir = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    ext2_indirect_entry_t* victim = &MAP_CACHE.indirect[0];
+    for (int i = 0; i < EXT2_INDIRECT_CACHE_SIZE; i++) {
+        ext2_indirect_entry_t* entry = &MAP_CACHE.indirect[i];
+        if (entry->block_index == block_index) {
+            entry->last_used = ++MAP_CACHE.clock;
+            return entry;
+        }
+        if (entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
 
-    /* freeing all data blocks */
-    for (int block_index = 0; block_index < block_per_dir; block_index++) {
-        uint32_t data_block_index = _ext2_get_block_of_inode(dentry, block_index);
-        _ext2_free_block_index(dentry->dev, dentry->fsdata, data_block_index);
+    if (!victim->data) {
+        victim->data = (uint32_t*)kmalloc(BLOCK_LEN(fsdata.sb));
+        if (!victim->data) {
+            return NULL;
+        }
     }
 
-    _ext2_free_inode_index(dentry->dev, dentry->fsdata, dentry->inode_indx);
-    return 0;
+    _ext2_write_indirect_lockless(dev, fsdata, victim);
+    victim->block_index = block_index;
+    victim->last_used = ++MAP_CACHE.clock;
+    if (is_new) {
+        memset(victim->data, 0, BLOCK_LEN(fsdata.sb));
+        victim->dirty = true;
+    } else if (_ext2_read_from_dev(dev, (uint8_t*)victim->data, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb)) < 0) {
+        victim->block_index = 0;
+        victim->last_used = 0;
+        return NULL;
+    }
+    return victim;
 }
 
-static int _ext2_decriment_links_count(dentry_t* dentry)
+static void _ext2_drop_indirect_lockless(vfs_device_t* dev, uint32_t block_index)
 {
-    return (--dentry->inode->links_count) == 0;
+    for (int i = 0; i < EXT2_INDIRECT_CACHE_SIZE; i++) {
+        ext2_indirect_entry_t* entry = &MAP_CACHE.indirect[i];
+        if (entry->block_index == block_index) {
+            entry->block_index = 0;
+            entry->last_used = 0;
+            entry->dirty = false;
+        }
+    }
 }
 
-/**
- * DIR FUNCTIONS
- */
-
-// NOTE: currently only link version is supported.
-// TODO: add cache.
-static int _ext2_lookup_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, const char* name, uint32_t len, uint32_t* found_inode_index)
+static void _ext2_flush_map_cache_lockless(vfs_device_t* dev, fsdata_t fsdata)
 {
-    if (block_index == 0) {
-        return -EINVAL;
+    for (int i = 0; i < EXT2_INDIRECT_CACHE_SIZE; i++) {
+        _ext2_write_indirect_lockless(dev, fsdata, &MAP_CACHE.indirect[i]);
     }
+}
 
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
-    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    for (;;) {
-        if (start_of_entry->inode == 0) {
-            return -EFAULT;
+static uint32_t _ext2_lookup_run_lockless(vfs_device_t* dev, uint32_t inode_indx, uint32_t logical)
+{
+    for (int i = 0; i < EXT2_MAP_RUNS; i++) {
+        ext2_map_run_t* run = &MAP_CACHE.runs[i];
+        if (run->inode_indx == inode_indx && run->logical <= logical && logical < run->logical + run->count) {
+            run->last_used = ++MAP_CACHE.clock;
+            return run->physical + (logical - run->logical);
         }
+    }
+    return 0;
+}
 
-        if (start_of_entry->name_len == len) {
-            bool is_name_same = true;
-            for (int i = 0; i < start_of_entry->name_len; i++) {
-                is_name_same &= (name[i] == *((char*)start_of_entry + 8 + i));
-            }
+/**
+ * Extends a run of the inode with a resolved mapping or starts a new run,
+ * replacing the least recently used one.
+ */
+static void _ext2_add_mapping_lockless(vfs_device_t* dev, uint32_t inode_indx, uint32_t logical, uint32_t physical)
+{
+    if (!physical) {
+        return;
+    }
 
-            if (is_name_same) {
-                *found_inode_index = start_of_entry->inode;
-                return 0;
-            }
+    ext2_map_run_t* victim = &MAP_CACHE.runs[0];
+    for (int i = 0; i < EXT2_MAP_RUNS; i++) {
+        ext2_map_run_t* run = &MAP_CACHE.runs[i];
+        if (run->inode_indx == inode_indx && run->logical + run->count == logical && run->physical + run->count == physical) {
+            run->count++;
+            run->last_used = ++MAP_CACHE.clock;
+            return;
         }
-
-        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
-        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
-            return -EFAULT;
+        if (run->last_used < victim->last_used) {
+            victim = run;
         }
     }
-    return -EFAULT;
+
+    victim->inode_indx = inode_indx;
+    victim->logical = logical;
+    victim->physical = physical;
+    victim->count = 1;
+    victim->last_used = ++MAP_CACHE.clock;
 }
 
-static int _ext2_getdirent_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint32_t* offset, dirent_t* dirent)
+/**
+ * Cuts runs of the inode at @logical, so they do not cover it or anything
+ * after it. Dropping all runs of the inode is cutting at 0.
+ */
+static void _ext2_cut_runs_lockless(vfs_device_t* dev, uint32_t inode_indx, uint32_t logical)
 {
-    if (block_index == 0) {
-        return -EINVAL;
-    }
-    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    uint32_t internal_offset = *offset % block_len;
-
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
-    for (;;) {
-        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + internal_offset);
-        internal_offset += start_of_entry->rec_len;
-        *offset += start_of_entry->rec_len;
-
-        if (start_of_entry->inode != 0) {
-            int name_len = start_of_entry->name_len;
-            if (name_len > 251) {
-                log_warn("[VFS] Full name len is unsupported\n");
-                name_len = 251;
-            }
-            memcpy(dirent->name, (char*)start_of_entry + 8, name_len);
-            dirent->name[name_len] = '\0';
-            return 0;
+    for (int i = 0; i < EXT2_MAP_RUNS; i++) {
+        ext2_map_run_t* run = &MAP_CACHE.runs[i];
+        if (run->inode_indx != inode_indx || run->logical + run->count <= logical) {
+            continue;
         }
 
-        if (internal_offset >= block_len) {
-            return -EFAULT;
+        if (run->logical >= logical) {
+            run->inode_indx = 0;
+            run->count = 0;
+            run->last_used = 0;
+        } else {
+            run->count = logical - run->logical;
         }
     }
-    return -EFAULT;
 }
 
-static int _ext2_get_dir_entries_count_in_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index)
-{
-    ASSERT(block_index != 0);
+/**
+ * BLOCK FUNCTIONS
+ */
 
-    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    uint32_t internal_offset = 0;
-    int result = 0;
+static uint32_t _ext2_get_block_offset(superblock_t* sb, uint32_t block_index)
+{
+    return SUPERBLOCK_START + (block_index - 1) * BLOCK_LEN(sb);
+}
 
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
-    for (;;) {
-        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + internal_offset);
-        internal_offset += start_of_entry->rec_len;
+/**
+ * Splits the index of a block of the inode into offsets inside the inode
+ * and inside the indirect blocks on the way. Returns the count of indirect
+ * levels.
+ */
+static int _ext2_get_block_path(superblock_t* sb, uint32_t inode_block_index, uint32_t* offsets)
+{
+    const uint32_t ptrs = BLOCK_LEN(sb) / 4;
+    if (inode_block_index < 12) {
+        offsets[0] = inode_block_index;
+        return 0;
+    }
 
-        if (start_of_entry->inode != 0) {
-            result++;
-        }
+    inode_block_index -= 12;
+    if (inode_block_index < ptrs) { // single indirect
+        offsets[0] = 12;
+        offsets[1] = inode_block_index;
+        return 1;
+    }
 
-        if (internal_offset >= block_len) {
-            return result;
-        }
+    inode_block_index -= ptrs;
+    if (inode_block_index < ptrs * ptrs) { // double indirect
+        offsets[0] = 13;
+        offsets[1] = inode_block_index / ptrs;
+        offsets[2] = inode_block_index % ptrs;
+        return 2;
     }
-    return result;
+
+    inode_block_index -= ptrs * ptrs; // triple indirect
+    offsets[0] = 14;
+    offsets[1] = inode_block_index / (ptrs * ptrs);
+    offsets[2] = (inode_block_index / ptrs) % ptrs;
+    offsets[3] = inode_block_index % ptrs;
+    return 3;
 }
 
-static bool _ext2_is_dir_empty(dentry_t* dir)
+/**
+ * Returns the count of indirect blocks which map the first @data_blocks
+ * blocks of an inode.
+ */
+static uint32_t _ext2_indirect_blocks_for(superblock_t* sb, uint32_t data_blocks)
 {
-    const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
-    uint32_t end_block_index = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
-    int result = 0;
+    const uint32_t ptrs = BLOCK_LEN(sb) / 4;
+    if (data_blocks <= 12) {
+        return 0;
+    }
 
-    for (uint32_t block_index = 0; block_index < end_block_index; block_index++) {
-        uint32_t data_block_index = _ext2_get_block_of_inode(dir, block_index);
-        result += _ext2_get_dir_entries_count_in_block(dir->dev, dir->fsdata, data_block_index);
+    data_blocks -= 12;
+    if (data_blocks <= ptrs) {
+        return 1;
+    }
 
-        /* 2 here is because don't count . and .. */
-        if (result > 2) {
-            return false;
-        }
+    data_blocks -= ptrs;
+    if (data_blocks <= ptrs * ptrs) {
+        return 1 + 1 + (data_blocks + ptrs - 1) / ptrs;
     }
 
-    return true;
+    data_blocks -= ptrs * ptrs;
+    return 1 + (1 + ptrs) + 1 + (data_blocks + ptrs * ptrs - 1) / (ptrs * ptrs) + (data_blocks + ptrs - 1) / ptrs;
 }
 
 /**
- * _ext2_getdents_block puts dents into @buf from block with index @block_index.
- * @block_index: index block to put from
- * @buf: result buffer
- * @len: len of the buffer @buf
- * @inner_offset: offset of block, shows the start from where to start
- * @scanned_bytes: keeps the result value how many bytes were scanned in this block.
- * return: returns an error (if return < 0) or count of bytes written to @buf.
+ * i_blocks counts indirect blocks as well as data blocks. Returns the count
+ * of data blocks, which is the largest one that fits into i_blocks together
+ * with its indirect blocks.
  */
-static int _ext2_getdents_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint8_t* buf, uint32_t len, uint32_t inner_offset, uint32_t* scanned_bytes)
+static uint32_t _ext2_data_blocks_of_inode(dentry_t* dentry)
 {
-    if (block_index == 0) {
-        return -EINVAL;
+    superblock_t* sb = dentry->fsdata.sb;
+    uint32_t total = TO_EXT_BLOCKS_CNT(sb, dentry->inode->blocks);
+    uint32_t data_blocks = total - min(total, _ext2_indirect_blocks_for(sb, total));
+    while (data_blocks < total && data_blocks + 1 + _ext2_indirect_blocks_for(sb, data_blocks + 1) <= total) {
+        data_blocks++;
     }
-    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
-    int already_read = 0;
+    return data_blocks;
+}
 
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
-    for (;;) {
-        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + inner_offset);
-        uint32_t record_name_len = NORM_FILENAME(start_of_entry->name_len);
-        uint32_t real_rec_len = 8 + record_name_len + 1;
+static uint32_t _ext2_resolve_block_of_inode_lockless(dentry_t* dentry, uint32_t inode_block_index)
+{
+    vfs_device_t* dev = dentry->dev;
+    uint32_t offsets[4];
+    int depth = _ext2_get_block_path(dentry->fsdata.sb, inode_block_index, offsets);
+
+    uint32_t block_index = dentry->inode->block[offsets[0]];
+    for (int lev = 1; lev <= depth && block_index; lev++) {
+        ext2_indirect_entry_t* entry = _ext2_get_indirect_lockless(dev, dentry->fsdata, block_index, false);
+        if (!entry) {
+            return 0;
+        }
+        block_index = entry->data[offsets[lev]];
+    }
+    return block_index;
+}
 
-        if (real_rec_len > len) {
-            /*  There is no space to put this element in the buffer.
-                If we havn't written anything, that means we can't fit
-                the elem in the buf, so, return an error */
-            if (already_read == 0) {
-                return -EINVAL;
+/**
+ * Consecutive blocks are found in the runs without touching indirect
+ * blocks, others are resolved through the cached indirect blocks.
+ */
+static uint32_t _ext2_get_block_of_inode(dentry_t* dentry, uint32_t inode_block_index)
+{
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&MAP_CACHE.lock);
+    uint32_t res = _ext2_lookup_run_lockless(dev, dentry->inode_indx, inode_block_index);
+    if (!res) {
+        res = _ext2_resolve_block_of_inode_lockless(dentry, inode_block_index);
+        _ext2_add_mapping_lockless(dev, dentry->inode_indx, inode_block_index, res);
+    }
+    lock_release(&MAP_CACHE.lock);
+    return res;
+}
+
+/**
+ * Indirect blocks which are missing on the way are allocated, unless the
+ * mapping is being cleared (@val is 0). The dentry is marked dirty after
+ * MAP_CACHE.lock is released, since the flusher takes MAP_CACHE.lock with
+ * dentry->lock held.
+ */
+static int _ext2_set_block_of_inode(dentry_t* dentry, uint32_t inode_block_index, uint32_t val)
+{
+    vfs_device_t* dev = dentry->dev;
+    uint32_t offsets[4];
+    int depth = _ext2_get_block_path(dentry->fsdata.sb, inode_block_index, offsets);
+    bool inode_dirty = false;
+    int err = 0;
+
+    lock_acquire(&MAP_CACHE.lock);
+    _ext2_cut_runs_lockless(dev, dentry->inode_indx, inode_block_index);
+
+    uint32_t* slot = &dentry->inode->block[offsets[0]];
+    ext2_indirect_entry_t* holder = NULL;
+    for (int lev = 1; lev <= depth; lev++) {
+        bool is_new = false;
+        if (!*slot) {
+            if (!val) {
+                goto out;
             }
-            return already_read;
+
+            uint32_t new_block_index;
+            if (_ext2_allocate_block_index(dev, dentry->fsdata, &new_block_index, val, dentry->inode_indx) < 0) {
+                err = -ENOSPC;
+                goto out;
+            }
+            *slot = new_block_index;
+            if (holder) {
+                holder->dirty = true;
+            }
+            dentry->inode->blocks += BLOCK_LEN(dentry->fsdata.sb) / 512;
+            inode_dirty = true;
+            is_new = true;
         }
 
-        inner_offset += start_of_entry->rec_len;
-        *scanned_bytes += start_of_entry->rec_len;
-        if (start_of_entry->inode != 0) {
-            // Change it here, to have the correct copied data.
-            start_of_entry->rec_len = real_rec_len;
-            memcpy(buf + already_read, (uint8_t*)start_of_entry, real_rec_len);
-            buf[already_read + real_rec_len - 1] = '\0';
+        ext2_indirect_entry_t* entry = _ext2_get_indirect_lockless(dev, dentry->fsdata, *slot, is_new);
+        if (!entry) {
+            err = -ENOMEM;
+            goto out;
+        }
+        holder = entry;
+        slot = &entry->data[offsets[lev]];
+    }
 
-            already_read += real_rec_len;
-            len -= real_rec_len;
+    *slot = val;
+    if (holder) {
+        holder->dirty = true;
+    } else {
+        inode_dirty = true;
+    }
+    _ext2_add_mapping_lockless(dev, dentry->inode_indx, inode_block_index, val);
+
+out:
+    lock_release(&MAP_CACHE.lock);
+    if (inode_dirty) {
+        dentry_set_flag(dentry, DENTRY_DIRTY);
+    }
+    return err;
+}
+
+static uint32_t _ext2_get_indirect_pointer(dentry_t* dentry, uint32_t block_index, uint32_t offset)
+{
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&MAP_CACHE.lock);
+    ext2_indirect_entry_t* entry = _ext2_get_indirect_lockless(dev, dentry->fsdata, block_index, false);
+    uint32_t res = entry ? entry->data[offset] : 0;
+    lock_release(&MAP_CACHE.lock);
+    return res;
+}
+
+/**
+ * Frees the indirect block and indirect blocks under it. Data blocks it
+ * maps have to be freed before.
+ */
+static void _ext2_free_indirect_tree(dentry_t* dentry, uint32_t block_index, int depth)
+{
+    vfs_device_t* dev = dentry->dev;
+    if (!block_index) {
+        return;
+    }
+
+    if (depth > 1) {
+        const uint32_t ptrs = BLOCK_LEN(dentry->fsdata.sb) / 4;
+        for (uint32_t i = 0; i < ptrs; i++) {
+            _ext2_free_indirect_tree(dentry, _ext2_get_indirect_pointer(dentry, block_index, i), depth - 1);
         }
+    }
 
-        if (inner_offset >= block_len) {
-            return already_read;
+    lock_acquire(&MAP_CACHE.lock);
+    _ext2_drop_indirect_lockless(dev, block_index);
+    lock_release(&MAP_CACHE.lock);
+    _ext2_free_block_index(dev, dentry->fsdata, block_index);
+}
+
+static void _ext2_clear_indirect_pointer(dentry_t* dentry, uint32_t block_index, uint32_t offset)
+{
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&MAP_CACHE.lock);
+    ext2_indirect_entry_t* entry = _ext2_get_indirect_lockless(dev, dentry->fsdata, block_index, false);
+    if (entry) {
+        entry->data[offset] = 0;
+        entry->dirty = true;
+    }
+    lock_release(&MAP_CACHE.lock);
+}
+
+/**
+ * Frees indirect blocks under @block_index which map only blocks at or
+ * after @data_blocks. @first is the first data block it maps. Returns
+ * true if @block_index itself was freed.
+ */
+static bool _ext2_trim_indirect_tree(dentry_t* dentry, uint32_t block_index, int depth, uint32_t first, uint32_t data_blocks)
+{
+    if (!block_index) {
+        return false;
+    }
+
+    if (first >= data_blocks) {
+        _ext2_free_indirect_tree(dentry, block_index, depth);
+        return true;
+    }
+
+    if (depth > 1) {
+        const uint32_t ptrs = BLOCK_LEN(dentry->fsdata.sb) / 4;
+        uint32_t span = depth == 2 ? ptrs : ptrs * ptrs;
+        for (uint32_t i = 0; i < ptrs; i++) {
+            uint32_t child_first = first + i * span;
+            if (child_first + span <= data_blocks) {
+                continue;
+            }
+            if (_ext2_trim_indirect_tree(dentry, _ext2_get_indirect_pointer(dentry, block_index, i), depth - 1, child_first, data_blocks)) {
+                _ext2_clear_indirect_pointer(dentry, block_index, i);
+            }
         }
     }
-    return already_read;
+    return false;
 }
 
-static int _ext2_add_first_entry_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len)
+/**
+ * Leaves only indirect blocks which map the first @data_blocks blocks, so
+ * i_blocks stays in sync with the count of data blocks.
+ */
+static void _ext2_trim_indirect_blocks(dentry_t* dentry, uint32_t data_blocks)
+{
+    const uint32_t ptrs = BLOCK_LEN(dentry->fsdata.sb) / 4;
+    uint32_t first = 12;
+    uint32_t span = ptrs;
+    for (int lev = 1; lev <= 3; lev++) {
+        if (_ext2_trim_indirect_tree(dentry, dentry->inode->block[11 + lev], lev, first, data_blocks)) {
+            dentry->inode->block[11 + lev] = 0;
+        }
+        first += span;
+        span *= ptrs;
+    }
+}
+
+/**
+ * Takes the first free block of the group at or after @from, wrapping
+ * around to the start of the group, skipping blocks reserved for other
+ * inodes.
+ */
+static int _ext2_find_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t group_index, uint32_t from, uint32_t inode_indx)
+{
+    uint8_t* block_bitmap = _ext2_get_block_bitmap_lockless(dev, fsdata, group_index);
+    if (!block_bitmap) {
+        return -ENOMEM;
+    }
+
+    const uint32_t len = _ext2_blocks_per_group(fsdata.sb);
+    for (int pass = 0; pass < 2; pass++) {
+        int off = pass ? 0 : min(from, len);
+        uint32_t end = pass ? min(from, len) : len;
+        while ((off = _ext2_bitmap_find_zero(block_bitmap, off, end)) >= 0) {
+            uint32_t candidate = _ext2_group_block(fsdata.sb, group_index, off);
+            ext2_prealloc_window_t* window = _ext2_find_reserving_window_lockless(dev, candidate, inode_indx);
+            if (!window) {
+                _ext2_mark_block_used_lockless(dev, fsdata, group_index, off);
+                *block_index = candidate;
+                return 0;
+            }
+            off += window->end - candidate;
+        }
+    }
+    return -ENOSPC;
+}
+
+static int _ext2_take_from_window_lockless(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t inode_indx)
+{
+    ext2_prealloc_window_t* window = _ext2_get_window_lockless(dev, inode_indx);
+    if (!window) {
+        return -ENOENT;
+    }
+
+    uint32_t group_index = _ext2_group_of_block(fsdata.sb, window->next);
+    uint8_t* block_bitmap = _ext2_get_block_bitmap_lockless(dev, fsdata, group_index);
+    if (!block_bitmap) {
+        return -ENOMEM;
+    }
+
+    uint32_t group_start = _ext2_group_block(fsdata.sb, group_index, 0);
+    for (; window->next < window->end; window->next++) {
+        uint32_t off = window->next - group_start;
+        if (!_ext2_bitmap_get(block_bitmap, off)) {
+            _ext2_mark_block_used_lockless(dev, fsdata, group_index, off);
+            *block_index = window->next++;
+            window->last_used = ++ALLOC_CACHE.clock;
+            return 0;
+        }
+    }
+
+    window->inode_indx = 0;
+    return -ENOSPC;
+}
+
+/**
+ * Allocates a block for the inode: from its window if it has one, otherwise
+ * as close to @goal as possible, opening a new window after the block.
+ */
+static int _ext2_allocate_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* block_index, uint32_t goal, uint32_t inode_indx)
+{
+    lock_acquire(&ALLOC_CACHE.lock);
+    if (_ext2_take_from_window_lockless(dev, fsdata, block_index, inode_indx) == 0) {
+        lock_release(&ALLOC_CACHE.lock);
+        return 0;
+    }
+
+    uint32_t groups_cnt = fsdata.gt->count;
+    uint32_t goal_group = 0;
+    uint32_t goal_off = 0;
+    if (goal && _ext2_group_of_block(fsdata.sb, goal) < groups_cnt) {
+        goal_group = _ext2_group_of_block(fsdata.sb, goal);
+        goal_off = goal - _ext2_group_block(fsdata.sb, goal_group, 0);
+    }
+
+    for (uint32_t i = 0; i < groups_cnt; i++) {
+        uint32_t group_id = (goal_group + i) % groups_cnt;
+        if (!fsdata.gt->table[group_id].free_blocks_count) {
+            continue;
+        }
+
+        uint32_t from = i ? ALLOC_CACHE.groups[group_id].block_hint : goal_off;
+        if (_ext2_find_free_block_index(dev, fsdata, block_index, group_id, from, inode_indx) == 0) {
+            _ext2_open_window_lockless(dev, fsdata, inode_indx, *block_index);
+            lock_release(&ALLOC_CACHE.lock);
+            return 0;
+        }
+    }
+
+    lock_release(&ALLOC_CACHE.lock);
+    return -ENOSPC;
+}
+
+static int _ext2_free_block_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index)
 {
     if (block_index == 0) {
         return -EINVAL;
     }
 
-    uint32_t record_name_len = NORM_FILENAME(len);
-    uint32_t min_rec_len = 8 + record_name_len;
-    dir_entry_t new_entry;
+    uint32_t group_index = _ext2_group_of_block(fsdata.sb, block_index);
+    uint32_t off = block_index - _ext2_group_block(fsdata.sb, group_index, 0);
 
-    uint8_t tmp_buf[DIR_ENTRY_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), DIR_ENTRY_LEN);
-    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    new_entry.inode = child_dentry->inode_indx;
-    new_entry.rec_len = BLOCK_LEN(fsdata.sb);
-    new_entry.name_len = len;
-    memcpy((void*)start_of_entry, (void*)&new_entry, 8);
-    memcpy((void*)((uint32_t)start_of_entry + 8), (void*)filename, len);
-    memset((void*)((uint32_t)start_of_entry + 8 + len), 0, record_name_len - len);
-    _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), DIR_ENTRY_LEN);
+    lock_acquire(&ALLOC_CACHE.lock);
+    uint8_t* block_bitmap = _ext2_get_block_bitmap_lockless(dev, fsdata, group_index);
+    if (!block_bitmap) {
+        lock_release(&ALLOC_CACHE.lock);
+        return -ENOMEM;
+    }
+
+    if (_ext2_bitmap_get(block_bitmap, off)) {
+        ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+        _ext2_bitmap_unset_bit(block_bitmap, off);
+        group->flags |= EXT2_GROUP_BLOCK_BITMAP_DIRTY;
+        group->block_hint = min(group->block_hint, off);
+        fsdata.gt->table[group_index].free_blocks_count++;
+        fsdata.sb->free_blocks_count++;
+        ALLOC_CACHE.group_table_dirty = true;
+    }
+    lock_release(&ALLOC_CACHE.lock);
     return 0;
 }
 
-static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len)
+/**
+ * Returns allocated block in @block_index. If @goal is 0, the block is
+ * placed after the last block of the inode or in the group of the inode.
+ */
+static int _ext2_allocate_block_for_inode(dentry_t* dentry, uint32_t goal, uint32_t* block_index)
+{
+    uint32_t blocks_per_inode = _ext2_data_blocks_of_inode(dentry);
+    if (!goal && blocks_per_inode) {
+        goal = _ext2_get_block_of_inode(dentry, blocks_per_inode - 1) + 1;
+    }
+    if (!goal) {
+        goal = _ext2_group_block(dentry->fsdata.sb, _ext2_group_of_inode(dentry->fsdata.sb, dentry->inode_indx), 0);
+    }
+
+    if (_ext2_allocate_block_index(dentry->dev, dentry->fsdata, block_index, goal, dentry->inode_indx) == 0) {
+        if (_ext2_set_block_of_inode(dentry, blocks_per_inode, *block_index) == 0) {
+            dentry->inode->blocks += BLOCK_LEN(dentry->fsdata.sb) / 512;
+            dentry_set_flag(dentry, DENTRY_DIRTY);
+            return 0;
+        }
+        _ext2_free_block_index(dentry->dev, dentry->fsdata, *block_index);
+    }
+    return -ENOSPC;
+}
+
+/**
+ * INODE FUNCTIONS
+ */
+
+int ext2_read_inode(dentry_t* dentry)
+{
+    uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
+    uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
+    uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
+    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
+    return _ext2_read_from_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
+}
+
+int ext2_write_inode(dentry_t* dentry)
+{
+    uint32_t inodes_per_group = dentry->fsdata.sb->inodes_per_group;
+    uint32_t holder_group = (dentry->inode_indx - 1) / inodes_per_group;
+    uint32_t pos_inside_group = (dentry->inode_indx - 1) % inodes_per_group;
+    uint32_t inode_start = _ext2_get_block_offset(dentry->fsdata.sb, dentry->fsdata.gt->table[holder_group].inode_table) + (pos_inside_group * INODE_LEN);
+
+    /* Bitmaps and indirect blocks go first, so the inode never points to blocks which are not on the drive yet. */
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&ALLOC_CACHE.lock);
+    _ext2_flush_alloc_cache_lockless(dev, dentry->fsdata);
+    lock_release(&ALLOC_CACHE.lock);
+    lock_acquire(&MAP_CACHE.lock);
+    _ext2_flush_map_cache_lockless(dev, dentry->fsdata);
+    lock_release(&MAP_CACHE.lock);
+
+    return _ext2_write_to_dev(dentry->dev, (uint8_t*)dentry->inode, inode_start, INODE_LEN);
+}
+
+static int _ext2_find_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* inode_index, uint32_t group_index)
+{
+    uint8_t* inode_bitmap = _ext2_get_inode_bitmap_lockless(dev, fsdata, group_index);
+    if (!inode_bitmap) {
+        return -ENOMEM;
+    }
+
+    ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+    int off = _ext2_bitmap_find_zero(inode_bitmap, group->inode_hint, _ext2_inodes_per_group(fsdata.sb));
+    if (off < 0) {
+        return -ENOSPC;
+    }
+
+    *inode_index = fsdata.sb->inodes_per_group * group_index + off + 1;
+    _ext2_bitmap_set_bit(inode_bitmap, off);
+    group->flags |= EXT2_GROUP_INODE_BITMAP_DIRTY;
+    group->inode_hint = off + 1;
+    fsdata.gt->table[group_index].free_inodes_count--;
+    fsdata.sb->free_inodes_count--;
+    ALLOC_CACHE.group_table_dirty = true;
+    return 0;
+}
+
+static int _ext2_allocate_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t* inode_index, uint32_t pref_group)
+{
+    uint32_t groups_cnt = fsdata.gt->count;
+    lock_acquire(&ALLOC_CACHE.lock);
+    for (int i = 0; i < groups_cnt; i++) {
+        uint32_t group_id = (pref_group + i) % groups_cnt;
+        if (fsdata.gt->table[group_id].free_inodes_count) {
+            if (_ext2_find_free_inode_index(dev, fsdata, inode_index, group_id) == 0) {
+                lock_release(&ALLOC_CACHE.lock);
+                return 0;
+            }
+        }
+    }
+    lock_release(&ALLOC_CACHE.lock);
+    return -ENOSPC;
+}
+
+static int _ext2_free_inode_index(vfs_device_t* dev, fsdata_t fsdata, uint32_t inode_index)
+{
+    uint32_t group_index = _ext2_group_of_inode(fsdata.sb, inode_index);
+    uint32_t off = (inode_index - 1) % fsdata.sb->inodes_per_group;
+
+    lock_acquire(&ALLOC_CACHE.lock);
+    _ext2_release_window_lockless(dev, inode_index);
+    uint8_t* inode_bitmap = _ext2_get_inode_bitmap_lockless(dev, fsdata, group_index);
+    if (!inode_bitmap) {
+        lock_release(&ALLOC_CACHE.lock);
+        return -ENOMEM;
+    }
+
+    if (_ext2_bitmap_get(inode_bitmap, off)) {
+        ext2_group_cache_t* group = &ALLOC_CACHE.groups[group_index];
+        _ext2_bitmap_unset_bit(inode_bitmap, off);
+        group->flags |= EXT2_GROUP_INODE_BITMAP_DIRTY;
+        group->inode_hint = min(group->inode_hint, off);
+        fsdata.gt->table[group_index].free_inodes_count++;
+        fsdata.sb->free_inodes_count++;
+        ALLOC_CACHE.group_table_dirty = true;
+    }
+    lock_release(&ALLOC_CACHE.lock);
+    return 0;
+}
+
+int ext2_free_inode(dentry_t* dentry)
+{
+    ASSERT(dentry->d_count == 0 && dentry->inode->links_count == 0);
+    uint32_t block_per_dir = _ext2_data_blocks_of_inode(dentry);
+
+    /* freeing all data blocks */
+    for (int block_index = 0; block_index < block_per_dir; block_index++) {
+        uint32_t data_block_index = _ext2_get_block_of_inode(dentry, block_index);
+        _ext2_free_block_index(dentry->dev, dentry->fsdata, data_block_index);
+    }
+
+    /* and indirect blocks, which mapped them */
+    for (int lev = 1; lev <= 3; lev++) {
+        _ext2_free_indirect_tree(dentry, dentry->inode->block[11 + lev], lev);
+        dentry->inode->block[11 + lev] = 0;
+    }
+
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&MAP_CACHE.lock);
+    _ext2_cut_runs_lockless(dev, dentry->inode_indx, 0);
+    lock_release(&MAP_CACHE.lock);
+
+    _ext2_free_inode_index(dentry->dev, dentry->fsdata, dentry->inode_indx);
+    return 0;
+}
+
+static int _ext2_decriment_links_count(dentry_t* dentry)
+{
+    return (--dentry->inode->links_count) == 0;
+}
+
+/**
+ * DIR FUNCTIONS
+ */
+
+// NOTE: currently only link version is supported.
+static int _ext2_lookup_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, const char* name, uint32_t len, uint32_t* found_inode_index)
 {
     if (block_index == 0) {
         return -EINVAL;
     }
 
-    uint32_t record_name_len = NORM_FILENAME(len);
-    uint32_t min_rec_len = 8 + record_name_len;
-    dir_entry_t new_entry;
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
+    for (;;) {
+        /* Deleted entries and index nodes have a zero inode. */
+        if (start_of_entry->inode != 0 && start_of_entry->name_len == len) {
+            bool is_name_same = true;
+            for (int i = 0; i < start_of_entry->name_len; i++) {
+                is_name_same &= (name[i] == *((char*)start_of_entry + 8 + i));
+            }
+
+            if (is_name_same) {
+                *found_inode_index = start_of_entry->inode;
+                return 0;
+            }
+        }
+
+        if (start_of_entry->rec_len == 0) {
+            return -EFAULT;
+        }
+
+        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
+        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
+            return -ENOENT;
+        }
+    }
+    return -EFAULT;
+}
+
+static int _ext2_getdirent_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint32_t* offset, dirent_t* dirent)
+{
+    if (block_index == 0) {
+        return -EINVAL;
+    }
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
+    uint32_t internal_offset = *offset % block_len;
+
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
+    for (;;) {
+        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + internal_offset);
+        internal_offset += start_of_entry->rec_len;
+        *offset += start_of_entry->rec_len;
+
+        if (start_of_entry->inode != 0) {
+            int name_len = start_of_entry->name_len;
+            if (name_len > 251) {
+                log_warn("[VFS] Full name len is unsupported\n");
+                name_len = 251;
+            }
+            memcpy(dirent->name, (char*)start_of_entry + 8, name_len);
+            dirent->name[name_len] = '\0';
+            return 0;
+        }
+
+        if (internal_offset >= block_len) {
+            return -EFAULT;
+        }
+    }
+    return -EFAULT;
+}
+
+static int _ext2_get_dir_entries_count_in_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index)
+{
+    ASSERT(block_index != 0);
+
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
+    uint32_t internal_offset = 0;
+    int result = 0;
+
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
+    for (;;) {
+        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + internal_offset);
+        internal_offset += start_of_entry->rec_len;
+
+        if (start_of_entry->inode != 0) {
+            result++;
+        }
+
+        if (internal_offset >= block_len) {
+            return result;
+        }
+    }
+    return result;
+}
+
+static bool _ext2_is_dir_empty(dentry_t* dir)
+{
+    const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
+    uint32_t end_block_index = _ext2_data_blocks_of_inode(dir);
+    int result = 0;
+
+    for (uint32_t block_index = 0; block_index < end_block_index; block_index++) {
+        uint32_t data_block_index = _ext2_get_block_of_inode(dir, block_index);
+        result += _ext2_get_dir_entries_count_in_block(dir->dev, dir->fsdata, data_block_index);
+
+        /* 2 here is because don't count . and .. */
+        if (result > 2) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * _ext2_getdents_block puts dents into @buf from block with index @block_index.
+ * @block_index: index block to put from
+ * @buf: result buffer
+ * @len: len of the buffer @buf
+ * @inner_offset: offset of block, shows the start from where to start
+ * @scanned_bytes: keeps the result value how many bytes were scanned in this block.
+ * return: returns an error (if return < 0) or count of bytes written to @buf.
+ */
+static int _ext2_getdents_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, uint8_t* buf, uint32_t len, uint32_t inner_offset, uint32_t* scanned_bytes)
+{
+    if (block_index == 0) {
+        return -EINVAL;
+    }
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
+    int already_read = 0;
+
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
+    for (;;) {
+        dir_entry_t* start_of_entry = (dir_entry_t*)((uint32_t)tmp_buf + inner_offset);
+        uint32_t record_name_len = NORM_FILENAME(start_of_entry->name_len);
+        uint32_t real_rec_len = 8 + record_name_len + 1;
+
+        if (real_rec_len > len) {
+            /*  There is no space to put this element in the buffer.
+                If we havn't written anything, that means we can't fit
+                the elem in the buf, so, return an error */
+            if (already_read == 0) {
+                return -EINVAL;
+            }
+            return already_read;
+        }
+
+        inner_offset += start_of_entry->rec_len;
+        *scanned_bytes += start_of_entry->rec_len;
+        if (start_of_entry->inode != 0) {
+            // Change it here, to have the correct copied data.
+            start_of_entry->rec_len = real_rec_len;
+            memcpy(buf + already_read, (uint8_t*)start_of_entry, real_rec_len);
+            buf[already_read + real_rec_len - 1] = '\0';
+
+            already_read += real_rec_len;
+            len -= real_rec_len;
+        }
+
+        if (inner_offset >= block_len) {
+            return already_read;
+        }
+    }
+    return already_read;
+}
+
+static inline uint8_t _ext2_get_file_type(fsdata_t fsdata, dentry_t* dentry)
+{
+    if (fsdata.sb->rev_level < 1 || !(fsdata.sb->feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE)) {
+        return EXT2_FT_UNKNOWN;
+    }
+
+    switch (dentry->inode->mode & 0xF000) {
+    case S_IFREG:
+        return EXT2_FT_REG_FILE;
+    case S_IFDIR:
+        return EXT2_FT_DIR;
+    default:
+        return EXT2_FT_UNKNOWN;
+    }
+}
+
+static void _ext2_fill_dir_entry(fsdata_t fsdata, dir_entry_t* entry, dentry_t* child_dentry, const char* filename, uint32_t len, uint32_t rec_len)
+{
+    uint32_t record_name_len = NORM_FILENAME(len);
+    entry->inode = child_dentry->inode_indx;
+    entry->rec_len = rec_len;
+    entry->name_len = len;
+    entry->file_type = _ext2_get_file_type(fsdata, child_dentry);
+    memcpy((void*)((uint32_t)entry + 8), (void*)filename, len);
+    memset((void*)((uint32_t)entry + 8 + len), 0, record_name_len - len);
+}
+
+static int _ext2_add_first_entry_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len)
+{
+    if (block_index == 0) {
+        return -EINVAL;
+    }
+
+    const uint32_t block_len = BLOCK_LEN(fsdata.sb);
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    memset(tmp_buf, 0, block_len);
+    _ext2_fill_dir_entry(fsdata, (dir_entry_t*)tmp_buf, child_dentry, filename, len, block_len);
+    _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), block_len);
+    return 0;
+}
+
+static int _ext2_add_to_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry, const char* filename, uint32_t len)
+{
+    if (block_index == 0) {
+        return -EINVAL;
+    }
+
+    uint32_t record_name_len = NORM_FILENAME(len);
+    uint32_t min_rec_len = 8 + record_name_len;
+
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
+
+    for (;;) {
+        /* An empty entry (the first one of a block could be such) is reused as a whole. */
+        uint32_t cur_rec_len = start_of_entry->inode ? 8 + NORM_FILENAME(start_of_entry->name_len) : 0;
+        if (start_of_entry->rec_len == 0) {
+            return -EFAULT;
+        }
+
+        // We have enough place to put both records
+        if (start_of_entry->rec_len >= cur_rec_len + min_rec_len) {
+            uint32_t new_rec_len = start_of_entry->rec_len - cur_rec_len;
+            dir_entry_t* start_of_new_entry = (dir_entry_t*)((uint32_t)start_of_entry + cur_rec_len);
+            if (cur_rec_len) {
+                start_of_entry->rec_len = cur_rec_len;
+            }
+            _ext2_fill_dir_entry(fsdata, start_of_new_entry, child_dentry, filename, len, new_rec_len);
+            _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+            return 0;
+        }
+
+        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
+        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
+            return -ENOSPC;
+        }
+    }
+}
+
+static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry)
+{
+    if (block_index == 0) {
+        return -EINVAL;
+    }
+
+    uint8_t tmp_buf[MAX_BLOCK_LEN];
+    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
+    dir_entry_t* prev_entry = (dir_entry_t*)0;
+
+    for (;;) {
+        if (start_of_entry->inode == child_dentry->inode_indx) {
+            /* deleting entry, the first one of a block is just marked as empty */
+            start_of_entry->inode = 0;
+            if (prev_entry) {
+                prev_entry->rec_len += start_of_entry->rec_len;
+            }
+
+            _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+            return 0;
+        }
+
+        if (start_of_entry->rec_len == 0) {
+            return -EFAULT;
+        }
+
+        prev_entry = start_of_entry;
+        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
+        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
+            return -ENOENT;
+        }
+    }
+}
+
+static void _ext2_remember_dir_hint(dentry_t* dir, uint32_t inode_indx, uint32_t block)
+{
+    ext2_dir_hint_t* hints = _ext2_dir_hints[dir->dev->dev->id];
+    ext2_dir_hint_t* hint = &hints[inode_indx % EXT2_DIR_HINTS];
+    hint->dir_inode_indx = dir->inode_indx;
+    hint->inode_indx = inode_indx;
+    hint->block = block;
+}
+
+static int _ext2_rm_child_by_hint(dentry_t* dir, dentry_t* child_dentry)
+{
+    ext2_dir_hint_t* hint = &_ext2_dir_hints[dir->dev->dev->id][child_dentry->inode_indx % EXT2_DIR_HINTS];
+    if (hint->dir_inode_indx != dir->inode_indx || hint->inode_indx != child_dentry->inode_indx) {
+        return -ENOENT;
+    }
+
+    hint->dir_inode_indx = 0;
+    if (hint->block >= _ext2_data_blocks_of_inode(dir)) {
+        return -ENOENT;
+    }
+
+    uint32_t block_index = _ext2_get_block_of_inode(dir, hint->block);
+    return _ext2_rm_from_dir_block(dir->dev, dir->fsdata, block_index, child_dentry);
+}
+
+static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, int len)
+{
+    uint32_t block_index;
+    uint32_t blocks_per_dir = _ext2_data_blocks_of_inode(dir);
+
+    if (dir->inode->flags & EXT2_INDEX_FL) {
+        int err = _ext2_dx_add_child(dir, child_dentry, name, len);
+        if (err == 0) {
+            goto updated_inode;
+        }
+        if (err != -EINVAL) {
+            return err;
+        }
+
+        /* The index is broken, but the entries are still valid for a linear scan. */
+        log_warn("Ext2: dir %d has a broken index, dropping it", dir->inode_indx);
+        dir->inode->flags &= ~EXT2_INDEX_FL;
+        dentry_set_flag(dir, DENTRY_DIRTY);
+    }
+
+    for (int i = 0; i < blocks_per_dir; i++) {
+        if ((block_index = _ext2_get_block_of_inode(dir, i))) {
+            if (_ext2_add_to_dir_block(dir->dev, dir->fsdata, block_index, child_dentry, name, len) == 0) {
+                goto updated_inode;
+            }
+        }
+    }
+
+    /* The dir outgrows its first block, so it becomes indexed instead of getting a second one. */
+    if (blocks_per_dir == 1 && _ext2_dx_create_index(dir) == 0) {
+        if (_ext2_dx_add_child(dir, child_dentry, name, len) == 0) {
+            goto updated_inode;
+        }
+        dir->inode->flags &= ~EXT2_INDEX_FL;
+        dentry_set_flag(dir, DENTRY_DIRTY);
+    }
+
+    uint32_t new_block_index;
+    if (_ext2_allocate_block_for_inode(dir, 0, &new_block_index) == 0) {
+        if (_ext2_add_first_entry_to_dir_block(dir->dev, dir->fsdata, new_block_index, child_dentry, name, len) == 0) {
+            goto updated_inode;
+        }
+    }
+
+    return -EFAULT;
+
+updated_inode:
+    child_dentry->inode->links_count++;
+    dentry_set_flag(child_dentry, DENTRY_DIRTY);
+    return 0;
+}
+
+static int _ext2_rm_child(dentry_t* dir, dentry_t* child_dentry)
+{
+    uint32_t block_index;
+    uint32_t blocks_per_dir = _ext2_data_blocks_of_inode(dir);
+
+    if (_ext2_rm_child_by_hint(dir, child_dentry) == 0) {
+        goto updated_inode;
+    }
+
+    for (int i = 0; i < blocks_per_dir; i++) {
+        if ((block_index = _ext2_get_block_of_inode(dir, i))) {
+            if (_ext2_rm_from_dir_block(dir->dev, dir->fsdata, block_index, child_dentry) == 0) {
+                goto updated_inode;
+            }
+        }
+    }
+
+    return -ENOENT;
+
+updated_inode:
+    child_dentry->inode->links_count--;
+    dentry_set_flag(child_dentry, DENTRY_DIRTY);
+    return 0;
+}
+
+static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode)
+{
+    dir->inode->mode = mode;
+    dir->inode->uid = 0; // FIXME: uid of real user
+    dir->inode->links_count = 0;
+    dir->inode->blocks = 0;
+    dentry_set_flag(dir, DENTRY_DIRTY);
+    if (_ext2_add_child(dir, dir, ".", 1) < 0) {
+        return -EFAULT;
+    }
+    if (_ext2_add_child(dir, parent_dir, "..", 2) < 0) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+/**
+ * DIR INDEX FUNCTIONS
+ */
+
+static inline uint32_t _ext2_dx_default_hash_version(superblock_t* sb)
+{
+    if (sb->rev_level >= 1 && sb->def_hash_version <= EXT2_DX_HASH_TEA) {
+        return sb->def_hash_version;
+    }
+    return EXT2_DX_HASH_HALF_MD4;
+}
+
+static inline uint32_t _ext2_dx_name_hash(superblock_t* sb, uint32_t version, const char* name, uint32_t len)
+{
+    if (sb->flags & EXT2_FLAGS_UNSIGNED_HASH) {
+        version += EXT2_DX_HASH_LEGACY_UNSIGNED;
+    }
+    return ext2_dx_hash(name, len, version, sb->hash_seed);
+}
+
+static inline dx_countlimit_t* _ext2_dx_countlimit(dx_entry_t* entries)
+{
+    return (dx_countlimit_t*)entries;
+}
+
+static inline uint32_t _ext2_dx_node_limit(superblock_t* sb)
+{
+    return (BLOCK_LEN(sb) - EXT2_DX_NODE_ENTRIES_OFFSET) / sizeof(dx_entry_t);
+}
+
+static int _ext2_dx_read_block(dentry_t* dir, uint32_t block, uint8_t* buf)
+{
+    if (block >= _ext2_data_blocks_of_inode(dir)) {
+        return -EINVAL;
+    }
+
+    uint32_t block_index = _ext2_get_block_of_inode(dir, block);
+    if (!block_index) {
+        return -EINVAL;
+    }
+
+    _ext2_read_from_dev(dir->dev, buf, _ext2_get_block_offset(dir->fsdata.sb, block_index), BLOCK_LEN(dir->fsdata.sb));
+    return 0;
+}
+
+static void _ext2_dx_write_block(dentry_t* dir, uint32_t block, uint8_t* buf)
+{
+    uint32_t block_index = _ext2_get_block_of_inode(dir, block);
+    _ext2_write_to_dev(dir->dev, buf, _ext2_get_block_offset(dir->fsdata.sb, block_index), BLOCK_LEN(dir->fsdata.sb));
+}
+
+static void _ext2_dx_release_frames(ext2_dx_frame_t* frames, int count)
+{
+    for (int i = 0; i < count; i++) {
+        kfree(frames[i].buf);
+    }
+}
+
+/**
+ * Walks the index down to the leaf which could hold the name. Index blocks
+ * on the way are kept in @frames and have to be released by the caller.
+ * Returns the count of frames or -EINVAL if the index is broken.
+ */
+static int _ext2_dx_probe(dentry_t* dir, const char* name, uint32_t len, uint32_t* hash, uint32_t* hash_version, ext2_dx_frame_t* frames)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    int count = 0;
+
+    frames[0].block = 0;
+    frames[0].buf = kmalloc(block_len);
+    if (!frames[0].buf) {
+        return -ENOMEM;
+    }
+    count++;
+
+    if (_ext2_dx_read_block(dir, 0, frames[0].buf) < 0) {
+        goto broken;
+    }
+
+    dx_root_info_t* info = (dx_root_info_t*)&frames[0].buf[EXT2_DX_ROOT_INFO_OFFSET];
+    if (info->reserved_zero || info->info_length != sizeof(dx_root_info_t) || info->indirect_levels >= EXT2_DX_MAX_LEVELS || info->hash_version > EXT2_DX_HASH_TEA) {
+        goto broken;
+    }
+
+    *hash_version = info->hash_version;
+    *hash = _ext2_dx_name_hash(sb, info->hash_version, name, len);
+    frames[0].entries = (dx_entry_t*)&frames[0].buf[EXT2_DX_ROOT_INFO_OFFSET + info->info_length];
+
+    for (int level = 0;; level++) {
+        ext2_dx_frame_t* frame = &frames[level];
+        dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+        if (countlimit->count == 0 || countlimit->count > countlimit->limit) {
+            goto broken;
+        }
+
+        /* The entry with the largest hash which is not above the looked up one. */
+        dx_entry_t* left = frame->entries + 1;
+        dx_entry_t* right = frame->entries + countlimit->count - 1;
+        while (left <= right) {
+            dx_entry_t* mid = left + (right - left) / 2;
+            if (mid->hash > *hash) {
+                right = mid - 1;
+            } else {
+                left = mid + 1;
+            }
+        }
+        frame->at = left - 1;
+
+        if (level == info->indirect_levels) {
+            return count;
+        }
+
+        ext2_dx_frame_t* next = &frames[level + 1];
+        next->block = frame->at->block;
+        next->buf = kmalloc(block_len);
+        if (!next->buf) {
+            _ext2_dx_release_frames(frames, count);
+            return -ENOMEM;
+        }
+        count++;
+
+        if (_ext2_dx_read_block(dir, next->block, next->buf) < 0) {
+            goto broken;
+        }
+        next->entries = (dx_entry_t*)&next->buf[EXT2_DX_NODE_ENTRIES_OFFSET];
+    }
+
+broken:
+    _ext2_dx_release_frames(frames, count);
+    return -EINVAL;
+}
+
+/**
+ * Names whose hashes are equal could be split between neighbour leaves,
+ * the lowest bit of the hash in the index marks such a continuation.
+ */
+static inline bool _ext2_dx_has_continuation(ext2_dx_frame_t* frame, uint32_t hash)
+{
+    dx_entry_t* next = frame->at + 1;
+    if (next >= frame->entries + _ext2_dx_countlimit(frame->entries)->count) {
+        return false;
+    }
+    return (next->hash & 1) && (next->hash & ~1) == hash;
+}
+
+static int _ext2_dx_lookup(dentry_t* dir, const char* name, uint32_t len, uint32_t* found_inode_index, uint32_t* found_block)
+{
+    ext2_dx_frame_t frames[EXT2_DX_MAX_LEVELS];
+    uint32_t hash, hash_version;
+    int count = _ext2_dx_probe(dir, name, len, &hash, &hash_version, frames);
+    if (count < 0) {
+        return count;
+    }
+
+    ext2_dx_frame_t* frame = &frames[count - 1];
+    int err = -ENOENT;
+    for (;;) {
+        uint32_t block_index = _ext2_get_block_of_inode(dir, frame->at->block);
+        if (_ext2_lookup_block(dir->dev, dir->fsdata, block_index, name, len, found_inode_index) == 0) {
+            *found_block = frame->at->block;
+            err = 0;
+            break;
+        }
+
+        if (!_ext2_dx_has_continuation(frame, hash)) {
+            break;
+        }
+        frame->at++;
+    }
+
+    _ext2_dx_release_frames(frames, count);
+    return err;
+}
+
+static void _ext2_dx_insert_entry(ext2_dx_frame_t* frame, uint32_t hash, uint32_t block)
+{
+    dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+    dx_entry_t* new_entry = frame->at + 1;
+    uint32_t tail = (frame->entries + countlimit->count) - new_entry;
+    memmove(new_entry + 1, new_entry, tail * sizeof(dx_entry_t));
+    new_entry->hash = hash;
+    new_entry->block = block;
+    countlimit->count++;
+}
+
+/**
+ * Index nodes look like blocks with a single empty entry.
+ */
+static void _ext2_dx_init_node(uint8_t* buf, uint32_t block_len)
+{
+    memset(buf, 0, block_len);
+    dir_entry_t* fake_entry = (dir_entry_t*)buf;
+    fake_entry->inode = 0;
+    fake_entry->rec_len = block_len;
+}
+
+static int _ext2_dx_append_block(dentry_t* dir, uint32_t* block)
+{
+    uint32_t block_index;
+    *block = _ext2_data_blocks_of_inode(dir);
+    return _ext2_allocate_block_for_inode(dir, 0, &block_index);
+}
+
+/**
+ * Makes sure the lowest index block on the path has room for one more
+ * entry: a full root moves its entries to a new node and the tree grows
+ * by a level, a full node is split in halves. Frames keep pointing to the
+ * same place of the index.
+ */
+static int _ext2_dx_make_room(dentry_t* dir, ext2_dx_frame_t* frames, int* count)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    ext2_dx_frame_t* frame = &frames[*count - 1];
+    dx_countlimit_t* countlimit = _ext2_dx_countlimit(frame->entries);
+    if (countlimit->count < countlimit->limit) {
+        return 0;
+    }
+
+    uint32_t new_block;
+    uint8_t* new_buf = kmalloc(block_len);
+    if (!new_buf) {
+        return -ENOMEM;
+    }
+
+    if (*count == 1) {
+        if (_ext2_dx_append_block(dir, &new_block) < 0) {
+            kfree(new_buf);
+            return -ENOSPC;
+        }
+
+        _ext2_dx_init_node(new_buf, block_len);
+        dx_entry_t* new_entries = (dx_entry_t*)&new_buf[EXT2_DX_NODE_ENTRIES_OFFSET];
+        memcpy(new_entries, frame->entries, countlimit->count * sizeof(dx_entry_t));
+        _ext2_dx_countlimit(new_entries)->limit = _ext2_dx_node_limit(sb);
+
+        dx_root_info_t* info = (dx_root_info_t*)&frame->buf[EXT2_DX_ROOT_INFO_OFFSET];
+        info->indirect_levels = 1;
+        countlimit->count = 1;
+        frame->entries[0].block = new_block;
+
+        frames[1].block = new_block;
+        frames[1].buf = new_buf;
+        frames[1].entries = new_entries;
+        frames[1].at = new_entries + (frame->at - frame->entries);
+        frame->at = frame->entries;
+        *count = 2;
+
+        _ext2_dx_write_block(dir, frames[1].block, frames[1].buf);
+        _ext2_dx_write_block(dir, frames[0].block, frames[0].buf);
+        return 0;
+    }
+
+    ext2_dx_frame_t* root = &frames[0];
+    dx_countlimit_t* root_countlimit = _ext2_dx_countlimit(root->entries);
+    if (root_countlimit->count >= root_countlimit->limit) {
+        kfree(new_buf);
+        return -ENOSPC;
+    }
+
+    if (_ext2_dx_append_block(dir, &new_block) < 0) {
+        kfree(new_buf);
+        return -ENOSPC;
+    }
+
+    uint32_t total = countlimit->count;
+    uint32_t half = total / 2;
+    uint32_t split_hash = frame->entries[half].hash;
+
+    _ext2_dx_init_node(new_buf, block_len);
+    dx_entry_t* new_entries = (dx_entry_t*)&new_buf[EXT2_DX_NODE_ENTRIES_OFFSET];
+    memcpy(new_entries, frame->entries + half, (total - half) * sizeof(dx_entry_t));
+    _ext2_dx_countlimit(new_entries)->limit = _ext2_dx_node_limit(sb);
+    _ext2_dx_countlimit(new_entries)->count = total - half;
+    countlimit->count = half;
+
+    _ext2_dx_insert_entry(root, split_hash, new_block);
+    _ext2_dx_write_block(dir, frame->block, frame->buf);
+    _ext2_dx_write_block(dir, new_block, new_buf);
+    _ext2_dx_write_block(dir, root->block, root->buf);
+
+    if (frame->at >= frame->entries + half) {
+        frame->at = new_entries + (frame->at - (frame->entries + half));
+        kfree(frame->buf);
+        frame->block = new_block;
+        frame->buf = new_buf;
+        frame->entries = new_entries;
+        root->at++;
+    } else {
+        kfree(new_buf);
+    }
+    return 0;
+}
+
+static void _ext2_dx_pack_entries(uint8_t* src, ext2_dx_map_entry_t* map, uint32_t from, uint32_t to, uint8_t* dst, uint32_t block_len)
+{
+    uint32_t offset = 0;
+    dir_entry_t* last_entry = (dir_entry_t*)dst;
+
+    memset(dst, 0, block_len);
+    for (uint32_t i = from; i < to; i++) {
+        dir_entry_t* entry = (dir_entry_t*)&src[map[i].offset];
+        uint32_t rec_len = 8 + NORM_FILENAME(entry->name_len);
+        memcpy(&dst[offset], entry, rec_len);
+        last_entry = (dir_entry_t*)&dst[offset];
+        last_entry->rec_len = rec_len;
+        offset += rec_len;
+    }
+    last_entry->rec_len += block_len - offset;
+}
+
+/**
+ * Moves the upper half of the entries of the leaf, ordered by hash, to a
+ * new block of the dir. @split_hash gets the lowest hash of the moved
+ * entries, with the continuation bit set if it is shared with the lower half.
+ */
+static int _ext2_dx_split_leaf(dentry_t* dir, uint32_t hash_version, uint32_t block, uint32_t* new_block, uint32_t* split_hash)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    const uint32_t max_entries = block_len / 12;
+    int err = 0;
+
+    uint8_t* bufs = kmalloc(3 * block_len);
+    ext2_dx_map_entry_t* map = kmalloc(max_entries * sizeof(ext2_dx_map_entry_t));
+    if (!bufs || !map) {
+        err = -ENOMEM;
+        goto out;
+    }
+
+    uint8_t* leaf_buf = bufs;
+    uint8_t* lower_buf = bufs + block_len;
+    uint8_t* upper_buf = bufs + 2 * block_len;
+    if (_ext2_dx_read_block(dir, block, leaf_buf) < 0) {
+        err = -EINVAL;
+        goto out;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t offset = 0; offset < block_len && count < max_entries;) {
+        dir_entry_t* entry = (dir_entry_t*)&leaf_buf[offset];
+        if (entry->rec_len == 0) {
+            err = -EINVAL;
+            goto out;
+        }
+        if (entry->inode) {
+            map[count].hash = _ext2_dx_name_hash(sb, hash_version, (char*)entry + 8, entry->name_len);
+            map[count].offset = offset;
+            count++;
+        }
+        offset += entry->rec_len;
+    }
+
+    if (count < 2) {
+        err = -ENOSPC;
+        goto out;
+    }
+
+    /* Insertion sort, a leaf holds not that many entries. */
+    for (uint32_t i = 1; i < count; i++) {
+        ext2_dx_map_entry_t cur = map[i];
+        uint32_t j = i;
+        while (j > 0 && map[j - 1].hash > cur.hash) {
+            map[j] = map[j - 1];
+            j--;
+        }
+        map[j] = cur;
+    }
+
+    uint32_t split = count / 2;
+    *split_hash = map[split].hash | (map[split].hash == map[split - 1].hash);
+
+    if (_ext2_dx_append_block(dir, new_block) < 0) {
+        err = -ENOSPC;
+        goto out;
+    }
+
+    _ext2_dx_pack_entries(leaf_buf, map, 0, split, lower_buf, block_len);
+    _ext2_dx_pack_entries(leaf_buf, map, split, count, upper_buf, block_len);
+    _ext2_dx_write_block(dir, block, lower_buf);
+    _ext2_dx_write_block(dir, *new_block, upper_buf);
+
+out:
+    if (map) {
+        kfree(map);
+    }
+    if (bufs) {
+        kfree(bufs);
+    }
+    return err;
+}
+
+static int _ext2_dx_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, uint32_t len)
+{
+    ext2_dx_frame_t frames[EXT2_DX_MAX_LEVELS];
+    uint32_t hash, hash_version;
+    int count = _ext2_dx_probe(dir, name, len, &hash, &hash_version, frames);
+    if (count < 0) {
+        return count;
+    }
+
+    ext2_dx_frame_t* frame = &frames[count - 1];
+    uint32_t block_index = _ext2_get_block_of_inode(dir, frame->at->block);
+    int err = _ext2_add_to_dir_block(dir->dev, dir->fsdata, block_index, child_dentry, name, len);
+    if (err != -ENOSPC) {
+        goto out;
+    }
+
+    err = _ext2_dx_make_room(dir, frames, &count);
+    if (err) {
+        goto out;
+    }
+    frame = &frames[count - 1];
+
+    uint32_t new_block, split_hash;
+    err = _ext2_dx_split_leaf(dir, hash_version, frame->at->block, &new_block, &split_hash);
+    if (err) {
+        goto out;
+    }
+
+    uint32_t target_block = (hash >= (split_hash & ~1)) ? new_block : frame->at->block;
+    _ext2_dx_insert_entry(frame, split_hash, new_block);
+    _ext2_dx_write_block(dir, frame->block, frame->buf);
+
+    block_index = _ext2_get_block_of_inode(dir, target_block);
+    err = _ext2_add_to_dir_block(dir->dev, dir->fsdata, block_index, child_dentry, name, len);
+
+out:
+    _ext2_dx_release_frames(frames, count);
+    return err;
+}
 
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
-    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    dir_entry_t* start_of_new_entry;
+/**
+ * Turns a dir with a single full block into an indexed one: entries are
+ * moved to a new leaf and block 0 becomes the root of the index.
+ */
+static int _ext2_dx_create_index(dentry_t* dir)
+{
+    superblock_t* sb = dir->fsdata.sb;
+    const uint32_t block_len = BLOCK_LEN(sb);
+    const uint32_t max_entries = block_len / 12;
+    int err = 0;
+
+    uint8_t* bufs = kmalloc(2 * block_len);
+    ext2_dx_map_entry_t* map = kmalloc(max_entries * sizeof(ext2_dx_map_entry_t));
+    if (!bufs || !map) {
+        err = -ENOMEM;
+        goto out;
+    }
 
-    if (start_of_entry->inode == 0) {
-        kpanic("Ext2: can't add as first entry with help of that function.");
+    uint8_t* root_buf = bufs;
+    uint8_t* leaf_buf = bufs + block_len;
+    if (_ext2_dx_read_block(dir, 0, root_buf) < 0) {
+        err = -EINVAL;
+        goto out;
     }
 
-    for (;;) {
-        uint32_t cur_filename_len = NORM_FILENAME(start_of_entry->name_len);
-        uint32_t cur_rec_len = 8 + cur_filename_len;
+    dir_entry_t* dot = (dir_entry_t*)root_buf;
+    if (dot->name_len != 1 || dot->rec_len != 12) {
+        err = -EINVAL;
+        goto out;
+    }
+    dir_entry_t* dotdot = (dir_entry_t*)&root_buf[dot->rec_len];
+    if (dotdot->name_len != 2 || dotdot->rec_len < 12) {
+        err = -EINVAL;
+        goto out;
+    }
 
-        // We have enough place to put both records
-        if (start_of_entry->rec_len >= cur_rec_len + min_rec_len) {
-            new_entry.inode = child_dentry->inode_indx;
-            new_entry.rec_len = start_of_entry->rec_len - cur_rec_len;
-            new_entry.name_len = len;
-            start_of_new_entry = (dir_entry_t*)((uint32_t)start_of_entry + cur_rec_len);
-            start_of_entry->rec_len = cur_rec_len;
-            goto update_res;
+    uint32_t count = 0;
+    for (uint32_t offset = 12 + dotdot->rec_len; offset < block_len && count < max_entries;) {
+        dir_entry_t* entry = (dir_entry_t*)&root_buf[offset];
+        if (entry->rec_len == 0) {
+            err = -EINVAL;
+            goto out;
         }
-
-        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
-        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
-            return -EFAULT;
+        if (entry->inode) {
+            map[count].offset = offset;
+            count++;
         }
+        offset += entry->rec_len;
     }
 
-update_res:
-    memcpy((void*)start_of_new_entry, (void*)&new_entry, 8);
-    memcpy((void*)((uint32_t)start_of_new_entry + 8), (void*)filename, len);
-    memset((void*)((uint32_t)start_of_new_entry + 8 + len), 0, record_name_len - len);
-    _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
-    return 0;
-}
+    uint32_t leaf_block;
+    if (_ext2_dx_append_block(dir, &leaf_block) < 0) {
+        err = -ENOSPC;
+        goto out;
+    }
 
-static int _ext2_rm_from_dir_block(vfs_device_t* dev, fsdata_t fsdata, uint32_t block_index, dentry_t* child_dentry)
-{
-    if (block_index == 0) {
-        return -EINVAL;
+    if (count) {
+        _ext2_dx_pack_entries(root_buf, map, 0, count, leaf_buf, block_len);
+    } else {
+        _ext2_dx_init_node(leaf_buf, block_len);
     }
+    _ext2_dx_write_block(dir, leaf_block, leaf_buf);
 
-    uint8_t tmp_buf[MAX_BLOCK_LEN];
-    _ext2_read_from_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
-    dir_entry_t* start_of_entry = (dir_entry_t*)tmp_buf;
-    dir_entry_t* prev_entry = (dir_entry_t*)0;
+    dotdot->rec_len = block_len - 12;
+    memset(&root_buf[24], 0, block_len - 24);
 
-    for (;;) {
+    dx_root_info_t* info = (dx_root_info_t*)&root_buf[EXT2_DX_ROOT_INFO_OFFSET];
+    info->hash_version = _ext2_dx_default_hash_version(sb);
+    info->info_length = sizeof(dx_root_info_t);
 
-        if (start_of_entry->inode == child_dentry->inode_indx) {
-            /* FIXME: just fix that */
-            if (!prev_entry) {
-                kpanic("Ext2: can't delete first entry.");
-            }
+    dx_entry_t* entries = (dx_entry_t*)&root_buf[EXT2_DX_ROOT_ENTRIES_OFFSET];
+    _ext2_dx_countlimit(entries)->limit = (block_len - EXT2_DX_ROOT_ENTRIES_OFFSET) / sizeof(dx_entry_t);
+    _ext2_dx_countlimit(entries)->count = 1;
+    entries[0].block = leaf_block;
+    _ext2_dx_write_block(dir, 0, root_buf);
 
-            /* deleting entry */
-            start_of_entry->inode = 0;
-            prev_entry->rec_len += start_of_entry->rec_len;
+    dir->inode->flags |= EXT2_INDEX_FL;
+    dentry_set_flag(dir, DENTRY_DIRTY);
 
-            _ext2_write_to_dev(dev, tmp_buf, _ext2_get_block_offset(fsdata.sb, block_index), BLOCK_LEN(fsdata.sb));
+    /* Rev 0 has no feature flags, drivers which don't know the index see plain blocks. */
+    if (sb->rev_level >= 1) {
+        sb->feature_compat |= EXT2_FEATURE_COMPAT_DIR_INDEX;
+    }
 
-            return 0;
-        }
+out:
+    if (map) {
+        kfree(map);
+    }
+    if (bufs) {
+        kfree(bufs);
+    }
+    return err;
+}
 
-        prev_entry = start_of_entry;
-        start_of_entry = (dir_entry_t*)((uint32_t)start_of_entry + start_of_entry->rec_len);
-        if ((uint32_t)start_of_entry >= (uint32_t)tmp_buf + BLOCK_LEN(fsdata.sb)) {
-            return -EFAULT;
+/**
+ * DELAYED ALLOCATION FUNCTIONS
+ */
+
+static ext2_delalloc_buffer_t* _ext2_delalloc_find_lockless(vfs_device_t* dev, uint32_t inode_indx)
+{
+    for (int i = 0; i < EXT2_DELALLOC_BUFFERS; i++) {
+        ext2_delalloc_buffer_t* buffer = &DELALLOC_CACHE.buffers[i];
+        if (buffer->dentry && buffer->inode_indx == inode_indx) {
+            return buffer;
         }
     }
+    return NULL;
 }
 
-static int _ext2_add_child(dentry_t* dir, dentry_t* child_dentry, const char* name, int len)
+/**
+ * _ext2_delalloc_get_lockless takes a free buffer for @dentry, or the least
+ * recently used one, which is flushed first.
+ */
+static ext2_delalloc_buffer_t* _ext2_delalloc_get_lockless(vfs_device_t* dev, dentry_t* dentry)
 {
-    uint32_t block_index;
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
-
-    for (int i = 0; i < blocks_per_dir; i++) {
-        if ((block_index = _ext2_get_block_of_inode(dir, i))) {
-            if (_ext2_add_to_dir_block(dir->dev, dir->fsdata, block_index, child_dentry, name, len) == 0) {
-                goto updated_inode;
-            }
+    ext2_delalloc_buffer_t* victim = NULL;
+    for (int i = 0; i < EXT2_DELALLOC_BUFFERS; i++) {
+        ext2_delalloc_buffer_t* buffer = &DELALLOC_CACHE.buffers[i];
+        if (!buffer->dentry) {
+            victim = buffer;
+            break;
+        }
+        if (!victim || buffer->last_used < victim->last_used) {
+            victim = buffer;
         }
     }
 
-    // FIXME: group
-    uint32_t new_block_index;
-    if (_ext2_allocate_block_for_inode(dir, 0, &new_block_index) == 0) {
-        if (_ext2_add_first_entry_to_dir_block(dir->dev, dir->fsdata, new_block_index, child_dentry, name, len) == 0) {
-            goto updated_inode;
-        }
+    if (victim->dentry) {
+        _ext2_delalloc_flush_lockless(dev, victim);
     }
 
-    return -EFAULT;
+    if (!victim->data) {
+        victim->data = (uint8_t*)kmalloc(EXT2_DELALLOC_BUFFER_SIZE);
+        if (!victim->data) {
+            return NULL;
+        }
+    }
 
-updated_inode:
-    child_dentry->inode->links_count++;
-    dentry_set_flag(child_dentry, DENTRY_DIRTY);
-    return 0;
+    victim->dentry = dentry_duplicate(dentry);
+    victim->inode_indx = dentry->inode_indx;
+    victim->start = dentry->inode->size;
+    victim->len = 0;
+    return victim;
 }
 
-static int _ext2_rm_child(dentry_t* dir, dentry_t* child_dentry)
+/**
+ * _ext2_delalloc_flush_lockless writes the buffered data with the regular
+ * write path, so blocks for the whole buffer are allocated at once and lie
+ * one after another on the drive.
+ */
+static void _ext2_delalloc_flush_lockless(vfs_device_t* dev, ext2_delalloc_buffer_t* buffer)
 {
-    uint32_t block_index;
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
-
-    for (int i = 0; i < blocks_per_dir; i++) {
-        if ((block_index = _ext2_get_block_of_inode(dir, i))) {
-            if (_ext2_rm_from_dir_block(dir->dev, dir->fsdata, block_index, child_dentry) == 0) {
-                child_dentry->inode->links_count--;
-                dentry_set_flag(child_dentry, DENTRY_DIRTY);
-                return 0;
-            }
-        }
+    dentry_t* dentry = buffer->dentry;
+    int written = _ext2_write_lockless(dentry, buffer->data, buffer->start, buffer->len);
+    if (written < (int)buffer->len) {
+        written = max(written, 0);
+        log_warn("Ext2: lost %d delayed bytes of inode %d", buffer->len - written, buffer->inode_indx);
+        // The size was set when the data was buffered, it is cut to what is on the drive.
+        dentry->inode->size = buffer->start + written;
+        dentry_set_flag(dentry, DENTRY_DIRTY | DENTRY_SIZE_DIRTY);
     }
 
-    return -ENOENT;
+    buffer->dentry = NULL;
+    buffer->len = 0;
+    dentry_put(dentry);
 }
 
-static int _ext2_setup_dir(dentry_t* dir, dentry_t* parent_dir, mode_t mode)
+static void _ext2_delalloc_flush_range_lockless(dentry_t* dentry, uint32_t start, uint32_t len)
 {
-    dir->inode->mode = mode;
-    dir->inode->uid = 0; // FIXME: uid of real user
-    dir->inode->links_count = 0;
-    dir->inode->blocks = 0;
-    dentry_set_flag(dir, DENTRY_DIRTY);
-    if (_ext2_add_child(dir, dir, ".", 1) < 0) {
-        return -EFAULT;
+    vfs_device_t* dev = dentry->dev;
+    ext2_delalloc_buffer_t* buffer = _ext2_delalloc_find_lockless(dev, dentry->inode_indx);
+    if (buffer && start + len > buffer->start) {
+        _ext2_delalloc_flush_lockless(dev, buffer);
     }
-    if (_ext2_add_child(dir, parent_dir, "..", 2) < 0) {
-        return -EFAULT;
+}
+
+/**
+ * _ext2_delalloc_write_lockless keeps small appends in memory, blocks for
+ * them are allocated when the buffer is flushed. Returns -EAGAIN if the
+ * data has to be written right away.
+ */
+static int _ext2_delalloc_write_lockless(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    vfs_device_t* dev = dentry->dev;
+    bool is_small_append = (len && start == dentry->inode->size && len <= EXT2_DELALLOC_BUFFER_SIZE / 2);
+    ext2_delalloc_buffer_t* buffer = _ext2_delalloc_find_lockless(dev, dentry->inode_indx);
+
+    if (buffer && (!is_small_append || buffer->len + len > EXT2_DELALLOC_BUFFER_SIZE)) {
+        _ext2_delalloc_flush_lockless(dev, buffer);
+        buffer = NULL;
     }
-    return 0;
+
+    if (!is_small_append) {
+        return -EAGAIN;
+    }
+
+    if (!buffer) {
+        buffer = _ext2_delalloc_get_lockless(dev, dentry);
+        if (!buffer) {
+            return -EAGAIN;
+        }
+    }
+
+    memcpy(&buffer->data[buffer->len], buf, len);
+    buffer->len += len;
+    buffer->last_used = ++DELALLOC_CACHE.clock;
+
+    dentry->inode->size = start + len;
+    dentry->inode->mtime = (uint32_t)timeman_now();
+    dentry_set_flag(dentry, DENTRY_DIRTY | DENTRY_SIZE_DIRTY);
+    return len;
 }
 
 /**
@@ -798,6 +2223,86 @@ static int _ext2_setup_file(dentry_t* file, mode_t mode)
     return 0;
 }
 
+static int _ext2_write_lockless(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    if (!len) {
+        return 0;
+    }
+
+    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
+    uint32_t start_block_index = start / block_len;
+    uint32_t end_block_index = (start + len - 1) / block_len;
+    uint32_t write_offset = start % block_len;
+    uint32_t to_write = len;
+    uint32_t already_written = 0;
+    uint32_t blocks_allocated = _ext2_data_blocks_of_inode(dentry);
+
+    /* Blocks which lie one after another on the drive are written with a single request. */
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+    uint8_t* run_buf = buf;
+
+    /* New blocks are placed right after the previous block of the file. */
+    uint32_t goal = 0;
+    int err = 0;
+
+    for (uint32_t data_block_index, virt_block_index = start_block_index; virt_block_index <= end_block_index; virt_block_index++) {
+        uint32_t write_to_block = min(to_write, block_len - write_offset);
+
+        if (blocks_allocated <= virt_block_index) {
+            if (_ext2_allocate_block_for_inode(dentry, goal, &data_block_index) < 0) {
+                break;
+            }
+        } else {
+            data_block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
+        }
+        goal = data_block_index + 1;
+
+        uint32_t dev_offset = _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + write_offset;
+        if (run_len && run_start + run_len == dev_offset) {
+            run_len += write_to_block;
+        } else {
+            if (run_len) {
+                err = _ext2_write_to_dev(dentry->dev, run_buf, run_start, run_len);
+                if (err < 0) {
+                    already_written = run_buf - buf;
+                    run_len = 0;
+                    break;
+                }
+            }
+            run_start = dev_offset;
+            run_len = write_to_block;
+            run_buf = buf + already_written;
+        }
+        to_write -= write_to_block;
+        already_written += write_to_block;
+        write_offset = 0;
+    }
+
+    if (run_len) {
+        err = _ext2_write_to_dev(dentry->dev, run_buf, run_start, run_len);
+        if (err < 0) {
+            already_written = run_buf - buf;
+        }
+    }
+
+    uint32_t flags = DENTRY_DIRTY;
+    if (_ext2_data_blocks_of_inode(dentry) != blocks_allocated) {
+        flags |= DENTRY_SIZE_DIRTY;
+    }
+    if (dentry->inode->size < start + already_written) {
+        dentry->inode->size = start + already_written;
+        flags |= DENTRY_SIZE_DIRTY;
+    }
+    dentry->inode->mtime = (uint32_t)timeman_now();
+    dentry_set_flag(dentry, flags);
+
+    if (!already_written) {
+        return err < 0 ? err : -ENOSPC;
+    }
+    return already_written;
+}
+
 /**
  * API FUNTIONS
  */
@@ -815,67 +2320,88 @@ bool ext2_can_write(dentry_t* dentry, uint32_t start)
 int ext2_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
-    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-    uint32_t start_block_index = start / block_len;
-    uint32_t end_block_index = min((start + len - 1) / block_len, blocks_allocated - 1);
-
     if (start >= dentry->inode->size) {
         lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
         return 0;
     }
 
     uint32_t have_to_read = min(len, dentry->inode->size - start);
+
+    /**
+     * Delayed data is copied from its buffer instead of being flushed, since
+     * the page cache reads files while it holds dentry->lock and a flush would
+     * take it again.
+     */
+    uint32_t from_buffer = 0;
+    ext2_delalloc_buffer_t* buffer = _ext2_delalloc_find_lockless(dentry->dev, dentry->inode_indx);
+    if (buffer && start + have_to_read > buffer->start) {
+        uint32_t buffer_from = max(start, buffer->start);
+        from_buffer = start + have_to_read - buffer_from;
+        memcpy(buf + (buffer_from - start), &buffer->data[buffer_from - buffer->start], from_buffer);
+        have_to_read -= from_buffer;
+    }
+
+    if (!have_to_read) {
+        lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
+        return from_buffer;
+    }
+
+    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
+    uint32_t blocks_allocated = _ext2_data_blocks_of_inode(dentry);
+    uint32_t start_block_index = start / block_len;
+    uint32_t end_block_index = min((start + have_to_read - 1) / block_len, blocks_allocated - 1);
     uint32_t read_offset = start % block_len;
     uint32_t already_read = 0;
 
+    /* Blocks which lie one after another on the drive are read with a single request. */
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+    uint8_t* run_buf = buf;
+    int err = 0;
+
     for (uint32_t virt_block_index = start_block_index; virt_block_index <= end_block_index; virt_block_index++) {
         uint32_t data_block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
         uint32_t read_from_block = min(have_to_read, block_len - read_offset);
-        _ext2_read_from_dev(dentry->dev, buf + already_read, _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + read_offset, read_from_block);
+        uint32_t dev_offset = _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + read_offset;
+        if (run_len && run_start + run_len == dev_offset) {
+            run_len += read_from_block;
+        } else {
+            if (run_len) {
+                err = _ext2_read_from_dev(dentry->dev, run_buf, run_start, run_len);
+                if (err < 0) {
+                    lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
+                    return err;
+                }
+            }
+            run_start = dev_offset;
+            run_len = read_from_block;
+            run_buf = buf + already_read;
+        }
         have_to_read -= read_from_block;
         already_read += read_from_block;
         read_offset = 0;
     }
 
+    if (run_len) {
+        err = _ext2_read_from_dev(dentry->dev, run_buf, run_start, run_len);
+    }
+
     lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
-    return already_read;
+    if (err < 0) {
+        return err;
+    }
+    return already_read + from_buffer;
 }
 
 int ext2_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
-    const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
-    uint32_t start_block_index = start / block_len;
-    uint32_t end_block_index = (start + len) / block_len;
-    uint32_t write_offset = start % block_len;
-    uint32_t to_write = len;
-    uint32_t already_written = 0;
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
-
-    for (uint32_t data_block_index, virt_block_index = start_block_index; virt_block_index <= end_block_index; virt_block_index++) {
-        uint32_t write_to_block = min(to_write, block_len - write_offset);
-
-        if (blocks_allocated <= virt_block_index) {
-            _ext2_allocate_block_for_inode(dentry, 0, &data_block_index);
-        } else {
-            data_block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
-        }
-
-        _ext2_write_to_dev(dentry->dev, buf + already_written, _ext2_get_block_offset(dentry->fsdata.sb, data_block_index) + write_offset, write_to_block);
-        to_write -= write_to_block;
-        already_written += write_to_block;
-        write_offset = 0;
-    }
-
-    if (dentry->inode->size < start + len) {
-        dentry->inode->size = start + len;
+    int res = _ext2_delalloc_write_lockless(dentry, buf, start, len);
+    if (res == -EAGAIN) {
+        res = _ext2_write_lockless(dentry, buf, start, len);
     }
-    dentry->inode->mtime = (uint32_t)timeman_now();
-    dentry_set_flag(dentry, DENTRY_DIRTY);
-
     lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
-    return already_written;
+    return res;
 }
 
 int ext2_truncate(dentry_t* dentry, uint32_t len)
@@ -885,18 +2411,28 @@ int ext2_truncate(dentry_t* dentry, uint32_t len)
         lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
         return 0;
     }
+    _ext2_delalloc_flush_range_lockless(dentry, len, dentry->inode->size - len);
 
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
-    const uint32_t last_written_byte = len - 1;
-    uint32_t last_written_block_index = last_written_byte / block_len;
-    uint32_t start_block_index = last_written_block_index + 1;
-    uint32_t blocks_allocated = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    uint32_t start_block_index = (len + block_len - 1) / block_len;
+    uint32_t blocks_allocated = _ext2_data_blocks_of_inode(dentry);
+
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&ALLOC_CACHE.lock);
+    _ext2_release_window_lockless(dev, dentry->inode_indx);
+    lock_release(&ALLOC_CACHE.lock);
 
     for (uint32_t block_index, virt_block_index = start_block_index; virt_block_index < blocks_allocated; virt_block_index++) {
         block_index = _ext2_get_block_of_inode(dentry, virt_block_index);
         _ext2_free_block_index(dentry->dev, dentry->fsdata, block_index);
+        _ext2_set_block_of_inode(dentry, virt_block_index, 0);
     }
 
+    if (start_block_index < blocks_allocated) {
+        _ext2_trim_indirect_blocks(dentry, start_block_index);
+        uint32_t blocks = start_block_index + _ext2_indirect_blocks_for(dentry->fsdata.sb, start_block_index);
+        dentry->inode->blocks = blocks * (block_len / 512);
+    }
     dentry->inode->size = len;
     dentry->inode->mtime = (uint32_t)timeman_now();
     dentry_set_flag(dentry, DENTRY_DIRTY);
@@ -904,28 +2440,93 @@ int ext2_truncate(dentry_t* dentry, uint32_t len)
     return 0;
 }
 
+/**
+ * ext2_fsync writes delayed data and the inode of @dentry and flushes the
+ * cache of the drive. With @datasync the inode is written only when the
+ * data could not be read back without it.
+ */
+int ext2_fsync(dentry_t* dentry, bool datasync)
+{
+    vfs_device_t* dev = dentry->dev;
+    lock_acquire(&VFS_DEVICE_LOCK);
+    ext2_delalloc_buffer_t* buffer = _ext2_delalloc_find_lockless(dev, dentry->inode_indx);
+    if (buffer) {
+        _ext2_delalloc_flush_lockless(dev, buffer);
+    }
+    lock_release(&VFS_DEVICE_LOCK);
+
+    uint32_t flag = datasync ? DENTRY_SIZE_DIRTY : DENTRY_DIRTY;
+    lock_acquire(&dentry->lock);
+    if (dentry_test_flag_lockless(dentry, flag)) {
+        ext2_write_inode(dentry);
+        dentry_rem_flag_lockless(dentry, DENTRY_DIRTY | DENTRY_SIZE_DIRTY);
+    }
+    lock_release(&dentry->lock);
+
+    return block_flush(dev->dev);
+}
+
+/**
+ * ext2_sync_device is called by the dentry flusher in the background. It
+ * allocates blocks for all delayed data of the device.
+ */
+int ext2_sync_device(vfs_device_t* dev)
+{
+    lock_acquire(&VFS_DEVICE_LOCK);
+    if (!_ext2_superblocks[dev->dev->id]) {
+        lock_release(&VFS_DEVICE_LOCK);
+        return -1;
+    }
+
+    for (int i = 0; i < EXT2_DELALLOC_BUFFERS; i++) {
+        ext2_delalloc_buffer_t* buffer = &DELALLOC_CACHE.buffers[i];
+        if (buffer->dentry) {
+            _ext2_delalloc_flush_lockless(dev, buffer);
+        }
+    }
+    lock_release(&VFS_DEVICE_LOCK);
+    return 0;
+}
+
 int ext2_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t** result)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dir));
-    uint32_t block_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
-    for (int block_index = 0; block_index < block_per_dir; block_index++) {
-        uint32_t data_block_index = _ext2_get_block_of_inode(dir, block_index);
-        uint32_t res_inode_indx = 0;
-        if (_ext2_lookup_block(dir->dev, dir->fsdata, data_block_index, name, len, &res_inode_indx) == 0) {
-            *result = dentry_get(dir->dev_indx, res_inode_indx);
-            lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dir));
-            return 0;
+    uint32_t res_inode_indx = 0;
+    uint32_t found_block = 0;
+    int err = -EINVAL;
+
+    if (dir->inode->flags & EXT2_INDEX_FL) {
+        err = _ext2_dx_lookup(dir, name, len, &res_inode_indx, &found_block);
+    }
+
+    /* A dir without index, or with a broken one, is scanned as a whole. */
+    if (err != 0 && err != -ENOENT) {
+        err = -ENOENT;
+        uint32_t block_per_dir = _ext2_data_blocks_of_inode(dir);
+        for (int block_index = 0; block_index < block_per_dir; block_index++) {
+            uint32_t data_block_index = _ext2_get_block_of_inode(dir, block_index);
+            if (_ext2_lookup_block(dir->dev, dir->fsdata, data_block_index, name, len, &res_inode_indx) == 0) {
+                found_block = block_index;
+                err = 0;
+                break;
+            }
         }
     }
+
+    if (err == 0) {
+        _ext2_remember_dir_hint(dir, res_inode_indx, found_block);
+        *result = dentry_get(dir->dev_indx, res_inode_indx);
+    }
     lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dir));
-    return -ENOENT;
+    return err;
 }
 
 int ext2_mkdir(dentry_t* dir, const char* name, uint32_t len, mode_t mode)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dir));
     uint32_t new_dir_inode_indx = 0;
-    if (_ext2_allocate_inode_index(dir->dev, dir->fsdata, &new_dir_inode_indx, 0) < 0) {
+    uint32_t pref_group = _ext2_group_of_inode(dir->fsdata.sb, dir->inode_indx);
+    if (_ext2_allocate_inode_index(dir->dev, dir->fsdata, &new_dir_inode_indx, pref_group) < 0) {
         lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dir));
         return -ENOSPC;
     }
@@ -977,7 +2578,7 @@ int ext2_getdirent(dentry_t* dir, uint32_t* offset, dirent_t* res)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dir));
     const uint32_t block_len = BLOCK_LEN(dir->fsdata.sb);
-    uint32_t blocks_per_dir = TO_EXT_BLOCKS_CNT(dir->fsdata.sb, dir->inode->blocks);
+    uint32_t blocks_per_dir = _ext2_data_blocks_of_inode(dir);
     if (*offset >= blocks_per_dir * block_len) {
         lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dir));
         return -1;
@@ -1000,7 +2601,7 @@ int ext2_getdents(dentry_t* dentry, uint8_t* buf, uint32_t* offset, uint32_t len
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dentry));
     const uint32_t block_len = BLOCK_LEN(dentry->fsdata.sb);
     uint32_t start_block_index = *offset / block_len;
-    uint32_t end_block_index = TO_EXT_BLOCKS_CNT(dentry->fsdata.sb, dentry->inode->blocks);
+    uint32_t end_block_index = _ext2_data_blocks_of_inode(dentry);
     uint32_t read_offset = *offset % block_len;
     uint32_t already_read = 0;
 
@@ -1028,7 +2629,8 @@ int ext2_create(dentry_t* dir, const char* name, uint32_t len, mode_t mode)
 {
     lock_acquire(&VFS_DEVICE_LOCK_OWNED_BY(dir));
     uint32_t new_file_inode_indx = 0;
-    if (_ext2_allocate_inode_index(dir->dev, dir->fsdata, &new_file_inode_indx, 0) < 0) {
+    uint32_t pref_group = _ext2_group_of_inode(dir->fsdata.sb, dir->inode_indx);
+    if (_ext2_allocate_inode_index(dir->dev, dir->fsdata, &new_file_inode_indx, pref_group) < 0) {
         lock_release(&VFS_DEVICE_LOCK_OWNED_BY(dir));
         return -ENOSPC;
     }
@@ -1074,14 +2676,21 @@ int ext2_recognize_drive(vfs_device_t* dev)
 {
     lock_acquire(&VFS_DEVICE_LOCK);
     superblock_t* superblock = (superblock_t*)kmalloc(SUPERBLOCK_LEN);
-    _ext2_read_from_dev(dev, (uint8_t*)superblock, SUPERBLOCK_START, SUPERBLOCK_LEN);
+    int err = _ext2_read_from_dev(dev, (uint8_t*)superblock, SUPERBLOCK_START, SUPERBLOCK_LEN);
+    if (err < 0) {
+        kfree(superblock);
+        lock_release(&VFS_DEVICE_LOCK);
+        return err;
+    }
 
     if (superblock->magic != 0xEF53) {
         kfree(superblock);
         lock_release(&VFS_DEVICE_LOCK);
         return -EINVAL;
     }
-    if (superblock->rev_level != 0) {
+    /* Rev 1 is supported while it has the same inodes and dir entries as rev 0. */
+    bool is_rev1_compatible = superblock->rev_level == 1 && superblock->inode_size == INODE_LEN && !(superblock->feature_incompat & ~EXT2_FEATURE_INCOMPAT_FILETYPE);
+    if (superblock->rev_level != 0 && !is_rev1_compatible) {
         kfree(superblock);
         lock_release(&VFS_DEVICE_LOCK);
         return -EINVAL;
@@ -1106,10 +2715,36 @@ int ext2_prepare_fs(vfs_device_t* dev)
 
     _ext2_group_table_info[dev->dev->id].count = groups_cnt;
     _ext2_group_table_info[dev->dev->id].table = group_table;
+
+    lock_init(&MAP_CACHE.lock);
+    memset(MAP_CACHE.indirect, 0, sizeof(MAP_CACHE.indirect));
+    memset(MAP_CACHE.runs, 0, sizeof(MAP_CACHE.runs));
+    MAP_CACHE.clock = 0;
+
+    lock_init(&ALLOC_CACHE.lock);
+    ALLOC_CACHE.groups = (ext2_group_cache_t*)kmalloc(groups_cnt * sizeof(ext2_group_cache_t));
+    if (!ALLOC_CACHE.groups) {
+        kfree(group_table);
+        kfree(superblock);
+        _ext2_group_table_info[dev->dev->id].table = NULL;
+        _ext2_superblocks[dev->dev->id] = NULL;
+        lock_release(&VFS_DEVICE_LOCK);
+        return -ENOMEM;
+    }
+    memset(ALLOC_CACHE.groups, 0, groups_cnt * sizeof(ext2_group_cache_t));
+    memset(ALLOC_CACHE.windows, 0, sizeof(ALLOC_CACHE.windows));
+    ALLOC_CACHE.group_table_dirty = false;
+    ALLOC_CACHE.clock = 0;
+
+    memset(&DELALLOC_CACHE, 0, sizeof(DELALLOC_CACHE));
     lock_release(&VFS_DEVICE_LOCK);
     return 0;
 }
 
+/**
+ * ext2_save_state is called when the device is ejected, after all its
+ * dentries are released, so the caches are not needed anymore.
+ */
 int ext2_save_state(vfs_device_t* dev)
 {
     lock_acquire(&VFS_DEVICE_LOCK);
@@ -1120,6 +2755,46 @@ int ext2_save_state(vfs_device_t* dev)
 
     superblock_t* superblock = _ext2_superblocks[dev->dev->id];
 
+    fsdata_t fsdata;
+    fsdata.sb = superblock;
+    fsdata.gt = &_ext2_group_table_info[dev->dev->id];
+
+    /* Delayed data allocates blocks, so it goes before both caches are flushed. */
+    for (int i = 0; i < EXT2_DELALLOC_BUFFERS; i++) {
+        ext2_delalloc_buffer_t* buffer = &DELALLOC_CACHE.buffers[i];
+        if (buffer->dentry) {
+            _ext2_delalloc_flush_lockless(dev, buffer);
+        }
+        if (buffer->data) {
+            kfree(buffer->data);
+            buffer->data = NULL;
+        }
+    }
+
+    lock_acquire(&MAP_CACHE.lock);
+    _ext2_flush_map_cache_lockless(dev, fsdata);
+    for (int i = 0; i < EXT2_INDIRECT_CACHE_SIZE; i++) {
+        if (MAP_CACHE.indirect[i].data) {
+            kfree(MAP_CACHE.indirect[i].data);
+            MAP_CACHE.indirect[i].data = NULL;
+        }
+    }
+    lock_release(&MAP_CACHE.lock);
+
+    lock_acquire(&ALLOC_CACHE.lock);
+    _ext2_flush_alloc_cache_lockless(dev, fsdata);
+    for (uint32_t i = 0; i < fsdata.gt->count; i++) {
+        if (ALLOC_CACHE.groups[i].block_bitmap) {
+            kfree(ALLOC_CACHE.groups[i].block_bitmap);
+        }
+        if (ALLOC_CACHE.groups[i].inode_bitmap) {
+            kfree(ALLOC_CACHE.groups[i].inode_bitmap);
+        }
+    }
+    kfree(ALLOC_CACHE.groups);
+    ALLOC_CACHE.groups = NULL;
+    lock_release(&ALLOC_CACHE.lock);
+
     uint32_t group_table_len = _ext2_group_table_info[dev->dev->id].count * GROUP_LEN;
     group_desc_t* group_table = _ext2_group_table_info[dev->dev->id].table;
     _ext2_write_to_dev(dev, (uint8_t*)group_table, _ext2_get_block_offset(superblock, 2), group_table_len);
@@ -1127,6 +2802,7 @@ int ext2_save_state(vfs_device_t* dev)
 
     _ext2_write_to_dev(dev, (uint8_t*)superblock, SUPERBLOCK_START, SUPERBLOCK_LEN);
     kfree(superblock);
+    _ext2_superblocks[dev->dev->id] = NULL;
     lock_release(&VFS_DEVICE_LOCK);
     return 0;
 }
@@ -1177,6 +2853,8 @@ driver_desc_t _ext2_driver_info()
     fs_desc.functions[DRIVER_FILE_SYSTEM_FSTAT] = NULL;
     fs_desc.functions[DRIVER_FILE_SYSTEM_IOCTL] = NULL;
     fs_desc.functions[DRIVER_FILE_SYSTEM_MMAP] = NULL;
+    fs_desc.functions[DRIVER_FILE_SYSTEM_FSYNC] = ext2_fsync;
+    fs_desc.functions[DRIVER_FILE_SYSTEM_SYNC_DEVICE] = ext2_sync_device;
 
     return fs_desc;
 }
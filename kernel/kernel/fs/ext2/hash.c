@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <fs/ext2/hash.h>
+#include <libkern/libkern.h>
+
+#define TEA_DELTA 0x9E3779B9
+
+#define MD4_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = _ext2_rol32(a, s))
+#define MD4_K1 0
+#define MD4_K2 013240474631UL
+#define MD4_K3 015666365641UL
+
+static inline uint32_t _ext2_rol32(uint32_t word, uint32_t shift)
+{
+    return (word << shift) | (word >> (32 - shift));
+}
+
+static void _ext2_tea_transform(uint32_t* buf, const uint32_t* in)
+{
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0], b1 = buf[1];
+    uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+
+    for (int n = 0; n < 16; n++) {
+        sum += TEA_DELTA;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+static void _ext2_half_md4_transform(uint32_t* buf, const uint32_t* in)
+{
+    uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    MD4_ROUND(MD4_F, a, b, c, d, in[0] + MD4_K1, 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[1] + MD4_K1, 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[2] + MD4_K1, 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[3] + MD4_K1, 19);
+    MD4_ROUND(MD4_F, a, b, c, d, in[4] + MD4_K1, 3);
+    MD4_ROUND(MD4_F, d, a, b, c, in[5] + MD4_K1, 7);
+    MD4_ROUND(MD4_F, c, d, a, b, in[6] + MD4_K1, 11);
+    MD4_ROUND(MD4_F, b, c, d, a, in[7] + MD4_K1, 19);
+
+    MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+    MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+    MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+    MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+    MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+
+    MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+    MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+    MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+    MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+    MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+/**
+ * Bytes are taken as signed or unsigned chars, depending on the hash
+ * version, which reflects the char type of the machine the fs was made on.
+ */
+static inline uint32_t _ext2_hash_char(const char* name, uint32_t i, bool is_unsigned)
+{
+    return is_unsigned ? (uint32_t)(uint8_t)name[i] : (uint32_t)(int32_t)(int8_t)name[i];
+}
+
+static uint32_t _ext2_legacy_hash(const char* name, uint32_t len, bool is_unsigned)
+{
+    uint32_t hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+    for (uint32_t i = 0; i < len; i++) {
+        hash = hash1 + (hash0 ^ (_ext2_hash_char(name, i, is_unsigned) * 7152373));
+        if (hash & 0x80000000) {
+            hash -= 0x7fffffff;
+        }
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+static void _ext2_str_to_hashbuf(const char* msg, uint32_t len, uint32_t* buf, int num, bool is_unsigned)
+{
+    uint32_t pad = len | (len << 8);
+    pad |= pad << 16;
+
+    uint32_t val = pad;
+    len = min(len, (uint32_t)num * 4);
+    for (uint32_t i = 0; i < len; i++) {
+        val = _ext2_hash_char(msg, i, is_unsigned) + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+    if (--num >= 0) {
+        *buf++ = val;
+    }
+    while (--num >= 0) {
+        *buf++ = pad;
+    }
+}
+
+uint32_t ext2_dx_hash(const char* name, uint32_t len, uint32_t version, const uint32_t* seed)
+{
+    uint32_t buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    uint32_t in[8];
+    uint32_t hash = 0;
+
+    if (seed && (seed[0] | seed[1] | seed[2] | seed[3])) {
+        memcpy(buf, seed, sizeof(buf));
+    }
+
+    bool is_unsigned = version >= EXT2_DX_HASH_LEGACY_UNSIGNED;
+    switch (version) {
+    case EXT2_DX_HASH_LEGACY:
+    case EXT2_DX_HASH_LEGACY_UNSIGNED:
+        hash = _ext2_legacy_hash(name, len, is_unsigned);
+        break;
+
+    case EXT2_DX_HASH_HALF_MD4:
+    case EXT2_DX_HASH_HALF_MD4_UNSIGNED:
+        for (int left = len; left > 0; left -= 32, name += 32) {
+            _ext2_str_to_hashbuf(name, left, in, 8, is_unsigned);
+            _ext2_half_md4_transform(buf, in);
+        }
+        hash = buf[1];
+        break;
+
+    case EXT2_DX_HASH_TEA:
+    case EXT2_DX_HASH_TEA_UNSIGNED:
+        for (int left = len; left > 0; left -= 16, name += 16) {
+            _ext2_str_to_hashbuf(name, left, in, 4, is_unsigned);
+            _ext2_tea_transform(buf, in);
+        }
+        hash = buf[0];
+        break;
+    }
+
+    hash &= ~1;
+    if (hash == (EXT2_DX_HASH_EOF << 1)) {
+        hash = (EXT2_DX_HASH_EOF - 1) << 1;
+    }
+    return hash;
+}
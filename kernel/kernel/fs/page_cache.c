@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <fs/page_cache.h>
+#include <fs/vfs.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <libkern/log.h>
+#include <mem/kmalloc.h>
+#include <mem/pmm.h>
+#include <mem/vmm/vmm.h>
+#include <mem/vmm/zoner.h>
+
+// #define PAGE_CACHE_DEBUG
+
+#define PAGE_CACHE_INITIAL_CAPACITY 16
+
+static uint32_t _page_cache_pages = 0;
+
+/**
+ * HELPERS
+ */
+
+static inline uint8_t* _page_cache_map_frame(zone_t* zone, uint32_t paddr)
+{
+    *zone = zoner_new_zone(VMM_PAGE_SIZE);
+    vmm_map_page(zone->start, paddr, PAGE_READABLE | PAGE_WRITABLE);
+    return zone->ptr;
+}
+
+static inline void _page_cache_unmap_frame(zone_t zone)
+{
+    vmm_unmap_page(zone.start);
+    zoner_free_zone(zone);
+}
+
+/**
+ * Returns the position of the first entry with index not less than @index.
+ */
+static uint32_t _page_cache_lower_bound(page_cache_t* cache, uint32_t index)
+{
+    uint32_t l = 0;
+    uint32_t r = cache->count;
+    while (l < r) {
+        uint32_t mid = (l + r) / 2;
+        if (cache->entries[mid].index < index) {
+            l = mid + 1;
+        } else {
+            r = mid;
+        }
+    }
+    return l;
+}
+
+static uint32_t _page_cache_find_lockless(dentry_t* dentry, uint32_t index)
+{
+    page_cache_t* cache = dentry->page_cache;
+    if (!cache) {
+        return 0;
+    }
+
+    uint32_t pos = _page_cache_lower_bound(cache, index);
+    if (pos < cache->count && cache->entries[pos].index == index) {
+        return cache->entries[pos].paddr;
+    }
+    return 0;
+}
+
+static int _page_cache_insert_lockless(dentry_t* dentry, uint32_t index, uint32_t paddr)
+{
+    page_cache_t* cache = dentry->page_cache;
+    if (!cache) {
+        cache = (page_cache_t*)kmalloc(sizeof(page_cache_t));
+        if (!cache) {
+            return -ENOMEM;
+        }
+        cache->count = 0;
+        cache->capacity = 0;
+        cache->entries = NULL;
+        dentry->page_cache = cache;
+    }
+
+    if (cache->count == cache->capacity) {
+        uint32_t new_capacity = cache->capacity ? cache->capacity * 2 : PAGE_CACHE_INITIAL_CAPACITY;
+        page_cache_entry_t* new_entries = (page_cache_entry_t*)kmalloc(new_capacity * sizeof(page_cache_entry_t));
+        if (!new_entries) {
+            return -ENOMEM;
+        }
+        if (cache->entries) {
+            memcpy(new_entries, cache->entries, cache->count * sizeof(page_cache_entry_t));
+            kfree(cache->entries);
+        }
+        cache->entries = new_entries;
+        cache->capacity = new_capacity;
+    }
+
+    uint32_t pos = _page_cache_lower_bound(cache, index);
+    memmove(&cache->entries[pos + 1], &cache->entries[pos], (cache->count - pos) * sizeof(page_cache_entry_t));
+    cache->entries[pos].index = index;
+    cache->entries[pos].paddr = paddr;
+    cache->entries[pos].mapped = false;
+    cache->count++;
+    __atomic_add_fetch(&_page_cache_pages, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static uint32_t _page_cache_get_lockless(dentry_t* dentry, uint32_t index)
+{
+    uint32_t paddr = _page_cache_find_lockless(dentry, index);
+    if (paddr) {
+        return paddr;
+    }
+
+    if (!dentry->ops->file.read) {
+        return 0;
+    }
+
+    paddr = (uint32_t)pmm_alloc_aligned(VMM_PAGE_SIZE, VMM_PAGE_SIZE);
+    if (!paddr) {
+        return 0;
+    }
+
+    zone_t tmp_zone;
+    uint8_t* data = _page_cache_map_frame(&tmp_zone, paddr);
+    memset(data, 0, VMM_PAGE_SIZE);
+    dentry->ops->file.read(dentry, data, index * VMM_PAGE_SIZE, VMM_PAGE_SIZE);
+    _page_cache_unmap_frame(tmp_zone);
+
+    if (_page_cache_insert_lockless(dentry, index, paddr) < 0) {
+        pmm_free((void*)paddr, VMM_PAGE_SIZE);
+        return 0;
+    }
+
+#ifdef PAGE_CACHE_DEBUG
+    log("[PageCache] Loaded page %d of inode %d", index, dentry->inode_indx);
+#endif
+    return paddr;
+}
+
+/**
+ * API
+ */
+
+/**
+ * Returns a frame which holds the page of the file at @offset, to be mapped
+ * into a process. The frame is loaded from the drive on the first access.
+ */
+uint32_t page_cache_get(dentry_t* dentry, uint32_t offset)
+{
+    uint32_t index = offset / VMM_PAGE_SIZE;
+    lock_acquire(&dentry->lock);
+    uint32_t paddr = _page_cache_get_lockless(dentry, index);
+    if (paddr) {
+        page_cache_t* cache = dentry->page_cache;
+        cache->entries[_page_cache_lower_bound(cache, index)].mapped = true;
+    }
+    lock_release(&dentry->lock);
+    return paddr;
+}
+
+int page_cache_read(dentry_t* dentry, uint8_t* buf, uint32_t offset, uint32_t len)
+{
+    int read = 0;
+    lock_acquire(&dentry->lock);
+    while (len) {
+        uint32_t in_page = offset % VMM_PAGE_SIZE;
+        uint32_t chunk = min(len, VMM_PAGE_SIZE - in_page);
+        uint32_t paddr = _page_cache_get_lockless(dentry, offset / VMM_PAGE_SIZE);
+        if (!paddr) {
+            break;
+        }
+
+        zone_t tmp_zone;
+        uint8_t* data = _page_cache_map_frame(&tmp_zone, paddr);
+        memcpy(buf, data + in_page, chunk);
+        _page_cache_unmap_frame(tmp_zone);
+
+        buf += chunk;
+        offset += chunk;
+        len -= chunk;
+        read += chunk;
+    }
+    lock_release(&dentry->lock);
+    return read;
+}
+
+/**
+ * Keeps cached pages coherent with the file. Only pages which are already
+ * in the cache are updated, the rest will be read from the drive on demand.
+ */
+void page_cache_write(dentry_t* dentry, uint8_t* buf, uint32_t offset, uint32_t len)
+{
+    lock_acquire(&dentry->lock);
+    if (!dentry->page_cache) {
+        lock_release(&dentry->lock);
+        return;
+    }
+
+    while (len) {
+        uint32_t in_page = offset % VMM_PAGE_SIZE;
+        uint32_t chunk = min(len, VMM_PAGE_SIZE - in_page);
+        uint32_t paddr = _page_cache_find_lockless(dentry, offset / VMM_PAGE_SIZE);
+        if (paddr) {
+            zone_t tmp_zone;
+            uint8_t* data = _page_cache_map_frame(&tmp_zone, paddr);
+            memcpy(data + in_page, buf, chunk);
+            _page_cache_unmap_frame(tmp_zone);
+        }
+
+        buf += chunk;
+        offset += chunk;
+        len -= chunk;
+    }
+    lock_release(&dentry->lock);
+}
+
+/**
+ * Drops cached pages past @len and zeroes the tail of the page at @len.
+ * Pages which are mapped into a process can't be freed, they are zeroed
+ * and stay in the cache until page_cache_free().
+ */
+void page_cache_truncate(dentry_t* dentry, uint32_t len)
+{
+    lock_acquire(&dentry->lock);
+    page_cache_t* cache = dentry->page_cache;
+    if (!cache) {
+        lock_release(&dentry->lock);
+        return;
+    }
+
+    uint32_t pos = _page_cache_lower_bound(cache, len / VMM_PAGE_SIZE);
+    uint32_t kept = pos;
+    for (uint32_t i = pos; i < cache->count; i++) {
+        page_cache_entry_t entry = cache->entries[i];
+        uint32_t in_page = (entry.index == len / VMM_PAGE_SIZE) ? len % VMM_PAGE_SIZE : 0;
+        if (!in_page && !entry.mapped) {
+            pmm_free((void*)entry.paddr, VMM_PAGE_SIZE);
+            __atomic_sub_fetch(&_page_cache_pages, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        zone_t tmp_zone;
+        uint8_t* data = _page_cache_map_frame(&tmp_zone, entry.paddr);
+        memset(data + in_page, 0, VMM_PAGE_SIZE - in_page);
+        _page_cache_unmap_frame(tmp_zone);
+        cache->entries[kept++] = entry;
+    }
+    cache->count = kept;
+    lock_release(&dentry->lock);
+}
+
+bool page_cache_is_cached(dentry_t* dentry, uint32_t offset)
+{
+    lock_acquire(&dentry->lock);
+    bool cached = _page_cache_find_lockless(dentry, offset / VMM_PAGE_SIZE) != 0;
+    lock_release(&dentry->lock);
+    return cached;
+}
+
+/**
+ * Frees all cached pages. The caller should garantee that the dentry is not
+ * held by anyone, so none of its pages is mapped.
+ */
+void page_cache_free(dentry_t* dentry)
+{
+    page_cache_t* cache = dentry->page_cache;
+    if (!cache) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < cache->count; i++) {
+        pmm_free((void*)cache->entries[i].paddr, VMM_PAGE_SIZE);
+    }
+    __atomic_sub_fetch(&_page_cache_pages, cache->count, __ATOMIC_RELAXED);
+
+    if (cache->entries) {
+        kfree(cache->entries);
+    }
+    kfree(cache);
+    dentry->page_cache = NULL;
+}
+
+uint32_t page_cache_pages()
+{
+    return _page_cache_pages;
+}
@@ -8,7 +8,9 @@
 #include <fs/vfs.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
+#include <mem/kmalloc.h>
 #include <tasking/tasking.h>
+#include <tasking/thread.h>
 
 /**
  * inode: xxxxPPPPPPPPPPBBBBBBBBBBBBBBBBBB 
@@ -17,6 +19,7 @@
  * B - bits of files at this level
  */
 #define PROCFS_PID_LEVEL 2
+#define PROCFS_PID_THREAD_LINE_LEN 128
 
 /* PID */
 int procfs_pid_getdents(dentry_t* dir, uint8_t* buf, uint32_t* offset, uint32_t len);
@@ -25,6 +28,10 @@ int procfs_pid_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t**
 /* FILES */
 static bool procfs_pid_memstat_can_read(dentry_t* dentry, uint32_t start);
 static int procfs_pid_memstat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static bool procfs_pid_stat_can_read(dentry_t* dentry, uint32_t start);
+static int procfs_pid_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static bool procfs_pid_threads_can_read(dentry_t* dentry, uint32_t start);
+static int procfs_pid_threads_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 
 /**
  * DATA
@@ -41,13 +48,19 @@ const file_ops_t procfs_pid_memstat_ops = {
 };
 
 const file_ops_t procfs_pid_stat_ops = {
-    .can_read = procfs_pid_memstat_can_read,
-    .read = procfs_pid_memstat_read,
+    .can_read = procfs_pid_stat_can_read,
+    .read = procfs_pid_stat_read,
+};
+
+const file_ops_t procfs_pid_threads_ops = {
+    .can_read = procfs_pid_threads_can_read,
+    .read = procfs_pid_threads_read,
 };
 
 static const procfs_files_t static_procfs_files[] = {
     { .name = "memstat", .mode = 0, .ops = &procfs_pid_memstat_ops },
     { .name = "stat", .mode = 0, .ops = &procfs_pid_stat_ops },
+    { .name = "threads", .mode = 0, .ops = &procfs_pid_threads_ops },
 };
 #define PROCFS_STATIC_FILES_COUNT_AT_LEVEL (sizeof(static_procfs_files) / sizeof(procfs_files_t))
 
@@ -62,6 +75,54 @@ static uint32_t procfs_pid_sfiles_get_inode_index(dentry_t* dir, int fileid)
     return procfs_get_inode_index(PROCFS_PID_LEVEL, body);
 }
 
+/**
+ * Returns NULL if the slot is taken by another process since the dentry
+ * was looked up.
+ */
+static proc_t* procfs_pid_get_proc(dentry_t* dentry)
+{
+    uint32_t procid = (dentry->inode_indx & 0x0fffffff) >> 18;
+    procfs_inode_t* procfs_inode = (procfs_inode_t*)dentry->inode;
+    if (proc[procid].pid != procfs_inode->pid) {
+        return NULL;
+    }
+    return &proc[procid];
+}
+
+/**
+ * Stat of a process is the stat of its alive threads plus the stat
+ * of the threads which are already freed.
+ */
+static int procfs_pid_sum_stat(proc_t* p, task_stat_t* res)
+{
+    int threads = 0;
+    lock_acquire(&p->lock);
+    memcpy(res, &p->stat, sizeof(task_stat_t));
+    foreach_thread(p)
+    {
+        task_stat_add(res, &thread->stat);
+        threads++;
+    }
+    lock_release(&p->lock);
+    return threads;
+}
+
+static int procfs_pid_copy_out(uint8_t* buf, uint32_t start, uint32_t len, const char* res)
+{
+    size_t size = strlen(res);
+
+    if (start == size) {
+        return 0;
+    }
+
+    if (len < size) {
+        return -EFAULT;
+    }
+
+    memcpy(buf, res, size);
+    return size;
+}
+
 /**
  * PID
  */
@@ -114,11 +175,12 @@ int procfs_pid_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t**
             if (strncmp(name, static_procfs_files[i].name, len) == 0) {
                 int newly_allocated;
                 *result = dentry_get_no_inode(dir->dev_indx, procfs_pid_sfiles_get_inode_index(dir, i), &newly_allocated);
+                procfs_inode_t* new_procfs_inode = (procfs_inode_t*)((*result)->inode);
                 if (newly_allocated) {
-                    procfs_inode_t* new_procfs_inode = (procfs_inode_t*)((*result)->inode);
                     new_procfs_inode->mode = static_procfs_files[i].mode;
                     new_procfs_inode->ops = static_procfs_files[i].ops;
                 }
+                new_procfs_inode->pid = procfs_inode->pid;
                 return 0;
             }
         }
@@ -138,13 +200,100 @@ static bool procfs_pid_memstat_can_read(dentry_t* dentry, uint32_t start)
 
 static int procfs_pid_memstat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
-    if (start == 12) {
+    proc_t* p = procfs_pid_get_proc(dentry);
+    if (!p || p->status != PROC_ALIVE || p->is_kthread) {
+        return -ESRCH;
+    }
+
+    uint32_t resident, shared;
+    vmm_count_resident_pages(p->pdir, &p->zones, &resident, &shared);
+
+    char res[64];
+    snprintf(res, 64, "resident %u\nshared %u\n", resident, shared);
+    size_t size = strlen(res);
+
+    if (start == size) {
         return 0;
     }
 
-    if (len < 12) {
+    if (len < size) {
         return -EFAULT;
     }
-    memcpy(buf, "reading mem", 12);
-    return 12;
-}
\ No newline at end of file
+
+    memcpy(buf, res, size);
+    return size;
+}
+
+static bool procfs_pid_stat_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+static int procfs_pid_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    proc_t* p = procfs_pid_get_proc(dentry);
+    if (!p || p->status != PROC_ALIVE) {
+        return -ESRCH;
+    }
+
+    task_stat_t stat;
+    int threads = procfs_pid_sum_stat(p, &stat);
+
+    uint32_t resident = 0, shared = 0;
+    if (!p->is_kthread) {
+        vmm_count_resident_pages(p->pdir, &p->zones, &resident, &shared);
+    }
+
+    char res[384];
+    snprintf(res, 384,
+        "threads %u\nuser_ticks %u\nsystem_ticks %u\nvoluntary_switches %u\ninvoluntary_switches %u\n"
+        "minor_faults %u\nmajor_faults %u\ncow_faults %u\nsyscalls %u\nread_bytes %u\nwritten_bytes %u\n"
+        "resident %u\nshared %u\n",
+        threads, stat.user_ticks, stat.system_ticks, stat.voluntary_switches, stat.involuntary_switches,
+        stat.minor_faults, stat.major_faults, stat.cow_faults, stat.syscalls, stat.read_bytes, stat.written_bytes,
+        resident, shared);
+    return procfs_pid_copy_out(buf, start, len, res);
+}
+
+static bool procfs_pid_threads_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+/**
+ * Prints a line per alive thread. Procfs has no directories below pid
+ * level, so threads are listed in a file instead of a task/ directory.
+ */
+static int procfs_pid_threads_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    proc_t* p = procfs_pid_get_proc(dentry);
+    if (!p || p->status != PROC_ALIVE) {
+        return -ESRCH;
+    }
+
+    task_stat_t stat;
+    int threads = procfs_pid_sum_stat(p, &stat);
+    uint32_t res_len = (threads + 1) * PROCFS_PID_THREAD_LINE_LEN;
+    char* res = kmalloc(res_len);
+    if (!res) {
+        return -ENOMEM;
+    }
+
+    int offset = snprintf(res, res_len, "tid utime stime vcsw ivcsw minflt majflt cowflt syscalls rbytes wbytes\n");
+    lock_acquire(&p->lock);
+    foreach_thread(p)
+    {
+        if (offset + PROCFS_PID_THREAD_LINE_LEN > res_len) {
+            break;
+        }
+        task_stat_t* ts = &thread->stat;
+        offset += snprintf(res + offset, res_len - offset, "%u %u %u %u %u %u %u %u %u %u %u\n",
+            thread->tid, ts->user_ticks, ts->system_ticks, ts->voluntary_switches, ts->involuntary_switches,
+            ts->minor_faults, ts->major_faults, ts->cow_faults, ts->syscalls, ts->read_bytes, ts->written_bytes);
+    }
+    lock_release(&p->lock);
+
+    int read = procfs_pid_copy_out(buf, start, len, res);
+    kfree(res);
+    return read;
+}
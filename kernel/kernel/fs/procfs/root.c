@@ -4,10 +4,14 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <fs/page_cache.h>
 #include <fs/procfs/procfs.h>
 #include <fs/vfs.h>
+#include <io/block/block.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
+#include <mem/kmalloc.h>
+#include <mem/pmm.h>
 #include <tasking/sched.h>
 #include <tasking/tasking.h>
 #include <time/time_manager.h>
@@ -30,6 +34,10 @@ static bool procfs_root_uptime_can_read(dentry_t* dentry, uint32_t start);
 static int procfs_root_uptime_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 static bool procfs_root_stat_can_read(dentry_t* dentry, uint32_t start);
 static int procfs_root_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static bool procfs_root_vmstat_can_read(dentry_t* dentry, uint32_t start);
+static int procfs_root_vmstat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
+static bool procfs_root_interrupts_can_read(dentry_t* dentry, uint32_t start);
+static int procfs_root_interrupts_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 
 /**
  * DATA
@@ -50,9 +58,21 @@ const file_ops_t procfs_root_stat_ops = {
     .read = procfs_root_stat_read,
 };
 
+const file_ops_t procfs_root_vmstat_ops = {
+    .can_read = procfs_root_vmstat_can_read,
+    .read = procfs_root_vmstat_read,
+};
+
+const file_ops_t procfs_root_interrupts_ops = {
+    .can_read = procfs_root_interrupts_can_read,
+    .read = procfs_root_interrupts_read,
+};
+
 static const procfs_files_t static_procfs_files[] = {
     { .name = "stat", .mode = 0, .ops = &procfs_root_stat_ops },
     { .name = "uptime", .mode = 0, .ops = &procfs_root_uptime_ops },
+    { .name = "vmstat", .mode = 0, .ops = &procfs_root_vmstat_ops },
+    { .name = "interrupts", .mode = 0, .ops = &procfs_root_interrupts_ops },
 };
 #define PROCFS_STATIC_FILES_COUNT_AT_LEVEL (sizeof(static_procfs_files) / sizeof(procfs_files_t))
 
@@ -167,11 +187,12 @@ int procfs_root_lookup(dentry_t* dir, const char* name, uint32_t len, dentry_t**
                 if (strncmp(name, pid_name, len) == 0) {
                     int newly_allocated;
                     *result = dentry_get_no_inode(dir->dev_indx, procfs_root_pid_get_inode_index(pidi), &newly_allocated);
+                    procfs_inode_t* new_procfs_inode = (procfs_inode_t*)((*result)->inode);
                     if (newly_allocated) {
-                        procfs_inode_t* new_procfs_inode = (procfs_inode_t*)((*result)->inode);
                         new_procfs_inode->mode = S_IFDIR;
                         new_procfs_inode->ops = &procfs_pid_ops;
                     }
+                    new_procfs_inode->pid = proc[pidi].pid;
                     return 0;
                 }
             }
@@ -236,4 +257,101 @@ static int procfs_root_stat_read(dentry_t* dentry, uint8_t* buf, uint32_t start,
 
     memcpy(buf, res, size);
     return size;
-}
\ No newline at end of file
+}
+
+static bool procfs_root_vmstat_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+static int procfs_root_vmstat_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    uint32_t context_switches = 0, syscalls = 0;
+    uint32_t minor_faults = 0, major_faults = 0, cow_faults = 0;
+    for (int i = 0; i < active_cpu_count(); i++) {
+        context_switches += cpus[i].stat_context_switches;
+        syscalls += cpus[i].stat_syscalls;
+        minor_faults += cpus[i].stat_minor_faults;
+        major_faults += cpus[i].stat_major_faults;
+        cow_faults += cpus[i].stat_cow_faults;
+    }
+
+    uint32_t block_bios, block_merges, block_requests;
+    block_get_stat(&block_bios, &block_merges, &block_requests);
+
+    char res[384];
+    snprintf(res, 384,
+        "mem_total_kb %u\nmem_free_kb %u\npage_cache_kb %u\ncontext_switches %u\nsyscalls %u\n"
+        "minor_faults %u\nmajor_faults %u\ncow_faults %u\nblock_bios %u\nblock_merges %u\nblock_requests %u\n",
+        pmm_get_max_blocks() * PMM_BLOCK_SIZE_KB, pmm_get_free_blocks() * PMM_BLOCK_SIZE_KB,
+        page_cache_pages() * (VMM_PAGE_SIZE / 1024), context_switches, syscalls,
+        minor_faults, major_faults, cow_faults, block_bios, block_merges, block_requests);
+    size_t size = strlen(res);
+
+    if (start == size) {
+        return 0;
+    }
+
+    if (len < size) {
+        return -EFAULT;
+    }
+
+    memcpy(buf, res, size);
+    return size;
+}
+
+static bool procfs_root_interrupts_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+/**
+ * Prints a line per irq line which has fired at least once, with a column
+ * per cpu.
+ */
+static int procfs_root_interrupts_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    const int line_len = 16 + 12 * CPU_CNT;
+    const int res_len = (CPU_STAT_IRQ_LINES + 1) * line_len;
+    char* res = kmalloc(res_len);
+    if (!res) {
+        return -ENOMEM;
+    }
+
+    int offset = snprintf(res, res_len, "irq");
+    for (int cpu = 0; cpu < active_cpu_count(); cpu++) {
+        offset += snprintf(res + offset, res_len - offset, " cpu%d", cpu);
+    }
+    offset += snprintf(res + offset, res_len - offset, "\n");
+
+    for (int line = 0; line < CPU_STAT_IRQ_LINES; line++) {
+        uint32_t total = 0;
+        for (int cpu = 0; cpu < active_cpu_count(); cpu++) {
+            total += cpus[cpu].stat_irqs[line];
+        }
+        if (!total) {
+            continue;
+        }
+
+        offset += snprintf(res + offset, res_len - offset, "%d", line);
+        for (int cpu = 0; cpu < active_cpu_count(); cpu++) {
+            offset += snprintf(res + offset, res_len - offset, " %u", cpus[cpu].stat_irqs[line]);
+        }
+        offset += snprintf(res + offset, res_len - offset, "\n");
+    }
+    size_t size = offset;
+
+    if (start == size) {
+        kfree(res);
+        return 0;
+    }
+
+    if (len < size) {
+        kfree(res);
+        return -EFAULT;
+    }
+
+    memcpy(buf, res, size);
+    kfree(res);
+    return size;
+}
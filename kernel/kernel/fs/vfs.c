@@ -5,6 +5,7 @@
  */
 
 #include <algo/dynamic_array.h>
+#include <fs/page_cache.h>
 #include <fs/vfs.h>
 #include <io/sockets/socket.h>
 #include <libkern/bits/errno.h>
@@ -131,11 +132,35 @@ void vfs_eject_device(device_t* dev)
 #endif
     int fs_id = _vfs_devices[dev->id].fs;
     fs_desc_t* fs = dynamic_array_get(&_vfs_fses, (int)fs_id);
+
+    /* Dentries are released while the fs state is still alive, the sync drops references held by the fs. */
+    if (fs->ops->sync_device) {
+        fs->ops->sync_device(&_vfs_devices[dev->id]);
+    }
+    dentry_put_all_dentries_of_dev(dev->id);
+
     if (fs->ops->eject_device) {
         int (*eject)(vfs_device_t * nd) = fs->ops->eject_device;
         eject(&_vfs_devices[dev->id]);
     }
-    dentry_put_all_dentries_of_dev(dev->id);
+}
+
+/**
+ * Lets filesystems write back data they hold in memory. Is called
+ * periodically by the dentry flusher.
+ */
+void vfs_sync_devices()
+{
+    for (int i = 0; i < MAX_DEVICES_COUNT; i++) {
+        if (!_vfs_devices[i].dev || _vfs_devices[i].dev->is_virtual) {
+            continue;
+        }
+
+        fs_desc_t* fs = dynamic_array_get(&_vfs_fses, _vfs_devices[i].fs);
+        if (fs && fs->ops->sync_device) {
+            fs->ops->sync_device(&_vfs_devices[i]);
+        }
+    }
 }
 
 void vfs_add_fs(driver_t* new_driver)
@@ -149,6 +174,7 @@ void vfs_add_fs(driver_t* new_driver)
     new_ops->recognize = new_driver->desc.functions[DRIVER_FILE_SYSTEM_RECOGNIZE];
     new_ops->prepare_fs = new_driver->desc.functions[DRIVER_FILE_SYSTEM_PREPARE_FS];
     new_ops->eject_device = new_driver->desc.functions[DRIVER_FILE_SYSTEM_EJECT_DEVICE];
+    new_ops->sync_device = new_driver->desc.functions[DRIVER_FILE_SYSTEM_SYNC_DEVICE];
 
     new_ops->file.mkdir = new_driver->desc.functions[DRIVER_FILE_SYSTEM_MKDIR];
     new_ops->file.rmdir = new_driver->desc.functions[DRIVER_FILE_SYSTEM_RMDIR];
@@ -165,6 +191,7 @@ void vfs_add_fs(driver_t* new_driver)
     new_ops->file.fstat = new_driver->desc.functions[DRIVER_FILE_SYSTEM_FSTAT];
     new_ops->file.ioctl = new_driver->desc.functions[DRIVER_FILE_SYSTEM_IOCTL];
     new_ops->file.mmap = new_driver->desc.functions[DRIVER_FILE_SYSTEM_MMAP];
+    new_ops->file.fsync = new_driver->desc.functions[DRIVER_FILE_SYSTEM_FSYNC];
 
     new_ops->dentry.write_inode = new_driver->desc.functions[DRIVER_FILE_SYSTEM_WRITE_INODE];
     new_ops->dentry.read_inode = new_driver->desc.functions[DRIVER_FILE_SYSTEM_READ_INODE];
@@ -332,6 +359,9 @@ int vfs_read(file_descriptor_t* fd, void* buf, uint32_t len)
     int read = fd->ops->read(fd->dentry, (uint8_t*)buf, fd->offset, len);
     if (read > 0) {
         fd->offset += read;
+        if (RUNNING_THREAD) {
+            RUNNING_THREAD->stat.read_bytes += read;
+        }
     }
     lock_release(&fd->lock);
     return read;
@@ -342,13 +372,22 @@ int vfs_write(file_descriptor_t* fd, void* buf, uint32_t len)
     lock_acquire(&fd->lock);
     int written = fd->ops->write(fd->dentry, (uint8_t*)buf, fd->offset, len);
     if (written > 0) {
+        if (fd->type == FD_TYPE_FILE) {
+            page_cache_write(fd->dentry, (uint8_t*)buf, fd->offset, written);
+        }
         fd->offset += written;
+        if (RUNNING_THREAD) {
+            RUNNING_THREAD->stat.written_bytes += written;
+        }
     }
 
     if (fd->flags & O_TRUNC) {
         if (fd->ops->truncate) {
             fd->ops->truncate(fd->dentry, fd->offset);
         }
+        if (fd->type == FD_TYPE_FILE) {
+            page_cache_truncate(fd->dentry, fd->offset);
+        }
     }
 
     lock_release(&fd->lock);
@@ -418,6 +457,21 @@ int vfs_fstat(file_descriptor_t* fd, fstat_t* stat)
     return 0;
 }
 
+/**
+ * Filesystems without fsync keep nothing in memory, so there is nothing
+ * to write back.
+ */
+int vfs_fsync(file_descriptor_t* fd, bool datasync)
+{
+    lock_acquire(&fd->lock);
+    int res = 0;
+    if (fd->ops->fsync) {
+        res = fd->ops->fsync(fd->dentry, datasync);
+    }
+    lock_release(&fd->lock);
+    return res;
+}
+
 int vfs_resolve_path_start_from(dentry_t* dentry, const char* path, dentry_t** result)
 {
     if (!path) {
@@ -558,6 +612,7 @@ static proc_zone_t* _vfs_do_mmap(file_descriptor_t* fd, mmap_params_t* params)
         zone->type = ZONE_TYPE_MAPPED_FILE_PRIVATLY;
         zone->file = dentry_duplicate(fd->dentry);
         zone->offset = params->offset;
+        zone->file_len = params->size;
     } else {
         /* TODO */
         return 0;
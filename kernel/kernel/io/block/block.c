@@ -0,0 +1,431 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <io/block/block.h>
+#include <libkern/bits/errno.h>
+#include <libkern/ktrace.h>
+#include <libkern/libkern.h>
+#include <libkern/log.h>
+#include <mem/kmalloc.h>
+#include <time/time_manager.h>
+
+// #define BLOCK_DEBUG
+
+#define BLOCK_SYNC_BATCH 4
+
+static block_queue_t _block_queues[MAX_DEVICES_COUNT];
+
+/**
+ * HELPERS
+ */
+
+static inline block_queue_t* _block_get_queue(device_t* dev)
+{
+    return &_block_queues[dev->id];
+}
+
+static inline bool _block_ranges_overlap(uint32_t a_start, uint32_t a_count, uint32_t b_start, uint32_t b_count)
+{
+    return a_start < b_start + b_count && b_start < a_start + a_count;
+}
+
+/**
+ * The bio could live on the stack of a waiter, so it is not touched after
+ * it is marked as done.
+ */
+static void _block_end_bio(bio_t* bio, int status)
+{
+    bio->status = status;
+    if (bio->end_io) {
+        bio->end_io(bio);
+    }
+    __atomic_or_fetch(&bio->flags, BIO_DONE, __ATOMIC_RELEASE);
+}
+
+/**
+ * QUEUE
+ */
+
+static void _block_insert_sorted_lockless(block_queue_t* q, block_request_t* req)
+{
+    block_request_t** it = &q->head;
+    while (*it && (*it)->sector <= req->sector) {
+        it = &(*it)->next;
+    }
+    req->next = *it;
+    *it = req;
+}
+
+static void _block_unlink_lockless(block_queue_t* q, block_request_t* req)
+{
+    block_request_t** it = &q->head;
+    while (*it != req) {
+        it = &(*it)->next;
+    }
+    *it = req->next;
+    req->next = NULL;
+}
+
+static bool _block_overlaps_queued_lockless(block_queue_t* q, bio_t* bio)
+{
+    for (block_request_t* req = q->head; req; req = req->next) {
+        if (_block_ranges_overlap(req->sector, req->count, bio->sector, bio->count)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Attaches the bio to a queued request of the same direction which ends
+ * right before it or starts right after it. A bio which overlaps queued
+ * sectors is never merged, so it could not overtake an earlier request.
+ */
+static bool _block_try_merge_lockless(block_queue_t* q, bio_t* bio)
+{
+    bool is_write = (bio->flags & BIO_WRITE);
+    if (_block_overlaps_queued_lockless(q, bio)) {
+        return false;
+    }
+
+    for (block_request_t* req = q->head; req; req = req->next) {
+        if (req->is_write != is_write || req->count + bio->count > BLOCK_MAX_REQUEST_SECTORS) {
+            continue;
+        }
+
+        if (req->sector + req->count == bio->sector) {
+            req->bio_tail->next = bio;
+            req->bio_tail = bio;
+            req->count += bio->count;
+            return true;
+        }
+
+        if (bio->sector + bio->count == req->sector) {
+            bio->next = req->bio_head;
+            req->bio_head = bio;
+            req->sector = bio->sector;
+            req->count += bio->count;
+            _block_unlink_lockless(q, req);
+            _block_insert_sorted_lockless(q, req);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Returns a queued request which overlaps @req and was queued before it.
+ */
+static block_request_t* _block_find_earlier_conflict_lockless(block_queue_t* q, block_request_t* req)
+{
+    for (block_request_t* it = q->head; it; it = it->next) {
+        if (it == req || it->seq > req->seq) {
+            continue;
+        }
+        if (_block_ranges_overlap(it->sector, it->count, req->sector, req->count)) {
+            return it;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Deadline elevator: a request which missed its deadline is served first,
+ * otherwise requests are served in ascending order of sectors starting
+ * from where the last one ended, wrapping around to the lowest one.
+ */
+static block_request_t* _block_pick_request_lockless(block_queue_t* q)
+{
+    time_t now = timeman_ticks_since_boot();
+    block_request_t* res = NULL;
+
+    for (block_request_t* req = q->head; req; req = req->next) {
+        if (req->deadline <= now && (!res || req->deadline < res->deadline)) {
+            res = req;
+        }
+    }
+
+    if (!res) {
+        for (block_request_t* req = q->head; req; req = req->next) {
+            if (req->sector >= q->next_sector) {
+                res = req;
+                break;
+            }
+        }
+    }
+
+    if (!res) {
+        res = q->head;
+    }
+
+    block_request_t* conflict;
+    while ((conflict = _block_find_earlier_conflict_lockless(q, res))) {
+        res = conflict;
+    }
+
+    _block_unlink_lockless(q, res);
+    q->next_sector = res->sector + res->count;
+    return res;
+}
+
+/**
+ * Drivers which do not handle requests get them sector by sector.
+ */
+static int _block_dispatch_by_sectors(device_t* dev, block_request_t* req)
+{
+    int (*read)(device_t * d, uint32_t s, uint8_t * r) = drivers[dev->driver_id].desc.functions[DRIVER_STORAGE_READ];
+    int (*write)(device_t * d, uint32_t s, uint8_t * r, uint32_t siz) = drivers[dev->driver_id].desc.functions[DRIVER_STORAGE_WRITE];
+    uint32_t sector = req->sector;
+
+    foreach_bio(req)
+    {
+        for (uint32_t i = 0; i < bio->count; i++, sector++) {
+            int res = req->is_write ? write(dev, sector, &bio->data[i * BLOCK_SECTOR_SIZE], BLOCK_SECTOR_SIZE) : read(dev, sector, &bio->data[i * BLOCK_SECTOR_SIZE]);
+            if (res < 0) {
+                return res;
+            }
+        }
+    }
+    return req->count * BLOCK_SECTOR_SIZE;
+}
+
+static void _block_dispatch(device_t* dev, block_request_t* req)
+{
+    int (*handle_request)(device_t * d, block_request_t * r) = drivers[dev->driver_id].desc.functions[DRIVER_STORAGE_HANDLE_REQUEST];
+
+#ifdef BLOCK_DEBUG
+    log("[Block] dev %d: %s %d sectors at %d", dev->id, req->is_write ? "write" : "read", req->count, req->sector);
+#endif
+
+    ktrace(KTRACE_EVENT_BIO_SUBMIT, req->sector, req->is_write);
+    int res = handle_request ? handle_request(dev, req) : _block_dispatch_by_sectors(dev, req);
+    ktrace(KTRACE_EVENT_BIO_COMPLETE, req->sector, res);
+
+    bio_t* bio = req->bio_head;
+    while (bio) {
+        bio_t* next = bio->next;
+        _block_end_bio(bio, res < 0 ? res : bio->count * BLOCK_SECTOR_SIZE);
+        bio = next;
+    }
+    kfree(req);
+}
+
+/**
+ * Only one cpu dispatches requests of a queue at a time, others just add
+ * theirs to the queue and they are served by the running one.
+ */
+static void _block_run_queue(device_t* dev, block_queue_t* q)
+{
+    lock_acquire(&q->lock);
+    if (q->running) {
+        lock_release(&q->lock);
+        return;
+    }
+    q->running = true;
+
+    while (q->head) {
+        block_request_t* req = _block_pick_request_lockless(q);
+        q->stat_dispatches++;
+        lock_release(&q->lock);
+        _block_dispatch(dev, req);
+        lock_acquire(&q->lock);
+    }
+
+    q->running = false;
+    lock_release(&q->lock);
+}
+
+/**
+ * API
+ */
+
+int block_init()
+{
+    for (int i = 0; i < MAX_DEVICES_COUNT; i++) {
+        lock_init(&_block_queues[i].lock);
+        _block_queues[i].head = NULL;
+        _block_queues[i].next_sector = 0;
+        _block_queues[i].next_seq = 0;
+        _block_queues[i].plugged = 0;
+        _block_queues[i].running = false;
+    }
+    return 0;
+}
+
+void bio_init(bio_t* bio, device_t* dev, uint32_t sector, uint32_t count, uint8_t* data, uint32_t flags)
+{
+    bio->dev = dev;
+    bio->sector = sector;
+    bio->count = count;
+    bio->data = data;
+    bio->flags = flags;
+    bio->status = 0;
+    bio->end_io = NULL;
+    bio->private = NULL;
+    bio->next = NULL;
+}
+
+/**
+ * Queues the bio. If the queue is not plugged, it is run right away in the
+ * context of the caller, so the bio could be completed on return.
+ */
+void block_submit(bio_t* bio)
+{
+    block_queue_t* q = _block_get_queue(bio->dev);
+    bio->next = NULL;
+    bio->flags &= ~BIO_DONE;
+
+    if (!bio->count || bio->count > BLOCK_MAX_REQUEST_SECTORS) {
+        _block_end_bio(bio, -EINVAL);
+        return;
+    }
+
+    block_request_t* req = kmalloc(sizeof(block_request_t));
+    if (!req) {
+        _block_end_bio(bio, -ENOMEM);
+        return;
+    }
+
+    lock_acquire(&q->lock);
+    q->stat_bios++;
+    if (_block_try_merge_lockless(q, bio)) {
+        q->stat_merges++;
+        kfree(req);
+    } else {
+        bool is_write = (bio->flags & BIO_WRITE);
+        req->sector = bio->sector;
+        req->count = bio->count;
+        req->is_write = is_write;
+        req->seq = q->next_seq++;
+        req->deadline = timeman_ticks_since_boot() + (is_write ? BLOCK_WRITE_DEADLINE : BLOCK_READ_DEADLINE);
+        req->bio_head = bio;
+        req->bio_tail = bio;
+        _block_insert_sorted_lockless(q, req);
+    }
+    bool plugged = q->plugged > 0;
+    lock_release(&q->lock);
+
+    if (!plugged) {
+        _block_run_queue(bio->dev, q);
+    }
+}
+
+/**
+ * Waits for the bio to complete. The queue is run even if it is plugged,
+ * since nobody else could be going to run it.
+ */
+int block_wait(bio_t* bio)
+{
+    block_queue_t* q = _block_get_queue(bio->dev);
+    while (!(__atomic_load_n(&bio->flags, __ATOMIC_ACQUIRE) & BIO_DONE)) {
+        _block_run_queue(bio->dev, q);
+    }
+    return bio->status;
+}
+
+/**
+ * While a queue is plugged, bios are only queued, so the ones submitted
+ * together could be merged and sorted before they reach the driver.
+ */
+void block_plug(device_t* dev)
+{
+    block_queue_t* q = _block_get_queue(dev);
+    lock_acquire(&q->lock);
+    q->plugged++;
+    lock_release(&q->lock);
+}
+
+void block_unplug(device_t* dev)
+{
+    block_queue_t* q = _block_get_queue(dev);
+    lock_acquire(&q->lock);
+    bool run = (--q->plugged == 0);
+    lock_release(&q->lock);
+
+    if (run) {
+        _block_run_queue(dev, q);
+    }
+}
+
+static int _block_rw(device_t* dev, uint32_t sector, uint32_t count, uint8_t* data, uint32_t flags)
+{
+    bio_t bios[BLOCK_SYNC_BATCH];
+    int total = 0;
+
+    while (count) {
+        int used = 0;
+        block_plug(dev);
+        for (; used < BLOCK_SYNC_BATCH && count; used++) {
+            uint32_t chunk = min(count, BLOCK_MAX_REQUEST_SECTORS);
+            bio_init(&bios[used], dev, sector, chunk, data, flags);
+            block_submit(&bios[used]);
+            sector += chunk;
+            count -= chunk;
+            data += chunk * BLOCK_SECTOR_SIZE;
+        }
+        block_unplug(dev);
+
+        for (int i = 0; i < used; i++) {
+            int res = block_wait(&bios[i]);
+            if (res < 0 && total >= 0) {
+                total = res;
+            } else if (total >= 0) {
+                total += res;
+            }
+        }
+    }
+    return total;
+}
+
+int block_read(device_t* dev, uint32_t sector, uint32_t count, uint8_t* data)
+{
+    return _block_rw(dev, sector, count, data, 0);
+}
+
+int block_write(device_t* dev, uint32_t sector, uint32_t count, uint8_t* data)
+{
+    return _block_rw(dev, sector, count, data, BIO_WRITE);
+}
+
+/**
+ * Waits until the queue is drained and asks the drive to write back its
+ * cache, so everything written before is on the medium. The queue is held
+ * as running meanwhile, so no request reaches the driver during the flush.
+ */
+int block_flush(device_t* dev)
+{
+    block_queue_t* q = _block_get_queue(dev);
+    int (*flush)(device_t * d) = drivers[dev->driver_id].desc.functions[DRIVER_STORAGE_FLUSH];
+
+    for (;;) {
+        lock_acquire(&q->lock);
+        if (!q->head && !q->running) {
+            q->running = true;
+            lock_release(&q->lock);
+            break;
+        }
+        lock_release(&q->lock);
+        _block_run_queue(dev, q);
+    }
+
+    int res = flush ? flush(dev) : 0;
+
+    lock_acquire(&q->lock);
+    q->running = false;
+    lock_release(&q->lock);
+    _block_run_queue(dev, q);
+    return res;
+}
+
+void block_get_stat(uint32_t* bios, uint32_t* merges, uint32_t* dispatches)
+{
+    *bios = *merges = *dispatches = 0;
+    for (int i = 0; i < MAX_DEVICES_COUNT; i++) {
+        *bios += _block_queues[i].stat_bios;
+        *merges += _block_queues[i].stat_merges;
+        *dispatches += _block_queues[i].stat_dispatches;
+    }
+}
@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <fs/vfs.h>
+#include <io/ioring/ioring.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <libkern/lock.h>
+#include <libkern/log.h>
+#include <mem/pmm.h>
+#include <mem/vmm/vmm.h>
+#include <mem/vmm/zoner.h>
+#include <syscalls/handlers.h>
+#include <tasking/proc.h>
+#include <tasking/tasking.h>
+
+// #define IORING_DEBUG
+
+#define IORING_MAX_RINGS 64
+
+/**
+ * Frames of a ring are mapped twice: into the kernel space without user
+ * access, so kernel threads can complete requests without switching to the
+ * pdir of the owner, and into a zone of the owner. Buffers are addressed by
+ * the owner with its own addresses and translated to the kernel view. The
+ * frames of a slot are kept after the ring is freed and reused by the next
+ * ring.
+ */
+struct ioring_ctx {
+    struct proc* proc;
+    ioring_t* ring;
+    uint32_t ring_paddr;
+    uint32_t user_ring;
+    bool busy;
+};
+typedef struct ioring_ctx ioring_ctx_t;
+
+static lock_t _ioring_lock;
+static zone_t _ioring_zone;
+static ioring_ctx_t _ioring_ctxs[IORING_MAX_RINGS];
+
+/**
+ * HELPERS
+ */
+
+static inline ioring_ctx_t* _ioring_find_ctx_lockless(proc_t* p)
+{
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        if (_ioring_ctxs[i].proc == p) {
+            return &_ioring_ctxs[i];
+        }
+    }
+    return NULL;
+}
+
+static inline file_descriptor_t* _ioring_get_fd(proc_t* p, int index)
+{
+    if (!p->fds || index < 0 || index >= MAX_OPENED_FILES) {
+        return NULL;
+    }
+
+    file_descriptor_t* fd = &p->fds[index];
+    if (!fd->dentry || !fd->ops) {
+        return NULL;
+    }
+    return fd;
+}
+
+/**
+ * Translates a buffer of the owner to the kernel view of the ring.
+ * Returns NULL if the buffer is not in the data area.
+ */
+static inline uint8_t* _ioring_get_buffer(ioring_ctx_t* ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t start = ctx->user_ring + sizeof(ioring_t);
+    uint32_t end = ctx->user_ring + IORING_SIZE;
+    if (start > addr || addr > end || len > end - addr) {
+        return NULL;
+    }
+    return (uint8_t*)ctx->ring + (addr - ctx->user_ring);
+}
+
+/**
+ * Ioctls take pointers to the memory of the owner, so they are run only
+ * in its context. Files without can_read/can_write are always ready, as
+ * in vfs_can_read() and vfs_can_write().
+ */
+static bool _ioring_sqe_is_ready(proc_t* p, ioring_sqe_t* sqe, bool in_owner_context)
+{
+    file_descriptor_t* fd;
+    switch (sqe->opcode) {
+    case IORING_OP_READ:
+        fd = _ioring_get_fd(p, sqe->fd);
+        return !fd || !fd->ops->can_read || fd->ops->can_read(fd->dentry, fd->offset);
+    case IORING_OP_WRITE:
+        fd = _ioring_get_fd(p, sqe->fd);
+        return !fd || !fd->ops->can_write || fd->ops->can_write(fd->dentry, fd->offset);
+    case IORING_OP_IOCTL:
+        return in_owner_context;
+    default:
+        return true;
+    }
+}
+
+static int _ioring_do_sqe(proc_t* p, ioring_ctx_t* ctx, ioring_sqe_t* sqe)
+{
+    if (sqe->opcode == IORING_OP_NOP) {
+        return 0;
+    }
+
+    file_descriptor_t* fd = _ioring_get_fd(p, sqe->fd);
+    if (!fd) {
+        return -EBADF;
+    }
+
+    uint8_t* buf;
+    switch (sqe->opcode) {
+    case IORING_OP_READ:
+        buf = _ioring_get_buffer(ctx, sqe->addr, sqe->len);
+        if (!buf) {
+            return -EFAULT;
+        }
+        return vfs_read(fd, buf, sqe->len);
+    case IORING_OP_WRITE:
+        buf = _ioring_get_buffer(ctx, sqe->addr, sqe->len);
+        if (!buf) {
+            return -EFAULT;
+        }
+        return vfs_write(fd, buf, sqe->len);
+    case IORING_OP_IOCTL:
+        if (fd->type != FD_TYPE_FILE || !fd->dentry->ops->file.ioctl) {
+            return -EACCES;
+        }
+        return fd->dentry->ops->file.ioctl(fd->dentry, sqe->len, sqe->addr);
+    case IORING_OP_CLOSE:
+        return vfs_close(fd);
+    default:
+        return -EINVAL;
+    }
+}
+
+/**
+ * Completes submitted entries in order and stops at the first one which
+ * would block. Returns the number of completed entries.
+ */
+static int _ioring_process(proc_t* p, ioring_ctx_t* ctx, bool in_owner_context)
+{
+    ioring_t* ring = ctx->ring;
+    int completed = 0;
+    uint32_t sq_head = ring->sq_head;
+    uint32_t sq_tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+    uint32_t cq_tail = ring->cq_tail;
+
+    while (sq_head != sq_tail) {
+        uint32_t cq_head = __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+        if (cq_tail - cq_head >= IORING_ENTRIES) {
+            break;
+        }
+
+        ioring_sqe_t* sqe = &ring->sqes[sq_head & (IORING_ENTRIES - 1)];
+        if (!_ioring_sqe_is_ready(p, sqe, in_owner_context)) {
+            break;
+        }
+
+        ioring_cqe_t* cqe = &ring->cqes[cq_tail & (IORING_ENTRIES - 1)];
+        cqe->res = _ioring_do_sqe(p, ctx, sqe);
+        cqe->user_data = sqe->user_data;
+
+        sq_head++;
+        cq_tail++;
+        completed++;
+        __atomic_store_n(&ring->sq_head, sq_head, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->cq_tail, cq_tail, __ATOMIC_RELEASE);
+    }
+
+#ifdef IORING_DEBUG
+    log("[IORing] Completed %d entries of pid %d", completed, p->pid);
+#endif
+    return completed;
+}
+
+static ioring_ctx_t* _ioring_claim_ctx(proc_t* p)
+{
+    lock_acquire(&_ioring_lock);
+    ioring_ctx_t* ctx = _ioring_find_ctx_lockless(p);
+    if (!ctx || ctx->busy) {
+        lock_release(&_ioring_lock);
+        return NULL;
+    }
+    ctx->busy = true;
+    lock_release(&_ioring_lock);
+    return ctx;
+}
+
+static inline void _ioring_release_ctx(ioring_ctx_t* ctx)
+{
+    lock_acquire(&_ioring_lock);
+    ctx->busy = false;
+    lock_release(&_ioring_lock);
+}
+
+/**
+ * API
+ */
+
+int ioring_init()
+{
+    _ioring_zone = zoner_new_zone(IORING_MAX_RINGS * IORING_SIZE);
+    lock_init(&_ioring_lock);
+    return 0;
+}
+
+/**
+ * Is called in the context of the owner, so the ring is mapped into its
+ * active pdir.
+ */
+int ioring_setup(proc_t* p, ioring_t** res)
+{
+    lock_acquire(&_ioring_lock);
+    ioring_ctx_t* ctx = _ioring_find_ctx_lockless(p);
+    if (ctx) {
+        *res = (ioring_t*)ctx->user_ring;
+        lock_release(&_ioring_lock);
+        return 0;
+    }
+
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        if (!_ioring_ctxs[i].proc && !_ioring_ctxs[i].busy) {
+            ctx = &_ioring_ctxs[i];
+            break;
+        }
+    }
+
+    if (!ctx) {
+        lock_release(&_ioring_lock);
+        return -ENOMEM;
+    }
+
+    if (!ctx->ring) {
+        ctx->ring_paddr = (uint32_t)pmm_alloc_aligned(IORING_SIZE, VMM_PAGE_SIZE);
+        if (!ctx->ring_paddr) {
+            lock_release(&_ioring_lock);
+            return -ENOMEM;
+        }
+        ctx->ring = (ioring_t*)(_ioring_zone.start + (ctx - _ioring_ctxs) * IORING_SIZE);
+        vmm_map_pages((uint32_t)ctx->ring, ctx->ring_paddr, IORING_SIZE / VMM_PAGE_SIZE, PAGE_READABLE | PAGE_WRITABLE);
+    }
+
+    proc_zone_t* zone = proc_new_random_zone(p, IORING_SIZE);
+    if (!zone) {
+        lock_release(&_ioring_lock);
+        return -ENOMEM;
+    }
+    zone->flags |= ZONE_WRITABLE | ZONE_READABLE;
+    zone->type |= ZONE_TYPE_DEVICE;
+    vmm_prepare_active_pdir_for_copying_at(zone->start, IORING_SIZE);
+    vmm_map_pages(zone->start, ctx->ring_paddr, IORING_SIZE / VMM_PAGE_SIZE, zone->flags);
+
+    memset(ctx->ring, 0, sizeof(ioring_t));
+    ctx->user_ring = zone->start;
+    ctx->proc = p;
+
+    *res = (ioring_t*)ctx->user_ring;
+    lock_release(&_ioring_lock);
+    return 0;
+}
+
+/**
+ * Runs submitted entries in the context of the owner. The entries which
+ * are not ready yet are left to the worker.
+ */
+int ioring_submit(proc_t* p)
+{
+    ioring_ctx_t* ctx = _ioring_claim_ctx(p);
+    if (!ctx) {
+        return 0;
+    }
+
+    int res = _ioring_process(p, ctx, true);
+    _ioring_release_ctx(ctx);
+    return res;
+}
+
+/**
+ * A forked process starts with the pdir of its parent, the ring is removed
+ * from it, so only the owner has access to the ring.
+ */
+int ioring_fork(proc_t* new_proc, proc_t* from_proc)
+{
+    lock_acquire(&_ioring_lock);
+    ioring_ctx_t* ctx = _ioring_find_ctx_lockless(from_proc);
+    uint32_t user_ring = ctx ? ctx->user_ring : 0;
+    lock_release(&_ioring_lock);
+    if (!user_ring) {
+        return 0;
+    }
+
+    proc_zone_t* zone = proc_find_zone(new_proc, user_ring);
+    if (!zone) {
+        return 0;
+    }
+
+    /* Tables are shared after fork, so they are copied before unmapping. */
+    pdirectory_t* prev_pdir = vmm_get_active_pdir();
+    vmm_switch_pdir(new_proc->pdir);
+    vmm_prepare_active_pdir_for_copying_at(user_ring, IORING_SIZE);
+    vmm_unmap_pages(user_ring, IORING_SIZE / VMM_PAGE_SIZE);
+    vmm_switch_pdir(prev_pdir);
+
+    return proc_delete_zone(new_proc, zone);
+}
+
+/**
+ * Detaches the ring from the process. Called with p->lock held, so the
+ * worker is not processing the ring at the moment.
+ */
+int ioring_free(proc_t* p)
+{
+    lock_acquire(&_ioring_lock);
+    ioring_ctx_t* ctx = _ioring_find_ctx_lockless(p);
+    if (!ctx) {
+        lock_release(&_ioring_lock);
+        return -EINVAL;
+    }
+    ctx->proc = NULL;
+    lock_release(&_ioring_lock);
+    return 0;
+}
+
+bool ioring_can_reap(proc_t* p, uint32_t min_complete)
+{
+    ioring_ctx_t* ctx = _ioring_find_ctx_lockless(p);
+    if (!ctx) {
+        return true;
+    }
+
+    ioring_t* ring = ctx->ring;
+    uint32_t sq_head = __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->cq_tail - ring->cq_head >= min_complete || sq_head == ring->sq_tail) {
+        return true;
+    }
+
+    /* The head entry could be run only by the owner. */
+    return !_ioring_sqe_is_ready(p, &ring->sqes[sq_head & (IORING_ENTRIES - 1)], false);
+}
+
+bool ioring_has_pending_work()
+{
+    for (int i = 0; i < IORING_MAX_RINGS; i++) {
+        ioring_ctx_t* ctx = &_ioring_ctxs[i];
+        proc_t* p = ctx->proc;
+        if (!p || ctx->busy) {
+            continue;
+        }
+
+        ioring_t* ring = ctx->ring;
+        uint32_t sq_head = ring->sq_head;
+        if (sq_head == ring->sq_tail || ring->cq_tail - ring->cq_head >= IORING_ENTRIES) {
+            continue;
+        }
+
+        if (_ioring_sqe_is_ready(p, &ring->sqes[sq_head & (IORING_ENTRIES - 1)], false)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Is a thread entry point. The worker completes entries which were not
+ * ready when they were submitted.
+ */
+void ioring_worker()
+{
+    for (;;) {
+        ksys1(SYS_IORING_ENTER, 0);
+
+        for (int i = 0; i < IORING_MAX_RINGS; i++) {
+            ioring_ctx_t* ctx = &_ioring_ctxs[i];
+            lock_acquire(&_ioring_lock);
+            proc_t* p = ctx->proc;
+            if (!p || ctx->busy) {
+                lock_release(&_ioring_lock);
+                continue;
+            }
+            ctx->busy = true;
+            lock_release(&_ioring_lock);
+
+            lock_acquire(&p->lock);
+            if (ctx->proc == p) {
+                _ioring_process(p, ctx, false);
+            }
+            lock_release(&p->lock);
+            _ioring_release_ctx(ctx);
+        }
+    }
+}
@@ -6,6 +6,7 @@
 
 #include <io/sockets/local_socket.h>
 #include <libkern/bits/errno.h>
+#include <libkern/ktrace.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
@@ -47,6 +48,7 @@ int local_socket_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t l
 {
     socket_t* sock_entry = (socket_t*)dentry;
     uint32_t read = sync_ringbuffer_read_with_start(&sock_entry->buffer, start, buf, len);
+    ktrace(KTRACE_EVENT_IPC_RECEIVE, (uint32_t)sock_entry, read);
     return read;
 }
 
@@ -62,6 +64,7 @@ int local_socket_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t
 {
     socket_t* sock_entry = (socket_t*)dentry;
     uint32_t written = sync_ringbuffer_write_ignore_bounds(&sock_entry->buffer, buf, len);
+    ktrace(KTRACE_EVENT_IPC_SEND, (uint32_t)sock_entry, written);
     return 0;
 }
 
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <io/tty/pty_buffer.h>
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <time/time_manager.h>
+
+static inline uint32_t _pty_buffer_clamp_size(uint32_t size)
+{
+    return max(PTY_BUFFER_MIN_SIZE, min(size, PTY_BUFFER_MAX_SIZE));
+}
+
+static void _pty_buffer_update_watermarks_lockless(pty_buffer_t* buf)
+{
+    uint32_t size = pty_buffer_size(buf);
+    buf->high_watermark = size / 4 * 3;
+    buf->low_watermark = size / 4;
+    buf->throttled = ringbuffer_space_to_read(&buf->ring.ringbuffer) >= buf->high_watermark;
+}
+
+int pty_buffer_init(pty_buffer_t* buf, uint32_t size)
+{
+    buf->ring = sync_ringbuffer_create(_pty_buffer_clamp_size(size));
+    if (!buf->ring.ringbuffer.zone.start) {
+        return -ENOMEM;
+    }
+    buf->coalesce_ticks = 0;
+    buf->first_pending_tick = 0;
+    _pty_buffer_update_watermarks_lockless(buf);
+    return 0;
+}
+
+void pty_buffer_free(pty_buffer_t* buf)
+{
+    sync_ringbuffer_free(&buf->ring);
+}
+
+static inline bool _pty_buffer_fits_lockless(pty_buffer_t* buf, ringbuffer_t* new_ring)
+{
+    return ringbuffer_space_to_read(&buf->ring.ringbuffer) < new_ring->zone.len;
+}
+
+static ringbuffer_t _pty_buffer_swap_ring_lockless(pty_buffer_t* buf, ringbuffer_t* new_ring)
+{
+    ringbuffer_t old_ring = buf->ring.ringbuffer;
+    uint32_t pending = ringbuffer_space_to_read(&old_ring);
+    new_ring->end = ringbuffer_read(&old_ring, new_ring->zone.ptr, pending);
+    buf->ring.ringbuffer = *new_ring;
+    _pty_buffer_update_watermarks_lockless(buf);
+    return old_ring;
+}
+
+/**
+ * Resizes both directions of a pty pair, either both or none of them.
+ * New rings are allocated before any of the buffers is touched.
+ *
+ * Data which is still in a buffer is moved to the new one, so a buffer
+ * can't be shrunk below the amount of pending data.
+ */
+int pty_buffer_resize_pair(pty_buffer_t* a, pty_buffer_t* b, uint32_t size)
+{
+    size = _pty_buffer_clamp_size(size);
+    ringbuffer_t new_a = ringbuffer_create(size);
+    if (!new_a.zone.start) {
+        return -ENOMEM;
+    }
+    ringbuffer_t new_b = ringbuffer_create(size);
+    if (!new_b.zone.start) {
+        ringbuffer_free(&new_a);
+        return -ENOMEM;
+    }
+
+    /* The only place which holds both locks, so the order can't deadlock. */
+    lock_acquire(&a->ring.lock);
+    lock_acquire(&b->ring.lock);
+    if (!_pty_buffer_fits_lockless(a, &new_a) || !_pty_buffer_fits_lockless(b, &new_b)) {
+        lock_release(&b->ring.lock);
+        lock_release(&a->ring.lock);
+        ringbuffer_free(&new_b);
+        ringbuffer_free(&new_a);
+        return -EBUSY;
+    }
+
+    ringbuffer_t old_a = _pty_buffer_swap_ring_lockless(a, &new_a);
+    ringbuffer_t old_b = _pty_buffer_swap_ring_lockless(b, &new_b);
+    lock_release(&b->ring.lock);
+    lock_release(&a->ring.lock);
+
+    ringbuffer_free(&old_b);
+    ringbuffer_free(&old_a);
+    return 0;
+}
+
+void pty_buffer_clear(pty_buffer_t* buf)
+{
+    lock_acquire(&buf->ring.lock);
+    ringbuffer_clear(&buf->ring.ringbuffer);
+    buf->throttled = false;
+    lock_release(&buf->ring.lock);
+}
+
+void pty_buffer_set_coalesce(pty_buffer_t* buf, uint32_t ms)
+{
+    lock_acquire(&buf->ring.lock);
+    buf->coalesce_ticks = (ms * timeman_ticks_per_second() + 999) / 1000;
+    lock_release(&buf->ring.lock);
+}
+
+bool pty_buffer_can_read(pty_buffer_t* buf)
+{
+    lock_acquire(&buf->ring.lock);
+    uint32_t pending = ringbuffer_space_to_read(&buf->ring.ringbuffer);
+    bool res = pending > 0;
+    if (res && buf->coalesce_ticks && pending < buf->high_watermark) {
+        res = timeman_ticks_since_boot() - buf->first_pending_tick >= buf->coalesce_ticks;
+    }
+    lock_release(&buf->ring.lock);
+    return res;
+}
+
+bool pty_buffer_can_write(pty_buffer_t* buf)
+{
+    lock_acquire(&buf->ring.lock);
+    uint32_t pending = ringbuffer_space_to_read(&buf->ring.ringbuffer);
+    if (buf->throttled && pending <= buf->low_watermark) {
+        buf->throttled = false;
+    }
+    /* One byte is always kept free, a full ringbuffer would look empty. */
+    bool res = !buf->throttled && pending + 1 < pty_buffer_size(buf);
+    lock_release(&buf->ring.lock);
+    return res;
+}
+
+uint32_t pty_buffer_read(pty_buffer_t* buf, uint8_t* data, uint32_t len)
+{
+    lock_acquire(&buf->ring.lock);
+    uint32_t res = ringbuffer_read(&buf->ring.ringbuffer, data, len);
+    lock_release(&buf->ring.lock);
+    return res;
+}
+
+uint32_t pty_buffer_write(pty_buffer_t* buf, const uint8_t* data, uint32_t len)
+{
+    lock_acquire(&buf->ring.lock);
+    uint32_t pending = ringbuffer_space_to_read(&buf->ring.ringbuffer);
+    uint32_t res = min(len, pty_buffer_size(buf) - pending - 1);
+    if (!pending && res) {
+        buf->first_pending_tick = timeman_ticks_since_boot();
+    }
+    res = ringbuffer_write(&buf->ring.ringbuffer, data, res);
+    if (pending + res >= buf->high_watermark) {
+        buf->throttled = true;
+    }
+    lock_release(&buf->ring.lock);
+    return res;
+}
@@ -8,6 +8,7 @@
 #include <io/tty/pty_master.h>
 #include <io/tty/pty_slave.h>
 #include <libkern/bits/errno.h>
+#include <libkern/bits/sys/ioctls.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 
@@ -27,6 +28,7 @@ bool pty_master_can_write(dentry_t* dentry, uint32_t start);
 int pty_master_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int pty_master_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len);
 int pty_master_fstat(dentry_t* dentry, fstat_t* stat);
+int pty_master_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg);
 
 static fs_ops_t pty_master_ops = {
     .recognize = 0,
@@ -52,7 +54,7 @@ static fs_ops_t pty_master_ops = {
         .mkdir = 0,
         .rmdir = 0,
         .fstat = pty_master_fstat,
-        .ioctl = 0,
+        .ioctl = pty_master_ioctl,
         .mmap = 0,
     }
 };
@@ -79,34 +81,28 @@ bool pty_master_can_read(dentry_t* dentry, uint32_t start)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    return sync_ringbuffer_space_to_read(&ptm->buffer) >= 1;
+    return pty_buffer_can_read(&ptm->buffer);
 }
 
 bool pty_master_can_write(dentry_t* dentry, uint32_t start)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    return sync_ringbuffer_space_to_write(&ptm->pts->buffer) >= 0;
+    return pty_buffer_can_write(&ptm->pts->buffer);
 }
 
 int pty_master_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    uint32_t leno = sync_ringbuffer_space_to_read(&ptm->buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = sync_ringbuffer_read(&ptm->buffer, buf, leno);
-    return leno;
+    return pty_buffer_read(&ptm->buffer, buf, len);
 }
 
 int pty_master_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_master_entry_t* ptm = _ptm_get(dentry);
     ASSERT(ptm);
-    sync_ringbuffer_write(&ptm->pts->buffer, buf, len);
-    return len;
+    return pty_buffer_write(&ptm->pts->buffer, buf, len);
 }
 
 int pty_master_fstat(dentry_t* dentry, fstat_t* stat)
@@ -117,6 +113,24 @@ int pty_master_fstat(dentry_t* dentry, fstat_t* stat)
     return 0;
 }
 
+int pty_master_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
+{
+    pty_master_entry_t* ptm = _ptm_get(dentry);
+    ASSERT(ptm);
+
+    switch (cmd) {
+    case PTY_GET_BUFFER_SIZE:
+        return pty_buffer_size(&ptm->buffer);
+    case PTY_SET_BUFFER_SIZE:
+        return pty_buffer_resize_pair(&ptm->buffer, &ptm->pts->buffer, arg);
+    case PTY_SET_COALESCE:
+        pty_buffer_set_coalesce(&ptm->buffer, arg);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
 int pty_master_alloc(file_descriptor_t* fd)
 {
     pty_master_entry_t* ptm = 0;
@@ -150,8 +164,22 @@ int pty_master_alloc(file_descriptor_t* fd)
     fd->offset = 0;
     fd->type = FD_TYPE_FILE;
 
-    pty_slave_create(INODE2PTSNO(ptm->dentry.inode_indx), ptm);
-    ptm->buffer = sync_ringbuffer_create_std();
+    /* A master is reused by a new pair, the buffer keeps the size it had. */
+    if (!ptm->buffer.ring.ringbuffer.zone.start) {
+        int err = pty_buffer_init(&ptm->buffer, PTY_BUFFER_STD_SIZE);
+        if (err) {
+            ptm->dentry.inode_indx = 0;
+            return err;
+        }
+    } else {
+        pty_buffer_clear(&ptm->buffer);
+    }
+    pty_buffer_set_coalesce(&ptm->buffer, 0);
 
+    int err = pty_slave_create(INODE2PTSNO(ptm->dentry.inode_indx), ptm);
+    if (err) {
+        ptm->dentry.inode_indx = 0;
+        return err;
+    }
     return 0;
 }
\ No newline at end of file
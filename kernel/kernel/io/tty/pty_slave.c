@@ -7,6 +7,7 @@
 #include <fs/devfs/devfs.h>
 #include <io/tty/pty_master.h>
 #include <io/tty/pty_slave.h>
+#include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 
@@ -26,34 +27,28 @@ bool pty_slave_can_read(dentry_t* dentry, uint32_t start)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    return sync_ringbuffer_space_to_read(&pts->buffer) >= 1;
+    return pty_buffer_can_read(&pts->buffer);
 }
 
 bool pty_slave_can_write(dentry_t* dentry, uint32_t start)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    return sync_ringbuffer_space_to_write(&pts->ptm->buffer) >= 0;
+    return pty_buffer_can_write(&pts->ptm->buffer);
 }
 
 int pty_slave_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    uint32_t leno = sync_ringbuffer_space_to_read(&pts->buffer);
-    if (leno > len) {
-        leno = len;
-    }
-    int res = sync_ringbuffer_read(&pts->buffer, buf, leno);
-    return leno;
+    return pty_buffer_read(&pts->buffer, buf, len);
 }
 
 int pty_slave_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
 {
     pty_slave_entry_t* pts = _pts_get(dentry);
     ASSERT(pts);
-    sync_ringbuffer_write(&pts->ptm->buffer, buf, len);
-    return len;
+    return pty_buffer_write(&pts->ptm->buffer, buf, len);
 }
 
 int pty_slave_ioctl(dentry_t* dentry, uint32_t cmd, uint32_t arg)
@@ -80,14 +75,24 @@ int pty_slave_create(int id, pty_master_entry_t* ptm)
         fops.read = pty_slave_read;
         fops.write = pty_slave_write;
         fops.ioctl = pty_slave_ioctl;
+
+        /* The buffer goes first, devfs can't unregister a failed slave. */
+        int err = pty_buffer_init(&pty_slaves[id].buffer, PTY_BUFFER_STD_SIZE);
+        if (err) {
+            dentry_put(mp);
+            return err;
+        }
         devfs_inode_t* res = devfs_register(mp, MKDEV(136, id), name, 4, 0, &fops);
+        if (!res) {
+            pty_buffer_free(&pty_slaves[id].buffer);
+            dentry_put(mp);
+            return -ENOMEM;
+        }
         pty_slaves[id].inode_indx = res->index;
         pty_slaves[id].ptm = ptm;
-        pty_slaves[id].buffer = sync_ringbuffer_create_std();
-        ASSERT(pty_slaves[id].buffer.ringbuffer.zone.start);
         ptm->pts = &pty_slaves[id];
     } else {
-        pty_slaves[id].buffer.ringbuffer.start = pty_slaves[id].buffer.ringbuffer.end = 0;
+        pty_buffer_clear(&pty_slaves[id].buffer);
     }
 
     dentry_put(mp);
@@ -20,6 +20,8 @@
 #include <fs/procfs/procfs.h>
 #include <fs/vfs.h>
 
+#include <io/block/block.h>
+#include <io/ioring/ioring.h>
 #include <io/shared_buffer/shared_buffer.h>
 #include <io/tty/ptmx.h>
 #include <io/tty/tty.h>
@@ -28,6 +30,7 @@
 
 #include <tasking/sched.h>
 
+#include <libkern/ktrace.h>
 #include <libkern/log.h>
 
 #include <syscalls/handlers.h>
@@ -51,6 +54,7 @@ static inline void wait_for_boot_cpu_to_finish(int* wt)
 void launching()
 {
     tasking_create_kernel_thread(dentry_flusher, NULL);
+    tasking_create_kernel_thread(ioring_worker, NULL);
     tasking_start_init_proc();
     ksys1(SYS_EXIT, 0);
 }
@@ -70,6 +74,7 @@ void stage3(mem_desc_t* mem_desc)
 
     // installing drivers
     driver_manager_init();
+    block_init();
     platform_drivers_setup();
     timeman_setup();
     vfs_install();
@@ -85,10 +90,14 @@ void stage3(mem_desc_t* mem_desc)
 
     // ipc
     shared_buffer_init();
+    ioring_init();
 
     // pty
     ptmx_install();
 
+    // tracing
+    ktrace_install();
+
     // init scheduling
     tasking_init();
     scheduler_init();
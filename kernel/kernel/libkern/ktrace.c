@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <drivers/driver_manager.h>
+#include <fs/devfs/devfs.h>
+#include <fs/vfs.h>
+#include <libkern/bits/errno.h>
+#include <libkern/ktrace.h>
+#include <libkern/libkern.h>
+#include <libkern/log.h>
+#include <mem/vmm/vmm.h>
+#include <mem/vmm/zoner.h>
+#include <platform/generic/system.h>
+#include <tasking/cpu.h>
+#include <time/time_manager.h>
+
+/**
+ * Every cpu writes only to its own buffer, so a slot is reserved with an
+ * atomic increment, which is enough to be safe against interrupts on the
+ * same cpu. The buffers are rings, old events are overwritten.
+ */
+struct ktrace_buffer {
+    uint32_t head;
+    uint32_t padding;
+    ktrace_event_t events[KTRACE_EVENTS_PER_CPU];
+};
+typedef struct ktrace_buffer ktrace_buffer_t;
+
+bool ktrace_enabled = false;
+static zone_t _ktrace_zone;
+static ktrace_buffer_t* _ktrace_buffers = NULL;
+static uint64_t _ktrace_start_ts;
+static uint32_t _ktrace_start_ticks;
+
+void ktrace_record(uint16_t type, uint32_t arg0, uint32_t arg1)
+{
+    cpu_t* cpu = THIS_CPU;
+    ktrace_buffer_t* buffer = &_ktrace_buffers[cpu->id];
+    uint32_t id = __atomic_fetch_add(&buffer->head, 1, __ATOMIC_RELAXED);
+
+    ktrace_event_t* event = &buffer->events[id & (KTRACE_EVENTS_PER_CPU - 1)];
+    event->ts = system_read_cycle_counter();
+    event->type = type;
+    event->cpu = cpu->id;
+    event->tid = cpu->running_thread ? cpu->running_thread->tid : 0;
+    event->arg0 = arg0;
+    event->arg1 = arg1;
+}
+
+/**
+ * DEVFS
+ */
+
+static void _ktrace_fill_header(ktrace_header_t* header)
+{
+    header->magic = KTRACE_MAGIC;
+    header->cpus = CPU_CNT;
+    header->events_per_cpu = KTRACE_EVENTS_PER_CPU;
+    header->ticks_per_second = timeman_ticks_per_second();
+    header->start_ts = _ktrace_start_ts;
+    header->start_ticks = _ktrace_start_ticks;
+    header->now_ts = system_read_cycle_counter();
+    header->now_ticks = timeman_ticks_since_boot();
+}
+
+static bool _ktrace_can_read(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+static int _ktrace_read(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    const uint32_t buffers_size = CPU_CNT * sizeof(ktrace_buffer_t);
+    const uint32_t total_size = sizeof(ktrace_header_t) + buffers_size;
+    if (start >= total_size) {
+        return 0;
+    }
+
+    uint32_t read = 0;
+    len = min(len, total_size - start);
+    if (start < sizeof(ktrace_header_t)) {
+        ktrace_header_t header;
+        _ktrace_fill_header(&header);
+        read = min(len, sizeof(ktrace_header_t) - start);
+        memcpy(buf, (uint8_t*)&header + start, read);
+    }
+
+    uint32_t offset = start + read - sizeof(ktrace_header_t);
+    memcpy(buf + read, (uint8_t*)_ktrace_buffers + offset, len - read);
+    return len;
+}
+
+static bool _ktrace_can_write(dentry_t* dentry, uint32_t start)
+{
+    return true;
+}
+
+/**
+ * Writing '1' clears the buffers and starts tracing, '0' stops it.
+ */
+static int _ktrace_write(dentry_t* dentry, uint8_t* buf, uint32_t start, uint32_t len)
+{
+    if (!len) {
+        return 0;
+    }
+
+    if (buf[0] == '1') {
+        ktrace_enabled = false;
+        memset(_ktrace_buffers, 0, CPU_CNT * sizeof(ktrace_buffer_t));
+        _ktrace_start_ts = system_read_cycle_counter();
+        _ktrace_start_ticks = timeman_ticks_since_boot();
+        __atomic_store_n(&ktrace_enabled, true, __ATOMIC_RELEASE);
+    } else if (buf[0] == '0') {
+        __atomic_store_n(&ktrace_enabled, false, __ATOMIC_RELEASE);
+    } else {
+        return -EINVAL;
+    }
+    return len;
+}
+
+int ktrace_install()
+{
+    const uint32_t buffers_size = CPU_CNT * sizeof(ktrace_buffer_t);
+    _ktrace_zone = zoner_new_zone(buffers_size);
+    if (!_ktrace_zone.start) {
+        return -ENOMEM;
+    }
+
+    /* Loading pages now, tracepoints are hit inside the page fault handler. */
+    vmm_tune_pages(_ktrace_zone.start, buffers_size, PAGE_READABLE | PAGE_WRITABLE);
+    _ktrace_buffers = (ktrace_buffer_t*)_ktrace_zone.ptr;
+    memset(_ktrace_buffers, 0, buffers_size);
+
+    dentry_t* mp;
+    if (vfs_resolve_path("/dev", &mp) < 0) {
+        return -ENOENT;
+    }
+
+    file_ops_t fops = { 0 };
+    fops.can_read = _ktrace_can_read;
+    fops.read = _ktrace_read;
+    fops.can_write = _ktrace_can_write;
+    fops.write = _ktrace_write;
+    devfs_register(mp, MKDEV(1, 11), "ktrace", 6, 0, &fops);
+    dentry_put(mp);
+    return 0;
+}
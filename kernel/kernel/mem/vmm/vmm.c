@@ -4,7 +4,9 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <fs/page_cache.h>
 #include <libkern/bits/errno.h>
+#include <libkern/ktrace.h>
 #include <libkern/libkern.h>
 #include <libkern/lock.h>
 #include <libkern/log.h>
@@ -69,6 +71,9 @@ static int _vmm_copy_page_to_resolve_cow(proc_t* p, uint32_t vaddr, ptable_t* sr
 static bool _vmm_is_zeroing_on_demand(uint32_t vaddr);
 static void _vmm_resolve_zeroing_on_demand(uint32_t vaddr);
 
+static proc_zone_t* _vmm_find_user_zone(uint32_t vaddr);
+static int _vmm_load_file_page(proc_zone_t* zone, uint32_t vaddr);
+
 static int _vmm_self_test();
 
 /**
@@ -79,6 +84,7 @@ static int vmm_allocate_ptable_lockless(uint32_t vaddr);
 static ALWAYS_INLINE int vmm_force_allocate_ptable_lockless(uint32_t vaddr);
 static ALWAYS_INLINE int vmm_free_ptable_lockless(uint32_t vaddr, dynamic_array_t* zones);
 static ALWAYS_INLINE int vmm_free_pdir_lockless(pdirectory_t* pdir, dynamic_array_t* zones);
+static ALWAYS_INLINE int vmm_count_resident_pages_lockless(pdirectory_t* pdir, dynamic_array_t* zones, uint32_t* resident, uint32_t* shared);
 
 static ALWAYS_INLINE int vmm_map_page_lockless(uint32_t vaddr, uint32_t paddr, uint32_t settings);
 static ALWAYS_INLINE int vmm_map_pages_lockless(uint32_t vaddr, uint32_t paddr, uint32_t n_pages, uint32_t settings);
@@ -891,12 +897,21 @@ static int _vmm_load_page_with_perm(uint32_t vaddr)
 }
 
 /**
- * The function prepare the page to write into it.
+ * The function prepare the page to write into it. Pages of privatly mapped
+ * files are filled as on a fault, _vmm_lock is dropped meanwhile since the
+ * page cache takes the dentry lock and maps frames itself.
  */
 static void _vmm_ensure_write_to_page(uint32_t vaddr)
 {
     if (!_vmm_is_page_present(vaddr)) {
-        _vmm_load_page_with_perm(vaddr);
+        proc_zone_t* zone = _vmm_find_user_zone(vaddr);
+        if (zone && (zone->type & ZONE_TYPE_MAPPED_FILE_PRIVATLY)) {
+            lock_release(&_vmm_lock);
+            _vmm_load_file_page(zone, vaddr);
+            lock_acquire(&_vmm_lock);
+        } else {
+            _vmm_load_page_with_perm(vaddr);
+        }
     }
     _vmm_ensure_cow_for_page(vaddr);
 }
@@ -924,7 +939,8 @@ static int _vmm_copy_page_to_resolve_cow(proc_t* p, uint32_t vaddr, ptable_t* sr
         return SHOULD_CRASH;
     }
 
-    if ((zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY)) {
+    /* Frames of devices and sharedly mapped files are not owned by the process, so they stay shared. */
+    if ((zone->type & (ZONE_TYPE_DEVICE | ZONE_TYPE_MAPPED_FILE_SHAREDLY))) {
         uint32_t old_page_paddr = page_desc_get_frame(*old_page_desc);
         return vmm_map_page_lockless(vaddr, old_page_paddr, zone->flags);
     }
@@ -1088,6 +1104,54 @@ int vmm_free_pdir(pdirectory_t* pdir, dynamic_array_t* zones)
     return res;
 }
 
+/**
+ * Counts user pages of @pdir which are backed by frames. Pages which
+ * belong to sharedly mapped files are reported in @shared too.
+ */
+static ALWAYS_INLINE int vmm_count_resident_pages_lockless(pdirectory_t* pdir, dynamic_array_t* zones, uint32_t* resident, uint32_t* shared)
+{
+    *resident = 0;
+    *shared = 0;
+    if (!pdir) {
+        return -EINVAL;
+    }
+
+    pdirectory_t* cur_pdir = vmm_get_active_pdir();
+    vmm_switch_pdir_lockless(pdir);
+
+    uint32_t table_coverage = VMM_PAGE_SIZE * VMM_TOTAL_PAGES_PER_TABLE;
+    for (int i = 0; i < VMM_KERNEL_TABLES_START; i++) {
+        table_desc_t* ptable_desc = _vmm_pdirectory_lookup(pdir, table_coverage * i);
+        if (!table_desc_is_present(*ptable_desc)) {
+            continue;
+        }
+
+        ptable_t* ptable = (ptable_t*)_vmm_pspace_get_nth_active_ptable(i);
+        for (int j = 0; j < VMM_TOTAL_PAGES_PER_TABLE; j++) {
+            if (!page_desc_is_present(ptable->entities[j])) {
+                continue;
+            }
+
+            (*resident)++;
+            proc_zone_t* zone = proc_find_zone_no_proc(zones, table_coverage * i + j * VMM_PAGE_SIZE);
+            if (zone && (zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY)) {
+                (*shared)++;
+            }
+        }
+    }
+
+    vmm_switch_pdir_lockless(cur_pdir);
+    return 0;
+}
+
+int vmm_count_resident_pages(pdirectory_t* pdir, dynamic_array_t* zones, uint32_t* resident, uint32_t* shared)
+{
+    lock_acquire(&_vmm_lock);
+    int res = vmm_count_resident_pages_lockless(pdir, zones, resident, shared);
+    lock_release(&_vmm_lock);
+    return res;
+}
+
 void* vmm_bring_to_kernel(uint8_t* src, uint32_t length)
 {
     if ((uint32_t)src >= KERNEL_BASE) {
@@ -1331,6 +1395,10 @@ static ALWAYS_INLINE int vmm_free_page_lockless(uint32_t vaddr, page_desc_t* pag
         if (zone->type & ZONE_TYPE_DEVICE) {
             return 0;
         }
+        /* Frames of sharedly mapped files are owned by the page cache. */
+        if (zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY) {
+            return 0;
+        }
     }
     _vmm_free_page_paddr(page_desc_get_frame(*page));
     return 0;
@@ -1344,30 +1412,121 @@ int vmm_free_page(uint32_t vaddr, page_desc_t* page, dynamic_array_t* zones)
     return res;
 }
 
+static proc_zone_t* _vmm_find_user_zone(uint32_t vaddr)
+{
+    if (PAGE_CHOOSE_OWNER(vaddr) != PAGE_USER || vmm_get_active_pdir() == vmm_get_kernel_pdir()) {
+        return NULL;
+    }
+
+    proc_t* holder_proc = tasking_get_proc_by_pdir(vmm_get_active_pdir());
+    if (!holder_proc) {
+        kpanic("No proc with the pdir\n");
+    }
+    return proc_find_zone(holder_proc, vaddr);
+}
+
+/**
+ * Sharedly mapped files are not copied into the process, the page
+ * from the page cache is mapped instead.
+ */
+static int _vmm_map_page_from_page_cache(proc_zone_t* zone, uint32_t vaddr)
+{
+    uint32_t offset = zone->offset + (PAGE_START(vaddr) - zone->start);
+    uint32_t paddr = page_cache_get(zone->file, offset);
+    if (!paddr) {
+        return SHOULD_CRASH;
+    }
+    return vmm_map_page(PAGE_START(vaddr), paddr, zone->flags);
+}
+
+/**
+ * Privatly mapped files get their own copy of the page, which is filled
+ * from the page cache. The part of the zone which is not backed by the
+ * file stays zeroed.
+ */
+static void _vmm_fill_page_from_page_cache(proc_zone_t* zone, uint32_t vaddr)
+{
+    uint32_t offset_in_zone = PAGE_START(vaddr) - zone->start;
+    if (offset_in_zone >= zone->file_len) {
+        return;
+    }
+
+    uint32_t len = min(VMM_PAGE_SIZE, zone->file_len - offset_in_zone);
+    page_cache_read(zone->file, (uint8_t*)PAGE_START(vaddr), zone->offset + offset_in_zone, len);
+}
+
+/**
+ * A fault is major when the page has to be read from the drive. Is called
+ * without _vmm_lock held, since the page cache takes the dentry lock.
+ */
+static void _vmm_account_fault(proc_zone_t* zone, uint32_t vaddr)
+{
+    bool major = false;
+    if (zone && (zone->type & (ZONE_TYPE_MAPPED_FILE_SHAREDLY | ZONE_TYPE_MAPPED_FILE_PRIVATLY))) {
+        uint32_t offset_in_zone = PAGE_START(vaddr) - zone->start;
+        if ((zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY) || offset_in_zone < zone->file_len) {
+            major = !page_cache_is_cached(zone->file, zone->offset + offset_in_zone);
+        }
+    }
+
+    cpu_t* cpu = THIS_CPU;
+    if (major) {
+        cpu->stat_major_faults++;
+    } else {
+        cpu->stat_minor_faults++;
+    }
+
+    if (cpu->running_thread) {
+        if (major) {
+            cpu->running_thread->stat.major_faults++;
+        } else {
+            cpu->running_thread->stat.minor_faults++;
+        }
+    }
+}
+
+/**
+ * Loads a page of a mapped file. Is called without _vmm_lock held.
+ */
+static int _vmm_load_file_page(proc_zone_t* zone, uint32_t vaddr)
+{
+    _vmm_account_fault(zone, vaddr);
+    if (zone->type & ZONE_TYPE_MAPPED_FILE_SHAREDLY) {
+        return _vmm_map_page_from_page_cache(zone, vaddr);
+    }
+
+    lock_acquire(&_vmm_lock);
+    int res = _vmm_load_page_with_perm(vaddr);
+    lock_release(&_vmm_lock);
+    if (res == OK) {
+        _vmm_fill_page_from_page_cache(zone, vaddr);
+    }
+    return res;
+}
+
+static inline void _vmm_account_cow_fault()
+{
+    cpu_t* cpu = THIS_CPU;
+    cpu->stat_cow_faults++;
+    if (cpu->running_thread) {
+        cpu->running_thread->stat.cow_faults++;
+    }
+}
+
 int vmm_page_fault_handler(uint32_t info, uint32_t vaddr)
 {
+    ktrace(KTRACE_EVENT_PAGE_FAULT, vaddr, info);
     lock_acquire(&_vmm_lock);
     if (_vmm_is_table_not_present(info) || _vmm_is_page_not_present(info)) {
+        proc_zone_t* zone = _vmm_find_user_zone(vaddr);
+        if (zone && (zone->type & (ZONE_TYPE_MAPPED_FILE_SHAREDLY | ZONE_TYPE_MAPPED_FILE_PRIVATLY))) {
+            lock_release(&_vmm_lock);
+            return _vmm_load_file_page(zone, vaddr);
+        }
+
         int res = _vmm_load_page_with_perm(vaddr);
         lock_release(&_vmm_lock);
-        if (PAGE_CHOOSE_OWNER(vaddr) == PAGE_USER && vmm_get_active_pdir() != vmm_get_kernel_pdir()) {
-            proc_t* holder_proc = tasking_get_proc_by_pdir(vmm_get_active_pdir());
-            if (!holder_proc) {
-                kpanic("No proc with the pdir\n");
-            }
-
-            proc_zone_t* zone = proc_find_zone(holder_proc, vaddr);
-            if (!zone) {
-                return SHOULD_CRASH;
-            }
-
-            if (zone->type & ZONE_TYPE_MAPPED_FILE_PRIVATLY) {
-                uint32_t offset = zone->offset + (PAGE_START(vaddr) - zone->start);
-                lock_acquire(&zone->file->lock);
-                zone->file->ops->file.read(zone->file, (void*)PAGE_START(vaddr), offset, VMM_PAGE_SIZE);
-                lock_release(&zone->file->lock);
-            }
-        }
+        _vmm_account_fault(zone, vaddr);
         return res;
     }
 
@@ -1379,6 +1538,7 @@ int vmm_page_fault_handler(uint32_t info, uint32_t vaddr)
                 kpanic("No proc with the pdir\n");
             }
             _vmm_resolve_copy_on_write(holder_proc, vaddr);
+            _vmm_account_cow_fault();
             visited++;
         }
         // if (_vmm_is_zeroing_on_demand(vaddr)) {
@@ -188,6 +188,7 @@ void irq_handler(trapframe_t* tf)
     /* We end the interrupt before handle it, since we can
        call sched() and not return here. */
     gic_descriptor.end_interrupt(int_disc);
+    cpu_count_irq(int_disc & 0x1ff);
     _irq_redirect(int_disc & 0x1ff);
     cpu_leave_kernel_space();
     system_enable_interrupts_only_counter();
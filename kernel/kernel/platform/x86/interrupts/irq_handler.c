@@ -31,6 +31,7 @@ void irq_handler(trapframe_t* tf)
         }
     }
 
+    cpu_count_irq(tf->int_no - IRQ_MASTER_OFFSET);
     irq_redirect(tf->int_no);
     /* We are leaving interrupt, and later interrupts will be on,
        when flags are restored */
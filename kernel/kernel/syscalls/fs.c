@@ -99,10 +99,23 @@ void sys_write(trapframe_t* tf)
         return_with_val(-EBADF);
     }
 
-    init_write_blocker(RUNNING_THREAD, fd);
-
-    int res = vfs_write(fd, (uint8_t*)param2, (uint32_t)param3);
-    return_with_val(res);
+    /* Devices with bounded buffers (like ptys) could take only a part of a big
+       write, the rest is written once the reader has drained the buffer. */
+    uint8_t* buf = (uint8_t*)param2;
+    uint32_t len = (uint32_t)param3;
+    uint32_t written = 0;
+    for (;;) {
+        init_write_blocker(RUNNING_THREAD, fd);
+        int res = vfs_write(fd, buf + written, len - written);
+        if (res < 0) {
+            return_with_val(written ? written : res);
+        }
+        written += res;
+        if (res == 0 || written >= len || RUNNING_THREAD->pending_signals_mask) {
+            break;
+        }
+    }
+    return_with_val(written);
 }
 
 void sys_lseek(trapframe_t* tf)
@@ -185,6 +198,28 @@ void sys_fstat(trapframe_t* tf)
     return_with_val(res);
 }
 
+static int _sys_fsync_impl(int fd_index, bool datasync)
+{
+    file_descriptor_t* fd = proc_get_fd(RUNNING_THREAD->process, fd_index);
+    if (!fd) {
+        return -EBADF;
+    }
+    if (fd->type != FD_TYPE_FILE) {
+        return -EINVAL;
+    }
+    return vfs_fsync(fd, datasync);
+}
+
+void sys_fsync(trapframe_t* tf)
+{
+    return_with_val(_sys_fsync_impl((int)param1, false));
+}
+
+void sys_fdatasync(trapframe_t* tf)
+{
+    return_with_val(_sys_fsync_impl((int)param1, true));
+}
+
 void sys_mkdir(trapframe_t* tf)
 {
     proc_t* p = RUNNING_THREAD->process;
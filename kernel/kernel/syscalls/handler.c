@@ -5,6 +5,7 @@
  */
 
 #include <libkern/bits/errno.h>
+#include <libkern/ktrace.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
@@ -62,6 +63,11 @@ static const void* syscalls[] = {
     [SYS_SHBUF_CREATE] = sys_shbuf_create,
     [SYS_SHBUF_GET] = sys_shbuf_get,
     [SYS_SHBUF_FREE] = sys_shbuf_free,
+    [SYS_CLOCK_PAGE] = sys_clock_page,
+    [SYS_IORING_SETUP] = sys_ioring_setup,
+    [SYS_IORING_ENTER] = sys_ioring_enter,
+    [SYS_FSYNC] = sys_fsync,
+    [SYS_FDATASYNC] = sys_fdatasync,
 };
 
 #ifdef __i386__
@@ -107,8 +113,15 @@ void sys_handler(trapframe_t* tf)
 {
     system_disable_interrupts();
     cpu_enter_kernel_space();
-    void (*callee)(trapframe_t*) = (void*)syscalls[sys_id];
+    uint32_t id = sys_id;
+    THIS_CPU->stat_syscalls++;
+    if (likely(RUNNING_THREAD)) {
+        RUNNING_THREAD->stat.syscalls++;
+    }
+    ktrace(KTRACE_EVENT_SYSCALL_ENTER, id, 0);
+    void (*callee)(trapframe_t*) = (void*)syscalls[id];
     callee(tf);
+    ktrace(KTRACE_EVENT_SYSCALL_EXIT, id, return_val);
     cpu_leave_kernel_space();
     system_enable_interrupts_only_counter();
 }
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <io/ioring/ioring.h>
 #include <io/shared_buffer/shared_buffer.h>
 #include <io/sockets/local_socket.h>
 #include <libkern/bits/errno.h>
@@ -106,4 +107,33 @@ void sys_shbuf_free(trapframe_t* tf)
 {
     int id = param1;
     return_with_val(shared_buffer_free(id));
+}
+
+void sys_ioring_setup(trapframe_t* tf)
+{
+    ioring_t** ring = (ioring_t**)param1;
+    return_with_val(ioring_setup(RUNNING_THREAD->process, ring));
+}
+
+/**
+ * Runs submitted entries and waits for @min_complete completions. Kernel
+ * threads use it to wait for entries which became ready.
+ */
+void sys_ioring_enter(trapframe_t* tf)
+{
+    thread_t* thread = RUNNING_THREAD;
+    proc_t* p = thread->process;
+    uint32_t min_complete = param1;
+
+    if (p->is_kthread) {
+        init_ioring_worker_blocker(thread);
+        return_with_val(0);
+    }
+
+    int res = ioring_submit(p);
+    if (min_complete) {
+        init_ioring_blocker(thread, min_complete);
+        res += ioring_submit(p);
+    }
+    return_with_val(res);
 }
\ No newline at end of file
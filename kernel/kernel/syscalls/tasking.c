@@ -66,6 +66,9 @@ void sys_getuid(trapframe_t* tf)
 void sys_kill(trapframe_t* tf)
 {
     thread_t* thread = thread_by_pid(param1);
+    if (!thread) {
+        return_with_val(-ESRCH);
+    }
     int ret = tasking_kill(thread, param2);
     return_with_val(ret);
 }
@@ -10,6 +10,7 @@
 #include <platform/generic/syscalls/params.h>
 #include <platform/generic/tasking/trapframe.h>
 #include <syscalls/handlers.h>
+#include <time/clock_page.h>
 #include <time/time_manager.h>
 
 void sys_clock_gettime(trapframe_t* tf)
@@ -48,4 +49,15 @@ void sys_gettimeofday(trapframe_t* tf)
     tz->tz_minuteswest = 0;
 
     return_with_val(0);
-}
\ No newline at end of file
+}
+
+void sys_clock_page(trapframe_t* tf)
+{
+    clock_page_t** u_page = (clock_page_t**)param1;
+    uint32_t addr = clock_page_user_address();
+    if (!addr) {
+        return_with_val(-ENOSYS);
+    }
+    *u_page = (clock_page_t*)addr;
+    return_with_val(0);
+}
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <io/ioring/ioring.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <libkern/syscall_structs.h>
@@ -161,3 +162,45 @@ int init_select_blocker(thread_t* thread, int nfds, fd_set_t* readfds, fd_set_t*
     resched();
     return 0;
 }
+
+int should_unblock_ioring_block(thread_t* thread)
+{
+    return ioring_can_reap(thread->process, thread->ioring_min_complete);
+}
+
+int init_ioring_blocker(thread_t* thread, uint32_t min_complete)
+{
+    thread->ioring_min_complete = min_complete;
+
+    if (should_unblock_ioring_block(thread)) {
+        return 0;
+    }
+
+    thread->status = THREAD_BLOCKED;
+    thread->blocker.reason = BLOCKER_IORING;
+    thread->blocker.should_unblock = should_unblock_ioring_block;
+    thread->blocker.should_unblock_for_signal = true;
+    sched_dequeue(thread);
+    resched();
+    return 0;
+}
+
+int should_unblock_ioring_worker_block(thread_t* thread)
+{
+    return ioring_has_pending_work();
+}
+
+int init_ioring_worker_blocker(thread_t* thread)
+{
+    if (should_unblock_ioring_worker_block(thread)) {
+        return 0;
+    }
+
+    thread->status = THREAD_BLOCKED;
+    thread->blocker.reason = BLOCKER_IORING;
+    thread->blocker.should_unblock = should_unblock_ioring_worker_block;
+    thread->blocker.should_unblock_for_signal = false;
+    sched_dequeue(thread);
+    resched();
+    return 0;
+}
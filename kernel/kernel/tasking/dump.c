@@ -112,7 +112,7 @@ void dump_and_kill(proc_t* p)
 
     // Kthread does NOT clean it's pdir, so we can share the pdir of
     // the blocked proc to read it's content.
-    dumper_p->pdir = p->pdir;
+    tasking_set_proc_pdir(dumper_p, p->pdir);
 
     resched();
 }
@@ -25,20 +25,22 @@
 #define COPING_BUFFER_LEN (PAGES_PER_COPING_BUFFER * VMM_PAGE_SIZE)
 #define USER_STACK_SIZE VMM_PAGE_SIZE
 
-static int _elf_load_do_copy_to_ram(proc_t* p, file_descriptor_t* fd, elf_program_header_32_t* ph)
+/**
+ * Fallback for segments which can't be mapped from the file, e.g. when
+ * a segment isn't aligned to a page or shares a page with another one.
+ * The segment is copied to a newly allocated anonymous zone.
+ */
+static int _elf_load_do_copy_to_ram(proc_t* p, file_descriptor_t* fd, elf_program_header_32_t* ph, uint32_t zone_flags)
 {
+    proc_zone_t* zone = proc_extend_zone(p, ph->p_vaddr, ph->p_memsz);
+    if (zone) {
+        zone->type = (ph->p_flags & PF_W) ? ZONE_TYPE_DATA : ZONE_TYPE_CODE;
+        zone->flags |= zone_flags;
+    }
+
     pdirectory_t* prev_pdir = vmm_get_active_pdir();
     vmm_switch_pdir(p->pdir);
 
-    uint32_t zones_count = proc->zones.size;
-
-    for (uint32_t i = 0; i < zones_count; i++) {
-        proc_zone_t* zone = (proc_zone_t*)dynamic_array_get(&proc->zones, i);
-        if (zone->type == ZONE_TYPE_BSS) {
-            memset((void*)zone->start, 0, zone->len);
-        }
-    }
-
     zone_t coping_zone = zoner_new_zone(COPING_BUFFER_LEN);
     uint32_t mem_remaining = ph->p_memsz;
     uint32_t file_remaining = ph->p_filesz;
@@ -70,6 +72,48 @@ static int _elf_load_do_copy_to_ram(proc_t* p, file_descriptor_t* fd, elf_progra
     return vmm_switch_pdir(prev_pdir);
 }
 
+/**
+ * Segments are loaded on demand. Read-only segments are mapped sharedly,
+ * so all processes running the same executable use the same frames from
+ * the page cache. Writable segments get private pages which are filled
+ * from the page cache on the first access.
+ */
+static int _elf_load_map_segment(proc_t* p, file_descriptor_t* fd, elf_program_header_32_t* ph)
+{
+    uint32_t zone_flags = 0;
+    if (ph->p_flags & PF_R) {
+        zone_flags |= ZONE_READABLE;
+    }
+    if (ph->p_flags & PF_W) {
+        zone_flags |= ZONE_WRITABLE;
+    }
+    if (ph->p_flags & PF_X) {
+        zone_flags |= ZONE_EXECUTABLE;
+    }
+
+    uint32_t offset_in_page = ph->p_vaddr & (VMM_PAGE_SIZE - 1);
+    if ((ph->p_offset & (VMM_PAGE_SIZE - 1)) != offset_in_page) {
+        return _elf_load_do_copy_to_ram(p, fd, ph, zone_flags);
+    }
+
+    proc_zone_t* zone = proc_new_zone(p, ph->p_vaddr, ph->p_memsz);
+    if (!zone) {
+        return _elf_load_do_copy_to_ram(p, fd, ph, zone_flags);
+    }
+
+    bool is_shared = !(ph->p_flags & PF_W) && ph->p_filesz == ph->p_memsz;
+    if (is_shared) {
+        zone->type = ZONE_TYPE_CODE | ZONE_TYPE_MAPPED_FILE_SHAREDLY;
+    } else {
+        zone->type = ZONE_TYPE_DATA | ZONE_TYPE_MAPPED_FILE_PRIVATLY;
+    }
+    zone->flags |= zone_flags;
+    zone->file = dentry_duplicate(fd->dentry);
+    zone->offset = ph->p_offset - offset_in_page;
+    zone->file_len = ph->p_filesz + offset_in_page;
+    return 0;
+}
+
 static int _elf_load_interpret_program_header_entry(proc_t* p, file_descriptor_t* fd)
 {
     elf_program_header_32_t ph;
@@ -83,8 +127,7 @@ static int _elf_load_interpret_program_header_entry(proc_t* p, file_descriptor_t
 #endif
     switch (ph.p_type) {
     case PT_LOAD:
-        _elf_load_do_copy_to_ram(p, fd, &ph);
-        break;
+        return _elf_load_map_segment(p, fd, &ph);
     default:
         break;
     }
@@ -92,58 +135,6 @@ static int _elf_load_interpret_program_header_entry(proc_t* p, file_descriptor_t
     return 0;
 }
 
-static int _elf_load_interpret_section_header_entry(proc_t* p, file_descriptor_t* fd)
-{
-    elf_section_header_32_t sh;
-    int err = vfs_read(fd, &sh, sizeof(sh));
-    if (err != sizeof(sh)) {
-        return err;
-    }
-
-#ifdef ELF_DEBUG
-    log("Section type %x %x - %x", sh.sh_type, sh.sh_addr, sh.sh_size);
-#endif
-    if (sh.sh_flags & SHF_ALLOC) {
-        uint32_t zone_flags = ZONE_READABLE;
-        uint32_t zone_type = ZONE_TYPE_NULL;
-        if (sh.sh_flags & SHF_WRITE) {
-            zone_flags |= ZONE_WRITABLE;
-        }
-        if (sh.sh_flags & SHF_EXECINSTR) {
-            zone_flags |= ZONE_EXECUTABLE;
-        }
-        // FIXME: Mapping of zone types is bad.
-        switch (sh.sh_type) {
-        case SHT_PROGBITS:
-            zone_type = ZONE_TYPE_CODE;
-            break;
-        case SHT_NOBITS:
-            zone_type = ZONE_TYPE_BSS;
-            break;
-        case SHT_INIT_ARRAY:
-            zone_type = ZONE_TYPE_DATA;
-            break;
-        case SHT_FINI_ARRAY:
-            zone_type = ZONE_TYPE_DATA;
-            break;
-        case SHT_PREINIT_ARRAY:
-            zone_type = ZONE_TYPE_DATA;
-            break;
-        default:
-            break;
-        }
-
-        if (zone_type) {
-            proc_zone_t* zone = proc_extend_zone(p, sh.sh_addr, sh.sh_size);
-            if (zone) {
-                zone->type = zone_type;
-                zone->flags |= zone_flags;
-            }
-        }
-    }
-    return 0;
-}
-
 static int _elf_load_alloc_stack(proc_t* p)
 {
     proc_zone_t* stack_zone = proc_new_random_zone_backward(p, USER_STACK_SIZE);
@@ -156,16 +147,13 @@ static int _elf_load_alloc_stack(proc_t* p)
 
 static inline int _elf_do_load(proc_t* p, file_descriptor_t* fd, elf_header_32_t* header)
 {
-    fd->offset = header->e_shoff;
-    int sh_num = header->e_shnum;
-    for (int i = 0; i < sh_num; i++) {
-        _elf_load_interpret_section_header_entry(p, fd);
-    }
-
     fd->offset = header->e_phoff;
     int ph_num = header->e_phnum;
     for (int i = 0; i < ph_num; i++) {
-        _elf_load_interpret_program_header_entry(p, fd);
+        int err = _elf_load_interpret_program_header_entry(p, fd);
+        if (err) {
+            return err;
+        }
     }
 
     proc_zone_t* stack_zone = proc_new_random_zone(p, VMM_PAGE_SIZE); // Forbid 0 allocations to make it work well
@@ -33,7 +33,7 @@ extern void _tasking_jumper();
 extern int _thread_setup_kstack(thread_t* thread, uint32_t esp);
 int kthread_setup(proc_t* p)
 {
-    p->pid = proc_alloc_pid();
+    tasking_set_proc_pid(p, proc_alloc_pid());
     p->pgid = p->pid;
     p->uid = 0;
     p->gid = 0;
@@ -42,11 +42,13 @@ int kthread_setup(proc_t* p)
     p->suid = 0;
     p->sgid = 0;
     p->is_kthread = true;
+    memset(&p->stat, 0, sizeof(p->stat));
     /* allocating kernel stack */
     p->main_thread = proc_alloc_thread();
-    p->main_thread->tid = p->pid;
+    tasking_set_thread_tid(p->main_thread, p->pid);
     p->main_thread->process = p;
     p->main_thread->last_cpu = LAST_CPU_NOT_SET;
+    memset(&p->main_thread->stat, 0, sizeof(p->main_thread->stat));
 
     p->main_thread->kstack = zoner_new_zone(KSTACK_ZONE_SIZE);
     if (!p->main_thread->kstack.start) {
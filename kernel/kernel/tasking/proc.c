@@ -5,6 +5,7 @@
  */
 
 #include <fs/vfs.h>
+#include <io/ioring/ioring.h>
 #include <io/tty/tty.h>
 #include <libkern/bits/errno.h>
 #include <libkern/libkern.h>
@@ -78,12 +79,6 @@ static thread_t* _proc_alloc_thread()
  * HELPER FUNCTIONS
  */
 
-#define foreach_thread(p)                                                                                                                      \
-    for (thread_list_node_t* __thread_list_node = thread_list.head; __thread_list_node != NULL; __thread_list_node = __thread_list_node->next) \
-        for (int i = 0; i < THREADS_PER_NODE; i++)                                                                                             \
-            for (thread_t* thread = &__thread_list_node->thread_storage[i]; thread; thread = NULL)                                             \
-                if (thread->process->pid == p->pid)
-
 thread_t* proc_alloc_thread()
 {
     return _proc_alloc_thread();
@@ -91,17 +86,22 @@ thread_t* proc_alloc_thread()
 
 thread_t* thread_by_pid(uint32_t pid)
 {
-    thread_list_node_t* __thread_list_node = thread_list.head;
-    while (__thread_list_node) {
-        for (int i = 0; i < THREADS_PER_NODE; i++) {
-            if (__thread_list_node->thread_storage[i].process->pid == pid) {
-                return &__thread_list_node->thread_storage[i];
-            }
-        }
-        __thread_list_node = __thread_list_node->next;
+    proc_t* p = tasking_get_proc(pid);
+    if (!p) {
+        return NULL;
     }
+    return p->main_thread;
+}
 
-    return NULL;
+static void _proc_put_zone_files(dynamic_array_t* zones)
+{
+    for (int i = 0; i < zones->size; i++) {
+        proc_zone_t* zone = (proc_zone_t*)dynamic_array_get(zones, i);
+        if (zone->file) {
+            dentry_put(zone->file);
+            zone->file = NULL;
+        }
+    }
 }
 
 uint32_t proc_alloc_pid()
@@ -126,7 +126,7 @@ int proc_init_storage()
 
 static ALWAYS_INLINE int proc_setup_lockless(proc_t* p)
 {
-    p->pid = proc_alloc_pid();
+    tasking_set_proc_pid(p, proc_alloc_pid());
     p->pgid = p->pid;
     p->ppid = 0;
     p->uid = 0;
@@ -136,6 +136,7 @@ static ALWAYS_INLINE int proc_setup_lockless(proc_t* p)
     p->suid = 0;
     p->sgid = 0;
     p->is_kthread = false;
+    memset(&p->stat, 0, sizeof(p->stat));
 
     p->main_thread = proc_alloc_thread();
     int res = thread_setup_main(p, p->main_thread);
@@ -257,6 +258,7 @@ int proc_copy_of(proc_t* new_proc, thread_t* from_thread)
         dynamic_array_push(&new_proc->zones, zone_to_copy);
     }
 
+    ioring_fork(new_proc, from_proc);
     return 0;
 }
 
@@ -317,7 +319,7 @@ static ALWAYS_INLINE int proc_load_lockless(proc_t* p, thread_t* main_thread, co
     // Reallocating proc.
     pdirectory_t* new_pdir = vmm_new_user_pdir();
     vmm_switch_pdir(new_pdir);
-    p->pdir = new_pdir;
+    tasking_set_proc_pdir(p, new_pdir);
 
     if (dynamic_array_init_of_size(&p->zones, sizeof(proc_zone_t), 8) != 0) {
         dentry_put(dentry);
@@ -335,7 +337,7 @@ success:
 
     // Clearing proc
     proc_kill_all_threads_except_lockless(p, p->main_thread);
-    p->pid = p->main_thread->tid;
+    tasking_set_proc_pid(p, p->main_thread->tid);
     if (p->proc_file) {
         dentry_put(p->proc_file);
     }
@@ -343,6 +345,8 @@ success:
     fpu_init_state(p->main_thread->fpu_state);
 #endif
     vmm_free_pdir(old_pdir, &old_zones);
+    _proc_put_zone_files(&old_zones);
+    ioring_free(p);
     dynamic_array_clear(&old_zones);
 
     // Setting up proc
@@ -354,9 +358,10 @@ success:
     return 0;
 
 restore:
-    p->pdir = old_pdir;
+    tasking_set_proc_pdir(p, old_pdir);
     vmm_switch_pdir(old_pdir);
     vmm_free_pdir(new_pdir, &p->zones);
+    _proc_put_zone_files(&p->zones);
     dynamic_array_clear(&p->zones);
     p->zones = old_zones;
     vfs_close(&fd);
@@ -382,6 +387,8 @@ int proc_free_lockless(proc_t* p)
         return -ESRCH;
     }
 
+    ioring_free(p);
+
     /* closing opend fds */
     if (p->fds) {
         for (int i = 0; i < MAX_OPENED_FILES; i++) {
@@ -402,13 +409,14 @@ int proc_free_lockless(proc_t* p)
 
     /* Key parts deletion. After that line you can't work with this process. */
     proc_kill_all_threads_lockless(p);
-    p->pid = 0;
+    tasking_set_proc_pid(p, 0);
 
     if (!p->is_kthread) {
         vmm_free_pdir(p->pdir, &p->zones);
-        p->pdir = NULL;
+        tasking_set_proc_pdir(p, NULL);
     }
 
+    _proc_put_zone_files(&p->zones);
     dynamic_array_free(&p->zones);
     return 0;
 }
@@ -67,6 +67,7 @@ static inline void _proc_swap_zones(proc_zone_t* one, proc_zone_t* two)
     one->flags = two->flags;
     one->len = two->len;
     one->offset = two->offset;
+    one->file_len = two->file_len;
     one->start = two->start;
     one->type = two->type;
 
@@ -74,6 +75,7 @@ static inline void _proc_swap_zones(proc_zone_t* one, proc_zone_t* two)
     two->flags = tmp.flags;
     two->len = tmp.len;
     two->offset = tmp.offset;
+    two->file_len = tmp.file_len;
     two->start = tmp.start;
     two->type = tmp.type;
 }
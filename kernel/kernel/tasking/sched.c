@@ -7,6 +7,7 @@
 // includes
 #include <algo/dynamic_array.h>
 #include <libkern/atomic.h>
+#include <libkern/ktrace.h>
 #include <libkern/libkern.h>
 #include <libkern/log.h>
 #include <mem/kmalloc.h>
@@ -195,6 +196,7 @@ void sched_unblock_threads()
             thread = &__thread_list_node->thread_storage[i];
             if (thread->status == THREAD_BLOCKED && thread->blocker.reason != BLOCKER_INVALID) {
                 if (thread->blocker.should_unblock && thread->blocker.should_unblock(thread)) {
+                    ktrace(KTRACE_EVENT_SCHED_WAKEUP, thread->tid, thread->blocker.reason);
                     thread->status = THREAD_RUNNING;
                     thread->blocker.reason = BLOCKER_INVALID;
                     sched_enqueue(thread);
@@ -218,8 +220,12 @@ void resched()
 {
     if (RUNNING_THREAD) {
         RUNNING_THREAD->stat_total_running_ticks += timeman_ticks_since_boot() - RUNNING_THREAD->start_time_in_ticks;
+        /* A thread which is still runnable was preempted, otherwise it gave up the cpu itself. */
         if (RUNNING_THREAD->status == THREAD_RUNNING) {
+            RUNNING_THREAD->stat.involuntary_switches++;
             _sched_add_to_end_of_runqueue(&cpus[RUNNING_THREAD->last_cpu].sched, RUNNING_THREAD);
+        } else {
+            RUNNING_THREAD->stat.voluntary_switches++;
         }
         switch_contexts(&RUNNING_THREAD->context, THIS_CPU->sched_context);
     } else {
@@ -291,6 +297,8 @@ void sched()
         thread->last_cpu = THIS_CPU->id;
         thread->start_time_in_ticks = timeman_ticks_since_boot();
         thread->ticks_until_preemption = _sched_get_timeslice(thread);
+        THIS_CPU->stat_context_switches++;
+        ktrace(KTRACE_EVENT_SCHED_SWITCH, thread->tid, thread->process->pid);
         switchuvm(thread);
         switch_contexts(&(THIS_CPU->sched_context), thread->context);
     }
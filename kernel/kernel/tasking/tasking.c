@@ -39,59 +39,192 @@ void _tasking_jumper()
 #endif
 
 /**
- * TASK LOADING FUNCTIONS
+ * INDICES
+ *
+ * Procs are indexed by pid and by pdir, threads are indexed by tid. Every
+ * index is a hash table of intrusive chains, so lookups don't walk the whole
+ * proc array or thread storage. The page fault handler looks the proc up by
+ * pdir on every user fault.
+ *
+ * Kernel threads borrow pdirs (the kernel one, or the pdir of a proc being
+ * dumped), so they aren't put into the pdir index.
+ *
+ * A thread stays in the tid index after it dies, until its slot is reused,
+ * so waitpid() works for a thread which has already exited.
  */
 
-extern thread_list_t thread_list;
-thread_t* tasking_get_thread(uint32_t tid)
+#define TASKING_INDEX_BITS 8
+#define TASKING_INDEX_SIZE (1 << TASKING_INDEX_BITS)
+
+static lock_t _tasking_index_lock;
+static proc_t* _proc_by_pid[TASKING_INDEX_SIZE];
+static proc_t* _proc_by_pdir[TASKING_INDEX_SIZE];
+static thread_t* _thread_by_tid[TASKING_INDEX_SIZE];
+
+/* Dead procs give their slots back, new procs take these first. */
+static uint16_t _free_proc_slots[MAX_PROCESS_COUNT];
+static uint32_t _free_proc_slots_cnt;
+
+static ALWAYS_INLINE uint32_t _tasking_id_hash(uint32_t id)
 {
-    thread_list_node_t* __thread_list_node = thread_list.head;
-    while (__thread_list_node) {
-        for (int i = 0; i < THREADS_PER_NODE; i++) {
-            if (__thread_list_node->thread_storage[i].tid == tid) {
-                return &__thread_list_node->thread_storage[i];
-            }
+    return id & (TASKING_INDEX_SIZE - 1);
+}
+
+static ALWAYS_INLINE uint32_t _tasking_pdir_hash(pdirectory_t* pdir)
+{
+    /* Pdirs are page aligned, the low bits are always zero. */
+    return ((uint32_t)pdir * 2654435761u) >> (32 - TASKING_INDEX_BITS);
+}
+
+static void _tasking_unlink_pid_lockless(proc_t* p)
+{
+    proc_t** link = &_proc_by_pid[_tasking_id_hash(p->pid)];
+    for (; *link; link = &(*link)->pid_index_next) {
+        if (*link == p) {
+            *link = p->pid_index_next;
+            break;
         }
-        __thread_list_node = __thread_list_node->next;
     }
+    p->pid_index_next = NULL;
+}
 
-    return NULL;
+static void _tasking_unlink_pdir_lockless(proc_t* p)
+{
+    proc_t** link = &_proc_by_pdir[_tasking_pdir_hash(p->pdir)];
+    for (; *link; link = &(*link)->pdir_index_next) {
+        if (*link == p) {
+            *link = p->pdir_index_next;
+            break;
+        }
+    }
+    p->pdir_index_next = NULL;
 }
 
-proc_t* tasking_get_proc(uint32_t pid)
+static void _tasking_unlink_tid_lockless(thread_t* thread)
 {
-    proc_t* p;
-    for (int i = 0; i < nxt_proc; i++) {
-        p = &proc[i];
-        if (p->pid == pid) {
-            return p;
+    thread_t** link = &_thread_by_tid[_tasking_id_hash(thread->tid)];
+    for (; *link; link = &(*link)->tid_index_next) {
+        if (*link == thread) {
+            *link = thread->tid_index_next;
+            break;
         }
     }
-    return NULL;
+    thread->tid_index_next = NULL;
+}
+
+void tasking_set_proc_pid(proc_t* p, uint32_t pid)
+{
+    lock_acquire(&_tasking_index_lock);
+    if (p->pid) {
+        _tasking_unlink_pid_lockless(p);
+    }
+    p->pid = pid;
+    if (pid) {
+        uint32_t hash = _tasking_id_hash(pid);
+        p->pid_index_next = _proc_by_pid[hash];
+        _proc_by_pid[hash] = p;
+    }
+    lock_release(&_tasking_index_lock);
+}
+
+void tasking_set_proc_pdir(proc_t* p, pdirectory_t* pdir)
+{
+    lock_acquire(&_tasking_index_lock);
+    if (p->pdir) {
+        _tasking_unlink_pdir_lockless(p);
+    }
+    p->pdir = pdir;
+    if (pdir && !p->is_kthread) {
+        uint32_t hash = _tasking_pdir_hash(pdir);
+        p->pdir_index_next = _proc_by_pdir[hash];
+        _proc_by_pdir[hash] = p;
+    }
+    lock_release(&_tasking_index_lock);
+}
+
+void tasking_set_thread_tid(thread_t* thread, uint32_t tid)
+{
+    lock_acquire(&_tasking_index_lock);
+    if (thread->tid) {
+        _tasking_unlink_tid_lockless(thread);
+    }
+    thread->tid = tid;
+    if (tid) {
+        uint32_t hash = _tasking_id_hash(tid);
+        thread->tid_index_next = _thread_by_tid[hash];
+        _thread_by_tid[hash] = thread;
+    }
+    lock_release(&_tasking_index_lock);
+}
+
+thread_t* tasking_get_thread(uint32_t tid)
+{
+    lock_acquire(&_tasking_index_lock);
+    thread_t* thread = _thread_by_tid[_tasking_id_hash(tid)];
+    while (thread && thread->tid != tid) {
+        thread = thread->tid_index_next;
+    }
+    lock_release(&_tasking_index_lock);
+    return thread;
+}
+
+proc_t* tasking_get_proc(uint32_t pid)
+{
+    lock_acquire(&_tasking_index_lock);
+    proc_t* p = _proc_by_pid[_tasking_id_hash(pid)];
+    while (p && p->pid != pid) {
+        p = p->pid_index_next;
+    }
+    lock_release(&_tasking_index_lock);
+    return p;
 }
 
 proc_t* tasking_get_proc_by_pdir(pdirectory_t* pdir)
+{
+    lock_acquire(&_tasking_index_lock);
+    proc_t* p = _proc_by_pdir[_tasking_pdir_hash(pdir)];
+    while (p && !(p->status == PROC_ALIVE && p->pdir == pdir)) {
+        p = p->pdir_index_next;
+    }
+    lock_release(&_tasking_index_lock);
+    return p;
+}
+
+static proc_t* _tasking_alloc_proc_slot()
 {
     proc_t* p;
-    for (int i = 0; i < nxt_proc; i++) {
-        p = &proc[i];
-        if (p->status == PROC_ALIVE && p->pdir == pdir) {
-            return p;
-        }
+    lock_acquire(&_tasking_index_lock);
+    if (_free_proc_slots_cnt) {
+        p = &proc[_free_proc_slots[--_free_proc_slots_cnt]];
+    } else {
+        ASSERT(nxt_proc < MAX_PROCESS_COUNT);
+        p = &proc[nxt_proc++];
     }
-    return NULL;
+    lock_release(&_tasking_index_lock);
+    return p;
+}
+
+static void _tasking_free_proc_slot(proc_t* p)
+{
+    lock_acquire(&_tasking_index_lock);
+    _free_proc_slots[_free_proc_slots_cnt++] = p - proc;
+    lock_release(&_tasking_index_lock);
 }
 
+/**
+ * TASK LOADING FUNCTIONS
+ */
+
 static proc_t* _tasking_alloc_proc()
 {
-    proc_t* p = &proc[nxt_proc++];
+    proc_t* p = _tasking_alloc_proc_slot();
     proc_setup(p);
     return p;
 }
 
 static proc_t* _tasking_alloc_proc_with_uid(uid_t uid, gid_t gid)
 {
-    proc_t* p = &proc[nxt_proc++];
+    proc_t* p = _tasking_alloc_proc_slot();
     proc_setup_with_uid(p, uid, gid);
     return p;
 }
@@ -99,14 +232,14 @@ static proc_t* _tasking_alloc_proc_with_uid(uid_t uid, gid_t gid)
 static proc_t* _tasking_fork_proc_from_current()
 {
     proc_t* new_proc = _tasking_alloc_proc();
-    new_proc->pdir = vmm_new_forked_user_pdir();
+    tasking_set_proc_pdir(new_proc, vmm_new_forked_user_pdir());
     proc_copy_of(new_proc, RUNNING_THREAD);
     return new_proc;
 }
 
 static proc_t* _tasking_alloc_kernel_thread(void* entry_point)
 {
-    proc_t* p = &proc[nxt_proc++];
+    proc_t* p = _tasking_alloc_proc_slot();
     kthread_setup(p);
     kthread_setup_regs(p, entry_point);
     return p;
@@ -125,7 +258,7 @@ void tasking_start_init_proc()
     proc_setup_tty(p, tty_new());
 
     /* creating new pdir */
-    p->pdir = vmm_new_user_pdir();
+    tasking_set_proc_pdir(p, vmm_new_user_pdir());
 
     if (proc_load(p, p->main_thread, "/boot/init") < 0) {
         kpanic("Failed to load init proc");
@@ -138,7 +271,7 @@ void tasking_start_init_proc()
 proc_t* tasking_create_kernel_thread(void* entry_point, void* data)
 {
     proc_t* p = _tasking_alloc_kernel_thread(entry_point);
-    p->pdir = vmm_get_kernel_pdir();
+    tasking_set_proc_pdir(p, vmm_get_kernel_pdir());
     kthread_fill_up_stack(p->main_thread, data);
     p->main_thread->status = THREAD_RUNNING;
     sched_enqueue(p->main_thread);
@@ -152,6 +285,8 @@ proc_t* tasking_create_kernel_thread(void* entry_point, void* data)
 void tasking_init()
 {
     nxt_proc = 0;
+    _free_proc_slots_cnt = 0;
+    lock_init(&_tasking_index_lock);
     proc_init_storage();
     signal_init();
     dump_prepare_kernel_data();
@@ -171,6 +306,7 @@ void tasking_kill_dying()
             proc_free_lockless(p);
             p->status = PROC_DEAD;
             lock_release(&p->lock);
+            _tasking_free_proc_slot(p);
         }
     }
 }
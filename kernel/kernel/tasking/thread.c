@@ -49,8 +49,10 @@ int thread_setup_main(proc_t* p, thread_t* thread)
     }
 
     thread->process = p;
-    thread->tid = p->pid;
+    tasking_set_thread_tid(thread, p->pid);
     thread->last_cpu = LAST_CPU_NOT_SET;
+    thread->stat_total_running_ticks = 0;
+    memset(&thread->stat, 0, sizeof(thread->stat));
 
     /* setting signal handlers to 0 */
     thread->signals_mask = 0xffffffff; /* for now all signals are legal */
@@ -76,8 +78,10 @@ int thread_setup(proc_t* p, thread_t* thread)
     }
 
     thread->process = p;
-    thread->tid = proc_alloc_pid();
+    tasking_set_thread_tid(thread, proc_alloc_pid());
     thread->last_cpu = LAST_CPU_NOT_SET;
+    thread->stat_total_running_ticks = 0;
+    memset(&thread->stat, 0, sizeof(thread->stat));
 
     /* setting signal handlers to 0 */
     thread->signals_mask = 0xffffffff; /* for now all signals are legal */
@@ -182,6 +186,7 @@ int thread_free(thread_t* thread)
     }
 
     thread_kstack_free(thread);
+    task_stat_add(&thread->process->stat, &thread->stat);
     thread->status = THREAD_DEAD;
     return 0;
 }
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <libkern/bits/errno.h>
+#include <libkern/libkern.h>
+#include <libkern/log.h>
+#include <mem/pmm.h>
+#include <mem/vmm/vmm.h>
+#include <mem/vmm/zoner.h>
+#include <platform/generic/system.h>
+#include <time/clock_page.h>
+#include <time/time_manager.h>
+
+// #define CLOCK_PAGE_DEBUG
+
+static zone_t _clock_page_zone;
+static clock_page_t* _clock_page = NULL;
+
+/**
+ * The page lives in the kernel space, whose tables are shared between all
+ * pdirs, so a single mapping makes it visible to every process. User access
+ * is read-only, the kernel is still able to write to it.
+ */
+int clock_page_setup()
+{
+    _clock_page_zone = zoner_new_zone(VMM_PAGE_SIZE);
+    if (!_clock_page_zone.start) {
+        return -ENOMEM;
+    }
+
+    uint32_t paddr = (uint32_t)pmm_alloc_aligned(VMM_PAGE_SIZE, VMM_PAGE_SIZE);
+    if (!paddr) {
+        zoner_free_zone(_clock_page_zone);
+        return -ENOMEM;
+    }
+
+    vmm_map_page(_clock_page_zone.start, paddr, PAGE_READABLE | PAGE_USER);
+    memset(_clock_page_zone.ptr, 0, VMM_PAGE_SIZE);
+    _clock_page = (clock_page_t*)_clock_page_zone.ptr;
+    _clock_page->ticks_per_second = timeman_ticks_per_second();
+    clock_page_update();
+
+#ifdef CLOCK_PAGE_DEBUG
+    log("Clock page is mapped at %x", _clock_page_zone.start);
+#endif
+    return 0;
+}
+
+/**
+ * Publishes the current time base. Only the boot cpu advances the time,
+ * so there is a single writer and no lock is needed.
+ */
+void clock_page_update()
+{
+    if (unlikely(!_clock_page)) {
+        return;
+    }
+
+    uint32_t seq = _clock_page->seq;
+    __atomic_store_n(&_clock_page->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    _clock_page->cpu_id = system_cpu_id();
+    _clock_page->ticks_since_boot = timeman_ticks_since_boot();
+    _clock_page->ticks_since_second = timeman_get_ticks_from_last_second();
+    _clock_page->seconds_since_boot = timeman_seconds_since_boot();
+    _clock_page->seconds_since_epoch = timeman_now();
+
+    __atomic_store_n(&_clock_page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+uint32_t clock_page_user_address()
+{
+    return _clock_page_zone.start;
+}
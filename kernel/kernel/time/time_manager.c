@@ -7,6 +7,7 @@
 #include <drivers/generic/rtc.h>
 #include <drivers/generic/timer.h>
 #include <libkern/log.h>
+#include <time/clock_page.h>
 #include <time/time_manager.h>
 
 // #define TIME_MANAGER_DEBUG
@@ -83,6 +84,7 @@ int timeman_setup()
 #ifdef TIME_MANAGER_DEBUG
     log("Loaded date: %d", time_since_epoch);
 #endif
+    clock_page_setup();
     return 0;
 }
 
@@ -100,6 +102,8 @@ void timeman_timer_tick()
         atomic_add(&time_since_epoch, 1);
         atomic_store(&ticks_since_second, 0);
     }
+
+    clock_page_update();
 }
 
 time_t timeman_now()
@@ -0,0 +1,22 @@
+#ifndef _LIBC_BITS_CLOCK_PAGE_H
+#define _LIBC_BITS_CLOCK_PAGE_H
+
+#include <sys/types.h>
+
+/**
+ * The clock page is mapped read-only into every process. The kernel
+ * republishes it on every timer tick, readers retry while @seq is odd
+ * or has changed during the read.
+ */
+struct clock_page {
+    uint32_t seq;
+    uint32_t cpu_id; /* CPU which published the snapshot */
+    uint32_t ticks_per_second;
+    time_t ticks_since_boot;
+    time_t ticks_since_second;
+    time_t seconds_since_boot;
+    time_t seconds_since_epoch;
+};
+typedef struct clock_page clock_page_t;
+
+#endif // _LIBC_BITS_CLOCK_PAGE_H
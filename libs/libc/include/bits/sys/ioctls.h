@@ -9,9 +9,15 @@
 #define TCSETSW 0x0105
 #define TCSETSF 0x0106
 
+/* PTY */
+#define PTY_GET_BUFFER_SIZE 0x0201
+#define PTY_SET_BUFFER_SIZE 0x0202 /* arg: size in bytes, applied to both directions */
+#define PTY_SET_COALESCE 0x0203 /* arg: window in ms the master waits to batch output, 0 to disable */
+
 /* BGA */
 #define BGA_SWAP_BUFFERS 0x0101
 #define BGA_GET_HEIGHT 0x0102
 #define BGA_GET_WIDTH 0x0103
+#define BGA_GET_BUFFERS_COUNT 0x0104
 
 #endif // _LIBC_BITS_SYS_IOCTLS_H
\ No newline at end of file
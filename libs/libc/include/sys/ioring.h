@@ -0,0 +1,16 @@
+#ifndef _LIBC_SYS_IORING_H
+#define _LIBC_SYS_IORING_H
+
+#include <bits/ioring.h>
+#include <stddef.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+int ioring_setup(ioring_t** ring);
+int ioring_enter(uint32_t min_complete);
+
+__END_DECLS
+
+#endif // _LIBC_SYS_IORING_H
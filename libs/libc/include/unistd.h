@@ -24,6 +24,8 @@ int rmdir(const char* path);
 int chdir(const char* path);
 int unlink(const char* path);
 off_t lseek(int fd, off_t off, int whence);
+int fsync(int fd);
+int fdatasync(int fd);
 
 /* identity */
 uid_t getuid();
@@ -3,11 +3,13 @@ int errno;
 extern int _stdio_init();
 extern int _stdio_deinit();
 extern int _malloc_init();
+extern int _clock_page_init();
 
 void _libc_init()
 {
     _malloc_init();
     _stdio_init();
+    _clock_page_init();
     extern void (*__init_array_start[])(int, char**, char**) __attribute__((visibility("hidden")));
     extern void (*__init_array_end[])(int, char**, char**) __attribute__((visibility("hidden")));
 
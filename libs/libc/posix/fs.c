@@ -68,6 +68,18 @@ int fstat(int nfds, fstat_t* stat)
     RETURN_WITH_ERRNO(res, 0, -1);
 }
 
+int fsync(int fd)
+{
+    int res = DO_SYSCALL_1(SYS_FSYNC, fd);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
+int fdatasync(int fd)
+{
+    int res = DO_SYSCALL_1(SYS_FDATASYNC, fd);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
 int select(int nfds, fd_set_t* readfds, fd_set_t* writefds, fd_set_t* exceptfds, timeval_t* timeout)
 {
     int res = DO_SYSCALL_5(SYS_SELECT, nfds, readfds, writefds, exceptfds, timeout);
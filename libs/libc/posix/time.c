@@ -1,8 +1,14 @@
+#include "../time/_internal.h"
 #include <sys/time.h>
 #include <sysdep.h>
 
 int gettimeofday(timeval_t* tv, timezone_t* tz)
 {
+    if (_clock_page_gettimeofday(tv, tz) == 0) {
+        set_errno(0);
+        return 0;
+    }
+
     int res = DO_SYSCALL_2(SYS_GET_TIME_OF_DAY, tv, tz);
     RETURN_WITH_ERRNO(res, res, -1);
 }
@@ -0,0 +1,14 @@
+#include <sys/ioring.h>
+#include <sysdep.h>
+
+int ioring_setup(ioring_t** ring)
+{
+    int res = DO_SYSCALL_1(SYS_IORING_SETUP, ring);
+    RETURN_WITH_ERRNO(res, 0, -1);
+}
+
+int ioring_enter(uint32_t min_complete)
+{
+    int res = DO_SYSCALL_1(SYS_IORING_ENTER, min_complete);
+    RETURN_WITH_ERRNO(res, res, -1);
+}
@@ -0,0 +1,16 @@
+#ifndef _LIBC_TIME__INTERNAL_H
+#define _LIBC_TIME__INTERNAL_H
+
+#include <bits/time.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+
+__BEGIN_DECLS
+
+int _clock_page_init();
+int _clock_page_gettime(clockid_t clk_id, timespec_t* tp);
+int _clock_page_gettimeofday(timeval_t* tv, timezone_t* tz);
+
+__END_DECLS
+
+#endif // _LIBC_TIME__INTERNAL_H
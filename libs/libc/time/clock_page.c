@@ -0,0 +1,82 @@
+#include "_internal.h"
+#include <bits/clock_page.h>
+#include <stddef.h>
+#include <sysdep.h>
+
+static clock_page_t* _clock_page = NULL;
+
+int _clock_page_init()
+{
+    int res = DO_SYSCALL_1(SYS_CLOCK_PAGE, &_clock_page);
+    if (res < 0) {
+        _clock_page = NULL;
+    }
+    return 0;
+}
+
+/**
+ * Seqlock read side: the kernel makes seq odd while it updates the page,
+ * so retry until the same even seq is seen before and after the copy.
+ */
+static inline void _clock_page_snapshot(clock_page_t* snap)
+{
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&_clock_page->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+
+        snap->ticks_per_second = _clock_page->ticks_per_second;
+        snap->ticks_since_second = _clock_page->ticks_since_second;
+        snap->seconds_since_boot = _clock_page->seconds_since_boot;
+        snap->seconds_since_epoch = _clock_page->seconds_since_epoch;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&_clock_page->seq, __ATOMIC_RELAXED) == seq) {
+            return;
+        }
+    }
+}
+
+/**
+ * Returns -1 when the time can't be served from the clock page,
+ * callers should fall back to the syscall then.
+ */
+int _clock_page_gettime(clockid_t clk_id, timespec_t* tp)
+{
+    if (!_clock_page || !tp) {
+        return -1;
+    }
+
+    clock_page_t snap;
+    _clock_page_snapshot(&snap);
+
+    switch (clk_id) {
+    case CLOCK_MONOTONIC:
+        tp->tv_sec = snap.seconds_since_boot;
+        break;
+    case CLOCK_REALTIME:
+        tp->tv_sec = snap.seconds_since_epoch;
+        break;
+    default:
+        return -1;
+    }
+    tp->tv_nsec = snap.ticks_since_second * (1000000000 / snap.ticks_per_second);
+    return 0;
+}
+
+int _clock_page_gettimeofday(timeval_t* tv, timezone_t* tz)
+{
+    if (!_clock_page || !tv || !tz) {
+        return -1;
+    }
+
+    clock_page_t snap;
+    _clock_page_snapshot(&snap);
+
+    tv->tv_sec = snap.seconds_since_epoch;
+    tv->tv_usec = snap.ticks_since_second * (1000000 / snap.ticks_per_second);
+    tz->tz_dsttime = DST_NONE;
+    tz->tz_minuteswest = 0;
+    return 0;
+}
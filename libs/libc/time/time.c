@@ -1,3 +1,4 @@
+#include "_internal.h"
 #include <sys/time.h>
 #include <sysdep.h>
 #include <time.h>
@@ -116,6 +117,11 @@ time_t mktime(tm_t* tm)
 
 int clock_gettime(clockid_t clk_id, timespec_t* tp)
 {
+    if (_clock_page_gettime(clk_id, tp) == 0) {
+        set_errno(0);
+        return 0;
+    }
+
     int res = DO_SYSCALL_2(SYS_CLOCK_GETTIME, clk_id, tp);
     RETURN_WITH_ERRNO(res, res, -1);
 }
@@ -8,6 +8,7 @@
 #include <functional>
 #include <libfoundation/Event.h>
 #include <libfoundation/EventReceiver.h>
+#include <libfoundation/IORing.h>
 #include <libfoundation/Receivers.h>
 #include <memory>
 #include <vector>
@@ -57,21 +58,18 @@ public:
         m_waiting_fds.push_back(FDWaiter(fd, on_read, on_write));
     }
 
-    inline void add(const Timer& timer)
-    {
-        m_timers.push_back(timer);
-    }
-
-    inline void add(Timer&& timer)
-    {
-        m_timers.push_back(std::move(timer));
-    }
+    // Slots of fired one-shot timers are reused, so rearming one doesn't grow the list.
+    void add(const Timer& timer);
+    void add(Timer&& timer);
 
     inline void add(EventReceiver& rec, Event* ptr)
     {
         m_event_queue.push_back(QueuedEvent(rec, ptr));
     }
 
+    // Operations queued to the ring are submitted once per pump().
+    inline IORing& ioring() { return m_ioring; }
+
     inline void stop(int exit_code) { m_exit_code = exit_code, m_stop_flag = true; }
     void check_fds();
     void check_timers();
@@ -84,5 +82,6 @@ private:
     std::vector<FDWaiter> m_waiting_fds;
     std::vector<Timer> m_timers;
     std::vector<QueuedEvent> m_event_queue;
+    IORing m_ioring;
 };
 } // namespace LFoundation
\ No newline at end of file
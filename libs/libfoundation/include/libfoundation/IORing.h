@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <sys/ioring.h>
+#include <sys/types.h>
+
+namespace LFoundation {
+
+// IORing batches file operations, so several of them cost a single syscall.
+// Operations are queued with read(), write(), ioctl() and close(), passed to
+// the kernel with submit() and their callbacks are invoked from reap() in the
+// order the operations were queued.
+class IORing {
+public:
+    using Callback = std::function<void(int res, uint8_t* data)>;
+
+    IORing() = default;
+    ~IORing() = default;
+
+    IORing(const IORing&) = delete;
+    IORing& operator=(const IORing&) = delete;
+
+    bool read(int fd, size_t len, Callback callback);
+    bool write(int fd, const void* buf, size_t len, Callback callback = nullptr);
+    bool ioctl(int fd, uint32_t cmd, uint32_t arg, Callback callback = nullptr);
+    bool close(int fd, Callback callback = nullptr);
+
+    // Passes queued operations to the kernel and waits for at least
+    // min_complete of them to complete. Returns the number of completions
+    // available to reap().
+    int submit(uint32_t min_complete = 0);
+    int reap();
+
+    inline bool has_queued() const { return m_queued_tail != m_sq_tail; }
+    inline size_t in_flight() const { return m_queued_tail - m_cq_head; }
+
+private:
+    bool setup();
+    bool has_room(size_t data_len) const;
+    bool reserve(size_t data_len);
+    uint8_t* alloc_data(size_t len);
+    void queue(uint32_t opcode, int fd, uint32_t addr, uint32_t len, Callback callback);
+
+    ioring_t* m_ring { nullptr };
+    bool m_setup_failed { false };
+    uint32_t m_sq_tail { 0 };
+    uint32_t m_queued_tail { 0 };
+    uint32_t m_cq_head { 0 };
+    size_t m_data_used { 0 };
+    Callback m_callbacks[IORING_ENTRIES];
+};
+
+} // namespace LFoundation
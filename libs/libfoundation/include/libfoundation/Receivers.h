@@ -116,6 +116,7 @@ public:
         , m_callback(fdw.m_callback)
         , m_time_interval(fdw.m_time_interval)
         , m_repeat(fdw.m_repeat)
+        , m_done(fdw.m_done)
         , m_expire_time(fdw.m_expire_time)
     {
     }
@@ -125,6 +126,7 @@ public:
         , m_callback(fdw.m_callback)
         , m_time_interval(fdw.m_time_interval)
         , m_repeat(fdw.m_repeat)
+        , m_done(fdw.m_done)
         , m_expire_time(fdw.m_expire_time)
     {
     }
@@ -132,16 +134,27 @@ public:
     Timer& operator=(const Timer& fdw)
     {
         m_callback = fdw.m_callback;
+        m_time_interval = fdw.m_time_interval;
+        m_repeat = fdw.m_repeat;
+        m_done = fdw.m_done;
+        m_expire_time = fdw.m_expire_time;
         return *this;
     }
 
     Timer& operator=(Timer&& fdw)
     {
-        m_callback = fdw.m_callback;
+        m_callback = std::move(fdw.m_callback);
+        m_time_interval = fdw.m_time_interval;
+        m_repeat = fdw.m_repeat;
+        m_done = fdw.m_done;
+        m_expire_time = fdw.m_expire_time;
         return *this;
     }
 
     inline bool repeated() const { return m_repeat; }
+
+    // A one-shot timer is done once it has fired, the event loop reuses its slot.
+    inline bool done() const { return m_done; }
     inline bool expired(const std::timespec& now) const
     {
         return now.tv_sec > m_expire_time.tv_sec || (now.tv_sec == m_expire_time.tv_sec && now.tv_nsec >= m_expire_time.tv_nsec);
@@ -156,7 +169,15 @@ public:
 
     void receive_event(std::unique_ptr<Event> event) override
     {
-        m_callback();
+        if (m_repeat) {
+            m_callback();
+            return;
+        }
+
+        // The callback may add a timer into this slot, so it runs from a copy.
+        auto callback = std::move(m_callback);
+        m_done = true;
+        callback();
     }
 
 private:
@@ -164,6 +185,7 @@ private:
     std::timespec m_expire_time;
     std::time_t m_time_interval;
     bool m_repeat { false };
+    bool m_done { false };
 };
 
 class CallEvent final : public Event {
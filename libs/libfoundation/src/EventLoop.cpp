@@ -67,6 +67,28 @@ void EventLoop::check_fds()
     }
 }
 
+void EventLoop::add(const Timer& timer)
+{
+    for (auto& slot : m_timers) {
+        if (slot.done()) {
+            slot = timer;
+            return;
+        }
+    }
+    m_timers.push_back(timer);
+}
+
+void EventLoop::add(Timer&& timer)
+{
+    for (auto& slot : m_timers) {
+        if (slot.done()) {
+            slot = std::move(timer);
+            return;
+        }
+    }
+    m_timers.push_back(std::move(timer));
+}
+
 void EventLoop::check_timers()
 {
     if (m_timers.empty()) {
@@ -77,7 +99,7 @@ void EventLoop::check_timers()
     clock_gettime(CLOCK_MONOTONIC, &tp);
 
     for (auto& timer : m_timers) {
-        if (!timer.expired(tp)) {
+        if (timer.done() || !timer.expired(tp)) {
             continue;
         }
 
@@ -99,7 +121,12 @@ void EventLoop::check_timers()
         event.receiver.receive_event(std::move(event.event));
     }
 
-    if (!events_to_dispatch.size()) {
+    if (m_ioring.has_queued()) {
+        m_ioring.submit();
+    }
+    int completions = m_ioring.reap();
+
+    if (!events_to_dispatch.size() && !completions) {
         sched_yield();
     }
 }
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <cstring>
+#include <libfoundation/IORing.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+namespace LFoundation {
+
+static inline void run_callback(IORing::Callback& callback, int res, uint8_t* data)
+{
+    if (callback) {
+        callback(std::move(res), std::move(data));
+    }
+}
+
+bool IORing::setup()
+{
+    if (m_ring) {
+        return true;
+    }
+
+    if (m_setup_failed) {
+        return false;
+    }
+
+    if (ioring_setup(&m_ring) < 0) {
+        m_ring = nullptr;
+        m_setup_failed = true;
+        return false;
+    }
+
+    m_sq_tail = m_queued_tail = m_ring->sq_tail;
+    m_cq_head = m_ring->cq_head;
+    m_data_used = 0;
+    return true;
+}
+
+bool IORing::has_room(size_t data_len) const
+{
+    return in_flight() < IORING_ENTRIES && m_data_used + ((data_len + 3) & ~3) <= IORING_DATA_SIZE;
+}
+
+bool IORing::reserve(size_t data_len)
+{
+    if (!setup() || data_len > IORING_DATA_SIZE) {
+        return false;
+    }
+
+    if (has_room(data_len)) {
+        return true;
+    }
+
+    // The data area is reused only when nothing is in flight. Entries which
+    // are not ready could stay in flight for a long time, so instead of
+    // waiting for them the caller falls back to a direct syscall.
+    submit();
+    reap();
+    return has_room(data_len);
+}
+
+uint8_t* IORing::alloc_data(size_t len)
+{
+    uint8_t* data = &m_ring->data[m_data_used];
+    m_data_used += (len + 3) & ~3;
+    return data;
+}
+
+void IORing::queue(uint32_t opcode, int fd, uint32_t addr, uint32_t len, Callback callback)
+{
+    uint32_t index = m_queued_tail & (IORING_ENTRIES - 1);
+    ioring_sqe_t& sqe = m_ring->sqes[index];
+    sqe.opcode = opcode;
+    sqe.fd = fd;
+    sqe.addr = addr;
+    sqe.len = len;
+    sqe.user_data = m_queued_tail;
+    m_callbacks[index] = std::move(callback);
+    m_queued_tail++;
+}
+
+bool IORing::read(int fd, size_t len, Callback callback)
+{
+    if (!reserve(len)) {
+        std::vector<uint8_t> data(len);
+        int res = ::read(fd, (char*)data.data(), len);
+        run_callback(callback, res, data.data());
+        return false;
+    }
+
+    uint8_t* data = alloc_data(len);
+    queue(IORING_OP_READ, fd, (uint32_t)data, len, std::move(callback));
+    return true;
+}
+
+bool IORing::write(int fd, const void* buf, size_t len, Callback callback)
+{
+    if (!reserve(len)) {
+        int res = ::write(fd, buf, len);
+        run_callback(callback, res, nullptr);
+        return false;
+    }
+
+    uint8_t* data = alloc_data(len);
+    memcpy(data, buf, len);
+    queue(IORING_OP_WRITE, fd, (uint32_t)data, len, std::move(callback));
+    return true;
+}
+
+bool IORing::ioctl(int fd, uint32_t cmd, uint32_t arg, Callback callback)
+{
+    if (!reserve(0)) {
+        int res = ::ioctl(fd, cmd, arg);
+        run_callback(callback, res, nullptr);
+        return false;
+    }
+
+    queue(IORING_OP_IOCTL, fd, arg, cmd, std::move(callback));
+    return true;
+}
+
+bool IORing::close(int fd, Callback callback)
+{
+    if (!reserve(0)) {
+        int res = ::close(fd);
+        run_callback(callback, res, nullptr);
+        return false;
+    }
+
+    queue(IORING_OP_CLOSE, fd, 0, 0, std::move(callback));
+    return true;
+}
+
+int IORing::submit(uint32_t min_complete)
+{
+    if (!m_ring) {
+        return 0;
+    }
+
+    __atomic_store_n(&m_ring->sq_tail, m_queued_tail, __ATOMIC_RELEASE);
+    m_sq_tail = m_queued_tail;
+    ioring_enter(min_complete);
+    return __atomic_load_n(&m_ring->cq_tail, __ATOMIC_ACQUIRE) - m_cq_head;
+}
+
+int IORing::reap()
+{
+    if (!m_ring) {
+        return 0;
+    }
+
+    int reaped = 0;
+    uint32_t cq_tail = __atomic_load_n(&m_ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (m_cq_head != cq_tail) {
+        ioring_cqe_t& cqe = m_ring->cqes[m_cq_head & (IORING_ENTRIES - 1)];
+        uint32_t index = cqe.user_data & (IORING_ENTRIES - 1);
+        int res = cqe.res;
+
+        uint8_t* data = nullptr;
+        if (m_ring->sqes[index].opcode == IORING_OP_READ) {
+            data = (uint8_t*)m_ring->sqes[index].addr;
+        }
+
+        Callback callback = std::move(m_callbacks[index]);
+        m_callbacks[index] = nullptr;
+        m_cq_head++;
+        __atomic_store_n(&m_ring->cq_head, m_cq_head, __ATOMIC_RELEASE);
+
+        run_callback(callback, res, data);
+        reaped++;
+    }
+
+    if (!in_flight()) {
+        m_data_used = 0;
+    }
+    return reaped;
+}
+
+} // namespace LFoundation
@@ -45,6 +45,9 @@ public:
 
     inline const Color& fill_color() const { return m_color; }
 
+    inline PixelBitmap& bitmap() { return m_bitmap; }
+    inline const PixelBitmap& bitmap() const { return m_bitmap; }
+
 private:
     void fill_rounded_helper(const Point<int>& start, size_t radius);
     void draw_rounded_helper(const Point<int>& start, size_t radius, const PixelBitmap& bitmap);
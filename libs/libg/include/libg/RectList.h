@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <libg/Rect.h>
+#include <libipc/Decodable.h>
+#include <libipc/Encodable.h>
+#include <libipc/Encoder.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace LG {
+
+// A list of areas, e.g. damage of a frame, which could be sent in a message.
+// Intersecting rects are merged, so no area is listed twice.
+class RectList : public std::vector<Rect>, public Encodable<RectList>, public Decodable<RectList> {
+public:
+    // When the list gets longer, it is collapsed into one bounding rect.
+    static constexpr size_t max_rects() { return 16; }
+
+    // A rect is sent as its origin, width and height.
+    static constexpr size_t encoded_rect_size() { return 4 * sizeof(int); }
+
+    RectList() = default;
+
+    void add(const Rect& area)
+    {
+        if (area.empty()) {
+            return;
+        }
+
+        for (int i = 0; i < size(); i++) {
+            if (at(i).contains(area)) {
+                return;
+            }
+        }
+
+        // Rects which the area touches are taken out and united with it. The
+        // union grows, so the scan repeats until it touches nothing else.
+        auto merged = area;
+        bool intersected = false;
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (int i = 0; i < size(); i++) {
+                if (merged.intersects(at(i))) {
+                    merged.unite(at(i));
+                    std::swap(at(i), back());
+                    pop_back();
+                    i--;
+                    changed = intersected = true;
+                }
+            }
+        }
+
+        if (!intersected && size() == max_rects()) {
+            merged.unite(bounding_rect());
+            clear_remain_capacity();
+        }
+        push_back(merged);
+    }
+
+    Rect bounding_rect() const
+    {
+        if (empty()) {
+            return Rect();
+        }
+
+        auto bounds = at(0);
+        for (int i = 1; i < size(); i++) {
+            bounds.unite(at(i));
+        }
+        return bounds;
+    }
+
+    void encode(EncodedMessage& buf) const override
+    {
+        Encoder::append(buf, (unsigned int)size());
+        for (int i = 0; i < size(); i++) {
+            Encoder::append(buf, at(i));
+        }
+    }
+
+    // The count comes from the sender, so it is checked against the rest of
+    // the message and the longest list a sender could make before reading
+    // any rects. The rest of a malformed message is skipped.
+    void decode(const char* buf, size_t& offset, size_t size) override
+    {
+        unsigned int count;
+        if (offset + sizeof(count) > size) {
+            offset = size;
+            return;
+        }
+        Encoder::decode(buf, offset, count);
+        if (count > max_rects() || count > (size - offset) / encoded_rect_size()) {
+            offset = size;
+            return;
+        }
+
+        for (int i = 0; i < count; i++) {
+            Rect rect;
+            Encoder::decode(buf, offset, rect);
+            add(rect);
+        }
+    }
+};
+
+} // namespace LG
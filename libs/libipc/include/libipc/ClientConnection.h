@@ -71,9 +71,9 @@ public:
         size_t buf_size = buf.size();
         for (size_t i = 0; i < buf_size; i += msg_len) {
             msg_len = 0;
-            if (auto response = m_client_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
+            if (auto response = m_client_decoder.decode((buf.data() + i), buf_size - i, msg_len)) {
                 m_messages.push_back(std::move(response));
-            } else if (auto response = m_server_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
+            } else if (auto response = m_server_decoder.decode((buf.data() + i), buf_size - i, msg_len)) {
                 m_messages.push_back(std::move(response));
             } else {
                 Logger::debug << getpid() << " :: ClientConnection read error" << std::endl;
@@ -5,4 +5,8 @@ template <typename T>
 class Decodable {
 public:
     virtual void decode(const char* buf, size_t& offset) { }
+
+    // size is the length of the message in buf. Values of a variable length
+    // check their length against it, the others don't need it.
+    virtual void decode(const char* buf, size_t& offset, size_t size) { decode(buf, offset); }
 };
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <libipc/Decodable.h>
 #include <vector>
 
 typedef std::vector<uint8_t> EncodedMessage;
@@ -85,6 +86,17 @@ public:
         value.decode(buf, offset);
     }
 
+    // Messages are decoded with their size, only values of a variable length use it.
+    static void decode(const char* buf, size_t& offset, size_t size, unsigned long& val) { decode(buf, offset, val); }
+    static void decode(const char* buf, size_t& offset, size_t size, unsigned int& val) { decode(buf, offset, val); }
+    static void decode(const char* buf, size_t& offset, size_t size, int& val) { decode(buf, offset, val); }
+
+    template <typename T>
+    static void decode(const char* buf, size_t& offset, size_t size, T& value)
+    {
+        static_cast<Decodable<T>&>(value).decode(buf, offset, size);
+    }
+
 private:
     Encoder() = default;
 };
\ No newline at end of file
@@ -46,11 +46,11 @@ public:
         size_t buf_size = buf.size();
         for (int i = 0; i < buf_size; i += msg_len) {
             msg_len = 0;
-            if (auto response = m_server_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
+            if (auto response = m_server_decoder.decode((buf.data() + i), buf_size - i, msg_len)) {
                 if (auto answer = m_server_decoder.handle(*response)) {
                     send_message(*answer);
                 }
-            } else if (auto response = m_client_decoder.decode((buf.data() + i), read_cnt - i, msg_len)) {
+            } else if (auto response = m_client_decoder.decode((buf.data() + i), buf_size - i, msg_len)) {
 
             } else {
                 std::abort();
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _LIBOBJC_CACHE_H
+#define _LIBOBJC_CACHE_H
+
+#include <libobjc/v1/decls.h>
+#include <stddef.h>
+
+// Method cache of a class, kept in its disp_table field.
+//
+// It is an open addressing table of selector to implementation pairs with
+// linear probing. The home slot is taken from the address of the selector,
+// selectors are 8 bytes long, so the low bits are dropped. A slot with a
+// null selector ends a probe sequence, the table is never filled up over
+// 3/4, so there is always one.
+//
+// objc_msgSend probes the cache in assembly, keep the layout and the
+// constants below in sync with msgsend_*.S.
+#define OBJC_CACHE_SEL_SHIFT 3
+#define OBJC_CACHE_MIN_CAPACITY 8
+
+struct objc_cache_entry {
+    SEL sel;
+    IMP imp;
+};
+
+struct objc_cache {
+    uintptr_t mask;
+    uintptr_t occupied;
+    struct objc_cache_entry buckets[1]; // Variable len
+};
+
+static inline uintptr_t cache_home_index(struct objc_cache* cache, SEL sel)
+{
+    return ((uintptr_t)sel >> OBJC_CACHE_SEL_SHIFT) & cache->mask;
+}
+
+IMP cache_lookup(Class cls, SEL sel);
+void cache_insert(Class cls, SEL sel, IMP imp);
+
+#endif // _LIBOBJC_CACHE_H
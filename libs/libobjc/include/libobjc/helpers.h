@@ -7,6 +7,7 @@
 #ifndef _LIBOBJC_HELPERS_H
 #define _LIBOBJC_HELPERS_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #define OBJC_EXPORT extern "C"
@@ -21,4 +22,15 @@
 #define OBJC_DEBUGPRINT(...) (sizeof(int))
 #endif
 
+// FNV-1a, used by the class and selector tables.
+static inline uint32_t objc_hash_string(const char* str)
+{
+    uint32_t hash = 2166136261u;
+    for (; *str; str++) {
+        hash ^= (uint8_t)*str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 #endif // _LIBOBJC_HELPERS_H
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <libobjc/cache.h>
+#include <libobjc/class.h>
+#include <libobjc/memory.h>
+#include <libobjc/runtime.h>
+#include <stddef.h>
+
+// The offset is hardcoded in msgsend_*.S.
+static_assert(__builtin_offsetof(struct objc_class, disp_table) == 8 * sizeof(void*), "disp_table is moved, update msgsend");
+static_assert(__builtin_offsetof(struct objc_cache, buckets) == 2 * sizeof(void*), "objc_cache is changed, update msgsend");
+static_assert(sizeof(struct objc_cache_entry) == 2 * sizeof(void*), "objc_cache_entry is changed, update msgsend");
+
+static inline struct objc_cache* cache_of(Class cls)
+{
+    return (struct objc_cache*)cls->disp_table;
+}
+
+static struct objc_cache* cache_alloc(uintptr_t capacity)
+{
+    size_t size = sizeof(struct objc_cache) + sizeof(struct objc_cache_entry) * (capacity - 1);
+    struct objc_cache* cache = (struct objc_cache*)objc_calloc(1, size);
+    cache->mask = capacity - 1;
+    cache->occupied = 0;
+    return cache;
+}
+
+static void cache_insert_into(struct objc_cache* cache, SEL sel, IMP imp)
+{
+    uintptr_t index = cache_home_index(cache, sel);
+    while (cache->buckets[index].sel) {
+        index = (index + 1) & cache->mask;
+    }
+
+    // The imp is set first, so a matching selector is never seen with
+    // an empty imp.
+    cache->buckets[index].imp = imp;
+    cache->buckets[index].sel = sel;
+    cache->occupied++;
+}
+
+IMP cache_lookup(Class cls, SEL sel)
+{
+    struct objc_cache* cache = cache_of(cls);
+    if (!cache) {
+        return nil_method;
+    }
+
+    for (uintptr_t index = cache_home_index(cache, sel);; index = (index + 1) & cache->mask) {
+        SEL cur_sel = cache->buckets[index].sel;
+        if (cur_sel == sel) {
+            return cache->buckets[index].imp;
+        }
+        if (!cur_sel) {
+            return nil_method;
+        }
+    }
+}
+
+void cache_insert(Class cls, SEL sel, IMP imp)
+{
+    struct objc_cache* cache = cache_of(cls);
+    if (!cache) {
+        cache = cache_alloc(OBJC_CACHE_MIN_CAPACITY);
+        cls->disp_table = cache;
+    }
+
+    uintptr_t capacity = cache->mask + 1;
+    if ((cache->occupied + 1) * 4 > capacity * 3) {
+        struct objc_cache* new_cache = cache_alloc(capacity * 2);
+        for (uintptr_t i = 0; i < capacity; i++) {
+            if (cache->buckets[i].sel) {
+                cache_insert_into(new_cache, cache->buckets[i].sel, cache->buckets[i].imp);
+            }
+        }
+        // TODO: The runtime is single threaded for now, once it isn't, the
+        // old cache can't be freed while other threads may probe it.
+        cls->disp_table = new_cache;
+        objc_free(cache);
+        cache = new_cache;
+    }
+
+    cache_insert_into(cache, sel, imp);
+}
@@ -5,6 +5,7 @@
  */
 
 #include <assert.h>
+#include <libobjc/cache.h>
 #include <libobjc/class.h>
 #include <libobjc/memory.h>
 #include <libobjc/module.h>
@@ -15,40 +16,69 @@
 
 struct class_node {
     const char* name;
-    int length;
+    uint32_t hash;
     Class cls;
 };
 
-// FIXME: Allocate it dynamically.
-static class_node class_tabel_storage[512];
-static int class_table_next_free = 0;
+// Classes are kept in an open addressing table with linear probing, keyed
+// by name.
+static class_node* class_table_storage;
+static uint32_t class_table_capacity = 0;
+static uint32_t class_table_size = 0;
+
+#define CLASS_TABLE_MIN_CAPACITY 64
 
 static Class unresolved_classes[128];
 static int unresolved_classes_next = 0;
 
 void class_table_init()
 {
+    class_table_capacity = CLASS_TABLE_MIN_CAPACITY;
+    class_table_storage = (class_node*)objc_calloc(class_table_capacity, sizeof(class_node));
 }
 
 Class class_table_find(const char* name)
 {
-    int len = strlen(name);
-    for (int i = 0; i < class_table_next_free; i++) {
-        if (len == class_tabel_storage[i].length) {
-            if (strcmp(name, class_tabel_storage[i].name) == 0) {
-                return class_tabel_storage[i].cls;
-            }
+    uint32_t hash = objc_hash_string(name);
+    uint32_t mask = class_table_capacity - 1;
+    for (uint32_t index = hash & mask; class_table_storage[index].cls; index = (index + 1) & mask) {
+        if (class_table_storage[index].hash == hash && strcmp(name, class_table_storage[index].name) == 0) {
+            return class_table_storage[index].cls;
         }
     }
     return Nil;
 }
 
+static void class_table_insert(const char* name, uint32_t hash, Class cls)
+{
+    uint32_t mask = class_table_capacity - 1;
+    uint32_t index = hash & mask;
+    while (class_table_storage[index].cls) {
+        index = (index + 1) & mask;
+    }
+    class_table_storage[index].name = name;
+    class_table_storage[index].hash = hash;
+    class_table_storage[index].cls = cls;
+}
+
 static void class_table_add(const char* name, Class cls)
 {
-    int place = class_table_next_free++;
-    class_tabel_storage[place].name = name;
-    class_tabel_storage[place].length = strlen(name);
-    class_tabel_storage[place].cls = cls;
+    if ((class_table_size + 1) * 4 > class_table_capacity * 3) {
+        class_node* old_storage = class_table_storage;
+        uint32_t old_capacity = class_table_capacity;
+
+        class_table_capacity = old_capacity * 2;
+        class_table_storage = (class_node*)objc_calloc(class_table_capacity, sizeof(class_node));
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (old_storage[i].cls) {
+                class_table_insert(old_storage[i].name, old_storage[i].hash, old_storage[i].cls);
+            }
+        }
+        objc_free(old_storage);
+    }
+
+    class_table_insert(name, objc_hash_string(name), cls);
+    class_table_size++;
 }
 
 bool class_add(Class cls)
@@ -144,7 +174,8 @@ static void class_root_add_instance_methods(Class cls)
         objc_free(new_list);
     }
 
-    // TODO: Update dispatch table.
+    // Misses aren't cached, so the new methods don't make any cached
+    // entry stale.
 }
 
 static void class_send_initialize(Class cls)
@@ -281,6 +312,9 @@ OBJC_EXPORT Class objc_lookup_class(const char* name)
     return objc_getClass(name);
 }
 
+// objc_msgSend probes the method cache itself, so this is the slow path:
+// the method is looked up in the hierarchy and cached under the selector
+// it was called with.
 IMP class_get_implementation(Class cls, SEL sel)
 {
     // TODO: Can't init it here, since meta classes are passed here.
@@ -288,8 +322,16 @@ IMP class_get_implementation(Class cls, SEL sel)
     //     class_send_initialize(cls);
     // }
 
-    sel = sel_registerTypedName((char*)sel->id, sel->types);
-    Method method = class_lookup_method_in_hierarchy(cls, sel);
+    IMP imp = cache_lookup(cls, sel);
+    if (imp) {
+        return imp;
+    }
+
+    SEL reg_sel = sel;
+    if (!selector_is_valid(reg_sel)) {
+        reg_sel = sel->types ? sel_registerTypedName((char*)sel->id, sel->types) : sel_registerName((char*)sel->id);
+    }
+    Method method = class_lookup_method_in_hierarchy(cls, reg_sel);
 
     if (!method) {
         return nil_method;
@@ -297,5 +339,9 @@ IMP class_get_implementation(Class cls, SEL sel)
 
     // TODO: Message forwarding
 
+    cache_insert(cls, sel, method->method_imp);
+    if (reg_sel != sel) {
+        cache_insert(cls, reg_sel, method->method_imp);
+    }
     return method->method_imp;
 }
\ No newline at end of file
@@ -10,30 +10,91 @@
 #include <libobjc/selector.h>
 #include <string.h>
 
-static struct objc_selector* selector_pool_start;
-static struct objc_selector* selector_pool_next;
+struct selector_node {
+    uint32_t hash;
+    SEL sel;
+};
+
+// Registered selectors are kept in an open addressing table with linear
+// probing, keyed by name and types. The selectors themselves are allocated
+// in chunks and never move, so a SEL stays valid once it is registered.
+static struct selector_node* selector_table_storage;
+static uint32_t selector_table_capacity = 0;
+static uint32_t selector_table_size = 0;
+
+#define SELECTOR_TABLE_MIN_CAPACITY 256
+#define SELECTOR_CHUNK_SIZE 128
+
+static struct objc_selector* selector_chunk;
+static int selector_chunk_next_free = SELECTOR_CHUNK_SIZE;
 
 #define CONST_DATA true
 #define VOLATILE_DATA false
 
-static SEL selector_table_add(const char* name, const char* types, bool const_data)
+static inline bool selector_types_equal(const char* types1, const char* types2)
+{
+    if (types1 == 0 || types2 == 0) {
+        return types1 == types2;
+    }
+    return strcmp(types1, types2) == 0;
+}
+
+static SEL selector_table_find(const char* name, const char* types, uint32_t hash)
+{
+    uint32_t mask = selector_table_capacity - 1;
+    for (uint32_t index = hash & mask; selector_table_storage[index].sel; index = (index + 1) & mask) {
+        struct selector_node* node = &selector_table_storage[index];
+        if (node->hash == hash && strcmp(name, (char*)node->sel->id) == 0 && selector_types_equal(types, node->sel->types)) {
+            return node->sel;
+        }
+    }
+    return (SEL)NULL;
+}
+
+static void selector_table_insert(SEL sel, uint32_t hash)
+{
+    uint32_t mask = selector_table_capacity - 1;
+    uint32_t index = hash & mask;
+    while (selector_table_storage[index].sel) {
+        index = (index + 1) & mask;
+    }
+    selector_table_storage[index].hash = hash;
+    selector_table_storage[index].sel = sel;
+}
+
+static void selector_table_grow()
 {
-    // Checking if we have this selector
-    for (struct objc_selector* cur_sel = selector_pool_start; cur_sel != selector_pool_next; cur_sel++) {
-        if (strcmp(name, (char*)cur_sel->id) == 0) {
-            if (cur_sel->types == 0 || types == 0) {
-                if (cur_sel->types == types) {
-                    return (SEL)cur_sel;
-                }
-            } else {
-                if (strcmp(types, cur_sel->types) == 0) {
-                    return (SEL)cur_sel;
-                }
-            }
+    struct selector_node* old_storage = selector_table_storage;
+    uint32_t old_capacity = selector_table_capacity;
+
+    selector_table_capacity = old_capacity * 2;
+    selector_table_storage = (struct selector_node*)objc_calloc(selector_table_capacity, sizeof(struct selector_node));
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_storage[i].sel) {
+            selector_table_insert(old_storage[i].sel, old_storage[i].hash);
         }
     }
+    objc_free(old_storage);
+}
+
+static SEL selector_alloc()
+{
+    if (selector_chunk_next_free == SELECTOR_CHUNK_SIZE) {
+        selector_chunk = (struct objc_selector*)objc_malloc(sizeof(struct objc_selector) * SELECTOR_CHUNK_SIZE);
+        selector_chunk_next_free = 0;
+    }
+    return (SEL)&selector_chunk[selector_chunk_next_free++];
+}
 
-    SEL sel = (SEL)selector_pool_next++;
+static SEL selector_table_add(const char* name, const char* types, bool const_data)
+{
+    uint32_t hash = objc_hash_string(name);
+    SEL sel = selector_table_find(name, types, hash);
+    if (sel) {
+        return sel;
+    }
+
+    sel = selector_alloc();
     if (const_data) {
         sel->id = (char*)name;
         sel->types = types;
@@ -54,18 +115,28 @@ static SEL selector_table_add(const char* name, const char* types, bool const_da
         }
     }
 
+    if ((selector_table_size + 1) * 4 > selector_table_capacity * 3) {
+        selector_table_grow();
+    }
+    selector_table_insert(sel, hash);
+    selector_table_size++;
     return sel;
 }
 
+// A selector is valid if it is the registered one, not a copy emitted by
+// the compiler.
 bool selector_is_valid(SEL sel)
 {
-    return (uintptr_t)selector_pool_start < (uintptr_t)sel && (uintptr_t)sel < (uintptr_t)selector_pool_next;
+    if (!sel || !sel->id) {
+        return false;
+    }
+    return selector_table_find((char*)sel->id, sel->types, objc_hash_string((char*)sel->id)) == sel;
 }
 
-// TODO: We currently do it really stupid
 void selector_table_init()
 {
-    selector_pool_start = selector_pool_next = (struct objc_selector*)malloc(1024);
+    selector_table_capacity = SELECTOR_TABLE_MIN_CAPACITY;
+    selector_table_storage = (struct selector_node*)objc_calloc(selector_table_capacity, sizeof(struct selector_node));
 }
 
 void selector_add_from_module(struct objc_selector* selectors)
@@ -28,16 +28,16 @@ public:
     void set_title(const std::string& title) { m_title = title, recalc_bounds(), set_needs_display(); }
     void set_title(std::string&& title) { m_title = std::move(title), recalc_bounds(), set_needs_display(); }
 
-    void set_title_color(const LG::Color& color) { m_title_color = color; }
+    void set_title_color(const LG::Color& color) { m_title_color = color, set_needs_display(); }
     const LG::Color& title_color() const { return m_title_color; }
 
-    void set_content_edge_insets(const EdgeInsets& ei) { m_content_edge_insets = ei; }
+    void set_content_edge_insets(const EdgeInsets& ei) { m_content_edge_insets = ei, set_needs_display(); }
     const EdgeInsets& content_edge_insets() const { return m_content_edge_insets; }
 
-    void set_font(const LG::Font& font) { m_font = font, recalc_bounds(); }
+    void set_font(const LG::Font& font) { m_font = font, recalc_bounds(), set_needs_display(); }
     inline const LG::Font& font() const { return m_font; }
 
-    void set_alignment(Text::Alignment alignment) { m_alignment = alignment; }
+    void set_alignment(Text::Alignment alignment) { m_alignment = alignment, set_needs_display(); }
     Text::Alignment alignment() const { return m_alignment; }
 
     virtual void display(const LG::Rect& rect) override;
@@ -47,7 +47,7 @@ public:
     virtual void mouse_down(const LG::Point<int>& location) override;
     virtual void mouse_up() override;
 
-    void set_type(Type type) { m_button_type = type; }
+    void set_type(Type type) { m_button_type = type, set_needs_display(); }
 
 protected:
     Button(View* superview, const LG::Rect& frame);
@@ -31,6 +31,9 @@ public:
     virtual std::unique_ptr<Message> handle(const NotifyWindowStatusChangedMessage& msg) override;
     virtual std::unique_ptr<Message> handle(const NotifyWindowIconChangedMessage& msg) override;
 
+    // Frames
+    virtual std::unique_ptr<Message> handle(const FrameCallbackMessage& msg) override;
+
 private:
     LFoundation::EventLoop& m_event_loop;
 };
@@ -37,8 +37,10 @@ public:
         set_draw_offset(frame.origin());
     }
 
+    // Subviews are drawn into the same bitmap as their superview, which is
+    // the window or a layer of a layer-backed view.
     Context(View& view, RelativeToCurrentContext)
-        : Context(view.window()->bitmap())
+        : Context(graphics_current_context().bitmap())
     {
         auto context_frame = view.frame();
         context_frame.offset_by(graphics_current_context().draw_offset());
@@ -47,7 +49,7 @@ public:
     }
 
     Context(View& view, const LG::Rect& frame, RelativeToCurrentContext)
-        : Context(view.window()->bitmap())
+        : Context(graphics_current_context().bitmap())
     {
         auto context_frame = frame;
         context_frame.offset_by(graphics_current_context().draw_offset());
@@ -30,6 +30,7 @@ public:
         KeyUpEvent,
         KeyDownEvent,
         DisplayEvent,
+        FrameCallbackEvent,
         LayoutEvent,
         WindowCloseRequestEvent,
         MenuBarActionEvent,
@@ -184,6 +185,22 @@ private:
     LG::Rect m_display_bounds;
 };
 
+class FrameCallbackEvent : public Event {
+public:
+    FrameCallbackEvent(uint32_t vblank)
+        : Event(Event::Type::FrameCallbackEvent)
+        , m_vblank(vblank)
+    {
+    }
+
+    ~FrameCallbackEvent() = default;
+
+    uint32_t vblank() const { return m_vblank; }
+
+private:
+    uint32_t m_vblank;
+};
+
 class View;
 class LayoutEvent : public Event {
 public:
@@ -19,20 +19,20 @@ class Label : public View {
 public:
     ~Label() = default;
 
-    void set_text(const std::string& text) { m_text = text, set_needs_display(); }
-    void set_text(std::string&& text) { m_text = std::move(text), set_needs_display(); }
+    void set_text(const std::string& text) { m_text = text, recalc_text_width(), set_needs_display(); }
+    void set_text(std::string&& text) { m_text = std::move(text), recalc_text_width(), set_needs_display(); }
     const std::string& text() const { return m_text; }
 
-    void set_text_color(const LG::Color& color) { m_text_color = color; }
+    void set_text_color(const LG::Color& color) { m_text_color = color, set_needs_display(); }
     const LG::Color& text_color() const { return m_text_color; }
 
-    void set_content_edge_insets(const EdgeInsets& ei) { m_content_edge_insets = ei; }
+    void set_content_edge_insets(const EdgeInsets& ei) { m_content_edge_insets = ei, set_needs_display(); }
     const EdgeInsets& content_edge_insets() const { return m_content_edge_insets; }
 
-    void set_alignment(Text::Alignment alignment) { m_alignment = alignment; }
+    void set_alignment(Text::Alignment alignment) { m_alignment = alignment, set_needs_display(); }
     Text::Alignment alignment() const { return m_alignment; }
 
-    void set_font(const LG::Font& font) { m_font = font, set_needs_display(); }
+    void set_font(const LG::Font& font) { m_font = font, recalc_text_width(), set_needs_display(); }
     inline const LG::Font& font() const { return m_font; }
 
     inline size_t preferred_width() const { return text_width() + m_content_edge_insets.left() + m_content_edge_insets.right(); }
@@ -47,10 +47,12 @@ protected:
 
 private:
     void recalc_bounds();
+    void recalc_text_width();
     size_t text_height() const;
-    size_t text_width() const;
+    inline size_t text_width() const { return m_text_width; }
 
     std::string m_text {};
+    size_t m_text_width { 0 };
     LG::Color m_text_color { LG::Color::Black };
     LG::Font m_font { LG::Font::system_font() };
 
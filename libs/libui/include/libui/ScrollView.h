@@ -30,13 +30,13 @@ public:
     virtual void display(const LG::Rect& rect) override;
     virtual void mouse_wheel_event(int wheel_data) override;
     virtual void receive_mouse_move_event(MouseEvent&) override;
-    virtual void receive_display_event(DisplayEvent&) override;
 
 protected:
     ScrollView(View* superview, const LG::Rect&);
     ScrollView(View* superview, Window* window, const LG::Rect& frame);
 
     void display_scroll_indicators(LG::Context&);
+    virtual void display_with_subviews(const LG::Rect& rect) override;
 
     // The location of a subview relativly to its superview could
     // differ from it's frame() (e.g when scrolling), to determine
@@ -45,6 +45,7 @@ protected:
 
 private:
     void did_scroll(int x, int y);
+    bool move_content(const LG::Point<int>& offset);
     void recalc_content_props();
 
     LG::Size m_content_size {};
@@ -44,19 +44,19 @@ public:
     const std::vector<View*>& arranged_subviews() const { return m_views; }
     std::vector<View*>& arranged_subviews() { return m_views; }
 
-    void set_axis(LayoutConstraints::Axis axis) { m_axis = axis; }
+    void set_axis(LayoutConstraints::Axis axis) { m_axis = axis, set_needs_layout(); }
     LayoutConstraints::Axis axis() const { return m_axis; }
 
-    void set_distribution(Distribution dist) { m_distribution = dist; }
+    void set_distribution(Distribution dist) { m_distribution = dist, set_needs_layout(); }
     Distribution distribution() const { return m_distribution; }
 
-    void set_alignment(Alignment alignment) { m_alignment = alignment; }
+    void set_alignment(Alignment alignment) { m_alignment = alignment, set_needs_layout(); }
     Alignment alignment() const { return m_alignment; }
 
-    void set_spacing(size_t spacing) { m_spacing = spacing; }
+    void set_spacing(size_t spacing) { m_spacing = spacing, set_needs_layout(); }
     size_t spacing() const { return m_spacing; }
 
-    virtual bool receive_layout_event(const LayoutEvent&, bool force_layout_if_not_target = false) override;
+    virtual void did_layout_subviews() override;
 
 protected:
     StackView(View* superview, const LG::Rect&);
@@ -11,6 +11,7 @@
 #include <libui/ScrollView.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace UI {
 
@@ -42,6 +43,7 @@ private:
     void recalc_text_size();
 
     std::string m_text {};
+    std::vector<size_t> m_line_starts {};
     LG::Color m_text_color { LG::Color::Black };
     LG::Font m_font { LG::Font::system_font() };
 };
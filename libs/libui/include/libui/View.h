@@ -7,8 +7,11 @@
 #pragma once
 #include <libfoundation/Logger.h>
 #include <libg/Color.h>
+#include <libg/PixelBitmap.h>
 #include <libg/Point.h>
 #include <libg/Rect.h>
+#include <libg/RectList.h>
+#include <libg/Size.h>
 #include <libui/Constraint.h>
 #include <libui/ContextManager.h>
 #include <libui/EdgeInsets.h>
@@ -45,6 +48,8 @@ public:
     {
         T* subview = new T(this, std::forward<Args>(args)...);
         m_subviews.push_back(subview);
+        m_needs_layout = true;
+        set_subtree_needs_layout();
         did_add_subview(*subview);
         return *subview;
     }
@@ -70,21 +75,27 @@ public:
     inline LG::Rect& frame() { return m_frame; }
     inline LG::Rect& bounds() { return m_bounds; }
     inline LG::Point<int> center() { return LG::Point<int>(frame().mid_x(), frame().mid_y()); }
-    inline void set_width(size_t x) { m_frame.set_width(x), m_bounds.set_width(x), set_needs_display(); }
-    inline void set_height(size_t x) { m_frame.set_height(x), m_bounds.set_height(x), set_needs_display(); }
+    inline void set_width(size_t x) { m_frame.set_width(x), m_bounds.set_width(x), did_change_size(); }
+    inline void set_height(size_t x) { m_frame.set_height(x), m_bounds.set_height(x), did_change_size(); }
 
     inline void turn_on_constraint_based_layout(bool b) { m_constraint_based_layout = b; }
-    void add_constraint(const Constraint& constraint) { m_constrints.push_back(constraint); }
+    void add_constraint(const Constraint& constraint) { m_constrints.push_back(constraint), m_needs_layout = true, set_subtree_needs_layout(); }
     const std::vector<UI::Constraint>& constraints() const { return m_constrints; }
 
+    // Layout is incremental: a pass lays out only views which were marked with
+    // set_needs_layout(), got new constraints or subviews, or whose size or
+    // superview's size has changed since they were laid out. Requests are
+    // merged into a single pass, which runs before the window is drawn.
     virtual void layout_subviews();
-    inline void set_needs_layout()
-    {
-        send_layout_message(*window(), this);
-        set_needs_display();
-    }
+    virtual void did_layout_subviews() { }
+    void set_needs_layout();
+    void layout_if_needed();
 
     LG::Rect frame_in_window();
+    // The part of the view, which is not clipped by its superviews, in window coordinates.
+    LG::Rect visible_rect_in_window();
+    // Whether views drawn after this view or after one of its superviews intersect the rect.
+    bool is_overlapped_in_window(const LG::Rect& rect_in_window);
 
     inline Window* window() { return m_window; }
     inline bool has_superview() { return m_superview; }
@@ -104,6 +115,14 @@ public:
     virtual void display(const LG::Rect& rect);
     virtual void did_display(const LG::Rect& rect);
 
+    // A layer-backed view keeps its rendering, subviews included, in its own
+    // bitmap. The layer is redrawn only where the view or its subviews were
+    // invalidated, otherwise it is just blended into the superview.
+    // Views which are redrawn together with their superview, but never change
+    // by themselves, are promoted to a layer automatically.
+    void set_layer_backed(bool layer_backed);
+    inline bool is_layer_backed() const { return m_layer_backed; }
+
     virtual void mouse_moved(const LG::Point<int>& new_location);
     virtual void mouse_wheel_event(int wheel_data);
     virtual void mouse_entered(const LG::Point<int>& location);
@@ -119,7 +138,6 @@ public:
     virtual void receive_keyup_event(KeyUpEvent&) override;
     virtual void receive_keydown_event(KeyDownEvent&) override;
     virtual void receive_display_event(DisplayEvent&) override;
-    virtual bool receive_layout_event(const LayoutEvent&, bool force_layout_if_not_target = false) override;
 
     inline LG::Color& background_color() { return m_background_color; }
     inline const LG::Color& background_color() const { return m_background_color; }
@@ -129,11 +147,25 @@ protected:
     View(View* superview, const LG::Rect&);
     View(View* superview, Window* window, const LG::Rect&);
 
-    inline void set_hovered(bool value) { m_hovered = value; }
-    inline void set_active(bool value) { m_active = value; }
+    inline void set_hovered(bool value)
+    {
+        if (m_hovered != value) {
+            m_hovered = value, set_needs_display();
+        }
+    }
+
+    inline void set_active(bool value)
+    {
+        if (m_active != value) {
+            m_active = value, set_needs_display();
+        }
+    }
 
     virtual std::optional<LG::Point<int>> subview_location(const View& subview) const;
 
+    // Draws the view and its subviews into the current context.
+    virtual void display_with_subviews(const LG::Rect& rect);
+
     template <Constraint::Attribute attr>
     inline void add_interpreted_constraint_to_mask() { m_applied_constraints_mask |= (1 << (int)attr); }
 
@@ -146,6 +178,17 @@ private:
     void set_window(Window* window) { m_window = window; }
     void set_superview(View* superview) { m_superview = superview; }
 
+    static constexpr int layer_promotion_threshold() { return 4; }
+
+    void did_change_size();
+    void set_subtree_needs_layout();
+    bool layout_inputs_changed() const;
+
+    bool can_be_promoted_to_layer();
+    void update_layer_promotion();
+    void display_layer(const LG::Rect& rect);
+    void clear_layer(const LG::Rect& rect);
+
     View* m_superview { nullptr };
     Window* m_window { nullptr };
     std::vector<View*> m_subviews;
@@ -156,11 +199,24 @@ private:
     std::vector<Constraint> m_constrints {};
     uint32_t m_applied_constraints_mask { 0 }; // Constraints applied to this view;
 
+    bool m_needs_layout { true };
+    bool m_subtree_needs_layout { false };
+    LG::Size m_layout_size {};
+    LG::Size m_layout_superview_size {};
+
     bool m_active { false };
     bool m_hovered { false };
     bool m_focusable { false };
 
     LG::Color m_background_color { LG::Color::White };
+
+    bool m_needs_display { false };
+    bool m_layer_backed { false };
+    bool m_layer_promoted { false };
+    int m_clean_redraws { 0 };
+    int m_dirty_redraws { 0 };
+    LG::PixelBitmap m_layer;
+    LG::RectList m_layer_damage;
 };
 
 inline void View::constraint_interpreter(const Constraint& constraint)
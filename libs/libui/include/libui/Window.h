@@ -12,6 +12,7 @@
 #include <libfoundation/SharedBuffer.h>
 #include <libg/Color.h>
 #include <libg/PixelBitmap.h>
+#include <libg/RectList.h>
 #include <libg/Size.h>
 #include <libg/string.h>
 #include <libui/MenuBar.h>
@@ -68,6 +69,26 @@ public:
     bool set_frame_style(const LG::Color& color);
     bool did_format_change();
 
+    // Requests are merged and drawn at most once per frame of the server:
+    // after drawing, the window waits for the frame callback.
+    void set_needs_display(const LG::Rect& rect);
+
+    // Layout requests are merged as well. The pass runs before the window is
+    // drawn, or earlier if the window is not waiting for a frame.
+    void set_needs_layout();
+
+    // Moves the pixels of the area by offset with the next frame, so only the
+    // strips which the content has left are drawn. Returns false if the area
+    // can't be moved, then the caller has to redraw it.
+    bool scroll_area(const LG::Rect& area, const LG::Point<int>& offset);
+
+    // Stats of drawn frames, used by benchmarks.
+    inline uint32_t frames_drawn() const { return m_frames_drawn; }
+    inline uint64_t pixels_drawn() const { return m_pixels_drawn; }
+    inline uint64_t pixels_moved() const { return m_pixels_moved; }
+    inline uint32_t layout_passes() const { return m_layout_passes; }
+    inline uint32_t views_laid_out() const { return m_views_laid_out; }
+
     inline const LG::string& icon_path() const { return m_icon_path; }
 
     void receive_event(std::unique_ptr<LFoundation::Event> event) override;
@@ -75,6 +96,11 @@ public:
 private:
     void setup_superview();
     void fill_with_opaque(const LG::Rect&);
+    void layout_pending();
+    void display_pending();
+    void copy_forward(const LG::RectList& damage);
+    void move_scrolled_area();
+    void swap_buffers(LG::RectList&& damage);
 
     uint32_t m_id;
     BaseViewController* m_root_view_controller { nullptr };
@@ -84,9 +110,27 @@ private:
     WindowType m_type { WindowType::Standard };
     LG::Rect m_bounds;
     LG::PixelBitmap m_bitmap;
+    // The server shows m_buffer, while frames are drawn into m_back_buffer.
     LFoundation::SharedBuffer<LG::Color> m_buffer;
+    LFoundation::SharedBuffer<LG::Color> m_back_buffer;
     LG::string m_icon_path { "/res/icons/apps/missing.icon" };
 
+    LG::RectList m_damage;
+    LG::RectList m_last_damage;
+    bool m_display_scheduled { false };
+    bool m_waiting_for_frame { false };
+    bool m_layout_scheduled { false };
+
+    LG::Rect m_scroll_area;
+    LG::Point<int> m_scroll_offset {};
+    bool m_scroll_pending { false };
+
+    uint32_t m_frames_drawn { 0 };
+    uint64_t m_pixels_drawn { 0 };
+    uint64_t m_pixels_moved { 0 };
+    uint32_t m_layout_passes { 0 };
+    uint32_t m_views_laid_out { 0 };
+
     MenuBar m_menubar;
 };
 
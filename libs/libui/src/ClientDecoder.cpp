@@ -7,6 +7,7 @@
 #include <libui/App.h>
 #include <libui/ClientDecoder.h>
 #include <libui/Event.h>
+#include <libui/Window.h>
 
 namespace UI {
 
@@ -64,7 +65,7 @@ std::unique_ptr<Message> ClientDecoder::handle(const KeyboardMessage& msg)
 
 std::unique_ptr<Message> ClientDecoder::handle(const DisplayMessage& msg)
 {
-    m_event_loop.add(App::the().window(), new DisplayEvent(msg.rect()));
+    App::the().window().set_needs_display(msg.rect());
     return nullptr;
 }
 
@@ -102,4 +103,13 @@ std::unique_ptr<Message> ClientDecoder::handle(const NotifyWindowIconChangedMess
     return nullptr;
 }
 
+// Frames
+std::unique_ptr<Message> ClientDecoder::handle(const FrameCallbackMessage& msg)
+{
+    if (App::the().window().id() == msg.win_id()) {
+        m_event_loop.add(App::the().window(), new FrameCallbackEvent(msg.vblank()));
+    }
+    return nullptr;
+}
+
 } // namespace UI
\ No newline at end of file
@@ -80,10 +80,12 @@ void Label::recalc_bounds()
     set_height(new_height);
 }
 
-size_t Label::text_width() const
+// The width is cached, since it is asked on each display and layout.
+void Label::recalc_text_width()
 {
     if (!m_text.size()) {
-        return 0;
+        m_text_width = 0;
+        return;
     }
 
     size_t width = 0;
@@ -93,7 +95,7 @@ size_t Label::text_width() const
     for (int i = 0; i < m_text.size(); i++) {
         width += f.glyph_width(m_text[i]) + letter_spacing;
     }
-    return width - letter_spacing;
+    m_text_width = width - letter_spacing;
 }
 
 size_t Label::text_height() const
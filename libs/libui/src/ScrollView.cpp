@@ -37,7 +37,42 @@ void ScrollView::did_scroll(int n_x, int n_y)
     int max_y = std::max(0, (int)content_size().height() - (int)bounds().height());
     content_offset().set_x(std::max(0, std::min(x + n_x, max_x)));
     content_offset().set_y(std::max(0, std::min(y + n_y, max_y)));
-    set_needs_display();
+
+    auto offset = LG::Point<int>(x, y) - content_offset();
+    if (!offset.x() && !offset.y()) {
+        return;
+    }
+
+    if (!move_content(offset)) {
+        set_needs_display();
+    }
+}
+
+// The window moves the visible pixels of the view, together with whatever
+// superviews have drawn under the content, and only the exposed strips are
+// redrawn.
+bool ScrollView::move_content(const LG::Point<int>& offset)
+{
+    // Layers keep their own copy of the content, which the window can't move.
+    for (View* view = this; view; view = view->superview()) {
+        if (view->is_layer_backed()) {
+            return false;
+        }
+    }
+
+    // Views on top of the content would be moved together with it.
+    auto rect = visible_rect_in_window();
+    if (is_overlapped_in_window(rect)) {
+        return false;
+    }
+
+    if (!window() || !window()->scroll_area(rect, offset)) {
+        return false;
+    }
+
+    // Scroll indicators stay in place, while the content moves under them.
+    set_needs_display(LG::Rect(bounds().max_x() - 6, 0, 7, bounds().height()));
+    return true;
 }
 
 void ScrollView::mouse_wheel_event(int wheel_data)
@@ -93,12 +128,11 @@ void ScrollView::receive_mouse_move_event(MouseEvent& event)
     Responder::receive_mouse_move_event(event);
 }
 
-void ScrollView::receive_display_event(DisplayEvent& event)
+void ScrollView::display_with_subviews(const LG::Rect& rect)
 {
-    event.bounds().intersect(bounds());
-    display(event.bounds());
+    display(rect);
     foreach_subview([&](View& subview) -> bool {
-        auto bounds = event.bounds();
+        auto bounds = rect;
         auto frame = subview.frame();
         frame.offset_by(-m_content_offset);
         bounds.intersect(frame);
@@ -111,14 +145,7 @@ void ScrollView::receive_display_event(DisplayEvent& event)
         }
         return true;
     });
-    did_display(event.bounds());
-
-    if (!has_superview()) {
-        // Only superview sends invalidate_message to server.
-        bool success = send_invalidate_message_to_server(event.bounds());
-    }
-
-    Responder::receive_display_event(event);
+    did_display(rect);
 }
 
 void ScrollView::recalc_content_props()
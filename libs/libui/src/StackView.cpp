@@ -21,15 +21,10 @@ StackView::StackView(View* superview, Window* window, const LG::Rect& frame)
 {
 }
 
-bool StackView::receive_layout_event(const LayoutEvent& event, bool force_layout_if_not_target)
+void StackView::did_layout_subviews()
 {
-    // StackView uses receive_layout_event to recalculate positions of
-    // subviews.
-    bool res = View::receive_layout_event(event, force_layout_if_not_target);
-    if (this == event.target() || force_layout_if_not_target) {
-        recalc_subviews_positions();
-    }
-    return res;
+    // Subviews are arranged after they are laid out, so their size is known.
+    recalc_subviews_positions();
 }
 
 size_t StackView::recalc_subview_min_x(View* view)
@@ -140,7 +135,8 @@ size_t StackView::recalc_spacing()
 }
 
 // recalc_subviews_positions recalculates the posistion of all subviews.
-// You have to call set_needs_layout instread of direct call to recalc_subviews_positions.
+// You have to call set_needs_layout instread of direct call to recalc_subviews_positions,
+// so it runs once per layout pass.
 void StackView::recalc_subviews_positions()
 {
     size_t spacing = recalc_spacing();
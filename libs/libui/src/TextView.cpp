@@ -28,25 +28,28 @@ void TextView::display(const LG::Rect& rect)
 
     auto& f = font();
     const size_t letter_spacing = f.glyph_spacing();
-    const size_t line_height = f.glyph_height();
-
-    int start_x = -content_offset().x();
-    int start_y = -content_offset().y();
-    int cur_x = start_x;
-    int cur_y = start_y;
-
-    for (int i = 0; i < m_text.size(); i++) {
-        if (m_text[i] == '\n') {
-            cur_x = start_x;
-            cur_y += line_height;
-            continue;
-        }
-
-        size_t glyph_width = f.glyph_width(m_text[i]) + letter_spacing;
-        if (bounds().contains(cur_x, cur_y) || bounds().contains(cur_x + glyph_width, cur_y + line_height)) {
-            ctx.draw({ cur_x, cur_y }, f.glyph_bitmap(m_text[i]));
+    const int line_height = f.glyph_height();
+
+    // Only lines within the rect are visited, so the cost doesn't depend on
+    // the length of the text.
+    int first_line = std::max(0, (rect.min_y() + content_offset().y()) / line_height);
+    int last_line = std::min((int)m_line_starts.size() - 1, (rect.max_y() + content_offset().y()) / line_height);
+
+    for (int line = first_line; line <= last_line; line++) {
+        int cur_x = -content_offset().x();
+        int cur_y = line * line_height - content_offset().y();
+
+        for (size_t i = m_line_starts[line]; i < m_text.size() && m_text[i] != '\n'; i++) {
+            if (cur_x > rect.max_x()) {
+                break;
+            }
+
+            size_t glyph_width = f.glyph_width(m_text[i]) + letter_spacing;
+            if (cur_x + (int)glyph_width > rect.min_x()) {
+                ctx.draw({ cur_x, cur_y }, f.glyph_bitmap(m_text[i]));
+            }
+            cur_x += glyph_width;
         }
-        cur_x += glyph_width;
     }
 
     display_scroll_indicators(ctx);
@@ -71,11 +74,14 @@ void TextView::recalc_text_size()
     int max_x = 0;
     int cur_y = 0;
 
+    m_line_starts.clear();
+    m_line_starts.push_back(0);
     for (int i = 0; i < m_text.size(); i++) {
         if (m_text[i] == '\n') {
-            std::max(max_x, cur_x);
+            max_x = std::max(max_x, cur_x);
             cur_x = 0;
             cur_y += line_height;
+            m_line_starts.push_back(i + 1);
             continue;
         }
 
@@ -83,8 +89,8 @@ void TextView::recalc_text_size()
         cur_x += glyph_width;
     }
 
-    std::max(max_x, cur_x);
-    content_size().set(LG::Size(cur_x, cur_y + line_height));
+    max_x = std::max(max_x, cur_x);
+    content_size().set(LG::Size(max_x, cur_y + line_height));
 }
 
 } // namespace UI
\ No newline at end of file
@@ -4,7 +4,9 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <algorithm>
 #include <libfoundation/EventLoop.h>
+#include <libfoundation/Memory.h>
 #include <libg/Color.h>
 #include <libui/Context.h>
 #include <libui/View.h>
@@ -61,6 +63,42 @@ LG::Rect View::frame_in_window()
     return rect;
 }
 
+LG::Rect View::visible_rect_in_window()
+{
+    View* view = this;
+    auto rect = bounds();
+    while (view->has_superview()) {
+        rect.offset_by(view->superview()->subview_location(*view).value());
+        view = view->superview();
+        rect.intersect(view->bounds());
+    }
+    return rect;
+}
+
+bool View::is_overlapped_in_window(const LG::Rect& rect_in_window)
+{
+    for (View* view = this; view->has_superview(); view = view->superview()) {
+        View* superview = view->superview();
+
+        LG::Point<int> superview_origin(0, 0);
+        for (View* it = superview; it->has_superview(); it = it->superview()) {
+            superview_origin.offset_by(it->superview()->subview_location(*it).value());
+        }
+
+        auto& siblings = superview->subviews();
+        auto it = std::find(siblings.begin(), siblings.end(), view);
+        for (it = it == siblings.end() ? it : it + 1; it != siblings.end(); it++) {
+            auto frame = (*it)->frame();
+            frame.set_origin(superview->subview_location(**it).value());
+            frame.offset_by(superview_origin);
+            if (frame.intersects(rect_in_window)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void View::layout_subviews()
 {
     // TODO: Apply topsort to find the right order.
@@ -69,6 +107,94 @@ void View::layout_subviews()
     }
 }
 
+void View::set_needs_layout()
+{
+    m_needs_layout = true;
+    set_subtree_needs_layout();
+    if (window()) {
+        window()->set_needs_layout();
+    }
+    set_needs_display();
+}
+
+void View::set_subtree_needs_layout()
+{
+    for (View* view = this; view; view = view->superview()) {
+        view->m_subtree_needs_layout = true;
+    }
+}
+
+void View::did_change_size()
+{
+    // The superview may arrange its subviews by their size.
+    if (has_superview()) {
+        superview()->set_needs_layout();
+    } else {
+        set_needs_display();
+    }
+}
+
+bool View::layout_inputs_changed() const
+{
+    if (bounds().width() != m_layout_size.width() || bounds().height() != m_layout_size.height()) {
+        return true;
+    }
+
+    // Constraints of the view could be relative to its superview.
+    if (m_superview) {
+        auto& superview_bounds = m_superview->bounds();
+        return superview_bounds.width() != m_layout_superview_size.width() || superview_bounds.height() != m_layout_superview_size.height();
+    }
+    return false;
+}
+
+void View::layout_if_needed()
+{
+    bool laid_out = false;
+    if (m_needs_layout || layout_inputs_changed()) {
+        layout_subviews();
+        m_needs_layout = false;
+        m_layout_size = LG::Size(bounds().width(), bounds().height());
+        if (m_superview) {
+            m_layout_superview_size = LG::Size(m_superview->bounds().width(), m_superview->bounds().height());
+        }
+        if (m_window) {
+            m_window->m_views_laid_out++;
+        }
+        set_needs_display();
+        laid_out = true;
+    }
+
+    if (!laid_out && !m_subtree_needs_layout) {
+        return;
+    }
+    m_subtree_needs_layout = false;
+
+    // Subviews are laid out before the view arranges them, since their own
+    // constraints could change their size.
+    bool subview_resized = false;
+    foreach_subview([&](View& subview) -> bool {
+        size_t width = subview.bounds().width();
+        size_t height = subview.bounds().height();
+        subview.layout_if_needed();
+        subview_resized |= (width != subview.bounds().width() || height != subview.bounds().height());
+        return true;
+    });
+
+    if (!laid_out && !subview_resized) {
+        return;
+    }
+
+    did_layout_subviews();
+    set_needs_display();
+
+    // Arranging could resize subviews, they are laid out again if so.
+    foreach_subview([&](View& subview) -> bool {
+        subview.layout_if_needed();
+        return true;
+    });
+}
+
 std::optional<LG::Point<int>> View::subview_location(const View& subview) const
 {
     return subview.frame().origin();
@@ -78,6 +204,11 @@ void View::set_needs_display(const LG::Rect& rect)
 {
     auto display_rect = rect;
     display_rect.intersect(bounds());
+    m_needs_display = true;
+    if (is_layer_backed()) {
+        m_layer_damage.add(display_rect);
+    }
+
     if (has_superview()) {
         auto location = superview()->subview_location(*this);
         display_rect.offset_by(location.value());
@@ -105,26 +236,22 @@ void View::mouse_moved(const LG::Point<int>& location)
 void View::mouse_entered(const LG::Point<int>& location)
 {
     set_hovered(true);
-    set_needs_display();
 }
 
 void View::mouse_exited()
 {
     set_hovered(false);
     set_active(false);
-    set_needs_display();
 }
 
 void View::mouse_down(const LG::Point<int>& location)
 {
-    m_active = true;
-    set_needs_display();
+    set_active(true);
 }
 
 void View::mouse_up()
 {
-    m_active = false;
-    set_needs_display();
+    set_active(false);
 }
 
 void View::mouse_wheel_event(int wheel_data)
@@ -216,12 +343,103 @@ void View::receive_keydown_event(KeyDownEvent&)
 {
 }
 
-void View::receive_display_event(DisplayEvent& event)
+void View::set_layer_backed(bool layer_backed)
 {
-    event.bounds().intersect(bounds());
-    display(event.bounds());
+    m_layer_promoted = false;
+    if (m_layer_backed == layer_backed) {
+        return;
+    }
+
+    m_layer_backed = layer_backed;
+    m_layer.clear();
+    m_layer_damage.clear();
+}
+
+bool View::can_be_promoted_to_layer()
+{
+    // The root view is drawn straight into the window, and a layer as big as
+    // the window would only double the memory.
+    if (!has_superview() || !window()) {
+        return false;
+    }
+
+    size_t area = bounds().width() * bounds().height();
+    size_t window_area = window()->bitmap().width() * window()->bitmap().height();
+    return area && area <= window_area / 4;
+}
+
+void View::update_layer_promotion()
+{
+    if (m_needs_display) {
+        m_clean_redraws = 0;
+        m_dirty_redraws++;
+    } else {
+        m_dirty_redraws = 0;
+        m_clean_redraws++;
+    }
+    m_needs_display = false;
+
+    if (!is_layer_backed()) {
+        if (m_clean_redraws >= layer_promotion_threshold() && can_be_promoted_to_layer()) {
+            set_layer_backed(true);
+            m_layer_promoted = true;
+        }
+        return;
+    }
+
+    // A promoted view which changes every frame costs more with a layer than without it.
+    if (m_layer_promoted && m_dirty_redraws >= layer_promotion_threshold()) {
+        set_layer_backed(false);
+    }
+}
+
+void View::clear_layer(const LG::Rect& rect)
+{
+    auto area = rect;
+    area.intersect(m_layer.bounds());
+    if (area.empty()) {
+        return;
+    }
+
+    uint32_t transparent = LG::Color(0, 0, 0, 0).u32();
+    for (int y = area.min_y(); y <= area.max_y(); y++) {
+        LFoundation::fast_set((uint32_t*)&m_layer[y][area.min_x()], transparent, area.width());
+    }
+}
+
+void View::display_layer(const LG::Rect& rect)
+{
+    if (m_layer.width() != bounds().width() || m_layer.height() != bounds().height()) {
+        m_layer.resize(bounds().width(), bounds().height());
+        m_layer.set_format(LG::PixelBitmapFormat::RGBA);
+        m_layer_damage.clear();
+        m_layer_damage.add(bounds());
+    }
+
+    if (!m_layer_damage.empty()) {
+        LG::RectList damage(std::move(m_layer_damage));
+        m_layer_damage.clear();
+
+        // The layer starts transparent, so views which don't fill their
+        // background are blended over the current content of the superview.
+        graphics_push_context(Context(m_layer));
+        for (int i = 0; i < damage.size(); i++) {
+            clear_layer(damage.at(i));
+            display_with_subviews(damage.at(i));
+        }
+        graphics_pop_context();
+    }
+
+    LG::Context ctx = graphics_current_context();
+    ctx.add_clip(rect);
+    ctx.draw({ 0, 0 }, m_layer);
+}
+
+void View::display_with_subviews(const LG::Rect& rect)
+{
+    display(rect);
     foreach_subview([&](View& subview) -> bool {
-        auto bounds = event.bounds();
+        auto bounds = rect;
         if (bounds.intersects(subview.frame())) {
             graphics_push_context(Context(subview, Context::RelativeToCurrentContext::Yes));
             bounds.offset_by(-subview.frame().origin());
@@ -231,29 +449,20 @@ void View::receive_display_event(DisplayEvent& event)
         }
         return true;
     });
-    did_display(event.bounds());
-
-    if (!has_superview()) {
-        // Only superview sends invalidate_message to server.
-        bool success = send_invalidate_message_to_server(event.bounds());
-    }
-
-    Responder::receive_display_event(event);
+    did_display(rect);
 }
 
-bool View::receive_layout_event(const LayoutEvent& event, bool force_layout_if_not_target)
+void View::receive_display_event(DisplayEvent& event)
 {
-    bool need_to_layout = (this == event.target()) | force_layout_if_not_target;
-    if (need_to_layout) {
-        layout_subviews();
+    event.bounds().intersect(bounds());
+    update_layer_promotion();
+    if (is_layer_backed()) {
+        display_layer(event.bounds());
+    } else {
+        display_with_subviews(event.bounds());
     }
 
-    foreach_subview([&](View& subview) -> bool {
-        bool found_target = subview.receive_layout_event(event, need_to_layout);
-        return need_to_layout || !found_target;
-    });
-
-    return need_to_layout;
+    Responder::receive_display_event(event);
 }
 
 } // namespace UI
\ No newline at end of file
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <libfoundation/Memory.h>
 #include <libui/App.h>
 #include <libui/Connection.h>
@@ -15,24 +17,26 @@ namespace UI {
 Window::Window(const LG::Size& size, WindowType type)
     : m_bounds(0, 0, size.width(), size.height())
     , m_buffer(size_t(size.width() * size.height() * 4))
+    , m_back_buffer(size_t(size.width() * size.height() * 4))
     , m_bitmap()
     , m_type(type)
 {
     m_id = Connection::the().new_window(*this);
     m_menubar.set_host_window_id(m_id);
-    m_bitmap = LG::PixelBitmap(m_buffer.data(), bounds().width(), bounds().height());
+    m_bitmap = LG::PixelBitmap(m_back_buffer.data(), bounds().width(), bounds().height());
     App::the().set_window(this);
 }
 
 Window::Window(const LG::Size& size, const LG::string& icon_path)
     : m_bounds(0, 0, size.width(), size.height())
     , m_buffer(size_t(size.width() * size.height() * 4))
+    , m_back_buffer(size_t(size.width() * size.height() * 4))
     , m_bitmap()
     , m_icon_path(icon_path)
 {
     m_id = Connection::the().new_window(*this);
     m_menubar.set_host_window_id(m_id);
-    m_bitmap = LG::PixelBitmap(m_buffer.data(), bounds().width(), bounds().height());
+    m_bitmap = LG::PixelBitmap(m_back_buffer.data(), bounds().width(), bounds().height());
     App::the().set_window(this);
 }
 
@@ -55,6 +59,9 @@ bool Window::did_format_change()
         fill_with_opaque(bounds());
     }
 
+    // The shown buffer gets the new format with the next frame.
+    set_needs_display(bounds());
+
     SetBufferMessage msg(Connection::the().key(), id(), buffer().id(), bitmap().format());
     return App::the().connection().send_async_message(msg);
 }
@@ -105,24 +112,21 @@ void Window::receive_event(std::unique_ptr<LFoundation::Event> event)
     }
 
     if (event->type() == Event::Type::DisplayEvent) {
-        if (m_superview) {
-            DisplayEvent& own_event = *(DisplayEvent*)event.get();
-
-            // If the window is in RGBA mode, we have to fill this rect
-            // with opaque color before superview will mix it's color on
-            // top of bitmap.
-            if (bitmap().format() == LG::PixelBitmapFormat::RGBA) {
-                fill_with_opaque(own_event.bounds());
-            }
-
-            m_superview->receive_display_event(own_event);
+        m_display_scheduled = false;
+        if (!m_waiting_for_frame) {
+            display_pending();
         }
     }
 
+    if (event->type() == Event::Type::FrameCallbackEvent) {
+        m_waiting_for_frame = false;
+        display_pending();
+    }
+
     if (event->type() == Event::Type::LayoutEvent) {
-        if (m_superview) {
-            LayoutEvent& own_event = *(LayoutEvent*)event.get();
-            m_superview->receive_layout_event(own_event);
+        m_layout_scheduled = false;
+        if (!m_waiting_for_frame) {
+            layout_pending();
         }
     }
 
@@ -134,6 +138,198 @@ void Window::receive_event(std::unique_ptr<LFoundation::Event> event)
     }
 }
 
+void Window::set_needs_display(const LG::Rect& rect)
+{
+    auto area = rect.intersection(bounds());
+    if (area.empty()) {
+        return;
+    }
+    m_damage.add(area);
+
+    if (!m_display_scheduled && !m_waiting_for_frame) {
+        LFoundation::EventLoop::the().add(*this, new DisplayEvent(area));
+        m_display_scheduled = true;
+    }
+}
+
+void Window::set_needs_layout()
+{
+    if (!m_layout_scheduled) {
+        LFoundation::EventLoop::the().add(*this, new LayoutEvent(m_superview));
+        m_layout_scheduled = true;
+    }
+}
+
+void Window::layout_pending()
+{
+    if (!m_superview) {
+        return;
+    }
+
+    uint32_t views_laid_out = m_views_laid_out;
+    m_superview->layout_if_needed();
+    if (m_views_laid_out != views_laid_out) {
+        m_layout_passes++;
+    }
+}
+
+void Window::display_pending()
+{
+    // Layout goes first, it could damage more areas.
+    layout_pending();
+    if (!m_superview || m_damage.empty()) {
+        return;
+    }
+
+    LG::RectList damage(std::move(m_damage));
+
+    // Requests made while drawing go to the next frame.
+    m_waiting_for_frame = true;
+
+    copy_forward(damage);
+    move_scrolled_area();
+    for (int i = 0; i < damage.size(); i++) {
+        DisplayEvent own_event(damage[i]);
+        m_pixels_drawn += damage[i].square();
+
+        // If the window is in RGBA mode, we have to fill this rect
+        // with opaque color before superview will mix it's color on
+        // top of bitmap.
+        if (bitmap().format() == LG::PixelBitmapFormat::RGBA) {
+            fill_with_opaque(own_event.bounds());
+        }
+
+        m_superview->receive_display_event(own_event);
+    }
+
+    // Moved pixels are new for the server as well.
+    if (m_scroll_pending) {
+        damage.add(m_scroll_area);
+        m_scroll_pending = false;
+        m_scroll_offset = LG::Point<int>(0, 0);
+    }
+
+    m_frames_drawn++;
+    swap_buffers(std::move(damage));
+
+    RequestFrameMessage msg(Connection::the().key(), id());
+    App::the().connection().send_async_message(msg);
+}
+
+void Window::copy_forward(const LG::RectList& damage)
+{
+    // The back buffer misses what was drawn in the last frame. Areas, which
+    // are not going to be redrawn, are copied from the shown buffer.
+    auto* front = m_buffer.data();
+    size_t width = bounds().width();
+    for (int i = 0; i < m_last_damage.size(); i++) {
+        auto& area = m_last_damage[i];
+        bool redrawn = false;
+        for (int j = 0; j < damage.size() && !redrawn; j++) {
+            redrawn = damage[j].contains(area);
+        }
+        if (redrawn) {
+            continue;
+        }
+
+        for (int y = area.min_y(); y <= area.max_y(); y++) {
+            auto* dest = reinterpret_cast<uint32_t*>(&m_bitmap[y][area.min_x()]);
+            auto* src = reinterpret_cast<const uint32_t*>(&front[y * width + area.min_x()]);
+            LFoundation::fast_copy(dest, src, area.width());
+        }
+    }
+}
+
+bool Window::scroll_area(const LG::Rect& rect, const LG::Point<int>& offset)
+{
+    auto area = rect.intersection(bounds());
+    if (area.empty() || (!offset.x() && !offset.y())) {
+        return true;
+    }
+
+    // Only one area is moved per frame.
+    if (m_scroll_pending && m_scroll_area != area) {
+        return false;
+    }
+
+    // Damage, which is not drawn yet, moves together with the content.
+    LG::RectList moved_damage;
+    for (int i = 0; i < m_damage.size(); i++) {
+        auto moved = m_damage[i].intersection(area);
+        if (moved.empty()) {
+            continue;
+        }
+        moved.offset_by(offset);
+        moved.intersect(area);
+        moved_damage.add(moved);
+    }
+    for (int i = 0; i < moved_damage.size(); i++) {
+        m_damage.add(moved_damage[i]);
+    }
+
+    m_scroll_area = area;
+    m_scroll_offset += offset;
+    m_scroll_pending = true;
+
+    if (std::abs(m_scroll_offset.x()) >= (int)area.width() || std::abs(m_scroll_offset.y()) >= (int)area.height()) {
+        m_scroll_pending = false;
+        m_scroll_offset = LG::Point<int>(0, 0);
+        set_needs_display(area);
+        return true;
+    }
+
+    if (offset.x()) {
+        int width = std::min(std::abs(offset.x()), (int)area.width());
+        int x = offset.x() > 0 ? area.min_x() : area.max_x() - width + 1;
+        set_needs_display(LG::Rect(x, area.min_y(), width, area.height()));
+    }
+    if (offset.y()) {
+        int height = std::min(std::abs(offset.y()), (int)area.height());
+        int y = offset.y() > 0 ? area.min_y() : area.max_y() - height + 1;
+        set_needs_display(LG::Rect(area.min_x(), y, area.width(), height));
+    }
+    return true;
+}
+
+void Window::move_scrolled_area()
+{
+    if (!m_scroll_pending) {
+        return;
+    }
+
+    auto dest = m_scroll_area;
+    dest.offset_by(m_scroll_offset);
+    dest.intersect(m_scroll_area);
+    if (dest.empty()) {
+        return;
+    }
+
+    // The shown buffer holds the last frame, so pixels are read from it and
+    // never overlap with the ones being written.
+    auto* front = m_buffer.data();
+    size_t width = bounds().width();
+    int src_x = dest.min_x() - m_scroll_offset.x();
+    for (int y = dest.min_y(); y <= dest.max_y(); y++) {
+        int src_y = y - m_scroll_offset.y();
+        auto* dst = reinterpret_cast<uint32_t*>(&m_bitmap[y][dest.min_x()]);
+        auto* src = reinterpret_cast<const uint32_t*>(&front[src_y * width + src_x]);
+        LFoundation::fast_copy(dst, src, dest.width());
+    }
+    m_pixels_moved += dest.square();
+}
+
+void Window::swap_buffers(LG::RectList&& damage)
+{
+    std::swap(m_buffer, m_back_buffer);
+    m_bitmap = LG::PixelBitmap(m_back_buffer.data(), bounds().width(), bounds().height(), m_bitmap.format());
+
+    // A single message per frame: the server switches the buffer and
+    // composes only the damaged areas.
+    SwapBufferMessage msg(Connection::the().key(), id(), m_buffer.id(), damage);
+    App::the().connection().send_async_message(msg);
+    m_last_damage = std::move(damage);
+}
+
 void Window::setup_superview()
 {
     graphics_push_context(Context(*m_superview));
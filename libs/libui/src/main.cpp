@@ -1,3 +1,7 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <libfoundation/ProcessInfo.h>
 #include <libui/App.h>
@@ -5,13 +9,56 @@
 #include <libui/View.h>
 #include <libui/Window.h>
 #include <memory>
+#include <sys/time.h>
 
 extern "C" bool __init_app_delegate(UI::AppDelegate** res);
 
+#ifdef BENCHMARK
+// Used by bench to measure exec-to-main latency. The bench passes its name
+// and the time it called execve() at, the app reports the time it took to
+// get here and pages resident at this point. It exits before connecting to
+// the window server.
+static int startup_probe(int argc, char** argv)
+{
+    timeval_t main_tv;
+    timezone_t tz;
+    gettimeofday(&main_tv, &tz);
+
+    if (argc < 5) {
+        return 1;
+    }
+    const char* name = argv[2];
+    int exec_sec = atoi(argv[3]);
+    int exec_usec = atoi(argv[4]);
+    printf("[BENCH][%s] %d (usec)\n", name, (int)(main_tv.tv_sec - exec_sec) * 1000000 + ((int)main_tv.tv_usec - exec_usec));
+
+    char path[32];
+    char memstat[64] = {};
+    snprintf(path, sizeof(path), "/proc/%d/memstat", getpid());
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        read(fd, memstat, sizeof(memstat) - 1);
+        close(fd);
+    }
+
+    int resident = 0, shared = 0;
+    sscanf(memstat, "resident %d\nshared %d\n", &resident, &shared);
+    printf("[BENCH INFO][%s] resident %d pages, shared %d pages\n", name, resident, shared);
+    fflush(stdout);
+    return 0;
+}
+#endif
+
 // Libs are compiled with -ffreestanding and LLVM mangles
 // main() with this flag. Have to mark it as extern "C".
 extern "C" int main(int argc, char** argv)
 {
+#ifdef BENCHMARK
+    if (argc > 1 && strcmp(argv[1], "--startup-probe") == 0) {
+        return startup_probe(argc, argv);
+    }
+#endif
+
     auto process_info = LFoundation::ProcessInfo(argc, argv);
     auto& app = std::pranaos::construct<UI::App>();
     UI::AppDelegate* app_delegate = nullptr;
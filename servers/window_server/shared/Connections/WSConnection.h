@@ -3,6 +3,7 @@
 
 #pragma once
 #include <libg/Rect.h>
+#include <libg/RectList.h>
 #include <libg/string.h>
 #include <libipc/ClientConnection.h>
 #include <libipc/Encoder.h>
@@ -474,6 +475,184 @@ private:
     int m_status;
 };
 
+class GetFrameStatsMessage : public Message {
+public:
+    GetFrameStatsMessage(message_key_t key)
+        : m_key(key)
+    {
+    }
+    int id() const override { return 16; }
+    int reply_id() const override { return 17; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+};
+
+class GetFrameStatsMessageReply : public Message {
+public:
+    GetFrameStatsMessageReply(message_key_t key, uint32_t frames, uint32_t cursor_frames, uint32_t busy_usec, uint32_t max_frame_usec)
+        : m_key(key)
+        , m_frames(frames)
+        , m_cursor_frames(cursor_frames)
+        , m_busy_usec(busy_usec)
+        , m_max_frame_usec(max_frame_usec)
+    {
+    }
+    int id() const override { return 17; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    uint32_t frames() const { return m_frames; }
+    uint32_t cursor_frames() const { return m_cursor_frames; }
+    uint32_t busy_usec() const { return m_busy_usec; }
+    uint32_t max_frame_usec() const { return m_max_frame_usec; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_frames);
+        Encoder::append(buffer, m_cursor_frames);
+        Encoder::append(buffer, m_busy_usec);
+        Encoder::append(buffer, m_max_frame_usec);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    uint32_t m_frames;
+    uint32_t m_cursor_frames;
+    uint32_t m_busy_usec;
+    uint32_t m_max_frame_usec;
+};
+
+class RequestFrameMessage : public Message {
+public:
+    RequestFrameMessage(message_key_t key, uint32_t window_id)
+        : m_key(key)
+        , m_window_id(window_id)
+    {
+    }
+    int id() const override { return 18; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    uint32_t window_id() const { return m_window_id; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_window_id);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    uint32_t m_window_id;
+};
+
+class SwapBufferMessage : public Message {
+public:
+    SwapBufferMessage(message_key_t key, uint32_t window_id, int buffer_id, LG::RectList damage)
+        : m_key(key)
+        , m_window_id(window_id)
+        , m_buffer_id(buffer_id)
+        , m_damage(damage)
+    {
+    }
+    int id() const override { return 19; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    uint32_t window_id() const { return m_window_id; }
+    int buffer_id() const { return m_buffer_id; }
+    LG::RectList damage() const { return m_damage; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_window_id);
+        Encoder::append(buffer, m_buffer_id);
+        Encoder::append(buffer, m_damage);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    uint32_t m_window_id;
+    int m_buffer_id;
+    LG::RectList m_damage;
+};
+
+class SetRefreshRateMessage : public Message {
+public:
+    SetRefreshRateMessage(message_key_t key, uint32_t rate)
+        : m_key(key)
+        , m_rate(rate)
+    {
+    }
+    int id() const override { return 20; }
+    int reply_id() const override { return 21; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    uint32_t rate() const { return m_rate; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_rate);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    uint32_t m_rate;
+};
+
+class SetRefreshRateMessageReply : public Message {
+public:
+    SetRefreshRateMessageReply(message_key_t key, int status)
+        : m_key(key)
+        , m_status(status)
+    {
+    }
+    int id() const override { return 21; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 320; }
+    int status() const { return m_status; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_status);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    int m_status;
+};
+
 class BaseWindowServerDecoder : public MessageDecoder {
 public:
     BaseWindowServerDecoder() { }
@@ -507,68 +686,96 @@ public:
         uint32_t var_target_window_id;
         uint32_t var_menu_id;
         int var_item_id;
+        uint32_t var_frames;
+        uint32_t var_cursor_frames;
+        uint32_t var_busy_usec;
+        uint32_t var_max_frame_usec;
+        LG::RectList var_damage;
+        uint32_t var_rate;
 
         switch (msg_id) {
         case 1:
             return new GreetMessage(secret_key);
         case 2:
-            Encoder::decode(buf, decoded_msg_len, var_connection_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_connection_id);
             return new GreetMessageReply(secret_key, var_connection_id);
         case 3:
-            Encoder::decode(buf, decoded_msg_len, var_type);
-            Encoder::decode(buf, decoded_msg_len, var_width);
-            Encoder::decode(buf, decoded_msg_len, var_height);
-            Encoder::decode(buf, decoded_msg_len, var_buffer_id);
-            Encoder::decode(buf, decoded_msg_len, var_icon_path);
+            Encoder::decode(buf, decoded_msg_len, size, var_type);
+            Encoder::decode(buf, decoded_msg_len, size, var_width);
+            Encoder::decode(buf, decoded_msg_len, size, var_height);
+            Encoder::decode(buf, decoded_msg_len, size, var_buffer_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_icon_path);
             return new CreateWindowMessage(secret_key, var_type, var_width, var_height, var_buffer_id, var_icon_path);
         case 4:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
             return new CreateWindowMessageReply(secret_key, var_window_id);
         case 5:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
             return new DestroyWindowMessage(secret_key, var_window_id);
         case 6:
-            Encoder::decode(buf, decoded_msg_len, var_status);
+            Encoder::decode(buf, decoded_msg_len, size, var_status);
             return new DestroyWindowMessageReply(secret_key, var_status);
         case 7:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_buffer_id);
-            Encoder::decode(buf, decoded_msg_len, var_format);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_buffer_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_format);
             return new SetBufferMessage(secret_key, var_window_id, var_buffer_id, var_format);
         case 8:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_color);
-            Encoder::decode(buf, decoded_msg_len, var_text_style);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_color);
+            Encoder::decode(buf, decoded_msg_len, size, var_text_style);
             return new SetBarStyleMessage(secret_key, var_window_id, var_color, var_text_style);
         case 9:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_title);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_title);
             return new SetTitleMessage(secret_key, var_window_id, var_title);
         case 10:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_rect);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_rect);
             return new InvalidateMessage(secret_key, var_window_id, var_rect);
         case 11:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_target_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_target_window_id);
             return new AskBringToFrontMessage(secret_key, var_window_id, var_target_window_id);
         case 12:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_title);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_title);
             return new MenuBarCreateMenuMessage(secret_key, var_window_id, var_title);
         case 13:
-            Encoder::decode(buf, decoded_msg_len, var_status);
-            Encoder::decode(buf, decoded_msg_len, var_menu_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_status);
+            Encoder::decode(buf, decoded_msg_len, size, var_menu_id);
             return new MenuBarCreateMenuMessageReply(secret_key, var_status, var_menu_id);
         case 14:
-            Encoder::decode(buf, decoded_msg_len, var_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_menu_id);
-            Encoder::decode(buf, decoded_msg_len, var_item_id);
-            Encoder::decode(buf, decoded_msg_len, var_title);
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_menu_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_item_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_title);
             return new MenuBarCreateItemMessage(secret_key, var_window_id, var_menu_id, var_item_id, var_title);
         case 15:
-            Encoder::decode(buf, decoded_msg_len, var_status);
+            Encoder::decode(buf, decoded_msg_len, size, var_status);
             return new MenuBarCreateItemMessageReply(secret_key, var_status);
+        case 16:
+            return new GetFrameStatsMessage(secret_key);
+        case 17:
+            Encoder::decode(buf, decoded_msg_len, size, var_frames);
+            Encoder::decode(buf, decoded_msg_len, size, var_cursor_frames);
+            Encoder::decode(buf, decoded_msg_len, size, var_busy_usec);
+            Encoder::decode(buf, decoded_msg_len, size, var_max_frame_usec);
+            return new GetFrameStatsMessageReply(secret_key, var_frames, var_cursor_frames, var_busy_usec, var_max_frame_usec);
+        case 18:
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            return new RequestFrameMessage(secret_key, var_window_id);
+        case 19:
+            Encoder::decode(buf, decoded_msg_len, size, var_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_buffer_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_damage);
+            return new SwapBufferMessage(secret_key, var_window_id, var_buffer_id, var_damage);
+        case 20:
+            Encoder::decode(buf, decoded_msg_len, size, var_rate);
+            return new SetRefreshRateMessage(secret_key, var_rate);
+        case 21:
+            Encoder::decode(buf, decoded_msg_len, size, var_status);
+            return new SetRefreshRateMessageReply(secret_key, var_status);
         default:
             decoded_msg_len = saved_dml;
             return nullptr;
@@ -602,6 +809,14 @@ public:
             return handle(static_cast<const MenuBarCreateMenuMessage&>(msg));
         case 14:
             return handle(static_cast<const MenuBarCreateItemMessage&>(msg));
+        case 16:
+            return handle(static_cast<const GetFrameStatsMessage&>(msg));
+        case 18:
+            return handle(static_cast<const RequestFrameMessage&>(msg));
+        case 19:
+            return handle(static_cast<const SwapBufferMessage&>(msg));
+        case 20:
+            return handle(static_cast<const SetRefreshRateMessage&>(msg));
         default:
             return nullptr;
         }
@@ -617,6 +832,10 @@ public:
     virtual std::unique_ptr<Message> handle(const AskBringToFrontMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const MenuBarCreateMenuMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const MenuBarCreateItemMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const GetFrameStatsMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const RequestFrameMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const SwapBufferMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const SetRefreshRateMessage& msg) { return nullptr; }
 };
 
 class MouseMoveMessage : public Message {
@@ -980,6 +1199,37 @@ private:
     LG::string m_icon_path;
 };
 
+class FrameCallbackMessage : public Message {
+public:
+    FrameCallbackMessage(message_key_t key, int win_id, uint32_t vblank)
+        : m_key(key)
+        , m_win_id(win_id)
+        , m_vblank(vblank)
+    {
+    }
+    int id() const override { return 12; }
+    int reply_id() const override { return -1; }
+    int key() const override { return m_key; }
+    int decoder_magic() const override { return 737; }
+    int win_id() const { return m_win_id; }
+    uint32_t vblank() const { return m_vblank; }
+    EncodedMessage encode() const override
+    {
+        EncodedMessage buffer;
+        Encoder::append(buffer, decoder_magic());
+        Encoder::append(buffer, id());
+        Encoder::append(buffer, key());
+        Encoder::append(buffer, m_win_id);
+        Encoder::append(buffer, m_vblank);
+        return buffer;
+    }
+
+private:
+    message_key_t m_key;
+    int m_win_id;
+    uint32_t m_vblank;
+};
+
 class BaseWindowClientDecoder : public MessageDecoder {
 public:
     BaseWindowClientDecoder() { }
@@ -1008,57 +1258,62 @@ public:
         int var_item_id;
         int var_changed_window_id;
         LG::string var_icon_path;
+        uint32_t var_vblank;
 
         switch (msg_id) {
         case 1:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_x);
-            Encoder::decode(buf, decoded_msg_len, var_y);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_x);
+            Encoder::decode(buf, decoded_msg_len, size, var_y);
             return new MouseMoveMessage(secret_key, var_win_id, var_x, var_y);
         case 2:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_type);
-            Encoder::decode(buf, decoded_msg_len, var_x);
-            Encoder::decode(buf, decoded_msg_len, var_y);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_type);
+            Encoder::decode(buf, decoded_msg_len, size, var_x);
+            Encoder::decode(buf, decoded_msg_len, size, var_y);
             return new MouseActionMessage(secret_key, var_win_id, var_type, var_x, var_y);
         case 3:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_x);
-            Encoder::decode(buf, decoded_msg_len, var_y);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_x);
+            Encoder::decode(buf, decoded_msg_len, size, var_y);
             return new MouseLeaveMessage(secret_key, var_win_id, var_x, var_y);
         case 4:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_wheel_data);
-            Encoder::decode(buf, decoded_msg_len, var_x);
-            Encoder::decode(buf, decoded_msg_len, var_y);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_wheel_data);
+            Encoder::decode(buf, decoded_msg_len, size, var_x);
+            Encoder::decode(buf, decoded_msg_len, size, var_y);
             return new MouseWheelMessage(secret_key, var_win_id, var_wheel_data, var_x, var_y);
         case 5:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_kbd_key);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_kbd_key);
             return new KeyboardMessage(secret_key, var_win_id, var_kbd_key);
         case 6:
-            Encoder::decode(buf, decoded_msg_len, var_rect);
+            Encoder::decode(buf, decoded_msg_len, size, var_rect);
             return new DisplayMessage(secret_key, var_rect);
         case 7:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
             return new WindowCloseRequestMessage(secret_key, var_win_id);
         case 8:
-            Encoder::decode(buf, decoded_msg_len, var_reason);
+            Encoder::decode(buf, decoded_msg_len, size, var_reason);
             return new DisconnectMessage(secret_key, var_reason);
         case 9:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_item_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_item_id);
             return new MenuBarActionMessage(secret_key, var_win_id, var_item_id);
         case 10:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_changed_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_type);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_changed_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_type);
             return new NotifyWindowStatusChangedMessage(secret_key, var_win_id, var_changed_window_id, var_type);
         case 11:
-            Encoder::decode(buf, decoded_msg_len, var_win_id);
-            Encoder::decode(buf, decoded_msg_len, var_changed_window_id);
-            Encoder::decode(buf, decoded_msg_len, var_icon_path);
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_changed_window_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_icon_path);
             return new NotifyWindowIconChangedMessage(secret_key, var_win_id, var_changed_window_id, var_icon_path);
+        case 12:
+            Encoder::decode(buf, decoded_msg_len, size, var_win_id);
+            Encoder::decode(buf, decoded_msg_len, size, var_vblank);
+            return new FrameCallbackMessage(secret_key, var_win_id, var_vblank);
         default:
             decoded_msg_len = saved_dml;
             return nullptr;
@@ -1094,6 +1349,8 @@ public:
             return handle(static_cast<const NotifyWindowStatusChangedMessage&>(msg));
         case 11:
             return handle(static_cast<const NotifyWindowIconChangedMessage&>(msg));
+        case 12:
+            return handle(static_cast<const FrameCallbackMessage&>(msg));
         default:
             return nullptr;
         }
@@ -1110,4 +1367,5 @@ public:
     virtual std::unique_ptr<Message> handle(const MenuBarActionMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const NotifyWindowStatusChangedMessage& msg) { return nullptr; }
     virtual std::unique_ptr<Message> handle(const NotifyWindowIconChangedMessage& msg) { return nullptr; }
+    virtual std::unique_ptr<Message> handle(const FrameCallbackMessage& msg) { return nullptr; }
 };
@@ -25,6 +25,7 @@ BaseWindow::BaseWindow(BaseWindow&& win)
     : m_id(win.m_id)
     , m_connection_id(win.m_connection_id)
     , m_buffer(win.m_buffer)
+    , m_back_buffer(win.m_back_buffer)
     , m_content_bitmap(std::move(win.m_content_bitmap))
     , m_bounds(win.m_bounds)
     , m_content_bounds(win.m_content_bounds)
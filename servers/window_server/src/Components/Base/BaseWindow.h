@@ -28,11 +28,19 @@ public:
     BaseWindow(BaseWindow&& win);
     ~BaseWindow() = default;
 
+    // Clients draw into one buffer while the other one is shown. Both are
+    // kept mapped, so a swap doesn't open the buffer again.
     inline void set_buffer(int buffer_id)
     {
+        if (m_buffer.id() == buffer_id) {
+            return;
+        }
+
+        std::swap(m_buffer, m_back_buffer);
         if (m_buffer.id() != buffer_id) {
             m_buffer.open(buffer_id);
         }
+        m_content_bitmap = LG::PixelBitmap(m_buffer.data(), m_content_bounds.width(), m_content_bounds.height(), m_content_bitmap.format());
     }
 
     inline int id() const { return m_id; }
@@ -70,6 +78,7 @@ protected:
     LG::Rect m_content_bounds;
     LG::PixelBitmap m_content_bitmap;
     LFoundation::SharedBuffer<LG::Color> m_buffer;
+    LFoundation::SharedBuffer<LG::Color> m_back_buffer;
 };
 
 } // namespace WinServer
\ No newline at end of file
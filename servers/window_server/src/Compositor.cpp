@@ -13,9 +13,11 @@
 #include "ResourceManager.h"
 #include "Screen.h"
 #include "WindowManager.h"
+#include <algorithm>
 #include <libfoundation/EventLoop.h>
 #include <libfoundation/Memory.h>
 #include <libg/Context.h>
+#include <sys/time.h>
 
 namespace WinServer {
 
@@ -31,40 +33,111 @@ Compositor::Compositor()
 #endif // TARGET_MOBILE
 {
     s_WinServer_Compositor_the = this;
+    m_cursor_background.resize(m_cursor_manager.current_cursor().width(), m_cursor_manager.current_cursor().height());
     invalidate(Screen::the().bounds());
-    LFoundation::EventLoop::the().add(LFoundation::Timer([] {
-        Compositor::the().refresh();
-    },
-        1000 / 60, LFoundation::Timer::Repeat));
 }
 
-void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& areas)
+void Compositor::save_cursor_background(const LG::PixelBitmap& bitmap)
 {
     auto& screen = Screen::the();
+    auto& cursor = m_cursor_manager.current_cursor();
+    m_cursor_position = m_cursor_manager.draw_position();
+    m_cursor_rect = LG::Rect(m_cursor_position.x(), m_cursor_position.y(), cursor.width(), cursor.height()).intersection(screen.bounds());
+
+    int offset_x = m_cursor_rect.min_x() - m_cursor_position.x();
+    int offset_y = m_cursor_rect.min_y() - m_cursor_position.y();
+    for (int j = 0; j < m_cursor_rect.height(); j++) {
+        auto* dest = reinterpret_cast<uint32_t*>(&m_cursor_background[offset_y + j][offset_x]);
+        auto* src = reinterpret_cast<const uint32_t*>(&bitmap[m_cursor_rect.min_y() + j][m_cursor_rect.min_x()]);
+        LFoundation::fast_copy(dest, src, m_cursor_rect.width());
+    }
+}
 
-    for (int i = 0; i < areas.size(); i++) {
-        auto bounds = areas[i].intersection(screen.bounds());
-        auto* buf1_ptr = reinterpret_cast<uint32_t*>(&screen.display_bitmap()[bounds.min_y()][bounds.min_x()]);
-        auto* buf2_ptr = reinterpret_cast<uint32_t*>(&screen.write_bitmap()[bounds.min_y()][bounds.min_x()]);
-        for (int j = 0; j < bounds.height(); j++) {
-            LFoundation::fast_copy(buf2_ptr, buf1_ptr, bounds.width());
-            buf1_ptr += screen.width();
-            buf2_ptr += screen.width();
-        }
+void Compositor::restore_cursor_background(LG::PixelBitmap& bitmap)
+{
+    int offset_x = m_cursor_rect.min_x() - m_cursor_position.x();
+    int offset_y = m_cursor_rect.min_y() - m_cursor_position.y();
+
+    for (int j = 0; j < m_cursor_rect.height(); j++) {
+        auto* dest = reinterpret_cast<uint32_t*>(&bitmap[m_cursor_rect.min_y() + j][m_cursor_rect.min_x()]);
+        auto* src = reinterpret_cast<const uint32_t*>(&m_cursor_background[offset_y + j][offset_x]);
+        LFoundation::fast_copy(dest, src, m_cursor_rect.width());
+    }
+}
+
+void Compositor::draw_cursor(LG::PixelBitmap& bitmap)
+{
+    LG::Context ctx(bitmap);
+    ctx.draw(m_cursor_manager.draw_position(), m_cursor_manager.current_cursor());
+    m_cursor_drawn = true;
+}
+
+// Only two small rects of the display buffer are touched, there is no need
+// to compose the frame and swap buffers.
+void Compositor::refresh_cursor()
+{
+    auto& display_bitmap = Screen::the().display_bitmap();
+    if (m_cursor_drawn) {
+        restore_cursor_background(display_bitmap);
     }
+    save_cursor_background(display_bitmap);
+    draw_cursor(display_bitmap);
+    m_cursor_moved = false;
+    m_frame_stats.cursor_frames++;
 }
 
-[[gnu::flatten]] void Compositor::refresh()
+void Compositor::refresh()
 {
-    if (m_invalidated_areas.size() == 0) {
+    if (m_invalidated_areas.empty() && !m_cursor_moved) {
         return;
     }
 
+    timeval_t frame_start, frame_end;
+    timezone_t tz;
+    gettimeofday(&frame_start, &tz);
+
+    if (m_invalidated_areas.empty()) {
+        refresh_cursor();
+    } else {
+        compose_frame();
+    }
+
+    gettimeofday(&frame_end, &tz);
+    uint32_t usec = (frame_end.tv_sec - frame_start.tv_sec) * 1000000 + (frame_end.tv_usec - frame_start.tv_usec);
+    m_frame_stats.busy_usec += usec;
+    m_frame_stats.max_frame_usec = std::max(m_frame_stats.max_frame_usec, usec);
+}
+
+[[gnu::flatten]] void Compositor::compose_frame()
+{
     auto& screen = Screen::the();
     auto& wm = WindowManager::the();
-    auto invalidated_areas = std::move(m_invalidated_areas);
+    auto damage = std::move(m_invalidated_areas);
     LG::Context ctx(screen.write_bitmap());
 
+    // The write buffer has not seen the damage of frames, which were shown
+    // since it was on screen, so it is redrawn too instead of being copied.
+    std::vector<LG::Rect> invalidated_areas;
+    int age = screen.write_buffer_age();
+    if (age == 0 || age - 1 > (int)m_damage_history.size()) {
+        invalidated_areas.push_back(screen.bounds());
+    } else {
+        invalidated_areas = damage;
+        for (int i = 0; i < age - 1; i++) {
+            for (auto& area : m_damage_history[i]) {
+                optimized_invalidate_insert(invalidated_areas, area);
+            }
+        }
+    }
+
+    if ((int)m_damage_history.size() < screen.buffers_count() - 1) {
+        m_damage_history.push_back({});
+    }
+    for (int i = m_damage_history.size() - 1; i > 0; i--) {
+        m_damage_history[i] = std::move(m_damage_history[i - 1]);
+    }
+    m_damage_history[0] = std::move(damage);
+
     auto is_window_area_invalidated = [&](const std::vector<LG::Rect>& areas, const LG::Rect& area) -> bool {
         for (int i = 0; i < areas.size(); i++) {
             if (area.intersects(areas[i])) {
@@ -154,16 +227,17 @@ void Compositor::copy_changes_to_second_buffer(const std::vector<LG::Rect>& area
     }
 #endif // TARGET_MOBILE
 
-    auto mouse_draw_position = m_cursor_manager.draw_position();
-    auto& current_mouse_bitmap = m_cursor_manager.current_cursor();
-    for (int i = 0; i < invalidated_areas.size(); i++) {
-        ctx.add_clip(invalidated_areas[i]);
-        ctx.draw(mouse_draw_position, current_mouse_bitmap);
-        ctx.reset_clip();
+    // Only the display buffer keeps the cursor, so the old one is removed
+    // from it before it goes off screen.
+    if (m_cursor_drawn) {
+        restore_cursor_background(screen.display_bitmap());
     }
+    save_cursor_background(screen.write_bitmap());
+    draw_cursor(screen.write_bitmap());
+    m_cursor_moved = false;
 
     screen.swap_buffers();
-    copy_changes_to_second_buffer(invalidated_areas);
+    m_frame_stats.frames++;
 }
 
 } // namespace WinServer
\ No newline at end of file
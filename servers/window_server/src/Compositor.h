@@ -6,7 +6,9 @@
 
 #pragma once
 #include "../shared/Connections/WSConnection.h"
+#include "FrameScheduler.h"
 #include "ServerDecoder.h"
+#include <libg/PixelBitmap.h>
 #include <libipc/ServerConnection.h>
 #include <vector>
 
@@ -28,9 +30,18 @@ public:
         return *s_WinServer_Compositor_the;
     }
 
+    // Frames are counted since the start, the activity monitor takes the difference.
+    struct FrameStats {
+        uint32_t frames { 0 };
+        uint32_t cursor_frames { 0 };
+        uint32_t busy_usec { 0 };
+        uint32_t max_frame_usec { 0 };
+    };
+
     Compositor();
 
     void refresh();
+    inline const FrameStats& frame_stats() const { return m_frame_stats; }
 
     void optimized_invalidate_insert(std::vector<LG::Rect>& data, const LG::Rect& inv_area)
     {
@@ -67,7 +78,9 @@ public:
         }
     }
 
-    inline void invalidate(const LG::Rect& area) { optimized_invalidate_insert(m_invalidated_areas, area); }
+    inline void invalidate(const LG::Rect& area) { optimized_invalidate_insert(m_invalidated_areas, area), FrameScheduler::the().schedule_frame(); }
+    inline void invalidate_cursor() { m_cursor_moved = true, FrameScheduler::the().schedule_frame(); }
+    inline bool has_damage() const { return !m_invalidated_areas.empty() || m_cursor_moved; }
     inline CursorManager& cursor_manager() { return m_cursor_manager; }
     inline const CursorManager& cursor_manager() const { return m_cursor_manager; }
     inline ResourceManager& resource_manager() { return m_resource_manager; }
@@ -85,9 +98,26 @@ public:
 #endif // TARGET_MOBILE
 
 private:
-    void copy_changes_to_second_buffer(const std::vector<LG::Rect>& areas);
+    void compose_frame();
+    void refresh_cursor();
+    void save_cursor_background(const LG::PixelBitmap& bitmap);
+    void restore_cursor_background(LG::PixelBitmap& bitmap);
+    void draw_cursor(LG::PixelBitmap& bitmap);
 
     std::vector<LG::Rect> m_invalidated_areas;
+
+    // Damage of the last frames, the newest goes first. The write buffer
+    // is redrawn with the damage it has missed while others were shown.
+    std::vector<std::vector<LG::Rect>> m_damage_history;
+    FrameStats m_frame_stats;
+
+    // The cursor is drawn over composed frames. Pixels under it are kept, so
+    // when only the cursor moves, it is redrawn right in the display buffer.
+    bool m_cursor_moved { true };
+    bool m_cursor_drawn { false };
+    LG::Point<int> m_cursor_position;
+    LG::Rect m_cursor_rect;
+    LG::PixelBitmap m_cursor_background;
     MenuBar& m_menu_bar;
     Popup& m_popup;
     CursorManager& m_cursor_manager;
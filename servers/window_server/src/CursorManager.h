@@ -133,14 +133,14 @@ public:
         }
     }
 
-    void update_position(MouseEvent* mouse_event)
+    void update_position(const MousePacket& packet)
     {
         clear_changed();
-        set<Params::OffsetX>(mouse_event->packet().x_offset);
-        set<Params::OffsetY>(-mouse_event->packet().y_offset);
-        set<Params::LeftButton>((mouse_event->packet().button_states & 1));
-        set<Params::RightButton>((mouse_event->packet().button_states & 2) >> 1);
-        set<Params::Wheel>(mouse_event->packet().wheel_data);
+        set<Params::OffsetX>(packet.x_offset);
+        set<Params::OffsetY>(-packet.y_offset);
+        set<Params::LeftButton>((packet.button_states & 1));
+        set<Params::RightButton>((packet.button_states & 2) >> 1);
+        set<Params::Wheel>(packet.wheel_data);
     }
 
 private:
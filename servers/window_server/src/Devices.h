@@ -6,9 +6,13 @@
 
 #pragma once
 #include "Event.h"
+#include "FrameScheduler.h"
+#include "MouseTrace.h"
 #include "WindowManager.h"
+#include <cstdint>
 #include <libfoundation/EventLoop.h>
 #include <memory>
+#include <vector>
 
 namespace WinServer {
 
@@ -23,23 +27,53 @@ public:
     Devices();
     ~Devices() = default;
 
-    inline void pump_mouse() const
+    // Packets are only queued here, the window manager gets them once per
+    // frame from dispatch_mouse_packets().
+    inline void pump_mouse()
     {
-        LFoundation::EventLoop& el = LFoundation::EventLoop::the();
-        WindowManager& wm = WindowManager::the();
-
-        char buf[512];
-        int read_cnt = read(m_mouse_fd, buf, sizeof(buf));
+        MousePacket packets[32];
+        int read_cnt = read(m_mouse_fd, reinterpret_cast<char*>(packets), sizeof(packets));
         if (read_cnt <= 0) {
             return;
         }
 
-        auto* packet_buf = reinterpret_cast<MousePacket*>(buf);
-        for (int offset = 0, cnt = 0; offset < read_cnt; offset += sizeof(MousePacket), cnt++) {
-            el.add(wm, new MouseEvent(packet_buf[cnt]));
+        int packets_cnt = read_cnt / (int)sizeof(MousePacket);
+#ifdef WS_MOUSE_TRACE_BENCH
+        if (m_mouse_trace.replaying()) {
+            return;
+        }
+        m_mouse_trace.record(packets, packets_cnt);
+#endif
+        for (int cnt = 0; cnt < packets_cnt; cnt++) {
+            queue_mouse_packet(packets[cnt]);
+        }
+    }
+
+    inline void dispatch_mouse_packets()
+    {
+#ifdef WS_MOUSE_TRACE_BENCH
+        if (m_mouse_trace.replaying()) {
+            m_mouse_trace.replay_frame(FrameScheduler::the().frame_interval_ms(), [this](const MousePacket& packet) { queue_mouse_packet(packet); });
+        }
+#endif
+        if (m_pending_mouse_packets.empty()) {
+            return;
+        }
+
+        WindowManager& wm = WindowManager::the();
+        for (auto& packet : m_pending_mouse_packets) {
+            wm.receive_mouse_packet(packet);
         }
+        m_pending_mouse_packets.clear();
+        m_last_pending_mergeable = false;
     }
 
+    inline bool has_pending_mouse_packets() const { return !m_pending_mouse_packets.empty(); }
+
+#ifdef WS_MOUSE_TRACE_BENCH
+    inline MouseTrace& mouse_trace() { return m_mouse_trace; }
+#endif
+
     inline void pump_keyboard() const
     {
         LFoundation::EventLoop& el = LFoundation::EventLoop::the();
@@ -58,8 +92,42 @@ public:
     }
 
 private:
+    static inline bool fits_int16(int val) { return INT16_MIN <= val && val <= INT16_MAX; }
+
+    // Motion is merged into the last pending packet, clicks are kept as is.
+    // A motion which would overflow the offsets of the packet starts a new one.
+    inline void queue_mouse_packet(const MousePacket& packet)
+    {
+        bool is_click = (packet.button_states != m_last_buttons);
+        m_last_buttons = packet.button_states;
+
+        if (!is_click && m_last_pending_mergeable && m_pending_mouse_packets.back().button_states == packet.button_states) {
+            auto& last = m_pending_mouse_packets.back();
+            int x_offset = (int)last.x_offset + packet.x_offset;
+            int y_offset = (int)last.y_offset + packet.y_offset;
+            int wheel_data = (int)last.wheel_data + packet.wheel_data;
+            if (fits_int16(x_offset) && fits_int16(y_offset) && fits_int16(wheel_data)) {
+                last.x_offset = x_offset;
+                last.y_offset = y_offset;
+                last.wheel_data = wheel_data;
+                last.time_ms = packet.time_ms;
+                return;
+            }
+        }
+
+        m_pending_mouse_packets.push_back(packet);
+        m_last_pending_mergeable = !is_click;
+        FrameScheduler::the().schedule_frame();
+    }
+
     int m_mouse_fd;
     int m_keyboard_fd;
+    std::vector<MousePacket> m_pending_mouse_packets;
+    uint16_t m_last_buttons { 0 };
+    bool m_last_pending_mergeable { false };
+#ifdef WS_MOUSE_TRACE_BENCH
+    MouseTrace m_mouse_trace;
+#endif
 };
 
 } // namespace WinServer
\ No newline at end of file
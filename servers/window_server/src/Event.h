@@ -36,6 +36,7 @@ struct MousePacket {
     int16_t y_offset;
     uint16_t button_states;
     int16_t wheel_data;
+    uint32_t time_ms;
 };
 
 struct KeyboardPacket {
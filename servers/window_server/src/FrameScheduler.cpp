@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "FrameScheduler.h"
+#include "Compositor.h"
+#include "Devices.h"
+#include "WindowManager.h"
+#include <algorithm>
+#include <errno.h>
+#include <libfoundation/EventLoop.h>
+
+namespace WinServer {
+
+FrameScheduler* s_WinServer_FrameScheduler_the = nullptr;
+
+FrameScheduler::FrameScheduler()
+    : m_refresh_rate(default_refresh_rate())
+    , m_period_ns(1000000000 / default_refresh_rate())
+{
+    s_WinServer_FrameScheduler_the = this;
+    clock_gettime(CLOCK_MONOTONIC, &m_next_vblank);
+    advance(m_next_vblank);
+}
+
+int FrameScheduler::set_refresh_rate(int rate)
+{
+    if (rate < min_refresh_rate() || rate > max_refresh_rate()) {
+        return -EINVAL;
+    }
+
+    m_refresh_rate = rate;
+    m_period_ns = 1000000000 / rate;
+    clock_gettime(CLOCK_MONOTONIC, &m_next_vblank);
+    advance(m_next_vblank);
+    return 0;
+}
+
+void FrameScheduler::request_frame_callback(int window_id)
+{
+    if (std::find(m_frame_callbacks.begin(), m_frame_callbacks.end(), window_id) != m_frame_callbacks.end()) {
+        return;
+    }
+    m_frame_callbacks.push_back(window_id);
+    schedule_frame();
+}
+
+void FrameScheduler::cancel_frame_callback(int window_id)
+{
+    auto it = std::find(m_frame_callbacks.begin(), m_frame_callbacks.end(), window_id);
+    if (it == m_frame_callbacks.end()) {
+        return;
+    }
+    *it = m_frame_callbacks.back();
+    m_frame_callbacks.pop_back();
+}
+
+bool FrameScheduler::has_pending_work() const
+{
+#ifdef WS_MOUSE_TRACE_BENCH
+    if (Devices::the().mouse_trace().replaying()) {
+        return true;
+    }
+#endif
+    return !m_frame_callbacks.empty() || Compositor::the().has_damage() || Devices::the().has_pending_mouse_packets();
+}
+
+void FrameScheduler::schedule_frame()
+{
+    if (m_frame_scheduled) {
+        return;
+    }
+    m_frame_scheduled = true;
+
+    std::timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    skip_missed_vblanks(now);
+    LFoundation::EventLoop::the().add(LFoundation::Timer([] {
+        FrameScheduler::the().tick();
+    },
+        ms_until(now, m_next_vblank), LFoundation::Timer::Once));
+}
+
+void FrameScheduler::skip_missed_vblanks(const std::timespec& now)
+{
+    // Missed vblanks are skipped. If the server was idle or stalled for
+    // long, the phase is restarted instead of catching up.
+    int missed = 0;
+    while (reached(now, m_next_vblank)) {
+        advance(m_next_vblank);
+        if (++missed > m_refresh_rate) {
+            m_next_vblank = now;
+            advance(m_next_vblank);
+            break;
+        }
+    }
+}
+
+void FrameScheduler::tick()
+{
+    m_frame_scheduled = false;
+
+    // The timer has a millisecond resolution and the deadline might be moved
+    // by set_refresh_rate(), so it is checked again.
+    std::timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (!reached(now, m_next_vblank)) {
+        schedule_frame();
+        return;
+    }
+
+    skip_missed_vblanks(now);
+    m_vblank_count++;
+
+    // Work queued while the frame is handled is picked up by it, so the
+    // timer is not armed from inside vblank().
+    m_frame_scheduled = true;
+    vblank();
+    m_frame_scheduled = false;
+
+    if (has_pending_work()) {
+        schedule_frame();
+    }
+}
+
+void FrameScheduler::vblank()
+{
+    // Mouse input is handled once per frame, so fast motion costs a single cursor update.
+    Devices::the().dispatch_mouse_packets();
+    Compositor::the().refresh();
+#ifdef WS_MOUSE_TRACE_BENCH
+    Devices::the().mouse_trace().frame_done();
+#endif
+    send_frame_callbacks();
+}
+
+void FrameScheduler::send_frame_callbacks()
+{
+    if (m_frame_callbacks.empty()) {
+        return;
+    }
+
+    auto& wm = WindowManager::the();
+    for (int window_id : m_frame_callbacks) {
+        auto* window = wm.window(window_id);
+        if (!window) {
+            continue;
+        }
+        LFoundation::EventLoop::the().add(Connection::the(), new SendEvent(new FrameCallbackMessage(window->connection_id(), window_id, m_vblank_count)));
+    }
+    m_frame_callbacks.clear();
+}
+
+} // namespace WinServer
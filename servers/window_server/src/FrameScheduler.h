@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+#include <ctime>
+#include <sys/types.h>
+#include <vector>
+
+namespace WinServer {
+
+// Frames are composed on vertical blanks of the display. BGA and PL111 don't
+// report them, so vblanks are simulated with the monotonic clock at the
+// refresh rate. Deadlines are advanced by the period, not reloaded from the
+// time they were noticed, so frames keep their phase.
+//
+// A frame is composed only if something is damaged. Clients which asked for a
+// frame callback are notified after each vblank, so they draw once per frame.
+//
+// The vblank timer is armed only while there is work for the next frame:
+// damage, mouse input or frame callbacks. An idle server doesn't wake up.
+class FrameScheduler {
+public:
+    inline static FrameScheduler& the()
+    {
+        extern FrameScheduler* s_WinServer_FrameScheduler_the;
+        return *s_WinServer_FrameScheduler_the;
+    }
+
+    static constexpr int default_refresh_rate() { return 60; }
+    static constexpr int min_refresh_rate() { return 1; }
+    static constexpr int max_refresh_rate() { return 240; }
+
+    FrameScheduler();
+
+    int set_refresh_rate(int rate);
+    inline int refresh_rate() const { return m_refresh_rate; }
+    inline uint32_t frame_interval_ms() const { return 1000 / m_refresh_rate; }
+    inline uint32_t vblank_count() const { return m_vblank_count; }
+
+    void request_frame_callback(int window_id);
+    void cancel_frame_callback(int window_id);
+
+    // Arms the vblank timer for the next deadline, if it is not armed yet.
+    void schedule_frame();
+
+private:
+    bool has_pending_work() const;
+    void skip_missed_vblanks(const std::timespec& now);
+    void tick();
+    void vblank();
+    void send_frame_callbacks();
+
+    inline bool reached(const std::timespec& now, const std::timespec& deadline) const
+    {
+        return now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec);
+    }
+
+    inline uint32_t ms_until(const std::timespec& now, const std::timespec& deadline) const
+    {
+        int64_t ns = (int64_t)(deadline.tv_sec - now.tv_sec) * 1000000000 + (deadline.tv_nsec - now.tv_nsec);
+        return ns > 0 ? (ns + 999999) / 1000000 : 0;
+    }
+
+    inline void advance(std::timespec& deadline) const
+    {
+        deadline.tv_nsec += m_period_ns;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            deadline.tv_sec++;
+        }
+    }
+
+    int m_refresh_rate;
+    uint32_t m_period_ns;
+    std::timespec m_next_vblank;
+    uint32_t m_vblank_count { 0 };
+    bool m_frame_scheduled { false };
+    std::vector<int> m_frame_callbacks;
+};
+
+} // namespace WinServer
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "MouseTrace.h"
+#include <fcntl.h>
+#include <libfoundation/Logger.h>
+#include <unistd.h>
+
+namespace WinServer {
+
+MouseTrace::MouseTrace()
+{
+    int fd = open(path(), O_RDONLY);
+    if (fd >= 0) {
+        MousePacket packet;
+        while (read(fd, reinterpret_cast<char*>(&packet), sizeof(packet)) == sizeof(packet)) {
+            m_packets.push_back(packet);
+        }
+        close(fd);
+        m_replaying = !m_packets.empty();
+        Logger::debug << "MouseTrace: replaying " << m_packets.size() << " packets" << std::endl;
+        return;
+    }
+
+    m_fd = open(path(), O_CREAT | O_RDWR);
+    if (m_fd < 0) {
+        Logger::debug << "MouseTrace: can't create " << path() << std::endl;
+    }
+}
+
+MouseTrace::~MouseTrace()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+void MouseTrace::record(const MousePacket* packets, int cnt)
+{
+    if (m_fd < 0) {
+        return;
+    }
+
+    cnt = std::min(cnt, max_packets() - m_recorded);
+    write(m_fd, reinterpret_cast<const char*>(packets), cnt * sizeof(MousePacket));
+    m_recorded += cnt;
+    if (m_recorded == max_packets()) {
+        fsync(m_fd);
+        close(m_fd);
+        m_fd = -1;
+        Logger::debug << "MouseTrace: recorded " << m_recorded << " packets" << std::endl;
+    }
+}
+
+void MouseTrace::frame_done()
+{
+    if (!m_replaying) {
+        return;
+    }
+
+    timeval_t frame_end;
+    gettimeofday(&frame_end, &m_tz);
+    int usec = (frame_end.tv_sec - m_frame_start.tv_sec) * 1000000 + (frame_end.tv_usec - m_frame_start.tv_usec);
+    m_frames++;
+    m_total_usec += usec;
+    m_max_usec = std::max(m_max_usec, usec);
+
+    if (m_next_packet == m_packets.size()) {
+        report();
+        m_replaying = false;
+    }
+}
+
+void MouseTrace::report()
+{
+    Logger::debug << "[BENCH][MOUSE TRACE] " << m_frames << " frames, " << m_total_usec / m_frames << " (usec) avg, " << m_max_usec << " (usec) max" << std::endl;
+}
+
+} // namespace WinServer
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+#include "Event.h"
+#include <sys/time.h>
+#include <vector>
+
+// #define WS_MOUSE_TRACE_BENCH
+
+namespace WinServer {
+
+// Records mouse packets into the trace file. If the file is already there,
+// its packets are replayed instead of the real mouse and time of frames is
+// reported, so cursor paths of the compositor could be compared.
+class MouseTrace {
+public:
+    static constexpr const char* path() { return "/mouse.trace"; }
+    static constexpr int max_packets() { return 4096; }
+
+    MouseTrace();
+    ~MouseTrace();
+
+    inline bool replaying() const { return m_replaying; }
+    void record(const MousePacket* packets, int cnt);
+
+    // Packets are replayed with the same timing as they were recorded.
+    template <typename Callback>
+    void replay_frame(uint32_t frame_interval_ms, Callback callback)
+    {
+        gettimeofday(&m_frame_start, &m_tz);
+        m_replay_time_ms += frame_interval_ms;
+        uint32_t start_ms = m_packets.front().time_ms;
+        while (m_next_packet < m_packets.size() && m_packets[m_next_packet].time_ms - start_ms <= m_replay_time_ms) {
+            callback(m_packets[m_next_packet++]);
+        }
+    }
+
+    void frame_done();
+
+private:
+    void report();
+
+    int m_fd { -1 };
+    bool m_replaying { false };
+    int m_recorded { 0 };
+    std::vector<MousePacket> m_packets;
+    size_t m_next_packet { 0 };
+    uint32_t m_replay_time_ms { 0 };
+
+    timeval_t m_frame_start;
+    timezone_t m_tz;
+    int m_frames { 0 };
+    int m_total_usec { 0 };
+    int m_max_usec { 0 };
+};
+
+} // namespace WinServer
@@ -6,6 +6,7 @@
 
 #include "Screen.h"
 #include "Compositor.h"
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -18,30 +19,32 @@ Screen* s_WinServer_Screen_the = nullptr;
 
 Screen::Screen()
     : m_depth(4)
-    , m_write_bitmap()
-    , m_display_bitmap()
 {
     s_WinServer_Screen_the = this;
     m_screen_fd = open("/dev/bga", O_RDWR);
     m_bounds = LG::Rect(0, 0, ioctl(m_screen_fd, BGA_GET_WIDTH, 0), ioctl(m_screen_fd, BGA_GET_HEIGHT, 0));
 
-    size_t screen_buffer_size = width() * height() * depth();
-    auto* first_buffer = reinterpret_cast<LG::Color*>(mmap(NULL, 1, PROT_READ | PROT_WRITE, MAP_SHARED, m_screen_fd, 0));
-    auto* second_buffer = reinterpret_cast<LG::Color*>(reinterpret_cast<uint8_t*>(first_buffer) + screen_buffer_size);
-
-    m_display_bitmap = LG::PixelBitmap(first_buffer, width(), height());
-    m_write_bitmap = LG::PixelBitmap(second_buffer, width(), height());
+    // Older drivers have only two buffers and don't know the ioctl.
+    m_buffers_count = ioctl(m_screen_fd, BGA_GET_BUFFERS_COUNT, 0);
+    m_buffers_count = std::max(2, std::min(m_buffers_count, MaxBuffers));
 
-    m_display_bitmap_ptr = &m_display_bitmap;
-    m_write_bitmap_ptr = &m_write_bitmap;
+    size_t screen_buffer_size = width() * height() * depth();
+    auto* buffers = reinterpret_cast<uint8_t*>(mmap(NULL, 1, PROT_READ | PROT_WRITE, MAP_SHARED, m_screen_fd, 0));
+    for (int i = 0; i < m_buffers_count; i++) {
+        auto* buffer = reinterpret_cast<LG::Color*>(buffers + i * screen_buffer_size);
+        m_buffers[i] = LG::PixelBitmap(buffer, width(), height());
+    }
 
     m_active_buffer = 0;
+    m_write_buffer = 1;
 }
 
 void Screen::swap_buffers()
 {
-    m_write_bitmap_ptr.swap(m_display_bitmap_ptr);
-    m_active_buffer ^= 1;
+    m_frame++;
+    m_buffer_frame[m_write_buffer] = m_frame;
+    m_active_buffer = m_write_buffer;
+    m_write_buffer = (m_write_buffer + 1) % m_buffers_count;
     ioctl(m_screen_fd, BGA_SWAP_BUFFERS, m_active_buffer);
 }
 
@@ -19,33 +19,46 @@ public:
         return *s_WinServer_Screen_the;
     }
 
+    static constexpr int MaxBuffers = 3;
+
     Screen();
 
     void swap_buffers();
 
+    // Returns how many frames ago the write buffer was on screen, 0 if its
+    // content is unknown.
+    inline int write_buffer_age() const
+    {
+        if (!m_buffer_frame[m_write_buffer]) {
+            return 0;
+        }
+        return m_frame + 1 - m_buffer_frame[m_write_buffer];
+    }
+    inline int buffers_count() const { return m_buffers_count; }
+
     inline size_t width() { return m_bounds.width(); }
     inline size_t height() const { return m_bounds.height(); }
     inline LG::Rect& bounds() { return m_bounds; }
     inline const LG::Rect& bounds() const { return m_bounds; }
     inline uint32_t depth() const { return m_depth; }
 
-    inline LG::PixelBitmap& write_bitmap() { return *m_write_bitmap_ptr; }
-    inline const LG::PixelBitmap& write_bitmap() const { return *m_write_bitmap_ptr; }
-    inline LG::PixelBitmap& display_bitmap() { return *m_display_bitmap_ptr; }
-    inline const LG::PixelBitmap& display_bitmap() const { return *m_display_bitmap_ptr; }
+    inline LG::PixelBitmap& write_bitmap() { return m_buffers[m_write_buffer]; }
+    inline const LG::PixelBitmap& write_bitmap() const { return m_buffers[m_write_buffer]; }
+    inline LG::PixelBitmap& display_bitmap() { return m_buffers[m_active_buffer]; }
+    inline const LG::PixelBitmap& display_bitmap() const { return m_buffers[m_active_buffer]; }
 
 private:
     int m_screen_fd;
     LG::Rect m_bounds;
     uint32_t m_depth;
 
+    int m_buffers_count;
     int m_active_buffer;
+    int m_write_buffer;
 
-    LG::PixelBitmap m_write_bitmap;
-    LG::PixelBitmap m_display_bitmap;
-
-    std::unique_ptr<LG::PixelBitmap> m_write_bitmap_ptr { nullptr };
-    std::unique_ptr<LG::PixelBitmap> m_display_bitmap_ptr { nullptr };
+    uint32_t m_frame { 0 };
+    uint32_t m_buffer_frame[MaxBuffers] {};
+    LG::PixelBitmap m_buffers[MaxBuffers];
 };
 
 } // namespace WinServer
\ No newline at end of file
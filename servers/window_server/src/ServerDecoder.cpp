@@ -10,6 +10,7 @@
 #elif TARGET_MOBILE
 #include "Mobile/Window.h"
 #endif
+#include "FrameScheduler.h"
 #include "WindowManager.h"
 
 namespace WinServer {
@@ -174,4 +175,41 @@ std::unique_ptr<Message> WindowServerDecoder::handle(const AskBringToFrontMessag
     return nullptr;
 }
 
+std::unique_ptr<Message> WindowServerDecoder::handle(const GetFrameStatsMessage& msg)
+{
+    auto& stats = Compositor::the().frame_stats();
+    return new GetFrameStatsMessageReply(msg.key(), stats.frames, stats.cursor_frames, stats.busy_usec, stats.max_frame_usec);
+}
+
+std::unique_ptr<Message> WindowServerDecoder::handle(const RequestFrameMessage& msg)
+{
+    FrameScheduler::the().request_frame_callback(msg.window_id());
+    return nullptr;
+}
+
+std::unique_ptr<Message> WindowServerDecoder::handle(const SwapBufferMessage& msg)
+{
+    auto* window = WindowManager::the().window(msg.window_id());
+    if (!window) {
+        return nullptr;
+    }
+    window->set_buffer(msg.buffer_id());
+
+    // Only the areas the client has drawn are composed again.
+    auto& compositor = Compositor::the();
+    auto damage = msg.damage();
+    for (int i = 0; i < damage.size(); i++) {
+        auto rect = damage[i];
+        rect.offset_by(window->content_bounds().origin());
+        rect.intersect(window->content_bounds());
+        compositor.invalidate(rect);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Message> WindowServerDecoder::handle(const SetRefreshRateMessage& msg)
+{
+    return new SetRefreshRateMessageReply(msg.key(), FrameScheduler::the().set_refresh_rate(msg.rate()));
+}
+
 } // namespace WinServer
\ No newline at end of file
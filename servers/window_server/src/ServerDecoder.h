@@ -26,6 +26,14 @@ public:
     virtual std::unique_ptr<Message> handle(const MenuBarCreateMenuMessage& msg) override;
     virtual std::unique_ptr<Message> handle(const MenuBarCreateItemMessage& msg) override;
     virtual std::unique_ptr<Message> handle(const AskBringToFrontMessage& msg) override;
+
+    // Stats
+    virtual std::unique_ptr<Message> handle(const GetFrameStatsMessage& msg) override;
+
+    // Frames
+    virtual std::unique_ptr<Message> handle(const RequestFrameMessage& msg) override;
+    virtual std::unique_ptr<Message> handle(const SwapBufferMessage& msg) override;
+    virtual std::unique_ptr<Message> handle(const SetRefreshRateMessage& msg) override;
 };
 
 } // namespace WinServer
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "WindowManager.h"
 #include "../shared/MessageContent/MouseAction.h"
 #include "CursorManager.h"
+#include "FrameScheduler.h"
 #include "Screen.h"
 #include <libfoundation/KeyboardMapping.h>
 #include <libfoundation/Logger.h>
@@ -79,6 +80,7 @@ void WindowManager::remove_window(Window* window)
     }
     remove_window_from_screen(window);
     m_windows.erase(std::find(m_windows.begin(), m_windows.end(), window));
+    FrameScheduler::the().cancel_frame_callback(window->id());
     notify_window_status_changed(window->id(), WindowStatusUpdateType::Removed);
 #ifdef TARGET_MOBILE
     if (auto* top_window = get_top_standard_window_in_view(); top_window) {
@@ -157,23 +159,25 @@ bool WindowManager::continue_window_move()
 }
 #endif // TARGET_DESKTOP
 
-void WindowManager::update_mouse_position(std::unique_ptr<LFoundation::Event> mouse_event)
+void WindowManager::update_mouse_position(const MousePacket& packet)
 {
-    auto invalidate_bounds = m_cursor_manager.current_cursor().bounds();
-    invalidate_bounds.origin().set(m_cursor_manager.draw_position());
-    m_compositor.invalidate(invalidate_bounds);
-
-    m_cursor_manager.update_position((WinServer::MouseEvent*)mouse_event.get());
+    m_cursor_manager.update_position(packet);
+    if (m_cursor_manager.is_changed<CursorManager::Params::Coords>()) {
+        m_compositor.invalidate_cursor();
+    }
+}
 
-    invalidate_bounds.origin().set(m_cursor_manager.draw_position());
-    m_compositor.invalidate(invalidate_bounds);
+void WindowManager::receive_mouse_event(std::unique_ptr<LFoundation::Event> event)
+{
+    auto* mouse_event = static_cast<MouseEvent*>(event.get());
+    receive_mouse_packet(mouse_event->packet());
 }
 
 #ifdef TARGET_DESKTOP
-void WindowManager::receive_mouse_event(std::unique_ptr<LFoundation::Event> event)
+void WindowManager::receive_mouse_packet(const MousePacket& packet)
 {
     Window* new_hovered_window = nullptr;
-    update_mouse_position(std::move(event));
+    update_mouse_position(packet);
 
     if (continue_window_move()) {
         return;
@@ -263,9 +267,9 @@ void WindowManager::receive_mouse_event(std::unique_ptr<LFoundation::Event> even
     }
 }
 #elif TARGET_MOBILE
-void WindowManager::receive_mouse_event(std::unique_ptr<LFoundation::Event> event)
+void WindowManager::receive_mouse_packet(const MousePacket& packet)
 {
-    update_mouse_position(std::move(event));
+    update_mouse_position(packet);
 
     if (m_compositor.control_bar().control_button_bounds().contains(m_cursor_manager.x(), m_cursor_manager.y()) && active_window()) {
         if (m_cursor_manager.pressed<CursorManager::Params::LeftButton>()) {
@@ -101,6 +101,7 @@ public:
     inline int next_win_id() { return ++m_next_win_id; }
 
     void receive_event(std::unique_ptr<LFoundation::Event> event) override;
+    void receive_mouse_packet(const MousePacket& packet);
 
     void setup_dock(Window* window);
 
@@ -120,7 +121,7 @@ private:
     void start_window_move(Window& window);
     bool continue_window_move();
 
-    void update_mouse_position(std::unique_ptr<LFoundation::Event> mouse_event);
+    void update_mouse_position(const MousePacket& packet);
     void receive_mouse_event(std::unique_ptr<LFoundation::Event> event);
     void receive_keyboard_event(std::unique_ptr<LFoundation::Event> event);
 
@@ -14,6 +14,7 @@
 #include "Connection.h"
 #include "CursorManager.h"
 #include "Devices.h"
+#include "FrameScheduler.h"
 #include "ResourceManager.h"
 #include "Screen.h"
 #include "WindowManager.h"
@@ -69,6 +70,7 @@ int main()
 #ifdef TARGET_MOBILE
     load_core_component<WinServer::ControlBar>();
 #endif
+    load_core_component<WinServer::FrameScheduler>();
     load_core_component<WinServer::Compositor>();
     load_core_component<WinServer::WindowManager>();
     load_core_component<WinServer::Devices>();
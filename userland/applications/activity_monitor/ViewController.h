@@ -9,6 +9,7 @@
 #include <libfoundation/ProcessInfo.h>
 #include <libui/App.h>
 #include <libui/Button.h>
+#include <libui/Connection.h>
 #include <libui/Label.h>
 #include <libui/StackView.h>
 #include <libui/View.h>
@@ -40,6 +41,7 @@ public:
         view().set_background_color(LG::Color::LightSystemBackground);
 
         auto& cpu_label = view().add_subview<UI::Label>(LG::Rect(0, 0, 180, 16));
+        auto& frames_label = view().add_subview<UI::Label>(LG::Rect(0, 0, 180, 16));
         auto& cpu_graphs_stackview = view().add_subview<UI::StackView>(LG::Rect(0, 0, 184, 100));
         cpu_graphs_stackview.set_distribution(UI::StackView::Distribution::FillEqually);
         cpu_graphs_stackview.set_spacing(10);
@@ -47,9 +49,12 @@ public:
         view().add_constraint(UI::Constraint(cpu_label, UI::Constraint::Attribute::Left, UI::Constraint::Relation::Equal, UI::SafeArea::Left));
         view().add_constraint(UI::Constraint(cpu_label, UI::Constraint::Attribute::Top, UI::Constraint::Relation::Equal, UI::SafeArea::Top));
 
+        view().add_constraint(UI::Constraint(frames_label, UI::Constraint::Attribute::Left, UI::Constraint::Relation::Equal, UI::SafeArea::Left));
+        view().add_constraint(UI::Constraint(frames_label, UI::Constraint::Attribute::Top, UI::Constraint::Relation::Equal, cpu_label, UI::Constraint::Attribute::Bottom, 1, 4));
+
         view().add_constraint(UI::Constraint(cpu_graphs_stackview, UI::Constraint::Attribute::Left, UI::Constraint::Relation::Equal, UI::SafeArea::Left));
         view().add_constraint(UI::Constraint(cpu_graphs_stackview, UI::Constraint::Attribute::Right, UI::Constraint::Relation::Equal, UI::SafeArea::Right));
-        view().add_constraint(UI::Constraint(cpu_graphs_stackview, UI::Constraint::Attribute::Top, UI::Constraint::Relation::Equal, cpu_label, UI::Constraint::Attribute::Bottom, 1, 8));
+        view().add_constraint(UI::Constraint(cpu_graphs_stackview, UI::Constraint::Attribute::Top, UI::Constraint::Relation::Equal, frames_label, UI::Constraint::Attribute::Bottom, 1, 8));
         view().add_constraint(UI::Constraint(cpu_graphs_stackview, UI::Constraint::Attribute::Bottom, UI::Constraint::Relation::Equal, UI::SafeArea::Bottom));
 
         for (int i = 0; i < cpu_count(); i++) {
@@ -64,6 +69,8 @@ public:
             update_data();
             cpu_label.set_text(std::string("Load ") + std::to_string(state.cpu_load[0]) + "%");
             cpu_label.set_needs_display();
+            frames_label.set_text(std::to_string(state.fps) + " fps, " + std::to_string(state.frame_usec / 1000) + "." + std::to_string(state.frame_usec / 100 % 10) + " ms");
+            frames_label.set_needs_display();
         },
             1000, LFoundation::Timer::Repeat));
     }
@@ -98,9 +105,30 @@ public:
         return 0;
     }
 
+    int update_frame_stats()
+    {
+        auto& connection = UI::Connection::the();
+        auto reply = connection.send_sync_message<GetFrameStatsMessageReply>(GetFrameStatsMessage(connection.key()));
+        if (!reply) {
+            return -1;
+        }
+
+        // Counters are cumulative, so the difference is the last second.
+        uint32_t frames = reply->frames() + reply->cursor_frames();
+        uint32_t diff_frames = frames - state.old_frames;
+        uint32_t diff_busy_usec = reply->busy_usec() - state.old_busy_usec;
+        state.old_frames = frames;
+        state.old_busy_usec = reply->busy_usec();
+
+        state.fps = diff_frames;
+        state.frame_usec = diff_frames ? diff_busy_usec / diff_frames : 0;
+        return 0;
+    }
+
     void update_data()
     {
         update_cpu_load();
+        update_frame_stats();
     }
 
 private:
@@ -113,6 +141,11 @@ private:
         std::vector<int> cpu_old_user_time;
         std::vector<int> cpu_old_system_time;
         std::vector<int> cpu_old_idle_time;
+
+        uint32_t fps { 0 };
+        uint32_t frame_usec { 0 };
+        uint32_t old_frames { 0 };
+        uint32_t old_busy_usec { 0 };
     };
     State state;
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "TerminalViewController.h"
 #include <csignal>
 #include <libui/AppDelegate.h>
+#include <sys/ioctl.h>
 
 static int shell_pid = 0;
 
@@ -12,6 +13,9 @@ int setup_shell()
         std::abort();
     }
 
+    // Output of the shell is batched for a frame, it is drawn once per frame anyway.
+    ioctl(ptmx, PTY_SET_COALESCE, 16);
+
     int f = fork();
     if (f == 0) {
         char* pname = ptsname(ptmx);
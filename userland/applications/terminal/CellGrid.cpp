@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "CellGrid.h"
+#include <algorithm>
+#include <cstring>
+
+CellGrid::~CellGrid()
+{
+    free(m_cells);
+    free(m_dirty);
+}
+
+void CellGrid::resize(size_t cols, size_t rows, size_t scrollback)
+{
+    // FIXME: Keep the content on window resize.
+    free(m_cells);
+    free(m_dirty);
+
+    m_cols = cols;
+    m_rows = rows;
+    m_capacity = rows + scrollback;
+    m_top = 0;
+    m_history = 0;
+    m_scrolled_lines = 0;
+    m_cells = (Cell*)malloc(m_capacity * m_cols * sizeof(Cell));
+    m_dirty = (bool*)malloc(m_rows * sizeof(bool));
+
+    Cell blank;
+    for (size_t i = 0; i < m_capacity * m_cols; i++) {
+        m_cells[i] = blank;
+    }
+    mark_all_dirty();
+}
+
+void CellGrid::clear_row(size_t line, const Cell& blank)
+{
+    Cell* cells = row(line);
+    for (size_t i = 0; i < m_cols; i++) {
+        cells[i] = blank;
+    }
+    mark_dirty(line);
+}
+
+void CellGrid::scroll_up(const Cell& blank)
+{
+    // The top row goes to the scrollback, the oldest line of the scrollback
+    // is reused as the new bottom row.
+    m_top = (m_top + 1) % m_capacity;
+    m_history = std::min(m_history + 1, m_capacity - m_rows);
+    m_scrolled_lines = std::min(m_scrolled_lines + 1, m_rows);
+
+    memmove(m_dirty, m_dirty + 1, (m_rows - 1) * sizeof(bool));
+    clear_row(m_rows - 1, blank);
+}
+
+void CellGrid::mark_all_dirty()
+{
+    memset(m_dirty, true, m_rows * sizeof(bool));
+}
+
+void CellGrid::clear_dirty()
+{
+    memset(m_dirty, false, m_rows * sizeof(bool));
+}
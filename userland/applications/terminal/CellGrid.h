@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <sys/types.h>
+
+struct Cell {
+    enum Flags : uint8_t {
+        Bold = (1 << 0),
+        Inverse = (1 << 1),
+    };
+
+    // Colors are indexes in the palette of the view, 0 is the default color.
+    char code { '\0' };
+    uint8_t fg { 0 };
+    uint8_t bg { 0 };
+    uint8_t flags { 0 };
+};
+
+// The screen and the scrollback share a ring buffer of rows: scrolling moves
+// the index of the top row, the cells stay in place. Rows of the screen are
+// addressed from 0, lines of the scrollback with negative numbers.
+//
+// Each row of the screen has a dirty bit, which is set when its cells are
+// changed. Scrolling shifts the bits together with the rows and counts the
+// lines scrolled, so the view could move its pixels instead of redrawing them.
+class CellGrid {
+public:
+    CellGrid() = default;
+    ~CellGrid();
+
+    void resize(size_t cols, size_t rows, size_t scrollback);
+
+    inline size_t cols() const { return m_cols; }
+    inline size_t rows() const { return m_rows; }
+    inline size_t history_size() const { return m_history; }
+
+    inline Cell* row(int line) { return &m_cells[physical_row(line) * m_cols]; }
+    inline const Cell* row(int line) const { return &m_cells[physical_row(line) * m_cols]; }
+    inline Cell& at(size_t line, size_t col) { return row(line)[col]; }
+
+    void clear_row(size_t line, const Cell& blank);
+    void scroll_up(const Cell& blank);
+
+    inline void mark_dirty(size_t line) { m_dirty[line] = true; }
+    void mark_all_dirty();
+    inline bool is_dirty(size_t line) const { return m_dirty[line]; }
+    void clear_dirty();
+
+    inline size_t scrolled_lines() const { return m_scrolled_lines; }
+    inline void clear_scrolled_lines() { m_scrolled_lines = 0; }
+
+private:
+    inline size_t physical_row(int line) const { return (m_top + m_capacity + line) % m_capacity; }
+
+    Cell* m_cells { nullptr };
+    bool* m_dirty { nullptr };
+    size_t m_cols { 0 };
+    size_t m_rows { 0 };
+    size_t m_capacity { 0 };
+    size_t m_top { 0 };
+    size_t m_history { 0 };
+    size_t m_scrolled_lines { 0 };
+};
@@ -21,11 +21,34 @@ TerminalView::TerminalView(UI::View* superview, UI::Window* window, const LG::Re
 
 void TerminalView::recalc_dimensions(const LG::Rect& frame)
 {
-    m_max_rows = (frame.height() - padding() - UI::SafeArea::Bottom) / glyph_height();
-    m_max_cols = (frame.width() - 2 * padding()) / glyph_width();
-    // FIXME: Add copy and resize on window resize.
-    m_display_data = (char*)malloc(m_max_rows * m_max_cols);
-    memset((uint8_t*)m_display_data, 0, m_max_rows * m_max_cols);
+    size_t rows = (frame.height() - padding() - UI::SafeArea::Bottom) / glyph_height();
+    size_t cols = (frame.width() - 2 * padding()) / glyph_width();
+    m_grid.resize(cols, rows, scrollback_lines());
+}
+
+LG::Color TerminalView::palette_color(uint8_t index, const LG::Color& default_color) const
+{
+    // Index 0 is the default color, others are the 8 colors of SGR.
+    switch (index) {
+    case 1:
+        return LG::Color(0x181818);
+    case 2:
+        return LG::Color(0xC23621);
+    case 3:
+        return LG::Color(0x25BC24);
+    case 4:
+        return LG::Color(0xADAD27);
+    case 5:
+        return LG::Color(0x492EE1);
+    case 6:
+        return LG::Color(0xD338D3);
+    case 7:
+        return LG::Color(0x33BBC8);
+    case 8:
+        return LG::Color(0xCBCCCD);
+    default:
+        return default_color;
+    }
 }
 
 void TerminalView::display(const LG::Rect& rect)
@@ -34,156 +57,274 @@ void TerminalView::display(const LG::Rect& rect)
     ctx.add_clip(rect);
 
     ctx.set_fill_color(background_color());
-    ctx.fill(bounds());
+    ctx.fill(rect);
 
-    auto& f = font();
-    ctx.set_fill_color(font_color());
-    LG::Point<int> text_start { padding(), padding() };
+    // Only rows and columns within the rect are visited.
+    int first_row = std::max(0, (rect.min_y() - padding()) / glyph_height());
+    int last_row = std::min((int)m_grid.rows() - 1, (rect.max_y() - padding()) / glyph_height());
+    int first_col = std::max(0, (rect.min_x() - padding()) / glyph_width());
+    int last_col = std::min((int)m_grid.cols() - 1, (rect.max_x() - padding()) / glyph_width());
 
-    for (int i = 0; i < m_max_rows; i++) {
-        for (int j = 0; j < m_max_cols; j++) {
-            int idx = i * m_max_cols + j;
-            ctx.draw(text_start, f.glyph_bitmap(m_display_data[idx]));
-            text_start.offset_by(glyph_width(), 0);
+    for (int i = first_row; i <= last_row; i++) {
+        const Cell* cells = m_grid.row(i - (int)m_scrollback_offset);
+        LG::Point<int> text_start { padding() + first_col * glyph_width(), padding() + i * glyph_height() };
+        for (int j = first_col; j <= last_col; j++, text_start.offset_by(glyph_width(), 0)) {
+            const Cell& cell = cells[j];
+            uint8_t fg = cell.fg;
+            uint8_t bg = cell.bg;
+            if (cell.flags & Cell::Inverse) {
+                std::swap(fg, bg);
+            }
+
+            if (bg) {
+                ctx.set_fill_color(palette_color(bg, background_color()));
+                ctx.fill(LG::Rect(text_start.x(), text_start.y(), glyph_width(), glyph_height()));
+            }
+
+            // Blank cells cost nothing.
+            if (cell.code <= ' ') {
+                continue;
+            }
+            auto& f = (cell.flags & Cell::Bold) ? bold_font() : font();
+            ctx.set_fill_color(palette_color(fg, font_color()));
+            ctx.draw(text_start, f.glyph_bitmap(cell.code));
         }
-        text_start.set_x(padding());
-        text_start.offset_by(0, glyph_height());
     }
 
-    ctx.set_fill_color(cursor_color());
-    auto cursor_left_corner = pos_on_screen();
-    ctx.fill(LG::Rect(cursor_left_corner.x(), cursor_left_corner.y(), cursor_width(), glyph_height()));
+    if (!m_scrollback_offset) {
+        ctx.set_fill_color(cursor_color());
+        auto cursor_left_corner = pos_on_screen();
+        ctx.fill(LG::Rect(cursor_left_corner.x(), cursor_left_corner.y(), cursor_width(), glyph_height()));
+    }
 }
 
-void TerminalView::scroll_line()
+void TerminalView::feed(char c)
 {
-    data_do_new_line();
-    set_needs_display();
+    switch (m_parser_state) {
+    case ParserState::Normal:
+        switch (c) {
+        case '\033':
+            m_parser_state = ParserState::Escape;
+            return;
+        case '\n':
+            new_line();
+            return;
+        case '\r':
+            carriage_return();
+            return;
+        case '\b':
+            backspace();
+            return;
+        case '\t':
+            tab();
+            return;
+        default:
+            if ((unsigned char)c >= ' ') {
+                put_char(c);
+            }
+            return;
+        }
+
+    case ParserState::Escape:
+        if (c == '[') {
+            m_parser_state = ParserState::Csi;
+            m_csi_params[0] = 0;
+            m_csi_param_count = 1;
+            m_csi_params_dropped = false;
+            return;
+        }
+        m_parser_state = ParserState::Normal;
+        return;
+
+    case ParserState::Csi:
+        // Params over MaxCsiParams are dropped, values are clamped.
+        if (c >= '0' && c <= '9') {
+            if (!m_csi_params_dropped) {
+                int& param = m_csi_params[m_csi_param_count - 1];
+                param = std::min(param * 10 + (c - '0'), MaxCsiParamValue);
+            }
+            return;
+        }
+        if (c == ';') {
+            if (m_csi_param_count < MaxCsiParams) {
+                m_csi_params[m_csi_param_count++] = 0;
+            } else {
+                m_csi_params_dropped = true;
+            }
+            return;
+        }
+        if (c >= 0x40 && c <= 0x7e) {
+            // Only colors and attributes are supported, other sequences are skipped.
+            if (c == 'm') {
+                apply_sgr();
+            }
+            m_parser_state = ParserState::Normal;
+        }
+        return;
+    }
 }
 
-void TerminalView::data_do_new_line()
+void TerminalView::apply_sgr()
 {
-    char* data_plus_line = m_display_data + (m_max_cols);
-    char* data_end_minus_line = m_display_data + (m_max_rows - 1) * m_max_cols;
-    memmove((uint8_t*)m_display_data, (uint8_t*)data_plus_line, (m_max_rows - 1) * m_max_cols);
-    memset((uint8_t*)data_end_minus_line, 0, m_max_cols);
+    for (int i = 0; i < m_csi_param_count; i++) {
+        int param = m_csi_params[i];
+        if (param == 0) {
+            m_pen = Cell();
+        } else if (param == 1) {
+            m_pen.flags |= Cell::Bold;
+        } else if (param == 7) {
+            m_pen.flags |= Cell::Inverse;
+        } else if (param == 22) {
+            m_pen.flags &= ~Cell::Bold;
+        } else if (param == 27) {
+            m_pen.flags &= ~Cell::Inverse;
+        } else if (param >= 30 && param <= 37) {
+            m_pen.fg = param - 30 + 1;
+        } else if (param == 39) {
+            m_pen.fg = 0;
+        } else if (param >= 40 && param <= 47) {
+            m_pen.bg = param - 40 + 1;
+        } else if (param == 49) {
+            m_pen.bg = 0;
+        }
+    }
 }
 
-WindowStatus TerminalView::cursor_positions_do_new_line()
+void TerminalView::put_char(char c)
 {
-    m_col = 0;
-    m_row++;
-    if (m_row == m_max_rows) {
-        m_row--;
-        return DoNewLine;
+    Cell& cell = m_grid.at(m_row, m_col);
+    cell = m_pen;
+    cell.code = c;
+    m_grid.mark_dirty(m_row);
+
+    m_col++;
+    if (m_col == m_grid.cols()) {
+        new_line();
     }
-    return Normal;
 }
 
-WindowStatus TerminalView::cursor_position_move_right()
+void TerminalView::new_line()
 {
-    m_col++;
-    if (m_col == m_max_cols) {
-        return cursor_positions_do_new_line();
+    m_grid.mark_dirty(m_row);
+    m_col = 0;
+    if (m_row + 1 == m_grid.rows()) {
+        m_grid.scroll_up(blank_cell());
+    } else {
+        m_row++;
     }
-    return Normal;
+    m_grid.mark_dirty(m_row);
+}
+
+void TerminalView::carriage_return()
+{
+    m_grid.mark_dirty(m_row);
+    m_col = 0;
 }
 
-WindowStatus TerminalView::cursor_position_move_left()
+void TerminalView::backspace()
 {
-    m_col--;
-    if (m_col == 0 && m_row > 0) {
+    // Input which filled up a row continues on the next one, so erasing it
+    // goes back to the end of the previous row.
+    if (m_col > 0) {
+        m_col--;
+    } else if (m_row > 0) {
+        m_grid.mark_dirty(m_row);
         m_row--;
+        m_col = m_grid.cols() - 1;
     }
-    return Normal;
+    m_grid.mark_dirty(m_row);
 }
 
-void TerminalView::new_line()
+void TerminalView::tab()
 {
-    will_move_cursor();
-    auto status = cursor_positions_do_new_line();
-    if (status == DoNewLine) {
-        data_do_new_line();
-    }
-    did_move_cursor();
+    m_col = std::min(m_grid.cols() - 1, (m_col / tab_width() + 1) * tab_width());
+    m_grid.mark_dirty(m_row);
 }
 
-void TerminalView::increment_counter()
+void TerminalView::erase_char()
 {
-    will_move_cursor();
-    m_col++;
-    if (m_col == m_max_cols) {
-        new_line();
+    m_grid.at(m_row, m_col) = blank_cell();
+    m_grid.mark_dirty(m_row);
+}
+
+void TerminalView::put_text(const char* data, size_t size)
+{
+    // New output brings the view back from the scrollback.
+    if (m_scrollback_offset) {
+        m_scrollback_offset = 0;
+        m_grid.mark_all_dirty();
+        set_needs_display();
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        feed(data[i]);
     }
-    did_move_cursor();
+    flush_damage();
 }
 
-void TerminalView::decrement_counter()
+bool TerminalView::move_text(int lines)
 {
-    will_move_cursor();
-    m_col--;
-    if (m_col == 0) {
-        m_row--;
+    // Layers keep their own copy of the content, which the window can't move.
+    for (View* view = this; view; view = view->superview()) {
+        if (view->is_layer_backed()) {
+            return false;
+        }
+    }
+
+    if (!window()) {
+        return false;
     }
-    did_move_cursor();
+
+    auto area = rows_rect(0, m_grid.rows());
+    area.offset_by(frame_in_window().origin());
+    return window()->scroll_area(area, LG::Point<int>(0, lines * glyph_height()));
 }
 
-void TerminalView::put_char(char c)
+void TerminalView::flush_damage()
 {
-    auto pt = pos_on_screen();
-    set_needs_display(LG::Rect(pt.x(), pt.y(), glyph_width(), glyph_height()));
-    m_display_data[pos_in_data()] = c;
+    size_t scrolled_lines = m_grid.scrolled_lines();
+    m_grid.clear_scrolled_lines();
+    if (scrolled_lines && !move_text(-(int)scrolled_lines)) {
+        m_grid.mark_all_dirty();
+    }
+
+    // Runs of dirty rows are invalidated as a single rect.
+    size_t rows = m_grid.rows();
+    for (size_t i = 0; i < rows; i++) {
+        if (!m_grid.is_dirty(i)) {
+            continue;
+        }
+
+        size_t first = i;
+        while (i + 1 < rows && m_grid.is_dirty(i + 1)) {
+            i++;
+        }
+        set_needs_display(rows_rect(first, i - first + 1));
+    }
+    m_grid.clear_dirty();
 }
 
-void TerminalView::push_back_char(char c)
+void TerminalView::mouse_wheel_event(int wheel_data)
 {
-    if (c == '\n') {
-        new_line();
+    int offset = std::max(0, std::min((int)m_scrollback_offset - wheel_data * wheel_lines(), (int)m_grid.history_size()));
+    int lines = offset - (int)m_scrollback_offset;
+    if (!lines) {
         return;
     }
-    put_char(c);
-    increment_counter();
-}
-
-void TerminalView::put_text(const std::string& data)
-{
-    auto current_pos = pos_on_screen();
-    LG::Point<int> top_left_update_location { current_pos.x(), current_pos.y() };
-    LG::Point<int> bottom_right_update_location { current_pos.x(), current_pos.y() };
-    auto set_to_redraw_full_screen = [&]() {
-        data_do_new_line();
-        top_left_update_location = { bounds().min_x(), bounds().min_y() };
-        bottom_right_update_location = { bounds().max_x(), bounds().max_y() };
-    };
-
-    will_move_cursor();
-    int n = data.size();
-    for (int i = 0; i < n; i++) {
-        char c = data[i];
-        if (c == '\n') {
-            auto status = cursor_positions_do_new_line();
-            if (status == DoNewLine) {
-                set_to_redraw_full_screen();
-            }
-        } else {
-            auto pt = pos_on_screen();
-            data_set_char(c);
-            auto status = cursor_position_move_right();
-            if (status == DoNewLine) {
-                set_to_redraw_full_screen();
-            } else {
-                top_left_update_location.set_x(std::min(top_left_update_location.x(), pt.x()));
-                top_left_update_location.set_y(std::min(top_left_update_location.y(), pt.y()));
-                bottom_right_update_location.set_x(std::max(bottom_right_update_location.x(), pt.x() + glyph_width()));
-                bottom_right_update_location.set_y(std::max(bottom_right_update_location.y(), pt.y() + glyph_height()));
-            }
-        }
+
+    m_scrollback_offset = offset;
+    if (!move_text(lines)) {
+        set_needs_display();
+        return;
     }
 
-    auto w = bottom_right_update_location.x() - top_left_update_location.x() + 1;
-    auto h = bottom_right_update_location.y() - top_left_update_location.y() + 1;
-    set_needs_display(LG::Rect(top_left_update_location.x(), top_left_update_location.y(), w, h));
-    did_move_cursor();
+    // The cursor is hidden while the scrollback is shown, its pixels could
+    // have been moved with the text.
+    set_needs_display(rows_rect(m_row, 1));
+    int moved_cursor_row = (int)m_row + lines;
+    if (moved_cursor_row >= 0 && moved_cursor_row < (int)m_grid.rows()) {
+        set_needs_display(rows_rect(moved_cursor_row, 1));
+    }
 }
 
 void TerminalView::send_input()
@@ -202,15 +343,17 @@ void TerminalView::receive_keydown_event(UI::KeyDownEvent& event)
     if (event.key() == LFoundation::Keycode::KEY_BACKSPACE) {
         if (m_input.size()) {
             m_input.pop_back();
-            decrement_counter();
-            put_char(' ');
+            backspace();
+            erase_char();
+            flush_damage();
         }
     } else if (event.key() == LFoundation::Keycode::KEY_RETURN) {
         m_input.push_back('\n');
-        push_back_char('\n');
+        put_text("\n", 1);
         send_input();
     } else if (event.key() < 128) {
-        m_input.push_back(char(event.key()));
-        push_back_char(char(event.key()));
+        char c = char(event.key());
+        m_input.push_back(c);
+        put_text(&c, 1);
     }
 }
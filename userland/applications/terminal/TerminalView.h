@@ -7,15 +7,11 @@
 #pragma once
 
 // includes
+#include "CellGrid.h"
 #include <libg/Font.h>
 #include <libui/View.h>
 #include <string>
 
-enum WindowStatus {
-    Normal,
-    DoNewLine,
-};
-
 class TerminalView : public UI::View {
     UI_OBJECT();
 
@@ -27,58 +23,66 @@ public:
     const LG::Color cursor_color() const { return LG::Color(200, 200, 200, 255); }
     const LG::Color& background_color() const { return m_background_color; }
     inline const LG::Font& font() const { return *m_font_ptr; }
+    inline const LG::Font& bold_font() const { return m_bold_font_ptr ? *m_bold_font_ptr : font(); }
 
     inline int glyph_width() const { return font().glyph_width('.'); }
     inline int glyph_height() const { return font().glyph_height(); }
 
     inline LG::Point<int> pos_on_screen() const { return { (int)m_col * glyph_width() + padding(), (int)m_row * glyph_height() + padding() }; }
-    inline int pos_in_data() const { return m_max_cols * m_row + m_col; }
 
-    void put_char(char c);
-    void put_text(const std::string& data);
+    void put_text(const char* data, size_t size);
+    inline void put_text(const std::string& data) { put_text(data.c_str(), data.size()); }
 
     void display(const LG::Rect& rect) override;
+    void mouse_wheel_event(int wheel_data) override;
     void receive_keyup_event(UI::KeyUpEvent&) override;
     void receive_keydown_event(UI::KeyDownEvent&) override;
 
     int ptmx() const { return m_ptmx; }
 
 private:
-    void terminal_init();
+    enum class ParserState {
+        Normal,
+        Escape,
+        Csi,
+    };
+
+    static constexpr size_t scrollback_lines() { return 2000; }
+    static constexpr int MaxCsiParams = 8;
+    static constexpr int MaxCsiParamValue = 9999;
+    static constexpr int tab_width() { return 8; }
+    static constexpr int wheel_lines() { return 3; }
 
-    WindowStatus cursor_positions_do_new_line();
-    WindowStatus cursor_position_move_right();
-    WindowStatus cursor_position_move_left();
-    void data_do_new_line();
-    inline void data_set_char(char c)
-    {
-        m_display_data[pos_in_data()] = c;
-    }
+    void recalc_dimensions(const LG::Rect&);
+    LG::Color palette_color(uint8_t index, const LG::Color& default_color) const;
 
-    void scroll_line();
+    void feed(char c);
+    void put_char(char c);
     void new_line();
-    void increment_counter();
-    void decrement_counter();
+    void carriage_return();
+    void backspace();
+    void tab();
+    void erase_char();
+    void apply_sgr();
 
-    void recalc_dimensions(const LG::Rect&);
-    void push_back_char(char c);
-    void send_input();
-
-    inline void will_move_cursor()
+    inline Cell blank_cell() const
     {
-        auto pt = pos_on_screen();
-        set_needs_display(LG::Rect(pt.x(), pt.y(), cursor_width() + spacing(), glyph_height()));
+        Cell blank;
+        blank.bg = m_pen.bg;
+        return blank;
     }
 
-    inline void did_move_cursor()
-    {
-        auto pt = pos_on_screen();
-        set_needs_display(LG::Rect(pt.x(), pt.y(), cursor_width() + spacing(), glyph_height()));
-    }
+    // Rows are drawn with the next frame. Scrolled lines are moved by the
+    // window instead of being redrawn.
+    void flush_damage();
+    bool move_text(int lines);
+    inline LG::Rect rows_rect(size_t first, size_t count) const { return LG::Rect(0, padding() + first * glyph_height(), bounds().width(), count * glyph_height()); }
+    void send_input();
 
     LG::Color m_background_color { 0xE9E9EA };
     LG::Color m_font_color { LG::Color::LightSystemText };
     LG::Font* m_font_ptr { LG::Font::load_from_file("/res/fonts/Liza.font/10/regular.font") };
+    LG::Font* m_bold_font_ptr { LG::Font::load_from_file("/res/fonts/Liza.font/10/bold.font") };
 
     constexpr int padding() const { return 2; }
     constexpr int spacing() const { return 2; }
@@ -87,9 +91,14 @@ private:
     int m_ptmx { -1 };
     std::string m_input {};
 
-    size_t m_max_cols { 0 };
-    size_t m_max_rows { 0 };
+    CellGrid m_grid;
+    Cell m_pen {};
     size_t m_col { 0 };
     size_t m_row { 0 };
-    char* m_display_data { nullptr };
-};
\ No newline at end of file
+    size_t m_scrollback_offset { 0 };
+
+    ParserState m_parser_state { ParserState::Normal };
+    int m_csi_params[MaxCsiParams] {};
+    int m_csi_param_count { 0 };
+    bool m_csi_params_dropped { false };
+};
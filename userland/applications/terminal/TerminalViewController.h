@@ -23,10 +23,12 @@ public:
     {
         LFoundation::EventLoop::the().add(
             view().ptmx(), [this] {
-                char text[256];
-                int cnt = read(view().ptmx(), text, 255);
-                text[cnt] = '\0';
-                view().put_text(std::string(text, cnt));
+                // Output is parsed in big chunks, it is drawn once per frame anyway.
+                char text[16 * 1024];
+                int cnt = read(view().ptmx(), text, sizeof(text));
+                if (cnt > 0) {
+                    view().put_text(text, cnt);
+                }
             },
             nullptr);
     }
@@ -0,0 +1,58 @@
+#include "common.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BIGFILE_BENCH_FILE_SIZE (32 * 1024 * 1024)
+#define BIGFILE_BENCH_CHUNK_SIZE (64 * 1024)
+#define BIGFILE_BENCH_RANDOM_SIZE (4 * 1024)
+#define BIGFILE_BENCH_RANDOM_READS 2048
+
+static const char* bigfile_bench_file = "/bigfile_bench";
+static char bigfile_bench_buf[BIGFILE_BENCH_CHUNK_SIZE];
+
+// Reads a file which goes through double indirect blocks, so every lookup
+// of a data block depends on how the block map of the inode is cached.
+void bench_bigfile()
+{
+    int fd = open(bigfile_bench_file, O_CREAT | O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+    for (int written = 0; written < BIGFILE_BENCH_FILE_SIZE; written += BIGFILE_BENCH_CHUNK_SIZE) {
+        if (write(fd, bigfile_bench_buf, BIGFILE_BENCH_CHUNK_SIZE) != BIGFILE_BENCH_CHUNK_SIZE) {
+            close(fd);
+            unlink(bigfile_bench_file);
+            return;
+        }
+    }
+    close(fd);
+
+    RUN_BENCH("BIGFILE SEQ READ 32MB", 3)
+    {
+        int fd = open(bigfile_bench_file, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        while (read(fd, bigfile_bench_buf, BIGFILE_BENCH_CHUNK_SIZE) > 0) { }
+        close(fd);
+    }
+
+    RUN_BENCH("BIGFILE RANDOM READ 4K", 3)
+    {
+        int fd = open(bigfile_bench_file, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        uint32_t seed = 0x6d2b79f5;
+        for (int i = 0; i < BIGFILE_BENCH_RANDOM_READS; i++) {
+            seed = seed * 1103515245 + 12345;
+            int id = (seed >> 8) % (BIGFILE_BENCH_FILE_SIZE / BIGFILE_BENCH_RANDOM_SIZE);
+            lseek(fd, id * BIGFILE_BENCH_RANDOM_SIZE, SEEK_SET);
+            read(fd, bigfile_bench_buf, BIGFILE_BENCH_RANDOM_SIZE);
+        }
+        close(fd);
+    }
+
+    unlink(bigfile_bench_file);
+}
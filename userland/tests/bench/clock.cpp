@@ -0,0 +1,37 @@
+#include "common.h"
+#include <cstdio>
+#include <sysdep.h>
+#include <time.h>
+
+#define CLOCK_BENCH_CALLS 100000
+
+static timespec_t ts;
+
+static void report_ns_per_call(const char* name)
+{
+    int usec = to_usec();
+    printf("[BENCH][%s] %d (usec)\n", name, usec);
+    printf("[BENCH INFO][%s] %d (ns/call)\n", name, usec / (CLOCK_BENCH_CALLS / 1000));
+    fflush(stdout);
+}
+
+void bench_clock()
+{
+    for (int run = 0; run < 3; run++) {
+        gettimeofday(&tv, &tz);
+        for (int i = 0; i < CLOCK_BENCH_CALLS; i++) {
+            DO_SYSCALL_2(SYS_CLOCK_GETTIME, CLOCK_MONOTONIC, &ts);
+        }
+        gettimeofday(&ttv, &tz);
+        report_ns_per_call("CLOCK SYSCALL");
+    }
+
+    for (int run = 0; run < 3; run++) {
+        gettimeofday(&tv, &tz);
+        for (int i = 0; i < CLOCK_BENCH_CALLS; i++) {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+        }
+        gettimeofday(&ttv, &tz);
+        report_ns_per_call("CLOCK VDSO");
+    }
+}
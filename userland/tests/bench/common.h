@@ -18,4 +18,12 @@ static inline int to_usec()
     return sec * 1000000 + diff;
 }
 
-void bench_pngloader();
\ No newline at end of file
+void bench_pngloader();
+void bench_clock();
+void bench_startup();
+void bench_ioring();
+void bench_disk();
+void bench_bigfile();
+void bench_dir();
+void bench_pty();
+void bench_proc();
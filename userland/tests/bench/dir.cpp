@@ -0,0 +1,58 @@
+#include "common.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DIR_BENCH_ENTRIES 10000
+
+static const char* dir_bench_dir = "/dir_bench";
+static char dir_bench_path[64];
+
+static inline const char* dir_bench_entry(int id)
+{
+    sprintf(dir_bench_path, "%s/entry%d", dir_bench_dir, id);
+    return dir_bench_path;
+}
+
+// Every lookup in a dir with thousands of entries scans all of its blocks,
+// unless the dir is indexed.
+void bench_dir()
+{
+    if (mkdir(dir_bench_dir) < 0) {
+        return;
+    }
+
+    int created = 0;
+    RUN_BENCH("DIR CREATE 10K", 1)
+    {
+        for (; created < DIR_BENCH_ENTRIES; created++) {
+            int fd = open(dir_bench_entry(created), O_CREAT | O_RDWR);
+            if (fd < 0) {
+                break;
+            }
+            close(fd);
+        }
+    }
+
+    RUN_BENCH("DIR LOOKUP 10K", 3)
+    {
+        uint32_t seed = 0x2545f491;
+        for (int i = 0; i < created; i++) {
+            seed = seed * 1103515245 + 12345;
+            int fd = open(dir_bench_entry((seed >> 8) % created), O_RDONLY);
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    RUN_BENCH("DIR UNLINK 10K", 1)
+    {
+        for (int i = 0; i < created; i++) {
+            unlink(dir_bench_entry(i));
+        }
+    }
+
+    rmdir(dir_bench_dir);
+}
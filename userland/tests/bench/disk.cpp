@@ -0,0 +1,98 @@
+#include "common.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define DISK_BENCH_FILE_SIZE (1024 * 1024)
+#define DISK_BENCH_CHUNK_SIZE (64 * 1024)
+#define DISK_BENCH_SMALL_SIZE (4 * 1024)
+#define DISK_BENCH_SMALL_COUNT (DISK_BENCH_FILE_SIZE / DISK_BENCH_SMALL_SIZE)
+#define DISK_BENCH_APPEND_SIZE 100
+#define DISK_BENCH_APPEND_COUNT 2000
+
+static const char* disk_bench_file = "/disk_bench";
+static char disk_bench_buf[DISK_BENCH_CHUNK_SIZE];
+
+static void disk_bench_read_small(int fd, bool random)
+{
+    uint32_t seed = 0x2545f491;
+    for (int i = 0; i < DISK_BENCH_SMALL_COUNT; i++) {
+        int id = i;
+        if (random) {
+            seed = seed * 1103515245 + 12345;
+            id = (seed >> 8) % DISK_BENCH_SMALL_COUNT;
+        }
+        lseek(fd, id * DISK_BENCH_SMALL_SIZE, SEEK_SET);
+        read(fd, disk_bench_buf, DISK_BENCH_SMALL_SIZE);
+    }
+}
+
+// Measures throughput of the storage driver with large sequential requests,
+// which let the filesystem pass many contiguous sectors to the driver at once.
+void bench_disk()
+{
+    for (int i = 0; i < DISK_BENCH_CHUNK_SIZE; i++) {
+        disk_bench_buf[i] = (char)i;
+    }
+
+    RUN_BENCH("DISK WRITE 1MB", 3)
+    {
+        int fd = open(disk_bench_file, O_CREAT | O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+        for (int written = 0; written < DISK_BENCH_FILE_SIZE; written += DISK_BENCH_CHUNK_SIZE) {
+            write(fd, disk_bench_buf, DISK_BENCH_CHUNK_SIZE);
+        }
+        close(fd);
+    }
+
+    RUN_BENCH("DISK READ 1MB", 3)
+    {
+        int fd = open(disk_bench_file, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        while (read(fd, disk_bench_buf, DISK_BENCH_CHUNK_SIZE) > 0) { }
+        close(fd);
+    }
+
+    // Small requests show how well the block layer sorts and merges them.
+    RUN_BENCH("DISK SEQ READ 4K", 3)
+    {
+        int fd = open(disk_bench_file, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        disk_bench_read_small(fd, false);
+        close(fd);
+    }
+
+    RUN_BENCH("DISK RANDOM READ 4K", 3)
+    {
+        int fd = open(disk_bench_file, O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        disk_bench_read_small(fd, true);
+        close(fd);
+    }
+
+    unlink(disk_bench_file);
+
+    // A log-like stream of small appends, which are gathered in memory by the
+    // filesystem and reach the drive as a few writes of consecutive blocks.
+    RUN_BENCH("DISK SMALL APPENDS", 3)
+    {
+        int fd = open(disk_bench_file, O_CREAT | O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+        for (int i = 0; i < DISK_BENCH_APPEND_COUNT; i++) {
+            write(fd, disk_bench_buf, DISK_BENCH_APPEND_SIZE);
+        }
+        fsync(fd);
+        close(fd);
+        unlink(disk_bench_file);
+    }
+}
@@ -0,0 +1,59 @@
+#include "common.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <libfoundation/IORing.h>
+#include <unistd.h>
+
+#define IORING_BENCH_ROUNDS 100
+#define IORING_BENCH_BATCH 32
+#define IORING_BENCH_WRITE_SIZE 16
+
+static const char* ioring_bench_file = "/ioring_bench";
+static char ioring_bench_buf[IORING_BENCH_WRITE_SIZE];
+
+// Both variants do the same IORING_BENCH_BATCH writes per round, the second one
+// passes them to the kernel with a single syscall.
+void bench_ioring()
+{
+    RUN_BENCH("IORING WRITES", 3)
+    {
+        int fd = open(ioring_bench_file, O_CREAT | O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+        for (int round = 0; round < IORING_BENCH_ROUNDS; round++) {
+            for (int i = 0; i < IORING_BENCH_BATCH; i++) {
+                write(fd, ioring_bench_buf, IORING_BENCH_WRITE_SIZE);
+            }
+        }
+        close(fd);
+    }
+
+    LFoundation::IORing ring;
+    int failed = 0;
+    RUN_BENCH("IORING BATCHED", 3)
+    {
+        int fd = open(ioring_bench_file, O_CREAT | O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+        for (int round = 0; round < IORING_BENCH_ROUNDS; round++) {
+            for (int i = 0; i < IORING_BENCH_BATCH; i++) {
+                ring.write(fd, ioring_bench_buf, IORING_BENCH_WRITE_SIZE, [&failed](int res, uint8_t*) {
+                    if (res != IORING_BENCH_WRITE_SIZE) {
+                        failed++;
+                    }
+                });
+            }
+            ring.submit(IORING_BENCH_BATCH);
+            ring.reap();
+        }
+        close(fd);
+    }
+
+    if (failed) {
+        printf("[BENCH INFO][IORING BATCHED] %d writes failed\n", failed);
+        fflush(stdout);
+    }
+    unlink(ioring_bench_file);
+}
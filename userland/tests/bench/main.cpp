@@ -31,6 +31,14 @@ void bench_kernel()
 int main(int argc, char** argv)
 {
     bench_kernel();
+    bench_proc();
+    bench_clock();
+    bench_startup();
+    bench_ioring();
+    bench_disk();
+    bench_bigfile();
+    bench_dir();
+    bench_pty();
     bench_pngloader();
     printf("[BENCH END]\n\n");
     fflush(stdout);
@@ -0,0 +1,70 @@
+#include "common.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#define PROC_BENCH_CHILDREN 256
+#define PROC_BENCH_LOOKUPS 20000
+#define PROC_BENCH_FAULT_PAGES 256
+#define PROC_BENCH_PAGE_SIZE 4096
+#define PROC_BENCH_SIGKILL 9
+
+static int proc_bench_pids[PROC_BENCH_CHILDREN];
+
+// Every lookup, kill and user page fault goes through the kernel proc
+// registry, so these are timed with a few hundred processes alive.
+void bench_proc()
+{
+    int children = 0;
+    for (; children < PROC_BENCH_CHILDREN; children++) {
+        int pid = fork();
+        if (pid < 0) {
+            break;
+        }
+        if (pid == 0) {
+            // select() without fds and timeout blocks until a signal, so
+            // the child sleeps until it is killed.
+            for (;;) {
+                select(0, nullptr, nullptr, nullptr, nullptr);
+            }
+        }
+        proc_bench_pids[children] = pid;
+    }
+    if (!children) {
+        return;
+    }
+    printf("[BENCH INFO][PROC] %d live children\n", children);
+    fflush(stdout);
+
+    RUN_BENCH("PROC LOOKUP", 3)
+    {
+        for (int i = 0; i < PROC_BENCH_LOOKUPS; i++) {
+            getpgid(proc_bench_pids[(i * 7) % children]);
+        }
+    }
+
+    RUN_BENCH("PAGE FAULTS", 3)
+    {
+        size_t len = PROC_BENCH_FAULT_PAGES * PROC_BENCH_PAGE_SIZE;
+        char* mem = (char*)mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        // Errors come back as a negative errno.
+        if ((uintptr_t)mem < (uintptr_t)-4096) {
+            for (size_t off = 0; off < len; off += PROC_BENCH_PAGE_SIZE) {
+                mem[off] = 1;
+            }
+            munmap(mem, len);
+        }
+    }
+
+    RUN_BENCH("KILL WAITPID", 1)
+    {
+        for (int i = 0; i < children; i++) {
+            kill(proc_bench_pids[i], PROC_BENCH_SIGKILL);
+            wait(proc_bench_pids[i]);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define PTY_BENCH_SIZE (4 * 1024 * 1024)
+#define PTY_BENCH_CHUNK_SIZE (16 * 1024)
+#define PTY_BENCH_COALESCE_MS 16
+
+static char pty_bench_buf[PTY_BENCH_CHUNK_SIZE];
+
+static int pty_bench_voluntary_switches()
+{
+    char path[32];
+    char stat[384] = {};
+    snprintf(path, sizeof(path), "/proc/%d/stat", getpid());
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+
+    int threads = 0, user_ticks = 0, system_ticks = 0, voluntary_switches = 0;
+    sscanf(stat, "threads %d\nuser_ticks %d\nsystem_ticks %d\nvoluntary_switches %d\n", &threads, &user_ticks, &system_ticks, &voluntary_switches);
+    return voluntary_switches;
+}
+
+// A child writes PTY_BENCH_SIZE bytes to the slave side as fast as it can,
+// like `cat` of a big file does, while the benchmark reads the master side.
+// Every time the reader goes to sleep waiting for output is counted as a
+// wakeup.
+static void pty_bench_run(const char* name, int coalesce_ms)
+{
+    int ptmx = posix_openpt(O_RDONLY);
+    if (ptmx < 0) {
+        return;
+    }
+    ioctl(ptmx, PTY_SET_COALESCE, coalesce_ms);
+    int buffer_size = ioctl(ptmx, PTY_GET_BUFFER_SIZE, 0);
+
+    int start_switches = pty_bench_voluntary_switches();
+    gettimeofday(&tv, &tz);
+
+    int pid = fork();
+    if (pid < 0) {
+        close(ptmx);
+        return;
+    }
+    if (pid == 0) {
+        int pts = open(ptsname(ptmx), O_WRONLY);
+        if (pts < 0) {
+            exit(1);
+        }
+        for (int written = 0; written < PTY_BENCH_SIZE; written += PTY_BENCH_CHUNK_SIZE) {
+            write(pts, pty_bench_buf, PTY_BENCH_CHUNK_SIZE);
+        }
+        exit(0);
+    }
+
+    int reads = 0;
+    for (int total = 0; total < PTY_BENCH_SIZE;) {
+        int res = read(ptmx, pty_bench_buf, PTY_BENCH_CHUNK_SIZE);
+        if (res <= 0) {
+            break;
+        }
+        total += res;
+        reads++;
+    }
+
+    gettimeofday(&ttv, &tz);
+    int wakeups = pty_bench_voluntary_switches() - start_switches;
+    wait(pid);
+    close(ptmx);
+
+    int usec = to_usec();
+    if (usec <= 0) {
+        usec = 1;
+    }
+    int mb = PTY_BENCH_SIZE / (1024 * 1024);
+    printf("[BENCH][%s] %d (MB/s)\n", name, (int)((long long)PTY_BENCH_SIZE * 1000000 / usec / (1024 * 1024)));
+    printf("[BENCH][%s WAKEUPS] %d (wakeups/MB)\n", name, wakeups / mb);
+    printf("[BENCH INFO][%s] %d reads, %d bytes buffer, %d ms coalesce window\n", name, reads, buffer_size, coalesce_ms);
+    fflush(stdout);
+}
+
+void bench_pty()
+{
+    for (int run = 0; run < 3; run++) {
+        pty_bench_run("PTY THROUGHPUT", 0);
+    }
+    for (int run = 0; run < 3; run++) {
+        pty_bench_run("PTY COALESCED", PTY_BENCH_COALESCE_MS);
+    }
+}
@@ -0,0 +1,45 @@
+#include "common.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// Apps are started with --startup-probe, so libui's main reports the time
+// from execve() to main() and resident pages, and exits right away. libui
+// handles the flag only in BENCHMARK builds, the ones which run the bench.
+// The time is taken in the child right before execve(), so fork and exit
+// of the app are not counted.
+static const char* startup_apps[][2] = {
+    { "STARTUP ABOUT", "/Applications/about.app/Content/about" },
+    { "STARTUP ACTIVITY MONITOR", "/Applications/activity_monitor.app/Content/activity_monitor" },
+    { "STARTUP CALCULATOR", "/Applications/calculator.app/Content/calculator" },
+    { "STARTUP TERMINAL", "/Applications/terminal.app/Content/terminal" },
+};
+
+#define STARTUP_BENCH_RUNS 3
+
+void bench_startup()
+{
+    for (int app = 0; app < sizeof(startup_apps) / sizeof(startup_apps[0]); app++) {
+        const char* name = startup_apps[app][0];
+        const char* path = startup_apps[app][1];
+        for (int run = 0; run < STARTUP_BENCH_RUNS; run++) {
+            int pid = fork();
+            if (pid < 0) {
+                return;
+            }
+            if (pid) {
+                wait(pid);
+                continue;
+            }
+
+            char exec_sec[16], exec_usec[16];
+            timeval_t exec_tv;
+            gettimeofday(&exec_tv, &tz);
+            snprintf(exec_sec, sizeof(exec_sec), "%d", (int)exec_tv.tv_sec);
+            snprintf(exec_usec, sizeof(exec_usec), "%d", (int)exec_tv.tv_usec);
+            char* argv[] = { (char*)path, (char*)"--startup-probe", (char*)name, exec_sec, exec_usec, nullptr };
+            execve(path, argv, nullptr);
+            exit(1);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "bench.h"
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define HASH_BENCH_KEYS 20000
+#define HASH_BENCH_LOOKUPS 4
+
+// Keys are spread like ids and addresses are, not sequential.
+static std::vector<int> hash_bench_keys()
+{
+    std::vector<int> keys;
+    uint32_t seed = 12345;
+    for (int i = 0; i < HASH_BENCH_KEYS; i++) {
+        seed = seed * 1103515245 + 12345;
+        keys.push_back((int)(seed >> 1));
+    }
+    return keys;
+}
+
+void bench_hash()
+{
+    auto keys = hash_bench_keys();
+    int checksum = 0;
+
+    std::map<int, int> map;
+    RUN_BENCH("MAP INSERT")
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            map[keys[i]] = i;
+        }
+    }
+    RUN_BENCH("MAP LOOKUP")
+    {
+        for (int round = 0; round < HASH_BENCH_LOOKUPS; round++) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                checksum += map[keys[i]];
+            }
+        }
+    }
+
+    std::unordered_map<int, int> unordered_map;
+    RUN_BENCH("UNORDERED MAP INSERT")
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            unordered_map[keys[i]] = i;
+        }
+    }
+    RUN_BENCH("UNORDERED MAP LOOKUP")
+    {
+        for (int round = 0; round < HASH_BENCH_LOOKUPS; round++) {
+            for (size_t i = 0; i < keys.size(); i++) {
+                checksum -= unordered_map.find(keys[i])->second;
+            }
+        }
+    }
+    RUN_BENCH("UNORDERED MAP MISS")
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            checksum += unordered_map.count(keys[i] + 1);
+        }
+    }
+
+    std::vector<std::string> names;
+    char name[32];
+    for (size_t i = 0; i < keys.size(); i++) {
+        snprintf(name, sizeof(name), "window_%d", keys[i]);
+        names.push_back(std::string(name));
+    }
+    std::unordered_set<std::string> name_set;
+    RUN_BENCH("UNORDERED SET STRING INSERT")
+    {
+        for (size_t i = 0; i < names.size(); i++) {
+            name_set.insert(names[i]);
+        }
+    }
+    RUN_BENCH("UNORDERED SET STRING LOOKUP")
+    {
+        for (size_t i = 0; i < names.size(); i++) {
+            checksum += name_set.contains(names[i]);
+        }
+    }
+
+    printf("[BENCH INFO][HASH] %d keys, %d lookup rounds, %u map / %u unordered_map / %u set elements, %u buckets, checksum %d\n",
+        HASH_BENCH_KEYS, HASH_BENCH_LOOKUPS, (unsigned)map.size(), (unsigned)unordered_map.size(), (unsigned)name_set.size(), (unsigned)unordered_map.bucket_count(), checksum);
+    fflush(stdout);
+}
@@ -0,0 +1,75 @@
+#include "bench.h"
+#include <memory>
+#include <string>
+
+#define STRING_BENCH_ROUNDS 1000
+
+static int string_bench_allocations = 0;
+
+template <class T>
+struct counting_allocator : public std::allocator<T> {
+    T* allocate(size_t n)
+    {
+        string_bench_allocations++;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+using counted_string = std::basic_string<char, std::char_traits<char>, counting_allocator<char>>;
+
+static const char* string_bench_titles[] = { "OK", "Cancel", "Terminal", "Calculator", "Activity Monitor", "About" };
+static int string_bench_sink = 0;
+
+// Each path runs STRING_BENCH_ROUNDS times and reports the allocations done
+// per run. Strings are built the way views and apps build them.
+#define RUN_STRING_BENCH(name, body)                                                                         \
+    {                                                                                                        \
+        string_bench_allocations = 0;                                                                        \
+        RUN_BENCH(name)                                                                                      \
+        {                                                                                                    \
+            for (int round = 0; round < STRING_BENCH_ROUNDS; round++) {                                      \
+                body                                                                                         \
+            }                                                                                                \
+        }                                                                                                    \
+        printf("[BENCH][%s ALLOCS] %d (allocs/1000 runs)\n", name, string_bench_allocations);            \
+        fflush(stdout);                                                                                      \
+    }
+
+void bench_string()
+{
+    // A label gets a short title, the view keeps a copy of it.
+    RUN_STRING_BENCH("STRING LABEL TITLE", {
+        counted_string title(string_bench_titles[round % 6]);
+        counted_string copy = title;
+        string_bench_sink += copy.size();
+    });
+
+    // A number is formatted for a label, like the calculator does.
+    RUN_STRING_BENCH("STRING NUMBER", {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d", round * 37);
+        counted_string text(buf);
+        string_bench_sink += text.size();
+    });
+
+    // A resource path is made of a few parts.
+    RUN_STRING_BENCH("STRING PATH CONCAT", {
+        counted_string name(string_bench_titles[round % 6]);
+        counted_string path = counted_string("/res/icons/apps/") + name + "/" + name + ".icon";
+        string_bench_sink += path.size();
+    });
+
+    // Typed characters are collected, like the terminal collects its input line.
+    RUN_STRING_BENCH("STRING INPUT LINE", {
+        counted_string input;
+        for (int i = 0; i < 40; i++) {
+            input.push_back('a' + i % 26);
+        }
+        input.clear();
+        input.push_back('\n');
+        string_bench_sink += input.size();
+    });
+
+    printf("[BENCH INFO][STRING] %d bytes inline, sink %d\n", (int)counted_string().capacity(), string_bench_sink);
+    fflush(stdout);
+}
@@ -1,3 +1,4 @@
+#include "bench.h"
 #include <functional>
 #include <iostream>
 #include <map>
@@ -18,4 +19,8 @@ int main()
     printf("Result: %d", a.size());
     printf("Result: %d", a[10]);
     printf("Result: %d", a.size());
+    printf("\n");
+
+    bench_hash();
+    bench_string();
 }
\ No newline at end of file
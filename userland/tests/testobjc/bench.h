@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+static inline int bench_now_usec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#define RUN_BENCH(name)                                                                \
+    for (int __bench_start = bench_now_usec(), __bench_once = 1; __bench_once;         \
+         printf("[BENCH][%s] %d (usec)\n", name, bench_now_usec() - __bench_start), \
+             fflush(stdout), __bench_once = 0)
+
+void bench_msgsend();
@@ -0,0 +1,95 @@
+#include "bench.h"
+#include <libfoundation/NSObject.h>
+#include <libobjc/class.h>
+#include <libobjc/selector.h>
+
+#define MSGSEND_BENCH_SENDS 1000000
+#define MSGSEND_BENCH_LOOKUPS 100000
+
+@interface BenchBase : NSObject {
+@public
+    int counter;
+}
+- (void)increment;
++ (int)classValue;
+@end
+
+@implementation BenchBase
+
+- (void)increment
+{
+    counter++;
+}
+
++ (int)classValue
+{
+    return 1;
+}
+
+@end
+
+// The methods are inherited, so a send which misses the method cache has to
+// walk the hierarchy.
+@interface BenchDerived : BenchBase
+@end
+
+@implementation BenchDerived
+@end
+
+@interface BenchLeaf : BenchDerived
+@end
+
+@implementation BenchLeaf
+@end
+
+static int __attribute__((noinline)) msgsend_bench_function(int* counter)
+{
+    return ++(*counter);
+}
+
+void bench_msgsend()
+{
+    BenchLeaf* leaf = [[BenchLeaf alloc] init];
+    int checksum = 0;
+
+    RUN_BENCH("C CALL")
+    {
+        for (int i = 0; i < MSGSEND_BENCH_SENDS; i++) {
+            msgsend_bench_function(&checksum);
+        }
+    }
+    RUN_BENCH("MSGSEND INSTANCE")
+    {
+        for (int i = 0; i < MSGSEND_BENCH_SENDS; i++) {
+            [leaf increment];
+        }
+    }
+    RUN_BENCH("MSGSEND CLASS")
+    {
+        for (int i = 0; i < MSGSEND_BENCH_SENDS; i++) {
+            checksum += [BenchLeaf classValue];
+        }
+    }
+    RUN_BENCH("MSGSEND NIL")
+    {
+        BenchLeaf* nil_leaf = (BenchLeaf*)nil;
+        for (int i = 0; i < MSGSEND_BENCH_SENDS; i++) {
+            [nil_leaf increment];
+        }
+    }
+    RUN_BENCH("CLASS LOOKUP")
+    {
+        for (int i = 0; i < MSGSEND_BENCH_LOOKUPS; i++) {
+            checksum += objc_getClass("BenchLeaf") != Nil;
+        }
+    }
+    RUN_BENCH("SELECTOR LOOKUP")
+    {
+        for (int i = 0; i < MSGSEND_BENCH_LOOKUPS; i++) {
+            checksum += sel_registerName("increment") != NULL;
+        }
+    }
+
+    printf("[BENCH INFO][MSGSEND] %d sends, checksum %d\n", leaf->counter, checksum);
+    fflush(stdout);
+}
@@ -1,3 +1,4 @@
+#include "bench.h"
 #include <libfoundation/NSObject.h>
 #include <libobjc/helpers.h>
 #include <stdio.h>
@@ -37,5 +38,8 @@ int main()
     [objectAlloc sampleMethod:22];
     [SampleClass sampleMethod];
     printf("Last called with %d", [objectAlloc get_last]);
+    printf("\n");
+
+    bench_msgsend();
     return 0;
 }
\ No newline at end of file
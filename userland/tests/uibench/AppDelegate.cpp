@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "ViewController.h"
+#include <libui/AppDelegate.h>
+
+class AppDelegate : public UI::AppDelegate {
+public:
+    AppDelegate() = default;
+    virtual ~AppDelegate() = default;
+
+    LG::Size preferred_desktop_window_size() const override { return LG::Size(640, 480); }
+
+    virtual bool application() override
+    {
+        auto& window = std::pranaos::construct<UI::Window>(window_size(), icon_path());
+        auto& superview = window.create_superview<UI::View, ViewController>();
+
+        window.set_title("UI Bench");
+        return true;
+    }
+
+private:
+};
+
+SET_APP_DELEGATE(AppDelegate);
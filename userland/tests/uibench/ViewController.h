@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2021, Krisna Pranav
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <libui/App.h>
+#include <libui/Connection.h>
+#include <libui/Label.h>
+#include <libui/StackView.h>
+#include <libui/TextView.h>
+#include <libui/View.h>
+#include <libui/ViewController.h>
+#include <libui/Window.h>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+// Runs three benchmarks, one after another, in the same window.
+//
+// UI DAMAGE moves a small widget over a big window, so each frame damages
+// only a few rects. The widget holds a label, which is cached in a layer once
+// the widget keeps moving without changing. Reports the cpu time the client
+// has spent and the time the window server has spent composing frames while
+// the widget was moving.
+//
+// UI SCROLL scrolls a text view with a long text. Reports frames per second
+// and the pixels drawn and moved per frame.
+//
+// UI LAYOUT changes labels deep in nested stack views and resizes the
+// outermost stack view, like a window resize does. Reports how many views
+// are laid out again per change.
+class ViewController : public UI::ViewController<UI::View> {
+public:
+    static constexpr int frames() { return 300; }
+    static constexpr int step() { return 4; }
+    static constexpr int text_lines() { return 10000; }
+    static constexpr int scroll_step() { return 2; }
+    static constexpr int stack_depth() { return 5; }
+    static constexpr int stack_fanout() { return 3; }
+    static constexpr int resize_every() { return 10; }
+
+    ViewController(UI::View& view)
+        : UI::ViewController<UI::View>(view)
+    {
+    }
+    virtual ~ViewController() = default;
+
+    void view_did_load() override
+    {
+        view().set_background_color(LG::Color::LightSystemBackground);
+
+        auto& widget = view().add_subview<UI::View>(LG::Rect(0, 100, 96, 32));
+        widget.set_background_color(LG::Color::Blue);
+        auto& label = widget.add_subview<UI::Label>(LG::Rect(8, 8, 80, 16));
+        label.set_text("uibench");
+        label.set_text_color(LG::Color::White);
+        m_widget = &widget;
+
+        auto& text_view = view().add_subview<UI::TextView>(LG::Rect(0, 160, view().bounds().width(), view().bounds().height() - 160));
+        text_view.set_text(long_text());
+        m_text_view = &text_view;
+
+        auto& stack_view = view().add_subview<UI::StackView>(LG::Rect(0, 0, view().bounds().width(), 96));
+        stack_view.set_distribution(UI::StackView::Distribution::FillEqually);
+        fill_stack(stack_view, stack_depth());
+        stack_view.set_needs_layout();
+        m_stack_view = &stack_view;
+
+        m_start_ticks = client_ticks();
+        m_start_stats = server_stats();
+
+        UI::App::the().event_loop().add(LFoundation::Timer([&] {
+            if (m_stage == Stage::Damage) {
+                move_widget();
+            } else if (m_stage == Stage::Scroll) {
+                scroll_text();
+            } else if (m_stage == Stage::Layout) {
+                change_layout();
+            }
+        },
+            1000 / 60, LFoundation::Timer::Repeat));
+    }
+
+private:
+    enum class Stage {
+        Damage,
+        Scroll,
+        Layout,
+        Done,
+    };
+
+    void move_widget()
+    {
+        auto old_frame = m_widget->frame();
+        m_widget->frame().offset_by(step(), 0);
+        if (m_widget->frame().max_x() >= view().bounds().width()) {
+            m_widget->frame().set_x(0);
+        }
+        view().set_needs_display(old_frame);
+        view().set_needs_display(m_widget->frame());
+
+        if (++m_frame == frames()) {
+            report_damage();
+            start_scroll();
+        }
+    }
+
+    void start_scroll()
+    {
+        auto& window = UI::App::the().window();
+        m_frame = 0;
+        m_start_frames = window.frames_drawn();
+        m_start_pixels_drawn = window.pixels_drawn();
+        m_start_pixels_moved = window.pixels_moved();
+        m_start_ms = now_ms();
+        m_stage = Stage::Scroll;
+    }
+
+    void scroll_text()
+    {
+        m_text_view->mouse_wheel_event(scroll_step());
+        if (++m_frame == frames()) {
+            report_scroll();
+            start_layout();
+        }
+    }
+
+    void fill_stack(UI::StackView& stack, int depth)
+    {
+        bool horizontal = stack.axis() == UI::LayoutConstraints::Axis::Horizontal;
+        for (int i = 0; i < stack_fanout(); i++) {
+            if (depth == 1) {
+                auto& label = stack.add_arranged_subview<UI::Label>();
+                label.set_text("0");
+                label.set_width(label.preferred_width());
+                label.set_height(12);
+                m_labels.push_back(&label);
+                continue;
+            }
+
+            auto& child = stack.add_arranged_subview<UI::StackView>();
+            child.set_axis(horizontal ? UI::LayoutConstraints::Axis::Vertical : UI::LayoutConstraints::Axis::Horizontal);
+            child.set_distribution(UI::StackView::Distribution::FillEqually);
+            auto cross_axis = horizontal ? UI::Constraint::Attribute::Height : UI::Constraint::Attribute::Width;
+            stack.add_constraint(UI::Constraint(child, cross_axis, UI::Constraint::Relation::Equal, stack, cross_axis, 1, 0));
+            fill_stack(child, depth - 1);
+        }
+    }
+
+    void start_layout()
+    {
+        auto& window = UI::App::the().window();
+        m_frame = 0;
+        m_last_laid_out = window.views_laid_out();
+        m_stage = Stage::Layout;
+    }
+
+    void change_layout()
+    {
+        // Views laid out since the last tick are counted to the change made then.
+        auto& window = UI::App::the().window();
+        uint32_t laid_out = window.views_laid_out() - m_last_laid_out;
+        m_last_laid_out = window.views_laid_out();
+        if (m_frame > 0) {
+            if (m_last_change_was_resize) {
+                m_resize_laid_out += laid_out, m_resizes++;
+            } else {
+                m_text_laid_out += laid_out, m_text_changes++;
+            }
+        }
+
+        if (m_frame == frames()) {
+            report_layout();
+            finish();
+            return;
+        }
+
+        m_last_change_was_resize = (m_frame % resize_every() == 0);
+        if (m_last_change_was_resize) {
+            int width = view().bounds().width() - (m_frame / resize_every() % 2) * 64;
+            m_stack_view->set_width(width);
+        } else {
+            auto* label = m_labels[m_frame % m_labels.size()];
+            char text[16];
+            snprintf(text, sizeof(text), "%d", m_frame);
+            label->set_text(std::string(text));
+            label->set_width(label->preferred_width());
+        }
+        m_frame++;
+    }
+
+    std::string long_text()
+    {
+        std::string text;
+        char line[64];
+        for (int i = 0; i < text_lines(); i++) {
+            snprintf(line, sizeof(line), "%05d The quick brown fox jumps over the lazy dog\n", i);
+            text += std::string(line);
+        }
+        return text;
+    }
+
+    int now_ms()
+    {
+        std::timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    int client_ticks()
+    {
+        char path[32];
+        char stat[384] = {};
+        snprintf(path, sizeof(path), "/proc/%d/stat", getpid());
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            return 0;
+        }
+        read(fd, stat, sizeof(stat) - 1);
+        close(fd);
+
+        int threads = 0, user_ticks = 0, system_ticks = 0;
+        sscanf(stat, "threads %d\nuser_ticks %d\nsystem_ticks %d\n", &threads, &user_ticks, &system_ticks);
+        return user_ticks + system_ticks;
+    }
+
+    std::unique_ptr<GetFrameStatsMessageReply> server_stats()
+    {
+        auto& connection = UI::Connection::the();
+        return connection.send_sync_message<GetFrameStatsMessageReply>(GetFrameStatsMessage(connection.key()));
+    }
+
+    void report_damage()
+    {
+        int ticks = client_ticks() - m_start_ticks;
+        auto stats = server_stats();
+        printf("[BENCH][UI DAMAGE CLIENT] %d (ticks)\n", ticks);
+        if (stats && m_start_stats) {
+            printf("[BENCH][UI DAMAGE SERVER] %d (usec)\n", stats->busy_usec() - m_start_stats->busy_usec());
+            printf("[BENCH INFO][UI DAMAGE] %d moves, %d frames composed, widget layer %s\n", frames(), stats->frames() - m_start_stats->frames(), m_widget->is_layer_backed() ? "on" : "off");
+        }
+        fflush(stdout);
+    }
+
+    void report_scroll()
+    {
+        auto& window = UI::App::the().window();
+        int elapsed_ms = std::max(1, now_ms() - m_start_ms);
+        uint32_t frames_drawn = std::max(1u, window.frames_drawn() - m_start_frames);
+        uint32_t pixels_drawn = (window.pixels_drawn() - m_start_pixels_drawn) / frames_drawn;
+        uint32_t pixels_moved = (window.pixels_moved() - m_start_pixels_moved) / frames_drawn;
+        printf("[BENCH][UI SCROLL FPS] %d (fps)\n", (int)(frames_drawn * 1000 / elapsed_ms));
+        printf("[BENCH][UI SCROLL DRAWN] %u (pixels/frame)\n", pixels_drawn);
+        printf("[BENCH][UI SCROLL MOVED] %u (pixels/frame)\n", pixels_moved);
+        printf("[BENCH INFO][UI SCROLL] %d lines, %d steps, %u frames drawn\n", text_lines(), frames(), frames_drawn);
+        fflush(stdout);
+    }
+
+    void report_layout()
+    {
+        auto& window = UI::App::the().window();
+        printf("[BENCH][UI LAYOUT TEXT] %u (views/change)\n", m_text_laid_out / std::max(1u, m_text_changes));
+        printf("[BENCH][UI LAYOUT RESIZE] %u (views/change)\n", m_resize_laid_out / std::max(1u, m_resizes));
+        printf("[BENCH INFO][UI LAYOUT] %d labels, depth %d, %u text changes, %u resizes, %u passes in total\n", (int)m_labels.size(), stack_depth(), m_text_changes, m_resizes, window.layout_passes());
+        fflush(stdout);
+    }
+
+    void finish()
+    {
+        m_stage = Stage::Done;
+        auto& connection = UI::Connection::the();
+        connection.send_sync_message<DestroyWindowMessageReply>(DestroyWindowMessage(connection.key(), UI::App::the().window().id()));
+        UI::App::the().event_loop().stop(0);
+    }
+
+    Stage m_stage { Stage::Damage };
+    UI::View* m_widget { nullptr };
+    UI::TextView* m_text_view { nullptr };
+    UI::StackView* m_stack_view { nullptr };
+    std::vector<UI::Label*> m_labels;
+    int m_frame { 0 };
+    int m_start_ticks { 0 };
+    std::unique_ptr<GetFrameStatsMessageReply> m_start_stats;
+
+    int m_start_ms { 0 };
+    uint32_t m_start_frames { 0 };
+    uint64_t m_start_pixels_drawn { 0 };
+    uint64_t m_start_pixels_moved { 0 };
+
+    uint32_t m_last_laid_out { 0 };
+    bool m_last_change_was_resize { false };
+    uint32_t m_text_laid_out { 0 };
+    uint32_t m_text_changes { 0 };
+    uint32_t m_resize_laid_out { 0 };
+    uint32_t m_resizes { 0 };
+};
@@ -114,7 +114,7 @@ class Generator:
             params_str = params_str[:-2]
         for i in msg.params:
             self.out(
-                "Encoder::decode(buf, decoded_msg_len, var_{0});".format(i[1]), offset)
+                "Encoder::decode(buf, decoded_msg_len, size, var_{0});".format(i[1]), offset)
         self.out("return new {0}({1});".format(msg.name, params_str), offset)
 
     def decoder_create_std_funcs(self, decoder):
@@ -207,6 +207,7 @@ class Generator:
         self.out("#include <libipc/ClientConnection.h>")
         self.out("#include <libipc/ServerConnection.h>")
         self.out("#include <libg/Rect.h>")
+        self.out("#include <libg/RectList.h>")
         self.out("#include <libg/string.h>")
         self.out("#include <new>")
         self.out("")
@@ -0,0 +1,164 @@
+# Converts a dump of /dev/ktrace into the Chrome trace event format, which
+# could be opened with chrome://tracing or https://ui.perfetto.dev.
+#
+# To get a dump, write '1' to /dev/ktrace to start tracing, run the workload,
+# write '0' to stop it and copy /dev/ktrace to a file.
+#
+# Usage: python3 ktrace2json.py <dump> [output.json]
+
+import json
+import os
+import re
+import struct
+import sys
+
+KTRACE_MAGIC = 0x4352544b
+HEADER_FORMAT = "<IIIIQQII"
+CPU_HEADER_FORMAT = "<II"
+EVENT_FORMAT = "<QHHIII"
+
+EVENT_NONE = 0
+EVENT_SCHED_SWITCH = 1
+EVENT_SCHED_WAKEUP = 2
+EVENT_SYSCALL_ENTER = 3
+EVENT_SYSCALL_EXIT = 4
+EVENT_PAGE_FAULT = 5
+EVENT_BIO_SUBMIT = 6
+EVENT_BIO_COMPLETE = 7
+EVENT_IPC_SEND = 8
+EVENT_IPC_RECEIVE = 9
+
+# Tracks which are not bound to a process.
+CPU_TRACK_PID = 100000
+BIO_TRACK_PID = 100001
+
+
+def load_syscall_names():
+    header = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "../../kernel/include/libkern/bits/syscalls.h")
+    names = {}
+    try:
+        with open(header) as f:
+            body = f.read()
+    except OSError:
+        return names
+
+    enum = body[body.find("enum __sysid"):]
+    enum = enum[enum.find("{") + 1:enum.find("}")]
+    for sysid, name in enumerate(re.findall(r"SYS_(\w+)", enum)):
+        names[sysid] = name.lower()
+    return names
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, cpus, events_per_cpu, ticks_per_second, start_ts, now_ts, start_ticks, now_ticks = struct.unpack_from(
+        HEADER_FORMAT, data, 0)
+    if magic != KTRACE_MAGIC:
+        sys.exit("{0}: not a ktrace dump".format(path))
+
+    if now_ticks <= start_ticks:
+        sys.exit("{0}: trace is too short to calibrate the clock".format(path))
+    freq = (now_ts - start_ts) * ticks_per_second / (now_ticks - start_ticks)
+
+    event_size = struct.calcsize(EVENT_FORMAT)
+    cpu_header_size = struct.calcsize(CPU_HEADER_FORMAT)
+    offset = header_size
+    events = []
+    for cpu in range(cpus):
+        head, _ = struct.unpack_from(CPU_HEADER_FORMAT, data, offset)
+        offset += cpu_header_size
+        for i in range(min(head, events_per_cpu)):
+            event = struct.unpack_from(EVENT_FORMAT, data, offset + i * event_size)
+            if event[1] != EVENT_NONE:
+                events.append(event)
+        offset += events_per_cpu * event_size
+
+    events.sort(key=lambda e: e[0])
+    return events, start_ts, freq
+
+
+def to_usec(ts, start_ts, freq):
+    return (ts - start_ts) * 1000000.0 / freq
+
+
+def convert(events, start_ts, freq):
+    syscall_names = load_syscall_names()
+    trace = []
+    pid_of_tid = {}
+    running = {}
+    syscalls = {}
+    bios = {}
+
+    def pid_of(tid):
+        return pid_of_tid.get(tid, tid)
+
+    # Switch events carry the pid of the next thread, so collect them first.
+    for ts, type, cpu, tid, arg0, arg1 in events:
+        if type == EVENT_SCHED_SWITCH:
+            pid_of_tid[arg0] = arg1
+
+    for ts, type, cpu, tid, arg0, arg1 in events:
+        usec = to_usec(ts, start_ts, freq)
+
+        if type == EVENT_SCHED_SWITCH:
+            if cpu in running:
+                prev_tid, prev_usec = running[cpu]
+                trace.append({"name": "tid {0} (pid {1})".format(prev_tid, pid_of(prev_tid)), "ph": "X",
+                              "ts": prev_usec, "dur": usec - prev_usec, "pid": CPU_TRACK_PID, "tid": cpu})
+            running[cpu] = (arg0, usec)
+
+        elif type == EVENT_SCHED_WAKEUP:
+            trace.append({"name": "wakeup", "ph": "i", "s": "t", "ts": usec, "pid": pid_of(arg0), "tid": arg0,
+                          "args": {"blocker": arg1, "by": tid}})
+
+        elif type == EVENT_SYSCALL_ENTER:
+            syscalls[tid] = (arg0, usec)
+
+        elif type == EVENT_SYSCALL_EXIT:
+            if tid in syscalls:
+                sysid, enter_usec = syscalls.pop(tid)
+                name = syscall_names.get(sysid, "syscall {0}".format(sysid))
+                res = arg1 - (1 << 32) if arg1 >= (1 << 31) else arg1
+                trace.append({"name": name, "ph": "X", "ts": enter_usec, "dur": usec - enter_usec,
+                              "pid": pid_of(tid), "tid": tid, "args": {"result": res}})
+
+        elif type == EVENT_PAGE_FAULT:
+            trace.append({"name": "page fault", "ph": "i", "s": "t", "ts": usec, "pid": pid_of(tid), "tid": tid,
+                          "args": {"vaddr": hex(arg0), "info": arg1}})
+
+        elif type == EVENT_BIO_SUBMIT:
+            bios[cpu] = (arg0, arg1, usec)
+
+        elif type == EVENT_BIO_COMPLETE:
+            if cpu in bios:
+                sector, is_write, submit_usec = bios.pop(cpu)
+                trace.append({"name": "write" if is_write else "read", "ph": "X", "ts": submit_usec,
+                              "dur": usec - submit_usec, "pid": BIO_TRACK_PID, "tid": cpu,
+                              "args": {"sector": sector, "result": arg1}})
+
+        elif type == EVENT_IPC_SEND or type == EVENT_IPC_RECEIVE:
+            name = "ipc send" if type == EVENT_IPC_SEND else "ipc receive"
+            trace.append({"name": name, "ph": "i", "s": "t", "ts": usec, "pid": pid_of(tid), "tid": tid,
+                          "args": {"socket": hex(arg0), "len": arg1}})
+
+    trace.append({"name": "process_name", "ph": "M", "pid": CPU_TRACK_PID, "args": {"name": "CPUs"}})
+    trace.append({"name": "process_name", "ph": "M", "pid": BIO_TRACK_PID, "args": {"name": "Block I/O"}})
+    for pid in set(pid_of_tid.values()):
+        trace.append({"name": "process_name", "ph": "M", "pid": pid, "args": {"name": "pid {0}".format(pid)}})
+    return trace
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit("Usage: {0} <dump> [output.json]".format(sys.argv[0]))
+
+    events, start_ts, freq = read_dump(sys.argv[1])
+    trace = convert(events, start_ts, freq)
+    output = sys.argv[2] if len(sys.argv) > 2 else os.path.splitext(sys.argv[1])[0] + ".json"
+    with open(output, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ms"}, f)
+    print("{0} events, clock {1:.0f} Hz, written to {2}".format(len(events), freq, output))